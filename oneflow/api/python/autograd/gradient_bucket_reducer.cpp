@@ -0,0 +1,42 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/autograd/gradient_bucket_reducer.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+
+namespace py = pybind11;
+
+namespace oneflow {
+
+ONEFLOW_API_PYBIND11_MODULE("autograd", m) {
+  py::class_<one::GradientBucketStat>(m, "GradientBucketStat")
+      .def_readonly("param_num", &one::GradientBucketStat::param_num)
+      .def_readonly("byte_size", &one::GradientBucketStat::byte_size)
+      .def_readonly("wait_us", &one::GradientBucketStat::wait_us);
+
+  py::class_<one::GradientBucketReducer, std::shared_ptr<one::GradientBucketReducer>>(
+      m, "GradientBucketReducer")
+      .def(py::init([](const std::shared_ptr<one::TensorTuple>& params, int64_t bucket_byte_size) {
+        return one::GradientBucketReducer::New(*params, bucket_byte_size).GetPtrOrThrow();
+      }))
+      .def_property_readonly("bucket_num", &one::GradientBucketReducer::bucket_num)
+      .def("param_indices", &one::GradientBucketReducer::param_indices)
+      .def("bucket_stats", &one::GradientBucketReducer::bucket_stats);
+}
+
+}  // namespace oneflow
@@ -18,6 +18,7 @@ limitations under the License.
 #include <pybind11/stl.h>
 #include <functional>
 #include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/vm/vm_util.h"
 #include "oneflow/core/framework/instructions_builder.h"
 #include "oneflow/core/framework/tensor.h"
 
@@ -359,6 +360,10 @@ ONEFLOW_API_PYBIND11_MODULE("deprecated", m) {
         return DeprecatedPhysicalRun(Build).GetOrThrow();
       },
       py::call_guard<py::gil_scoped_release>());
+
+  m.def(
+      "FlushDeferredInstructions", []() { return vm::FlushDeferredInstructions().GetOrThrow(); },
+      py::call_guard<py::gil_scoped_release>());
 }
 
 }  // namespace oneflow
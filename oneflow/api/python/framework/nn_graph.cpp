@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/api/python/of_api_registry.h"
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/framework/nn_graph.h"
+#include "oneflow/core/job/plan_cache.h"
 #include "oneflow/core/job/runtime.h"
 #include "oneflow/core/register/blob.h"
 
@@ -48,6 +49,15 @@ ONEFLOW_API_PYBIND11_MODULE("nn.graph.", m) {
       .def("complie_and_init_runtime",
            [](NNGraph& graph) { return graph.CompileAndInitRuntime().GetOrThrow(); });
 
+  py::class_<PlanCacheStats>(m, "PlanCacheStats")
+      .def_readonly("hit_count", &PlanCacheStats::hit_count)
+      .def_readonly("miss_count", &PlanCacheStats::miss_count)
+      .def_readonly("invalid_count", &PlanCacheStats::invalid_count)
+      .def_readonly("compile_count", &PlanCacheStats::compile_count)
+      .def_readonly("compile_seconds", &PlanCacheStats::compile_seconds)
+      .def_readonly("load_seconds", &PlanCacheStats::load_seconds);
+  m.def("GetPlanCacheStats", &PlanCache::GetStats);
+
   m.def("RunLazyNNGraph",
         [](const one::TensorTuple& inputs, const one::TensorTuple& outputs,
            const one::TensorTuple& parameters, const std::shared_ptr<NNGraph>& nn_graph) {
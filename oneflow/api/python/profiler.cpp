@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/api/python/of_api_registry.h"
 
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/timeline.h"
 
 namespace py = pybind11;
 
@@ -30,6 +31,16 @@ ONEFLOW_API_PYBIND11_MODULE("profiler", m) {
   m.def("ProfilerStart", []() { profiler::ProfilerStart(); });
 
   m.def("ProfilerStop", []() { profiler::ProfilerStop(); });
+
+  m.def("TimelineStart", []() { profiler::TimelineStart(); });
+
+  m.def("TimelineStop", []() { profiler::TimelineStop(); });
+
+  m.def("TimelineClear", []() { profiler::TimelineClear(); });
+
+  m.def("TimelineChromeTraceJson", []() { return profiler::TimelineChromeTraceJson(); });
+
+  m.def("TimelineSummaryTable", []() { return profiler::TimelineSummaryTable(); });
 }
 
 }  // namespace oneflow
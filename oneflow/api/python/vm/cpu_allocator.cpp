@@ -0,0 +1,45 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/vm/cpu_allocator.h"
+#include "oneflow/core/common/global.h"
+
+namespace py = pybind11;
+
+namespace oneflow {
+namespace vm {
+
+ONEFLOW_API_PYBIND11_MODULE("vm", m) {
+  m.def("GetCpuAllocatorStat", []() {
+    const CpuAllocator::Stat stat = Global<CpuAllocator>::Get()->GetStat();
+    py::dict ret;
+    ret["allocate_cnt"] = stat.allocate_cnt;
+    ret["cache_hit_cnt"] = stat.cache_hit_cnt;
+    ret["os_allocate_cnt"] = stat.os_allocate_cnt;
+    ret["os_release_cnt"] = stat.os_release_cnt;
+    ret["os_bytes"] = stat.os_bytes;
+    ret["in_use_bytes"] = stat.in_use_bytes;
+    ret["requested_bytes"] = stat.requested_bytes;
+    ret["cached_bytes"] = stat.cached_bytes;
+    ret["hit_rate"] = stat.hit_rate();
+    ret["fragmentation"] = stat.fragmentation();
+    return ret;
+  });
+}
+
+}  // namespace vm
+}  // namespace oneflow
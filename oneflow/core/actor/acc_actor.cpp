@@ -35,15 +35,17 @@ class AccActor final : public Actor {
   std::function<void(DeviceCtx*, void* dst, const void* src, size_t)> cpy_func_;
   int32_t acc_cnt_;
   int32_t max_acc_cnt_;
+  int64_t in_regst_desc_id_;
+  int64_t out_regst_desc_id_;
 };
 
 void AccActor::VirtualActorInit(const TaskProto& proto) {
-  const Shape& in_time_shape = Global<RegstMgr>::Get()
-                                   ->RegstDesc4RegstDescId(Name2SoleRegstDescId("in"))
-                                   .data_regst_time_shape();
-  const Shape& out_time_shape = Global<RegstMgr>::Get()
-                                    ->RegstDesc4RegstDescId(Name2SoleRegstDescId("out"))
-                                    .data_regst_time_shape();
+  in_regst_desc_id_ = Name2SoleRegstDescId("in");
+  out_regst_desc_id_ = Name2SoleRegstDescId("out");
+  const Shape& in_time_shape =
+      Global<RegstMgr>::Get()->RegstDesc4RegstDescId(in_regst_desc_id_).data_regst_time_shape();
+  const Shape& out_time_shape =
+      Global<RegstMgr>::Get()->RegstDesc4RegstDescId(out_regst_desc_id_).data_regst_time_shape();
   CHECK_GE(in_time_shape.elem_cnt(), out_time_shape.elem_cnt());
   Init(proto, in_time_shape.elem_cnt() / out_time_shape.elem_cnt());
 }
@@ -65,8 +67,8 @@ void AccActor::Init(const TaskProto& task_proto, int32_t max_acc_cnt) {
 }
 
 void AccActor::Act() {
-  Regst* out_regst = GetNaiveCurWriteable("out");
-  Regst* in_regst = GetNaiveCurReadable("in");
+  Regst* out_regst = GetNaiveCurWriteable(out_regst_desc_id_);
+  Regst* in_regst = GetNaiveCurReadable(in_regst_desc_id_);
   if (acc_cnt_ == 0) {
     const Blob* in_blob = in_regst->GetMutSoleBlob();
     Blob* out_blob = out_regst->GetMutSoleBlob();
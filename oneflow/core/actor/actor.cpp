@@ -79,6 +79,7 @@ void Actor::Init(const JobDesc* job_desc, const TaskProto& task_proto,
   thrd_id_ = Global<IDMgr>::Get()->ThrdId4ActorId(actor_id_);
   job_id_ = task_proto.job_id();
   InitDeviceCtx(thread_ctx);
+  is_device_callback_inline_ = dynamic_cast<CpuDeviceCtx*>(device_ctx_.get()) != nullptr;
   if (task_proto.has_parallel_ctx()) {
     parallel_ctx_.reset(new ParallelContext(task_proto.parallel_ctx()));
   }
@@ -99,18 +100,14 @@ void Actor::Init(const JobDesc* job_desc, const TaskProto& task_proto,
   eord_regst_desc_ids_.clear();
 
   for (const auto& pair : task_proto.produced_regst_desc()) {
-    Global<RegstMgr>::Get()->NewRegsts(pair.second, [this](Regst* regst) {
-      produced_regsts_[regst->regst_desc_id()].emplace_back(regst);
-    });
+    Global<RegstMgr>::Get()->NewRegsts(pair.second,
+                                       [this](Regst* regst) { AddProducedRegst(regst); });
     int64_t regst_desc_id = pair.second.regst_desc_id();
     CHECK(name2regst_desc_id_.insert({pair.first, {regst_desc_id}}).second);
     if (pair.second.regst_desc_type().has_ctrl_regst_desc()) {
       produced_ctrl_regst_desc_ids_.insert(regst_desc_id);
     }
   }
-  for (const auto& pair : produced_regsts_) {
-    for (const auto& regst : pair.second) { produced_regst2reading_cnt_[regst.get()] = 0; }
-  }
 
   for (const auto& pair : task_proto.consumed_regst_desc_id()) {
     CHECK(name2regst_desc_id_.find(pair.first) == name2regst_desc_id_.end());
@@ -131,10 +128,53 @@ void Actor::Init(const JobDesc* job_desc, const TaskProto& task_proto,
   is_naive_consumed_eord_ = false;
   TakeOverNaiveConsumed(task_proto.consumed_regst_desc_id());
   TakeOverNaiveProduced(task_proto.produced_regst_desc());
+  InitRegstSlotIndexCache();
   InitBnInOp2BlobInfo(task_proto);
   VirtualActorInit(task_proto);
 }
 
+void Actor::AddProducedRegst(Regst* regst) {
+  const int64_t regst_desc_id = regst->regst_desc_id();
+  produced_regsts_[regst_desc_id].emplace_back(regst);
+  int64_t index = produced_regst_desc_id_index_.Find(regst_desc_id);
+  if (index == -1) {
+    index = produced_regst_desc_id_index_.Insert(regst_desc_id);
+    produced_index2regsts_.emplace_back();
+    produced_index2reading_cnts_.emplace_back();
+  }
+  produced_index2regsts_.at(index).push_back(regst);
+  produced_index2reading_cnts_.at(index).push_back(0);
+}
+
+void Actor::InitRegstSlotIndexCache() {
+  naive_consumed_index2is_ctrl_.resize(naive_consumed_rs_.total_regst_desc_cnt());
+  for (int64_t i = 0; i < naive_consumed_index2is_ctrl_.size(); ++i) {
+    naive_consumed_index2is_ctrl_[i] =
+        IsConsumedCtrlRegstDescId(naive_consumed_rs_.RegstDescId4Index(i));
+  }
+  naive_produced_index2is_ctrl_.resize(naive_produced_rs_.total_regst_desc_cnt());
+  for (int64_t i = 0; i < naive_produced_index2is_ctrl_.size(); ++i) {
+    naive_produced_index2is_ctrl_[i] =
+        IsProducedCtrlRegstDescId(naive_produced_rs_.RegstDescId4Index(i));
+  }
+  const int64_t inplace_cnt = inplace_consumed_rs_.total_regst_desc_cnt();
+  CHECK_EQ(inplace_cnt, inplace_produced_rs_.total_regst_desc_cnt());
+  inplace_consumed_index2no_out_consumed_.resize(inplace_cnt);
+  inplace_consumed_index2produced_index_.resize(inplace_cnt);
+  inplace_produced_index2consumed_index_.resize(inplace_cnt);
+  for (int64_t i = 0; i < inplace_cnt; ++i) {
+    const int64_t in_regst_desc_id = inplace_consumed_rs_.RegstDescId4Index(i);
+    inplace_consumed_index2no_out_consumed_[i] =
+        inplace_in_ids_with_no_out_consumed_.find(in_regst_desc_id)
+        != inplace_in_ids_with_no_out_consumed_.end();
+    const int64_t out_index = inplace_produced_rs_.Index4RegstDescId(
+        inplace_regst_desc_id_in2out_.at(in_regst_desc_id));
+    CHECK_NE(out_index, -1);
+    inplace_consumed_index2produced_index_[i] = out_index;
+    inplace_produced_index2consumed_index_[out_index] = i;
+  }
+}
+
 void Actor::TakeOverInplaceConsumedAndProduced(
     const PbMap<std::string, RegstDescProto>& produced_ids) {
   for (const auto& pair : produced_ids) {
@@ -261,12 +301,31 @@ const std::vector<int64_t>& Actor::Name2RegstDescIds(const std::string& name) co
   return name2regst_desc_id_.at(name);
 }
 
+bool Actor::FindProducedRegst(Regst* regst, int64_t* index, int64_t* pos) const {
+  *index = produced_regst_desc_id_index_.Find(regst->regst_desc_id());
+  if (*index == -1) { return false; }
+  const std::vector<Regst*>& regsts = produced_index2regsts_[*index];
+  for (int64_t i = 0; i < regsts.size(); ++i) {
+    if (regsts[i] == regst) {
+      *pos = i;
+      return true;
+    }
+  }
+  return false;
+}
+
 int64_t Actor::ReadingCnt4ProducedRegst(Regst* regst) const {
-  return produced_regst2reading_cnt_.at(regst);
+  int64_t index = -1;
+  int64_t pos = -1;
+  CHECK(FindProducedRegst(regst, &index, &pos));
+  return produced_index2reading_cnts_[index][pos];
 }
 
 void Actor::IncreaseReadingCnt4ProducedRegst(Regst* regst, int64_t val) {
-  produced_regst2reading_cnt_.at(regst) += val;
+  int64_t index = -1;
+  int64_t pos = -1;
+  CHECK(FindProducedRegst(regst, &index, &pos));
+  produced_index2reading_cnts_[index][pos] += val;
 }
 
 void Actor::InitDeviceCtx(const ThreadCtx& thread_ctx) {
@@ -299,18 +358,19 @@ int Actor::HandlerNormal(const ActorMsg& msg) {
   } else if (msg.msg_type() == ActorMsgType::kRegstMsg) {
     if (msg.SrcMachineId() == GlobalProcessCtx::Rank()) {
       Regst* regst = msg.regst();
-      if (naive_consumed_rs_.HasRegstDescId(regst->regst_desc_id())) {
-        CHECK_EQ(0, naive_consumed_rs_.TryPushBackRegst(regst));
-        const auto& rdeq = naive_consumed_rs_.RegstDeq4RegstDescId(regst->regst_desc_id());
-        CHECK(rdeq.empty() == false);
-        if (rdeq.front()->regst_desc()->regst_desc_type().has_data_regst_desc()) {
-          NormalProcessNaiveReadableDataRegstMsg(rdeq);
+      const int64_t regst_desc_id = regst->regst_desc_id();
+      int64_t index = naive_consumed_rs_.Index4RegstDescId(regst_desc_id);
+      if (index != -1) {
+        naive_consumed_rs_.PushBackRegst4Index(index, regst);
+        const RegstRing& ring = naive_consumed_rs_.RegstRing4Index(index);
+        if (ring.front()->regst_desc()->regst_desc_type().has_data_regst_desc()) {
+          NormalProcessNaiveReadableDataRegstMsg(ring);
         }
-      } else if (inplace_consumed_rs_.HasRegstDescId(regst->regst_desc_id())) {
-        CHECK_EQ(0, inplace_consumed_rs_.TryPushBackRegst(regst));
-        int64_t out_regst_desc_id = inplace_regst_desc_id_in2out_.at(regst->regst_desc_id());
-        CHECK(regst->GetSoleBlob()->dptr()
-              == inplace_produced_rs_.Front(out_regst_desc_id)->GetSoleBlob()->dptr());
+      } else if ((index = inplace_consumed_rs_.Index4RegstDescId(regst_desc_id)) != -1) {
+        inplace_consumed_rs_.PushBackRegst4Index(index, regst);
+        Regst* out_regst =
+            inplace_produced_rs_.Front4Index(inplace_consumed_index2produced_index_[index]);
+        CHECK(regst->GetSoleBlob()->dptr() == out_regst->GetSoleBlob()->dptr());
       } else if (TryUpdtStateAsProducedRegst(regst) == 0) {
         // do nothing
       } else {
@@ -410,21 +470,13 @@ void Actor::AsyncSendInplaceProducedRegstMsgToConsumer() {
 }
 
 void Actor::AsyncRetInplaceConsumedRegstIfNoConsumer() {
-  tmp_regst_desc_id_vec_.clear();
-  inplace_consumed_rs_.ForChosenRegstDeq(
-      [&](int64_t regst_desc_id) {
-        return inplace_in_ids_with_no_out_consumed_.find(regst_desc_id)
-               != inplace_in_ids_with_no_out_consumed_.end();
-      },
-      [&](const std::deque<Regst*>& deq) {
-        if (!deq.empty()) {
-          Regst* in_regst = deq.front();
-          CHECK(in_regst);
-          AsyncSendRegstMsgToProducer(in_regst);
-          tmp_regst_desc_id_vec_.push_back(in_regst->regst_desc_id());
-        }
-      });
-  inplace_consumed_rs_.PopFrontRegsts(tmp_regst_desc_id_vec_);
+  for (int64_t i = 0; i < inplace_consumed_index2no_out_consumed_.size(); ++i) {
+    if (!inplace_consumed_index2no_out_consumed_[i]) { continue; }
+    Regst* in_regst = inplace_consumed_rs_.Front4Index(i);
+    if (in_regst == nullptr) { continue; }
+    AsyncSendRegstMsgToProducer(in_regst);
+    inplace_consumed_rs_.PopFrontRegst4Index(i);
+  }
 }
 
 void Actor::VirtualAsyncSendInplaceProducedRegstMsgToConsumer() {
@@ -441,41 +493,37 @@ void Actor::VirtualAsyncSendNaiveConsumedRegstMsgToProducer() {
 }
 
 void Actor::AsyncSendConsumedCtrlRegstMsgToProducer() {
-  auto IsChosenRegstDescId = [this](int64_t regst_desc_id) {
-    return IsConsumedCtrlRegstDescId(regst_desc_id) && ConsumedCtrlRegstValid(regst_desc_id);
-  };
-
-  tmp_regst_desc_id_vec_.clear();
-  naive_consumed_rs_.ForChosenRegstDeq(
-      IsChosenRegstDescId, [&](int64_t regst_desc_id, const std::deque<Regst*>& reg_deq) {
-        CHECK(reg_deq.empty() == false);
-        auto producer_task_id = Global<RegstMgr>::Get()->ProducerTaskId4RegstDescId(regst_desc_id);
-        Regst* regst = reg_deq.front();
-        CHECK_GE(reg_deq.size(), 1);
-        // must access regst before sending it to producer
-        tmp_regst_desc_id_vec_.push_back(regst_desc_id);
-        EnqueueAsyncMsg(ActorMsg::BuildRegstMsgToProducer(actor_id_, producer_task_id, regst));
-      });
-  naive_consumed_rs_.PopFrontRegsts(tmp_regst_desc_id_vec_);
+  for (int64_t i = 0; i < naive_consumed_index2is_ctrl_.size(); ++i) {
+    if (!naive_consumed_index2is_ctrl_[i]) { continue; }
+    const int64_t regst_desc_id = naive_consumed_rs_.RegstDescId4Index(i);
+    if (!ConsumedCtrlRegstValid(regst_desc_id)) { continue; }
+    Regst* regst = naive_consumed_rs_.Front4Index(i);
+    CHECK(regst != nullptr);
+    auto producer_task_id = Global<RegstMgr>::Get()->ProducerTaskId4RegstDescId(regst_desc_id);
+    // must access regst before sending it to producer
+    naive_consumed_rs_.PopFrontRegst4Index(i);
+    EnqueueAsyncMsg(ActorMsg::BuildRegstMsgToProducer(actor_id_, producer_task_id, regst));
+  }
 }
 
 void Actor::AsyncSendProducedCtrlRegstMsgToConsumer() {
-  auto IsChosenRegstDescId = [this](int64_t regst_desc_id) {
-    return IsProducedCtrlRegstDescId(regst_desc_id) && ProducedCtrlRegstValid(regst_desc_id);
-  };
-
-  tmp_regst_desc_id_vec_.clear();
-  naive_produced_rs_.ForChosenFrontRegst(IsChosenRegstDescId, [&](Regst* regst) {
+  for (int64_t i = 0; i < naive_produced_index2is_ctrl_.size(); ++i) {
+    if (!naive_produced_index2is_ctrl_[i]) { continue; }
+    if (!ProducedCtrlRegstValid(naive_produced_rs_.RegstDescId4Index(i))) { continue; }
+    Regst* regst = naive_produced_rs_.Front4Index(i);
+    CHECK(regst != nullptr);
     CHECK(regst->regst_desc()->regst_desc_type().has_ctrl_regst_desc());
     int64_t real_consumer_cnt = HandleRegstToConsumer(regst);
-    if (real_consumer_cnt > 0) { tmp_regst_desc_id_vec_.push_back(regst->regst_desc_id()); }
-  });
-  naive_produced_rs_.PopFrontRegsts(tmp_regst_desc_id_vec_);
+    if (real_consumer_cnt > 0) { naive_produced_rs_.PopFrontRegst4Index(i); }
+  }
 }
 
 int64_t Actor::HandleRegstToConsumer(Regst* regst) {
-  auto regst_reading_cnt_it = produced_regst2reading_cnt_.find(regst);
-  CHECK_EQ(regst_reading_cnt_it->second, 0);
+  int64_t index = -1;
+  int64_t pos = -1;
+  CHECK(FindProducedRegst(regst, &index, &pos));
+  int64_t& reading_cnt = produced_index2reading_cnts_[index][pos];
+  CHECK_EQ(reading_cnt, 0);
 
   int64_t real_consumer_cnt = 0;
   for (int64_t consumer : regst->consumers_actor_id()) {
@@ -483,7 +531,7 @@ int64_t Actor::HandleRegstToConsumer(Regst* regst) {
     real_consumer_cnt += 1;
   }
   total_reading_cnt_ += real_consumer_cnt;
-  regst_reading_cnt_it->second += real_consumer_cnt;
+  reading_cnt += real_consumer_cnt;
   return real_consumer_cnt;
 }
 
@@ -530,38 +578,38 @@ void Actor::AsyncLaunchKernel() {
 }
 
 void Actor::HandleProducedNaiveDataRegstToConsumer() {
-  tmp_regst_desc_id_vec_.clear();
-  naive_produced_rs_.ForEachFrontRegst([&](Regst* regst) {
+  for (int64_t i = 0; i < naive_produced_rs_.total_regst_desc_cnt(); ++i) {
+    Regst* regst = naive_produced_rs_.Front4Index(i);
+    CHECK(regst != nullptr);
     if (regst->regst_desc()->regst_desc_type().has_data_regst_desc()) {
       int64_t real_consumer_cnt = HandleRegstToConsumer(regst);
-      if (real_consumer_cnt > 0) { tmp_regst_desc_id_vec_.push_back(regst->regst_desc_id()); }
+      if (real_consumer_cnt > 0) { naive_produced_rs_.PopFrontRegst4Index(i); }
     }
-  });
-  naive_produced_rs_.PopFrontRegsts(tmp_regst_desc_id_vec_);
+  }
 }
 
 void Actor::HandleProducedInplaceDataRegstToConsumer() {
-  tmp_regst_desc_id_vec_.clear();
-  inplace_produced_rs_.ForEachFrontRegst([&](Regst* regst) {
+  for (int64_t i = 0; i < inplace_produced_rs_.total_regst_desc_cnt(); ++i) {
+    Regst* regst = inplace_produced_rs_.Front4Index(i);
+    CHECK(regst != nullptr);
     CHECK(regst->regst_desc()->regst_desc_type().has_data_regst_desc());
     int64_t real_consumer_cnt = HandleRegstToConsumer(regst);
-    if (real_consumer_cnt > 0) { tmp_regst_desc_id_vec_.push_back(regst->regst_desc_id()); }
-  });
-  inplace_produced_rs_.PopFrontRegsts(tmp_regst_desc_id_vec_);
+    if (real_consumer_cnt > 0) { inplace_produced_rs_.PopFrontRegst4Index(i); }
+  }
 }
 
 void Actor::HandleConsumedNaiveDataRegstToProducer() {
-  tmp_regst_desc_id_vec_.clear();
-  naive_consumed_rs_.ForEachFrontRegst([&](int64_t regst_desc_id, Regst* regst) {
-    if (IsConsumedCtrlRegstDescId(regst_desc_id)) { return; }
+  for (int64_t i = 0; i < naive_consumed_index2is_ctrl_.size(); ++i) {
+    if (naive_consumed_index2is_ctrl_[i]) { continue; }
+    Regst* regst = naive_consumed_rs_.Front4Index(i);
+    CHECK(regst != nullptr);
     if (regst->regst_desc()->regst_desc_type().has_data_regst_desc()) {
       // must access regst before sending it to producer
-      tmp_regst_desc_id_vec_.push_back(regst->regst_desc_id());
+      naive_consumed_rs_.PopFrontRegst4Index(i);
       EnqueueAsyncMsg(
           ActorMsg::BuildRegstMsgToProducer(actor_id_, regst->producer_actor_id(), regst));
     }
-  });
-  naive_consumed_rs_.PopFrontRegsts(tmp_regst_desc_id_vec_);
+  }
 }
 
 void Actor::AsyncSendEORDMsgForAllProducedRegstDesc() {
@@ -596,20 +644,23 @@ Regst* Actor::GetSoleProducedRegst4RegstDescId(int64_t regst_desc_id) const {
 }
 
 int Actor::TryUpdtStateAsProducedRegst(Regst* regst) {
-  auto reading_cnt_it = produced_regst2reading_cnt_.find(regst);
-  if (reading_cnt_it == produced_regst2reading_cnt_.end()) { return -1; }
-  CHECK(produced_regsts_.find(regst->regst_desc_id()) != produced_regsts_.end());
-  CHECK_GE(reading_cnt_it->second, 1);
-  reading_cnt_it->second -= 1;
+  int64_t index = -1;
+  int64_t pos = -1;
+  if (!FindProducedRegst(regst, &index, &pos)) { return -1; }
+  int64_t& reading_cnt = produced_index2reading_cnts_[index][pos];
+  CHECK_GE(reading_cnt, 1);
+  reading_cnt -= 1;
   total_reading_cnt_ -= 1;
-  if (reading_cnt_it->second != 0) { return 0; }
+  if (reading_cnt != 0) { return 0; }
 
-  if (inplace_produced_rs_.TryPushBackRegst(regst) == 0) {
-    int64_t in_regst_desc_id = inplace_regst_desc_id_out2in_.at(regst->regst_desc_id());
-    Regst* in_regst = inplace_consumed_rs_.Front(in_regst_desc_id);
+  const int64_t out_index = inplace_produced_rs_.Index4RegstDescId(regst->regst_desc_id());
+  if (out_index != -1) {
+    inplace_produced_rs_.PushBackRegst4Index(out_index, regst);
+    const int64_t in_index = inplace_produced_index2consumed_index_[out_index];
+    Regst* in_regst = inplace_consumed_rs_.Front4Index(in_index);
     CHECK(in_regst);
     AsyncSendRegstMsgToProducer(in_regst);
-    CHECK_EQ(0, inplace_consumed_rs_.TryPopFrontRegst(in_regst_desc_id));
+    inplace_consumed_rs_.PopFrontRegst4Index(in_index);
   } else if (naive_produced_rs_.TryPushBackRegst(regst) != 0) {
     UpdtStateAsCustomizedProducedRegst(regst);
   }
@@ -646,8 +697,13 @@ Regst* Actor::GetNaiveCurWriteable(int64_t regst_desc_id) const {
 }
 
 void Actor::AsyncSendQueuedMsg() {
-  if (!async_msg_queue_.empty()) {
-    std::deque<ActorMsg> msgs;
+  if (async_msg_queue_.empty()) { return; }
+  if (is_device_callback_inline_) {
+    // cpu device ctx runs callbacks inline, skip packing the msgs into a closure
+    for (const ActorMsg& msg : async_msg_queue_) { Global<ActorMsgBus>::Get()->SendMsg(msg); }
+    async_msg_queue_.clear();
+  } else {
+    std::vector<ActorMsg> msgs;
     msgs.swap(async_msg_queue_);
     device_ctx_->AddCallBack([msgs]() {
       for (const ActorMsg& msg : msgs) { Global<ActorMsgBus>::Get()->SendMsg(msg); }
@@ -79,6 +79,7 @@ class Actor : public ActorBase {
 
   int64_t ReadingCnt4ProducedRegst(Regst* regst) const;
   void IncreaseReadingCnt4ProducedRegst(Regst* regst, int64_t val);
+  void AddProducedRegst(Regst* regst);
   void IncreaseTotalReadingCnt(int64_t val) { total_reading_cnt_ += val; }
 
   // Msg Handler
@@ -142,7 +143,7 @@ class Actor : public ActorBase {
   }
 
   // Process Msg
-  virtual void NormalProcessNaiveReadableDataRegstMsg(const std::deque<Regst*>&) {}
+  virtual void NormalProcessNaiveReadableDataRegstMsg(const RegstRing&) {}
   virtual bool NormalTryProcessReadableMsgFromOtherMachine(const ActorMsg&) { return false; }
   int TryUpdtStateAsProducedRegst(Regst* regst);
 
@@ -160,6 +161,9 @@ class Actor : public ActorBase {
   void TakeOverNaiveConsumed(const PbMap<std::string, RegstDescIdSet>& consumed_ids);
   void TakeOverNaiveProduced(const PbMap<std::string, RegstDescProto>& produced_ids);
   void InitBnInOp2BlobInfo(const TaskProto& task_proto);
+  void InitRegstSlotIndexCache();
+  // false: regst is not produced by this actor
+  bool FindProducedRegst(Regst* regst, int64_t* index, int64_t* pos) const;
 
   // Send Msgs
   void AsyncSendNaiveProducedRegstMsgToConsumer();
@@ -207,7 +211,11 @@ class Actor : public ActorBase {
   int64_t remaining_eord_cnt_;
 
   HashMap<int64_t, std::vector<std::unique_ptr<Regst>>> produced_regsts_;
-  HashMap<Regst*, int64_t> produced_regst2reading_cnt_;
+  // reading counts of produced regsts, indexed by the dense index of their regst desc and then
+  // by the position of the regst among the regsts of that desc
+  RegstDescIdIndex produced_regst_desc_id_index_;
+  std::vector<std::vector<Regst*>> produced_index2regsts_;
+  std::vector<std::vector<int64_t>> produced_index2reading_cnts_;
   int64_t total_reading_cnt_;
 
   RegstSlot naive_produced_rs_;
@@ -224,9 +232,16 @@ class Actor : public ActorBase {
   HashMap<int64_t, int64_t> inplace_regst_desc_id_in2out_;
   HashMap<int64_t, int64_t> inplace_regst_desc_id_out2in_;
 
-  std::deque<ActorMsg> async_msg_queue_;
+  // per slot index caches of the sets above, filled once the slots are inited
+  std::vector<bool> naive_consumed_index2is_ctrl_;
+  std::vector<bool> naive_produced_index2is_ctrl_;
+  std::vector<bool> inplace_consumed_index2no_out_consumed_;
+  std::vector<int64_t> inplace_consumed_index2produced_index_;
+  std::vector<int64_t> inplace_produced_index2consumed_index_;
+
+  std::vector<ActorMsg> async_msg_queue_;
   bool is_kernel_launch_synchronized_;
-  std::vector<int64_t> tmp_regst_desc_id_vec_;
+  bool is_device_callback_inline_;
 };
 
 }  // namespace oneflow
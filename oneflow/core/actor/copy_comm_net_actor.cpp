@@ -57,6 +57,7 @@ class CopyCommNetActor final : public Actor {
   CommNetDeviceCtx* comm_net_device_ctx_;
   int64_t next_sequence_number_;
   int64_t in_regst_desc_id_;
+  int64_t out_regst_desc_id_;
 };
 
 CopyCommNetActor::~CopyCommNetActor() { Global<CommNet>::Get()->DeleteActorReadId(actor_read_id_); }
@@ -81,6 +82,7 @@ void CopyCommNetActor::VirtualActorInit(const TaskProto& task_proto) {
   is_in_eord_ = false;
   next_sequence_number_ = 0;
   in_regst_desc_id_ = Name2SoleRegstDescId("copy_in");
+  out_regst_desc_id_ = Name2SoleRegstDescId("copy_out");
   OF_SET_MSG_HANDLER(&CopyCommNetActor::HandlerNormal);
 }
 
@@ -112,7 +114,7 @@ void CopyCommNetActor::Act() {
   int64_t src_actor_id = readable_it->second.producer;
   int64_t src_machine_id = Global<IDMgr>::Get()->MachineId4ActorId(src_actor_id);
   // writeable
-  Regst* writeable_regst = GetNaiveCurWriteable("copy_out");
+  Regst* writeable_regst = GetNaiveCurWriteable(out_regst_desc_id_);
   if (readable_it->second.has_sole_empty_blob) {
     // pass if regst dynamic body is emtpy
     Blob* data_blob = writeable_regst->GetMutSoleBlob();
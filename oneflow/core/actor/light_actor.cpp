@@ -638,10 +638,24 @@ ActorBase* TryNewLightActorWithoutInit(const TaskProto& task_proto, const Thread
       return NewLightActorWithKernel(task_proto, thread_ctx,
                                      NewDefaultDeviceCtx(task_proto, thread_ctx));
     }
-  } else if (task_proto.task_type() == TaskType::kCopyHd) {
+  } else if (task_proto.task_type() == TaskType::kCopyHd
+             || task_proto.task_type() == TaskType::kForeignInput
+             || task_proto.task_type() == TaskType::kForeignOutput
+             || task_proto.task_type() == TaskType::kDistributeConcat
+             || task_proto.task_type() == TaskType::kDistributeSplit
+             || task_proto.task_type() == TaskType::kSliceBoxing
+             || task_proto.task_type() == TaskType::kBoxingIdentity
+             || task_proto.task_type() == TaskType::kCollectiveBoxingPack
+             || task_proto.task_type() == TaskType::kCollectiveBoxingUnpack
+             || task_proto.task_type() == TaskType::kDecodeH2D) {
+    // task types run by NaiveActor
     return NewLightActorWithKernel(task_proto, thread_ctx,
                                    NewDefaultDeviceCtx(task_proto, thread_ctx));
-  } else if (task_proto.task_type() == TaskType::kTick) {
+  } else if (task_proto.task_type() == TaskType::kTick
+             || task_proto.task_type() == TaskType::kDeviceTick
+             || task_proto.task_type() == TaskType::kSrcSubsetTick
+             || task_proto.task_type() == TaskType::kDstSubsetTick) {
+    // task types run by TickActor
     return NewLightActorWithoutKernel(task_proto, thread_ctx,
                                       NewDefaultDeviceCtx(task_proto, thread_ctx));
   } else if (task_proto.task_type() == TaskType::kCollectiveBoxingGeneric) {
@@ -17,14 +17,34 @@ limitations under the License.
 
 namespace oneflow {
 
+int64_t RegstDescIdIndex::Insert(int64_t regst_desc_id) {
+  CHECK_EQ(Find(regst_desc_id), -1);
+  const int64_t index = index2regst_desc_id_.size();
+  index2regst_desc_id_.push_back(regst_desc_id);
+  if (index2regst_desc_id_.size() > kMaxLinearScanSize) {
+    if (regst_desc_id2index_.empty()) {
+      for (int64_t i = 0; i < index; ++i) { regst_desc_id2index_[index2regst_desc_id_[i]] = i; }
+    }
+    regst_desc_id2index_[regst_desc_id] = index;
+  }
+  return index;
+}
+
+void RegstRing::Grow() {
+  std::vector<Regst*> buf(buf_.size() * 2);
+  for (size_t i = 0; i < size_; ++i) { buf[i] = at(i); }
+  buf_.swap(buf);
+  head_ = 0;
+}
+
 bool RegstSlot::HasRegstDescId(int64_t regst_desc_id) const {
-  CHECK(is_inited_);
-  return regst_desc_id2regsts_.find(regst_desc_id) != regst_desc_id2regsts_.end();
+  return Index4RegstDescId(regst_desc_id) != -1;
 }
 
-const std::deque<Regst*>& RegstSlot::RegstDeq4RegstDescId(int64_t regst_desc_id) const {
-  CHECK(is_inited_);
-  return regst_desc_id2regsts_.at(regst_desc_id);
+const RegstRing& RegstSlot::RegstDeq4RegstDescId(int64_t regst_desc_id) const {
+  int64_t index = Index4RegstDescId(regst_desc_id);
+  CHECK_NE(index, -1);
+  return index2regsts_.at(index);
 }
 
 int RegstSlot::TryPushBackRegst(Regst* regst) {
@@ -32,21 +52,17 @@ int RegstSlot::TryPushBackRegst(Regst* regst) {
 }
 
 int RegstSlot::TryPushBackRegst(Regst* regst, int64_t regst_desc_id) {
-  CHECK(is_inited_);
-  auto it = regst_desc_id2regsts_.find(regst_desc_id);
-  if (it == regst_desc_id2regsts_.end()) { return -1; }
-  if (it->second.empty()) { available_regst_desc_cnt_ += 1; }
-  it->second.push_back(regst);
+  int64_t index = Index4RegstDescId(regst_desc_id);
+  if (index == -1) { return -1; }
+  PushBackRegst4Index(index, regst);
   return 0;
 }
 
 int RegstSlot::TryPopFrontRegst(int64_t regst_desc_id) {
-  CHECK(is_inited_);
-  auto it = regst_desc_id2regsts_.find(regst_desc_id);
-  if (it == regst_desc_id2regsts_.end()) { return -1; }
-  CHECK(it->second.empty() == false);
-  it->second.pop_front();
-  if (it->second.empty()) { available_regst_desc_cnt_ -= 1; }
+  int64_t index = Index4RegstDescId(regst_desc_id);
+  if (index == -1) { return -1; }
+  CHECK(index2regsts_.at(index).empty() == false);
+  PopFrontRegst4Index(index);
   return 0;
 }
 
@@ -57,31 +73,26 @@ void RegstSlot::PopFrontRegsts(const std::vector<int64_t>& regst_desc_ids) {
 
 void RegstSlot::InsertRegstDescId(int64_t regst_desc_id) {
   CHECK(is_inited_ == false);
-  CHECK(regst_desc_id2regsts_.emplace(regst_desc_id, std::deque<Regst*>()).second);
+  CHECK_EQ(regst_desc_id_index_.Insert(regst_desc_id), index2regsts_.size());
+  index2regsts_.emplace_back();
 }
 
 Regst* RegstSlot::Front(int64_t regst_desc_id) const {
-  CHECK(is_inited_);
-  auto it = regst_desc_id2regsts_.find(regst_desc_id);
-  if (it == regst_desc_id2regsts_.end()) { return nullptr; }
-  if (it->second.empty()) { return nullptr; }
-  return it->second.front();
+  int64_t index = Index4RegstDescId(regst_desc_id);
+  if (index == -1) { return nullptr; }
+  return Front4Index(index);
 }
 
 Regst* RegstSlot::SoleFront() const {
   CHECK(is_inited_);
   CHECK_EQ(1, total_regst_desc_cnt());
-  auto it = regst_desc_id2regsts_.begin();
-  if (it->second.empty()) { return nullptr; }
-  return it->second.front();
+  return Front4Index(0);
 }
 
 Regst* RegstSlot::FirstFront() const {
   CHECK(is_inited_);
   CHECK_GE(total_regst_desc_cnt(), 1);
-  auto it = regst_desc_id2regsts_.begin();
-  if (it->second.empty()) { return nullptr; }
-  return it->second.front();
+  return Front4Index(0);
 }
 
 void RegstSlot::InitedDone() {
@@ -91,10 +102,10 @@ void RegstSlot::InitedDone() {
 
 void RegstSlot::ForChosenFrontRegst(std::function<bool(int64_t)> IsChosenRegstDescId,
                                     std::function<void(Regst*)> Handler) const {
-  for (const auto& kv : regst_desc_id2regsts_) {
-    if (IsChosenRegstDescId(kv.first)) {
-      CHECK(kv.second.empty() == false);
-      Handler(kv.second.front());
+  for (int64_t i = 0; i < index2regsts_.size(); ++i) {
+    if (IsChosenRegstDescId(RegstDescId4Index(i))) {
+      CHECK(index2regsts_[i].empty() == false);
+      Handler(index2regsts_[i].front());
     }
   }
 }
@@ -102,40 +113,48 @@ void RegstSlot::ForChosenFrontRegst(std::function<bool(int64_t)> IsChosenRegstDe
 void RegstSlot::ForChosenFrontRegst(
     std::function<bool(int64_t)> IsChosenRegstDescId,
     std::function<void(int64_t regst_desc_id, Regst*)> Handler) const {
-  for (const auto& kv : regst_desc_id2regsts_) {
-    if (IsChosenRegstDescId(kv.first)) {
-      CHECK(kv.second.empty() == false);
-      Handler(kv.first, kv.second.front());
+  for (int64_t i = 0; i < index2regsts_.size(); ++i) {
+    const int64_t regst_desc_id = RegstDescId4Index(i);
+    if (IsChosenRegstDescId(regst_desc_id)) {
+      CHECK(index2regsts_[i].empty() == false);
+      Handler(regst_desc_id, index2regsts_[i].front());
     }
   }
 }
 
 void RegstSlot::ForChosenRegstDeq(std::function<bool(int64_t)> IsChosenRegstDescId,
-                                  std::function<void(const std::deque<Regst*>&)> Handler) const {
-  for (const auto& kv : regst_desc_id2regsts_) {
-    if (IsChosenRegstDescId(kv.first)) { Handler(kv.second); }
+                                  std::function<void(const RegstRing&)> Handler) const {
+  for (int64_t i = 0; i < index2regsts_.size(); ++i) {
+    if (IsChosenRegstDescId(RegstDescId4Index(i))) { Handler(index2regsts_[i]); }
   }
 }
 
 void RegstSlot::ForChosenRegstDeq(
     std::function<bool(int64_t)> IsChosenRegstDescId,
-    std::function<void(int64_t regst_desc_id, const std::deque<Regst*>&)> Handler) const {
-  for (const auto& kv : regst_desc_id2regsts_) {
-    if (IsChosenRegstDescId(kv.first)) { Handler(kv.first, kv.second); }
+    std::function<void(int64_t regst_desc_id, const RegstRing&)> Handler) const {
+  for (int64_t i = 0; i < index2regsts_.size(); ++i) {
+    const int64_t regst_desc_id = RegstDescId4Index(i);
+    if (IsChosenRegstDescId(regst_desc_id)) { Handler(regst_desc_id, index2regsts_[i]); }
   }
 }
 
 void RegstSlot::ForEachFrontRegst(std::function<void(Regst*)> Handler) const {
-  ForChosenFrontRegst([](int64_t) { return true; }, Handler);
+  for (const RegstRing& ring : index2regsts_) {
+    CHECK(ring.empty() == false);
+    Handler(ring.front());
+  }
 }
 
 void RegstSlot::ForEachFrontRegst(
     std::function<void(int64_t regst_desc_id, Regst*)> Handler) const {
-  ForChosenFrontRegst([](int64_t) { return true; }, Handler);
+  for (int64_t i = 0; i < index2regsts_.size(); ++i) {
+    CHECK(index2regsts_[i].empty() == false);
+    Handler(RegstDescId4Index(i), index2regsts_[i].front());
+  }
 }
 
-void RegstSlot::ForEachRegstDeq(std::function<void(const std::deque<Regst*>&)> Handler) const {
-  ForChosenRegstDeq([](int64_t) { return true; }, Handler);
+void RegstSlot::ForEachRegstDeq(std::function<void(const RegstRing&)> Handler) const {
+  for (const RegstRing& ring : index2regsts_) { Handler(ring); }
 }
 
 }  // namespace oneflow
@@ -20,30 +20,97 @@ limitations under the License.
 
 namespace oneflow {
 
+// Maps the regst desc ids an actor touches to dense indices [0, size). Actors rarely see more
+// than a handful of regst descs, so lookups scan a flat array and only fall back to hashing
+// beyond kMaxLinearScanSize entries.
+class RegstDescIdIndex final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(RegstDescIdIndex);
+  RegstDescIdIndex() = default;
+  ~RegstDescIdIndex() = default;
+
+  int64_t size() const { return index2regst_desc_id_.size(); }
+  int64_t RegstDescId4Index(int64_t index) const { return index2regst_desc_id_.at(index); }
+  // -1: cannot find regst_desc_id
+  int64_t Find(int64_t regst_desc_id) const {
+    if (index2regst_desc_id_.size() <= kMaxLinearScanSize) {
+      for (size_t i = 0; i < index2regst_desc_id_.size(); ++i) {
+        if (index2regst_desc_id_[i] == regst_desc_id) { return i; }
+      }
+      return -1;
+    }
+    auto it = regst_desc_id2index_.find(regst_desc_id);
+    return it == regst_desc_id2index_.end() ? -1 : it->second;
+  }
+  int64_t Insert(int64_t regst_desc_id);
+
+ private:
+  static constexpr size_t kMaxLinearScanSize = 8;
+
+  std::vector<int64_t> index2regst_desc_id_;
+  HashMap<int64_t, int64_t> regst_desc_id2index_;
+};
+
+// A growable FIFO of regsts backed by a power-of-two ring, used in place of std::deque so that
+// steady state push/pop never touches the allocator.
+class RegstRing final {
+ public:
+  RegstRing() : buf_(kInitCapacity), head_(0), size_(0) {}
+  ~RegstRing() = default;
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  Regst* front() const {
+    CHECK_GT(size_, 0);
+    return buf_[head_];
+  }
+  Regst* at(size_t i) const {
+    CHECK_LT(i, size_);
+    return buf_[(head_ + i) & (buf_.size() - 1)];
+  }
+  void push_back(Regst* regst) {
+    if (size_ == buf_.size()) { Grow(); }
+    buf_[(head_ + size_) & (buf_.size() - 1)] = regst;
+    size_ += 1;
+  }
+  void pop_front() {
+    CHECK_GT(size_, 0);
+    head_ = (head_ + 1) & (buf_.size() - 1);
+    size_ -= 1;
+  }
+
+ private:
+  static constexpr size_t kInitCapacity = 4;
+  void Grow();
+
+  std::vector<Regst*> buf_;
+  size_t head_;
+  size_t size_;
+};
+
 class RegstSlot final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(RegstSlot);
-  RegstSlot() : regst_desc_id2regsts_(), available_regst_desc_cnt_(0), is_inited_(false) {}
+  RegstSlot() : available_regst_desc_cnt_(0), is_inited_(false) {}
   ~RegstSlot() = default;
 
   bool is_inited() const { return is_inited_; }
-  size_t total_regst_desc_cnt() const { return regst_desc_id2regsts_.size(); }
+  size_t total_regst_desc_cnt() const { return index2regsts_.size(); }
   size_t available_regst_desc_cnt() const { return available_regst_desc_cnt_; }
 
   bool IsCurSlotReady() const { return available_regst_desc_cnt() == total_regst_desc_cnt(); }
   bool HasRegstDescId(int64_t regst_desc_id) const;
-  const std::deque<Regst*>& RegstDeq4RegstDescId(int64_t regst_desc_id) const;
+  const RegstRing& RegstDeq4RegstDescId(int64_t regst_desc_id) const;
   void ForEachFrontRegst(std::function<void(Regst*)>) const;
   void ForEachFrontRegst(std::function<void(int64_t regst_desc_id, Regst*)>) const;
-  void ForEachRegstDeq(std::function<void(const std::deque<Regst*>&)>) const;
+  void ForEachRegstDeq(std::function<void(const RegstRing&)>) const;
   void ForChosenFrontRegst(std::function<bool(int64_t)>, std::function<void(Regst*)>) const;
   void ForChosenFrontRegst(std::function<bool(int64_t)>,
                            std::function<void(int64_t regst_desc_id, Regst*)>) const;
   void ForChosenRegstDeq(std::function<bool(int64_t)>,
-                         std::function<void(const std::deque<Regst*>&)>) const;
-  void ForChosenRegstDeq(
-      std::function<bool(int64_t)>,
-      std::function<void(int64_t regst_desc_id, const std::deque<Regst*>&)>) const;
+                         std::function<void(const RegstRing&)>) const;
+  void ForChosenRegstDeq(std::function<bool(int64_t)>,
+                         std::function<void(int64_t regst_desc_id, const RegstRing&)>) const;
 
   Regst* Front(int64_t regst_desc_id) const;
   Regst* SoleFront() const;
@@ -56,11 +123,37 @@ class RegstSlot final {
 
   void PopFrontRegsts(const std::vector<int64_t>& regst_desc_ids);
 
+  // Dense index access, index in [0, total_regst_desc_cnt())
+  // -1: cannot find regst_desc_id
+  int64_t Index4RegstDescId(int64_t regst_desc_id) const {
+    CHECK(is_inited_);
+    return regst_desc_id_index_.Find(regst_desc_id);
+  }
+  int64_t RegstDescId4Index(int64_t index) const {
+    return regst_desc_id_index_.RegstDescId4Index(index);
+  }
+  const RegstRing& RegstRing4Index(int64_t index) const { return index2regsts_.at(index); }
+  Regst* Front4Index(int64_t index) const {
+    const RegstRing& ring = index2regsts_.at(index);
+    return ring.empty() ? nullptr : ring.front();
+  }
+  void PushBackRegst4Index(int64_t index, Regst* regst) {
+    RegstRing& ring = index2regsts_.at(index);
+    if (ring.empty()) { available_regst_desc_cnt_ += 1; }
+    ring.push_back(regst);
+  }
+  void PopFrontRegst4Index(int64_t index) {
+    RegstRing& ring = index2regsts_.at(index);
+    ring.pop_front();
+    if (ring.empty()) { available_regst_desc_cnt_ -= 1; }
+  }
+
   void InitedDone();
   void InsertRegstDescId(int64_t regst_desc_id);
 
  private:
-  HashMap<int64_t, std::deque<Regst*>> regst_desc_id2regsts_;
+  RegstDescIdIndex regst_desc_id_index_;
+  std::vector<RegstRing> index2regsts_;
   size_t available_regst_desc_cnt_;
   bool is_inited_;
 };
@@ -58,11 +58,9 @@ void RepeatActor::VirtualActorInit(const TaskProto& proto) {
     LOG(WARNING)
         << "RepeatActor has more than one consumed register. This will impact performance.";
   }
-  const int64_t out_regst_desc_id = out_regst_desc.regst_desc_id();
   for (int64_t i = 1; i < repeat_num_; ++i) {
-    Global<RegstMgr>::Get()->NewRegsts(out_regst_desc, [this, out_regst_desc_id](Regst* regst) {
-      produced_regsts_[out_regst_desc_id].emplace_back(regst);
-      produced_regst2reading_cnt_[regst] = 0;
+    Global<RegstMgr>::Get()->NewRegsts(out_regst_desc, [this](Regst* regst) {
+      AddProducedRegst(regst);
       naive_produced_rs_.TryPushBackRegst(regst);
     });
   }
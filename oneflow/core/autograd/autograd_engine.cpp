@@ -81,7 +81,45 @@ Maybe<void> AutogradEngine::RunBackwardAndSaveGrads4LeafTensorIf(const TensorTup
   JUST(CheckConsistentTensorsMeta(outputs));
   JUST(CheckConsistentTensorsMeta(out_grads));
   DisableCheckConsistentTensorMetaScope disable_meta_check;
-  return RunBackwardAndSaveGrads4LeafTensor(outputs, out_grads, retain_graph, create_graph);
+  BackwardPassGuard backward_pass_guard(this);
+  JUST(RunBackwardAndSaveGrads4LeafTensor(outputs, out_grads, retain_graph, create_graph));
+  JUST(RunBackwardFinalCallbacks());
+  backward_pass_guard.set_done();
+  return Maybe<void>::Ok();
+}
+
+// Drops the callbacks of a backward pass when it ends, running their abort callbacks unless the
+// pass got through all its final callbacks
+class AutogradEngine::BackwardPassGuard final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(BackwardPassGuard);
+  explicit BackwardPassGuard(AutogradEngine* engine) : engine_(engine), is_done_(false) {
+    engine_->backward_final_callbacks_.clear();
+    engine_->backward_abort_callbacks_.clear();
+  }
+  ~BackwardPassGuard() {
+    if (!is_done_) {
+      for (const auto& abort_callback : engine_->backward_abort_callbacks_) { abort_callback(); }
+    }
+    engine_->backward_final_callbacks_.clear();
+    engine_->backward_abort_callbacks_.clear();
+  }
+
+  void set_done() { is_done_ = true; }
+
+ private:
+  AutogradEngine* engine_;
+  bool is_done_;
+};
+
+Maybe<void> AutogradEngine::RunBackwardFinalCallbacks() {
+  // callbacks may queue further callbacks
+  while (!backward_final_callbacks_.empty()) {
+    std::vector<std::function<Maybe<void>()>> callbacks;
+    callbacks.swap(backward_final_callbacks_);
+    for (const auto& callback : callbacks) { JUST(callback()); }
+  }
+  return Maybe<void>::Ok();
 }
 
 Maybe<TensorTuple> AutogradEngine::RunBackwardAndReturnInputsTensorGradIf(
@@ -135,6 +173,7 @@ Maybe<void> FunctionNode::AccGrad4LeafTensor(bool create_graph) {
   for (const std::shared_ptr<AutogradMeta>& out : output_meta_datas_) {
     if (out->is_leaf() && out->requires_grad()) {
       JUST(CopyOrAccGrad(out.get(), /*autograd_mode=*/false));
+      for (const auto& hook : out->acc_grad_hooks()) { JUST(hook()); }
     }
   }
   return Maybe<void>::Ok();
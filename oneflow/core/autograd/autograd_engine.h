@@ -83,11 +83,23 @@ class AutogradEngine {
       const std::shared_ptr<
           const std::function<Maybe<void>(const TensorTuple&, TensorTuple*, bool)>>& backward_fn,
       const TensorTuple& inputs, TensorTuple* outputs) = 0;
+  // Queues a callback run once the running RunBackwardAndSaveGrads4LeafTensorIf has applied all
+  // its nodes, e.g. to flush the gradients that are still waiting in a reducer. If the backward
+  // pass or one of its final callbacks fails, abort_callback runs instead, so that whoever queued
+  // the callback can reset the state it keeps for the pass.
+  void QueueBackwardFinalCallback(const std::function<Maybe<void>()>& callback,
+                                  const std::function<void()>& abort_callback) {
+    backward_final_callbacks_.push_back(callback);
+    backward_abort_callbacks_.push_back(abort_callback);
+  }
 
  protected:
   AutogradEngine() = default;
 
  private:
+  class BackwardPassGuard;
+  Maybe<void> RunBackwardFinalCallbacks();
+
   virtual Maybe<void> RunBackwardAndSaveGrads4LeafTensor(const TensorTuple& outputs,
                                                          const TensorTuple& out_grads,
                                                          bool retain_graph, bool create_graph) = 0;
@@ -96,6 +108,10 @@ class AutogradEngine {
                                                                   const TensorTuple& out_grads,
                                                                   bool retain_graph,
                                                                   bool create_graph) = 0;
+
+  std::vector<std::function<Maybe<void>()>> backward_final_callbacks_;
+  // of every final callback queued in the running backward pass
+  std::vector<std::function<void()>> backward_abort_callbacks_;
 };
 
 // Stack Autograd Node and Engine
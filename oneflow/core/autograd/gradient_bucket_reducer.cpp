@@ -0,0 +1,179 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/autograd/gradient_bucket_reducer.h"
+#include "oneflow/core/autograd/autograd_engine.h"
+#include "oneflow/core/autograd/autograd_meta.h"
+#include "oneflow/core/autograd/autograd_mode.h"
+#include "oneflow/core/framework/device.h"
+#include "oneflow/core/framework/dtype.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/functional/functional.h"
+#include "oneflow/core/functional/scalar.h"
+#include "oneflow/core/job/rank_group_scope.h"
+
+namespace oneflow {
+namespace one {
+
+/*static*/ Maybe<GradientBucketReducer> GradientBucketReducer::New(const TensorTuple& params,
+                                                                   int64_t bucket_byte_size) {
+  CHECK_GT_OR_RETURN(bucket_byte_size, 0);
+  std::shared_ptr<GradientBucketReducer> reducer(
+      new GradientBucketReducer(params, bucket_byte_size));
+  JUST(reducer->InitBuckets());
+  JUST(reducer->RegisterAccGradHooks());
+  return reducer;
+}
+
+Maybe<void> GradientBucketReducer::InitBuckets() {
+  param_index2bucket_index_.assign(params_.size(), -1);
+  Symbol<Device> bucket_device;
+  Symbol<DType> bucket_dtype;
+  for (int64_t i = params_.size() - 1; i >= 0; --i) {
+    const auto& param = params_.at(i);
+    CHECK_OR_RETURN(param->is_local()) << "only local parameters can be reduced in buckets";
+    if (!param->requires_grad()) { continue; }
+    CHECK_OR_RETURN(param->is_leaf()) << "parameters must be leaf tensors";
+    const Symbol<Device> device = JUST(param->device());
+    const Symbol<DType> dtype = param->dtype();
+    const int64_t elem_cnt = param->shape()->elem_cnt();
+    const int64_t byte_size = elem_cnt * JUST(dtype->bytes());
+    // a bucket holds grads of the same device and data type
+    if (buckets_.empty() || device != bucket_device || dtype != bucket_dtype
+        || buckets_.back().byte_size + byte_size > bucket_byte_size_) {
+      buckets_.emplace_back(Bucket{{}, 0, 0, 0, {}});
+      bucket_device = device;
+      bucket_dtype = dtype;
+    }
+    Bucket* bucket = &buckets_.back();
+    bucket->param_indices.push_back(i);
+    bucket->elem_cnt += elem_cnt;
+    bucket->byte_size += byte_size;
+    param_index2bucket_index_.at(i) = buckets_.size() - 1;
+  }
+  ResetBackwardState();
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> GradientBucketReducer::RegisterAccGradHooks() {
+  const std::weak_ptr<GradientBucketReducer> weak_reducer = shared_from_this();
+  FOR_RANGE(int64_t, i, 0, params_.size()) {
+    if (param_index2bucket_index_.at(i) == -1) { continue; }
+    const auto& param = params_.at(i);
+    if (!param->grad_fn_node()) { JUST(AddAccumulateFunctionNode(param)); }
+    param->mut_autograd_meta()->add_acc_grad_hook([weak_reducer, i]() -> Maybe<void> {
+      const auto& reducer = weak_reducer.lock();
+      if (reducer) { JUST(reducer->MarkGradReady(i)); }
+      return Maybe<void>::Ok();
+    });
+  }
+  return Maybe<void>::Ok();
+}
+
+void GradientBucketReducer::ResetBackwardState() {
+  for (auto& bucket : buckets_) { bucket.pending_param_num = bucket.param_indices.size(); }
+  next_bucket_index_ = 0;
+  in_backward_ = false;
+}
+
+Maybe<void> GradientBucketReducer::MarkGradReady(int64_t param_index) {
+  if (!in_backward_) {
+    in_backward_ = true;
+    bucket_stats_.clear();
+    const std::weak_ptr<GradientBucketReducer> weak_reducer = shared_from_this();
+    GetThreadLocalAutogradEngine()->QueueBackwardFinalCallback(
+        [weak_reducer]() -> Maybe<void> {
+          const auto& reducer = weak_reducer.lock();
+          if (reducer) { JUST(reducer->FinalizeBackward()); }
+          return Maybe<void>::Ok();
+        },
+        // a failed backward pass leaves buckets half ready, the next pass starts over
+        [weak_reducer]() {
+          const auto& reducer = weak_reducer.lock();
+          if (reducer) { reducer->ResetBackwardState(); }
+        });
+  }
+  const int64_t bucket_index = param_index2bucket_index_.at(param_index);
+  Bucket* bucket = &buckets_.at(bucket_index);
+  // already launched in this backward pass
+  if (bucket_index < next_bucket_index_ || bucket->pending_param_num == 0) {
+    return Maybe<void>::Ok();
+  }
+  if (bucket->pending_param_num == bucket->param_indices.size()) {
+    bucket->first_ready_time = std::chrono::steady_clock::now();
+  }
+  bucket->pending_param_num -= 1;
+  // keeps the launching order the same on all ranks
+  while (next_bucket_index_ < buckets_.size()
+         && buckets_.at(next_bucket_index_).pending_param_num == 0) {
+    JUST(LaunchBucket(next_bucket_index_));
+    ++next_bucket_index_;
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> GradientBucketReducer::LaunchBucket(int64_t bucket_index) {
+  autograd::AutoGradMode mode(false);
+  const Bucket& bucket = buckets_.at(bucket_index);
+  const auto now = std::chrono::steady_clock::now();
+  const int64_t wait_us =
+      bucket.pending_param_num == bucket.param_indices.size()
+          ? 0
+          : std::chrono::duration_cast<std::chrono::microseconds>(now - bucket.first_ready_time)
+                .count();
+  bucket_stats_.emplace_back(GradientBucketStat{static_cast<int64_t>(bucket.param_indices.size()),
+                                                bucket.byte_size, wait_us});
+
+  TensorTuple flat_grads;
+  flat_grads.reserve(bucket.param_indices.size());
+  for (int64_t param_index : bucket.param_indices) {
+    const auto& param = params_.at(param_index);
+    std::shared_ptr<Tensor> grad = JUST(param->acc_grad());
+    // unused on this rank but maybe used on the others
+    if (!grad) { grad = JUST(functional::ZerosLike(param)); }
+    flat_grads.push_back(JUST(functional::Reshape(grad, Shape({param->shape()->elem_cnt()}))));
+  }
+  std::shared_ptr<Tensor> bucket_grad = flat_grads.at(0);
+  if (flat_grads.size() > 1) {
+    bucket_grad = JUST(functional::Concat(flat_grads, 0, bucket.elem_cnt));
+  }
+  const int64_t rank_num = JUST(RankGroupScope::CurrentRankGroup())->size();
+  bucket_grad = JUST(functional::ScalarMul(bucket_grad, functional::Scalar(1.0 / rank_num)));
+  bucket_grad = JUST(functional::LocalAllReduce(bucket_grad));
+
+  int64_t offset = 0;
+  for (int64_t param_index : bucket.param_indices) {
+    const auto& param = params_.at(param_index);
+    const int64_t elem_cnt = param->shape()->elem_cnt();
+    std::shared_ptr<Tensor> grad = bucket_grad;
+    if (bucket.param_indices.size() > 1) {
+      grad = JUST(functional::Narrow(bucket_grad, 0, offset, elem_cnt));
+    }
+    JUST(param->set_acc_grad(JUST(functional::Reshape(grad, *param->shape()))));
+    offset += elem_cnt;
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> GradientBucketReducer::FinalizeBackward() {
+  for (; next_bucket_index_ < buckets_.size(); ++next_bucket_index_) {
+    JUST(LaunchBucket(next_bucket_index_));
+  }
+  ResetBackwardState();
+  return Maybe<void>::Ok();
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_AUTOGRAD_GRADIENT_BUCKET_REDUCER_H_
+#define ONEFLOW_CORE_AUTOGRAD_GRADIENT_BUCKET_REDUCER_H_
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+
+namespace oneflow {
+namespace one {
+
+struct GradientBucketStat {
+  int64_t param_num;
+  int64_t byte_size;
+  // from the first grad of the bucket getting ready to the launch of its allreduce
+  int64_t wait_us;
+};
+
+// Averages the grads of data parallel parameters over the ranks of the current rank group during
+// the backward pass. The grads are packed into flat buckets of at most `bucket_byte_size' bytes
+// in the reversed order of `params', which is roughly the order their grads get ready. Once all
+// grads of a bucket are accumulated, the allreduce of the bucket is launched asynchronously, so
+// it overlaps with the rest of the backward pass. Buckets are launched in the same order on all
+// ranks, and the ones not full yet are launched when the backward pass ends.
+class GradientBucketReducer final : public std::enable_shared_from_this<GradientBucketReducer> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(GradientBucketReducer);
+  ~GradientBucketReducer() = default;
+
+  static Maybe<GradientBucketReducer> New(const TensorTuple& params, int64_t bucket_byte_size);
+
+  int64_t bucket_num() const { return buckets_.size(); }
+  const std::vector<int64_t>& param_indices(int64_t bucket_index) const {
+    return buckets_.at(bucket_index).param_indices;
+  }
+  // stats of the buckets in the last backward pass
+  const std::vector<GradientBucketStat>& bucket_stats() const { return bucket_stats_; }
+
+ private:
+  struct Bucket {
+    std::vector<int64_t> param_indices;
+    int64_t elem_cnt;
+    int64_t byte_size;
+    int64_t pending_param_num;
+    std::chrono::steady_clock::time_point first_ready_time;
+  };
+
+  GradientBucketReducer(const TensorTuple& params, int64_t bucket_byte_size)
+      : params_(params), bucket_byte_size_(bucket_byte_size), in_backward_(false) {}
+
+  Maybe<void> InitBuckets();
+  Maybe<void> RegisterAccGradHooks();
+  void ResetBackwardState();
+  Maybe<void> MarkGradReady(int64_t param_index);
+  Maybe<void> LaunchBucket(int64_t bucket_index);
+  Maybe<void> FinalizeBackward();
+
+  const TensorTuple params_;
+  const int64_t bucket_byte_size_;
+  std::vector<Bucket> buckets_;
+  std::vector<int64_t> param_index2bucket_index_;
+  std::vector<GradientBucketStat> bucket_stats_;
+  bool in_backward_;
+  int64_t next_bucket_index_;
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_AUTOGRAD_GRADIENT_BUCKET_REDUCER_H_
@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/ccl/ccl.h"
+#include "oneflow/core/ccl/cpu_collective_transport.h"
 #include "oneflow/core/device/nccl_util.h"
 #include "oneflow/core/framework/transport_util.h"
 #include "oneflow/core/job/parallel_desc.h"
@@ -81,6 +82,46 @@ Maybe<void> CpuBroadcast(const void* in, void* out, size_t buffer_size, int64_t
   return Maybe<void>::Ok();
 }
 
+template<>
+Maybe<void> AllReduce<DeviceType::kCPU>(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                                        ReduceType reduce_type, Symbol<ParallelDesc> parallel_desc,
+                                        DeviceCtx* ctx) {
+  CHECK_EQ_OR_RETURN(parallel_desc->device_type(), DeviceType::kCPU);
+  std::vector<int64_t> ranks;
+  int64_t rank_index = -1;
+  JUST(InitCollectiveRanks(*parallel_desc, &ranks, &rank_index));
+  const auto& transport_token = JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+  TransportTokenCollectiveTransport transport(ranks, rank_index, transport_token);
+  return CpuAllReduce(in, out, elem_cnt, dtype, reduce_type, &transport,
+                      CpuCollectiveChunkBytes());
+}
+
+template<>
+Maybe<void> ReduceScatter<DeviceType::kCPU>(const void* in, void* out, size_t elem_cnt,
+                                            DataType dtype, ReduceType reduce_type,
+                                            Symbol<ParallelDesc> parallel_desc, DeviceCtx* ctx) {
+  CHECK_EQ_OR_RETURN(parallel_desc->device_type(), DeviceType::kCPU);
+  std::vector<int64_t> ranks;
+  int64_t rank_index = -1;
+  JUST(InitCollectiveRanks(*parallel_desc, &ranks, &rank_index));
+  const auto& transport_token = JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+  TransportTokenCollectiveTransport transport(ranks, rank_index, transport_token);
+  return CpuReduceScatter(in, out, elem_cnt, dtype, reduce_type, &transport,
+                          CpuCollectiveChunkBytes());
+}
+
+template<>
+Maybe<void> AllGather<DeviceType::kCPU>(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                                        Symbol<ParallelDesc> parallel_desc, DeviceCtx* ctx) {
+  CHECK_EQ_OR_RETURN(parallel_desc->device_type(), DeviceType::kCPU);
+  std::vector<int64_t> ranks;
+  int64_t rank_index = -1;
+  JUST(InitCollectiveRanks(*parallel_desc, &ranks, &rank_index));
+  const auto& transport_token = JUST(TransportToken::NewTransportToken(kTransportTokenTypeData));
+  TransportTokenCollectiveTransport transport(ranks, rank_index, transport_token);
+  return CpuAllGather(in, out, elem_cnt, dtype, &transport, CpuCollectiveChunkBytes());
+}
+
 #ifdef WITH_CUDA
 std::pair<ncclComm_t, int64_t> RawGetNcclCommAndPeerNcclRank(int64_t peer_process_id) {
   std::set<std::pair<int64_t, int64_t>> device_set;
@@ -29,6 +29,12 @@ class TransportToken;
 // collective communication library
 namespace ccl {
 
+enum ReduceType {
+  kInvalidReduceType = 0,
+  kSum,
+  kMax,
+};
+
 template<DeviceType device_type>
 Maybe<void> Send(const void* in, size_t elem_cnt, DataType dtype, int64_t dst, DeviceCtx* ctx);
 
@@ -39,6 +45,22 @@ template<DeviceType device_type>
 Maybe<void> Broadcast(const void* in, void* out, size_t elem_cnt, DataType dtype, int64_t root,
                       Symbol<ParallelDesc> parallel_desc, DeviceCtx* ctx);
 
+// `elem_cnt' is the element count of `in' and `out'
+template<DeviceType device_type>
+Maybe<void> AllReduce(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                      ReduceType reduce_type, Symbol<ParallelDesc> parallel_desc, DeviceCtx* ctx);
+
+// `elem_cnt' is the element count of `out', `in' holds parallel_num times of it
+template<DeviceType device_type>
+Maybe<void> ReduceScatter(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                          ReduceType reduce_type, Symbol<ParallelDesc> parallel_desc,
+                          DeviceCtx* ctx);
+
+// `elem_cnt' is the element count of `in', `out' holds parallel_num times of it
+template<DeviceType device_type>
+Maybe<void> AllGather(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                      Symbol<ParallelDesc> parallel_desc, DeviceCtx* ctx);
+
 Maybe<void> CpuBroadcast(const void* in, void* out, size_t buffer_size, int64_t root,
                          Symbol<ParallelDesc> parallel_desc, const TransportToken& transport_token);
 
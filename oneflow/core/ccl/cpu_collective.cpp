@@ -0,0 +1,339 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <cstring>
+#include "oneflow/core/ccl/cpu_collective.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/common/spin_counter.h"
+#include "oneflow/core/framework/transport_util.h"
+
+namespace oneflow {
+
+namespace ccl {
+
+namespace {
+
+// out = lhs op rhs, out may alias lhs or rhs
+using ReduceFn = void (*)(const void* lhs, const void* rhs, void* out, size_t elem_cnt);
+
+template<typename T>
+void ReduceSum(const void* lhs, const void* rhs, void* out, size_t elem_cnt) {
+  const T* x = reinterpret_cast<const T*>(lhs);
+  const T* y = reinterpret_cast<const T*>(rhs);
+  T* z = reinterpret_cast<T*>(out);
+  for (size_t i = 0; i < elem_cnt; ++i) { z[i] = x[i] + y[i]; }
+}
+
+template<typename T>
+void ReduceMax(const void* lhs, const void* rhs, void* out, size_t elem_cnt) {
+  const T* x = reinterpret_cast<const T*>(lhs);
+  const T* y = reinterpret_cast<const T*>(rhs);
+  T* z = reinterpret_cast<T*>(out);
+  for (size_t i = 0; i < elem_cnt; ++i) { z[i] = std::max(x[i], y[i]); }
+}
+
+Maybe<ReduceFn> GetReduceFn(DataType dtype, ReduceType reduce_type) {
+#define MAKE_REDUCE_FN_ENTRY(type_cpp, type_proto)           \
+  {std::make_pair(type_proto, kSum), &ReduceSum<type_cpp>}, \
+      {std::make_pair(type_proto, kMax), &ReduceMax<type_cpp>},
+  static const HashMap<std::pair<DataType, ReduceType>, ReduceFn> reduce_fns{
+      OF_PP_FOR_EACH_TUPLE(MAKE_REDUCE_FN_ENTRY, ARITHMETIC_DATA_TYPE_SEQ)};
+#undef MAKE_REDUCE_FN_ENTRY
+  const auto& iter = reduce_fns.find(std::make_pair(dtype, reduce_type));
+  CHECK_OR_RETURN(iter != reduce_fns.end())
+      << "cpu collective does not support reducing data type " << dtype << " by " << reduce_type;
+  return iter->second;
+}
+
+size_t ChunkElemCnt(size_t chunk_bytes, size_t elem_size) {
+  return std::max<size_t>(chunk_bytes / elem_size, 1);
+}
+
+size_t TreeAllReduceMaxBytes() {
+  static const int64_t max_bytes =
+      ParseIntegerFromEnv("ONEFLOW_CCL_CPU_TREE_ALL_REDUCE_MAX_BYTES", 64 << 10);
+  return max_bytes;
+}
+
+// Segment i of the data is [offsets[i], offsets[i + 1]), segment indexes are taken modulo the
+// number of ranks. Every segment is handled in chunks of at most chunk_elem_cnt elements.
+class RingSegments final {
+ public:
+  RingSegments(std::vector<int64_t>&& offsets, size_t chunk_elem_cnt)
+      : offsets_(std::move(offsets)), chunk_elem_cnt_(chunk_elem_cnt), max_chunk_num_(0) {
+    FOR_RANGE(int64_t, i, 0, num()) {
+      max_chunk_num_ = std::max(max_chunk_num_, ChunkNum(ElemCnt(i)));
+    }
+  }
+
+  int64_t num() const { return offsets_.size() - 1; }
+  int64_t Begin(int64_t i) const { return offsets_.at(Index(i)); }
+  int64_t ElemCnt(int64_t i) const { return offsets_.at(Index(i) + 1) - offsets_.at(Index(i)); }
+  int64_t max_chunk_num() const { return max_chunk_num_; }
+  int64_t max_elem_cnt() const { return max_chunk_num_ * chunk_elem_cnt_; }
+
+  // Handler(chunk_id, offset in the segment, elem_cnt)
+  Maybe<void> ForEachChunk(int64_t i,
+                           const std::function<Maybe<void>(int64_t, int64_t, int64_t)>& Handler)
+      const {
+    const int64_t elem_cnt = ElemCnt(i);
+    FOR_RANGE(int64_t, chunk_id, 0, ChunkNum(elem_cnt)) {
+      const int64_t offset = chunk_id * chunk_elem_cnt_;
+      JUST(Handler(chunk_id, offset, std::min<int64_t>(chunk_elem_cnt_, elem_cnt - offset)));
+    }
+    return Maybe<void>::Ok();
+  }
+
+ private:
+  int64_t Index(int64_t i) const { return ((i % num()) + num()) % num(); }
+  int64_t ChunkNum(int64_t elem_cnt) const {
+    return (elem_cnt + chunk_elem_cnt_ - 1) / chunk_elem_cnt_;
+  }
+
+  const std::vector<int64_t> offsets_;
+  const int64_t chunk_elem_cnt_;
+  int64_t max_chunk_num_;
+};
+
+// Rank r ends up with segment r reduced over all ranks in `out'. At step s rank r sends its
+// partial result of segment r - s - 1 to the next rank and reduces segment r - s - 2 received
+// from the previous rank into a partial result, which it forwards at step s + 1.
+Maybe<void> RingReduceScatter(const char* in, char* out, const RingSegments& segments,
+                              size_t elem_size, ReduceFn Reduce,
+                              CpuCollectiveTransport* transport) {
+  const int64_t num_ranks = transport->num_ranks();
+  const int64_t rank = transport->rank_index();
+  CHECK_GE_OR_RETURN(num_ranks, 2);
+  CHECK_EQ_OR_RETURN(segments.num(), num_ranks);
+  const int64_t prev = (rank + num_ranks - 1) % num_ranks;
+  const int64_t next = (rank + 1) % num_ranks;
+  const int64_t max_chunk_num = segments.max_chunk_num();
+  const size_t buffer_size = segments.max_elem_cnt() * elem_size;
+  // partial results of odd and even steps, a buffer is received into at step s and sent from at
+  // step s + 1
+  std::vector<char> buffers(2 * buffer_size);
+  std::vector<std::atomic<int64_t>> recv_pending(2 * max_chunk_num);
+  // sends from the two buffers and from `in'
+  std::vector<std::atomic<int64_t>> send_pending(3);
+
+  const auto PostRecvs = [&](int64_t step) -> Maybe<void> {
+    const int64_t b = step % 2;
+    return segments.ForEachChunk(
+        rank - step - 2, [&](int64_t chunk_id, int64_t offset, int64_t elem_cnt) -> Maybe<void> {
+          return transport->AsyncRecv(prev, buffers.data() + b * buffer_size + offset * elem_size,
+                                      elem_cnt * elem_size,
+                                      &recv_pending.at(b * max_chunk_num + chunk_id));
+        });
+  };
+  JUST(segments.ForEachChunk(
+      rank - 1, [&](int64_t chunk_id, int64_t offset, int64_t elem_cnt) -> Maybe<void> {
+        return transport->AsyncSend(next, in + (segments.Begin(rank - 1) + offset) * elem_size,
+                                    elem_cnt * elem_size, &send_pending.at(2));
+      }));
+  JUST(PostRecvs(0));
+  FOR_RANGE(int64_t, step, 0, num_ranks - 1) {
+    const int64_t b = step % 2;
+    const bool is_last_step = (step == num_ranks - 2);
+    const int64_t segment = rank - step - 2;
+    if (!is_last_step) {
+      // the other buffer is still being sent from for this step
+      JUST(WaitUntilTransferDone(send_pending.at(1 - b)));
+      JUST(PostRecvs(step + 1));
+    }
+    JUST(segments.ForEachChunk(
+        segment, [&](int64_t chunk_id, int64_t offset, int64_t elem_cnt) -> Maybe<void> {
+          JUST(WaitUntilTransferDone(recv_pending.at(b * max_chunk_num + chunk_id)));
+          char* partial = buffers.data() + b * buffer_size + offset * elem_size;
+          char* reduced = is_last_step ? out + offset * elem_size : partial;
+          Reduce(in + (segments.Begin(segment) + offset) * elem_size, partial, reduced, elem_cnt);
+          if (!is_last_step) {
+            JUST(transport->AsyncSend(next, reduced, elem_cnt * elem_size, &send_pending.at(b)));
+          }
+          return Maybe<void>::Ok();
+        }));
+  }
+  for (const auto& pending : send_pending) { JUST(WaitUntilTransferDone(pending)); }
+  return Maybe<void>::Ok();
+}
+
+// Segment r of `out' is ready on rank r. At step s rank r forwards segment r - s to the next
+// rank and receives segment r - s - 1 from the previous one, right into `out'.
+Maybe<void> RingAllGather(char* out, const RingSegments& segments, size_t elem_size,
+                          CpuCollectiveTransport* transport) {
+  const int64_t num_ranks = transport->num_ranks();
+  const int64_t rank = transport->rank_index();
+  CHECK_GE_OR_RETURN(num_ranks, 2);
+  CHECK_EQ_OR_RETURN(segments.num(), num_ranks);
+  const int64_t prev = (rank + num_ranks - 1) % num_ranks;
+  const int64_t next = (rank + 1) % num_ranks;
+  const int64_t max_chunk_num = segments.max_chunk_num();
+  std::vector<std::atomic<int64_t>> recv_pending((num_ranks - 1) * max_chunk_num);
+  std::atomic<int64_t> send_pending(0);
+
+  // nothing is received into the same place twice, so all receives can be posted up front
+  FOR_RANGE(int64_t, step, 0, num_ranks - 1) {
+    const int64_t segment = rank - step - 1;
+    JUST(segments.ForEachChunk(
+        segment, [&](int64_t chunk_id, int64_t offset, int64_t elem_cnt) -> Maybe<void> {
+          return transport->AsyncRecv(prev, out + (segments.Begin(segment) + offset) * elem_size,
+                                      elem_cnt * elem_size,
+                                      &recv_pending.at(step * max_chunk_num + chunk_id));
+        }));
+  }
+  JUST(segments.ForEachChunk(
+      rank, [&](int64_t chunk_id, int64_t offset, int64_t elem_cnt) -> Maybe<void> {
+        return transport->AsyncSend(next, out + (segments.Begin(rank) + offset) * elem_size,
+                                    elem_cnt * elem_size, &send_pending);
+      }));
+  FOR_RANGE(int64_t, step, 0, num_ranks - 2) {
+    const int64_t segment = rank - step - 1;
+    JUST(segments.ForEachChunk(
+        segment, [&](int64_t chunk_id, int64_t offset, int64_t elem_cnt) -> Maybe<void> {
+          JUST(WaitUntilTransferDone(recv_pending.at(step * max_chunk_num + chunk_id)));
+          return transport->AsyncSend(next,
+                                      out + (segments.Begin(segment) + offset) * elem_size,
+                                      elem_cnt * elem_size, &send_pending);
+        }));
+  }
+  for (const auto& pending : recv_pending) { JUST(WaitUntilTransferDone(pending)); }
+  JUST(WaitUntilTransferDone(send_pending));
+  return Maybe<void>::Ok();
+}
+
+void CopyIfNotInplace(const void* in, void* out, size_t size) {
+  if (in != out) { std::memcpy(out, in, size); }
+}
+
+}  // namespace
+
+size_t CpuCollectiveChunkBytes() {
+  static const int64_t chunk_bytes = ParseIntegerFromEnv("ONEFLOW_CCL_CPU_CHUNK_BYTES", 1 << 20);
+  return chunk_bytes;
+}
+
+Maybe<void> WaitUntilTransferDone(const std::atomic<int64_t>& pending) {
+  return SpinWaitUntilTimeout([&] { return pending.load() > 0; }, TransportUtil::TimeoutSeconds());
+}
+
+Maybe<void> CpuRingAllReduce(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                             ReduceType reduce_type, CpuCollectiveTransport* transport,
+                             size_t chunk_bytes) {
+  const size_t elem_size = GetSizeOfDataType(dtype);
+  const int64_t num_ranks = transport->num_ranks();
+  if (elem_cnt == 0) { return Maybe<void>::Ok(); }
+  if (num_ranks == 1) {
+    CopyIfNotInplace(in, out, elem_cnt * elem_size);
+    return Maybe<void>::Ok();
+  }
+  const auto& Reduce = JUST(GetReduceFn(dtype, reduce_type));
+  BalancedSplitter bs(elem_cnt, num_ranks);
+  std::vector<int64_t> offsets(num_ranks + 1);
+  FOR_RANGE(int64_t, i, 0, num_ranks) { offsets.at(i) = bs.At(i).begin(); }
+  offsets.at(num_ranks) = elem_cnt;
+  const RingSegments segments(std::move(offsets), ChunkElemCnt(chunk_bytes, elem_size));
+  char* out_ptr = reinterpret_cast<char*>(out);
+  char* out_segment = out_ptr + segments.Begin(transport->rank_index()) * elem_size;
+  JUST(RingReduceScatter(reinterpret_cast<const char*>(in), out_segment, segments, elem_size,
+                         Reduce, transport));
+  JUST(RingAllGather(out_ptr, segments, elem_size, transport));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CpuTreeAllReduce(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                             ReduceType reduce_type, CpuCollectiveTransport* transport) {
+  const size_t size = elem_cnt * GetSizeOfDataType(dtype);
+  const int64_t num_ranks = transport->num_ranks();
+  const int64_t rank = transport->rank_index();
+  if (elem_cnt == 0) { return Maybe<void>::Ok(); }
+  CopyIfNotInplace(in, out, size);
+  if (num_ranks == 1) { return Maybe<void>::Ok(); }
+  const auto& Reduce = JUST(GetReduceFn(dtype, reduce_type));
+  const int64_t children[2] = {rank * 2 + 1, rank * 2 + 2};
+  std::vector<char> child_buffers(2 * size);
+  std::vector<std::atomic<int64_t>> recv_pending(2);
+  std::atomic<int64_t> send_pending(0);
+  FOR_RANGE(int64_t, i, 0, 2) {
+    if (children[i] >= num_ranks) { continue; }
+    JUST(transport->AsyncRecv(children[i], child_buffers.data() + i * size, size,
+                              &recv_pending.at(i)));
+  }
+  FOR_RANGE(int64_t, i, 0, 2) {
+    if (children[i] >= num_ranks) { continue; }
+    JUST(WaitUntilTransferDone(recv_pending.at(i)));
+    Reduce(child_buffers.data() + i * size, out, out, elem_cnt);
+  }
+  if (rank > 0) {
+    const int64_t parent = (rank - 1) / 2;
+    JUST(transport->AsyncSend(parent, out, size, &send_pending));
+    JUST(WaitUntilTransferDone(send_pending));
+    JUST(transport->AsyncRecv(parent, out, size, &recv_pending.at(0)));
+    JUST(WaitUntilTransferDone(recv_pending.at(0)));
+  }
+  FOR_RANGE(int64_t, i, 0, 2) {
+    if (children[i] >= num_ranks) { continue; }
+    JUST(transport->AsyncSend(children[i], out, size, &send_pending));
+  }
+  JUST(WaitUntilTransferDone(send_pending));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CpuAllReduce(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                         ReduceType reduce_type, CpuCollectiveTransport* transport,
+                         size_t chunk_bytes) {
+  if (elem_cnt * GetSizeOfDataType(dtype) <= TreeAllReduceMaxBytes()) {
+    return CpuTreeAllReduce(in, out, elem_cnt, dtype, reduce_type, transport);
+  } else {
+    return CpuRingAllReduce(in, out, elem_cnt, dtype, reduce_type, transport, chunk_bytes);
+  }
+}
+
+Maybe<void> CpuReduceScatter(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                             ReduceType reduce_type, CpuCollectiveTransport* transport,
+                             size_t chunk_bytes) {
+  const size_t elem_size = GetSizeOfDataType(dtype);
+  const int64_t num_ranks = transport->num_ranks();
+  if (elem_cnt == 0) { return Maybe<void>::Ok(); }
+  if (num_ranks == 1) {
+    CopyIfNotInplace(in, out, elem_cnt * elem_size);
+    return Maybe<void>::Ok();
+  }
+  const auto& Reduce = JUST(GetReduceFn(dtype, reduce_type));
+  std::vector<int64_t> offsets(num_ranks + 1);
+  FOR_RANGE(int64_t, i, 0, num_ranks + 1) { offsets.at(i) = i * elem_cnt; }
+  const RingSegments segments(std::move(offsets), ChunkElemCnt(chunk_bytes, elem_size));
+  return RingReduceScatter(reinterpret_cast<const char*>(in), reinterpret_cast<char*>(out),
+                           segments, elem_size, Reduce, transport);
+}
+
+Maybe<void> CpuAllGather(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                         CpuCollectiveTransport* transport, size_t chunk_bytes) {
+  const size_t elem_size = GetSizeOfDataType(dtype);
+  const int64_t num_ranks = transport->num_ranks();
+  if (elem_cnt == 0) { return Maybe<void>::Ok(); }
+  char* out_ptr = reinterpret_cast<char*>(out);
+  CopyIfNotInplace(in, out_ptr + transport->rank_index() * elem_cnt * elem_size,
+                   elem_cnt * elem_size);
+  if (num_ranks == 1) { return Maybe<void>::Ok(); }
+  std::vector<int64_t> offsets(num_ranks + 1);
+  FOR_RANGE(int64_t, i, 0, num_ranks + 1) { offsets.at(i) = i * elem_cnt; }
+  const RingSegments segments(std::move(offsets), ChunkElemCnt(chunk_bytes, elem_size));
+  return RingAllGather(out_ptr, segments, elem_size, transport);
+}
+
+}  // namespace ccl
+
+}  // namespace oneflow
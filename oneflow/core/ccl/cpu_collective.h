@@ -0,0 +1,84 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_CCL_CPU_COLLECTIVE_H_
+#define ONEFLOW_CORE_CCL_CPU_COLLECTIVE_H_
+
+#include <atomic>
+#include "oneflow/core/ccl/ccl.h"
+#include "oneflow/core/common/maybe.h"
+
+namespace oneflow {
+
+namespace ccl {
+
+// Moves the bytes of a CPU collective between its ranks, which are addressed by their index in
+// [0, num_ranks). Transfers are asynchronous: `pending' is incremented when a transfer is posted
+// and decremented when it is done. Transfers between the same pair of ranks are matched in the
+// order they are posted on both sides.
+class CpuCollectiveTransport {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(CpuCollectiveTransport);
+  CpuCollectiveTransport(int64_t num_ranks, int64_t rank_index)
+      : num_ranks_(num_ranks), rank_index_(rank_index) {}
+  virtual ~CpuCollectiveTransport() = default;
+
+  int64_t num_ranks() const { return num_ranks_; }
+  int64_t rank_index() const { return rank_index_; }
+
+  virtual Maybe<void> AsyncSend(int64_t peer_index, const void* ptr, size_t size,
+                                std::atomic<int64_t>* pending) = 0;
+  virtual Maybe<void> AsyncRecv(int64_t peer_index, void* ptr, size_t size,
+                                std::atomic<int64_t>* pending) = 0;
+
+ private:
+  const int64_t num_ranks_;
+  const int64_t rank_index_;
+};
+
+Maybe<void> WaitUntilTransferDone(const std::atomic<int64_t>& pending);
+
+// ONEFLOW_CCL_CPU_CHUNK_BYTES, default 1MB
+size_t CpuCollectiveChunkBytes();
+
+// Ring algorithms split the data into one segment per rank and the segments into chunks of
+// `chunk_bytes'. A chunk is reduced and forwarded as soon as it arrives, so the reduction overlaps
+// with the transfer of the following chunks.
+Maybe<void> CpuRingAllReduce(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                             ReduceType reduce_type, CpuCollectiveTransport* transport,
+                             size_t chunk_bytes);
+// The tree algorithm reduces up a binary heap of the ranks and broadcasts down again, it takes
+// 2 * log2(num_ranks) hops instead of 2 * (num_ranks - 1) and suits small data.
+Maybe<void> CpuTreeAllReduce(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                             ReduceType reduce_type, CpuCollectiveTransport* transport);
+
+// Uses the tree algorithm up to ONEFLOW_CCL_CPU_TREE_ALL_REDUCE_MAX_BYTES (default 64KB) and the
+// ring algorithm above it.
+Maybe<void> CpuAllReduce(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                         ReduceType reduce_type, CpuCollectiveTransport* transport,
+                         size_t chunk_bytes);
+// `elem_cnt' is the element count of `out', `in' holds num_ranks times of it
+Maybe<void> CpuReduceScatter(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                             ReduceType reduce_type, CpuCollectiveTransport* transport,
+                             size_t chunk_bytes);
+// `elem_cnt' is the element count of `in', `out' holds num_ranks times of it
+Maybe<void> CpuAllGather(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                         CpuCollectiveTransport* transport, size_t chunk_bytes);
+
+}  // namespace ccl
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_CCL_CPU_COLLECTIVE_H_
@@ -0,0 +1,235 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "oneflow/core/ccl/cpu_collective.h"
+#include "oneflow/core/common/cpu_test_util.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace ccl {
+namespace test {
+
+namespace {
+
+// small chunks so that every segment of the tests below is pipelined
+constexpr size_t kChunkBytes = 16384;
+
+// Matches the posted sends and receives of every pair of ranks in order and copies in process
+class LoopbackNetwork final {
+ public:
+  explicit LoopbackNetwork(int64_t num_ranks)
+      : num_ranks_(num_ranks), channels_(num_ranks * num_ranks) {}
+
+  int64_t num_ranks() const { return num_ranks_; }
+
+  void PostSend(int64_t src, int64_t dst, const void* ptr, size_t size,
+                std::atomic<int64_t>* pending) {
+    Channel* channel = &channels_.at(src * num_ranks_ + dst);
+    std::unique_lock<std::mutex> lock(channel->mutex);
+    channel->sends.push_back(Transfer{const_cast<void*>(ptr), size, pending});
+    TryMatch(channel);
+  }
+
+  void PostRecv(int64_t src, int64_t dst, void* ptr, size_t size,
+                std::atomic<int64_t>* pending) {
+    Channel* channel = &channels_.at(src * num_ranks_ + dst);
+    std::unique_lock<std::mutex> lock(channel->mutex);
+    channel->recvs.push_back(Transfer{ptr, size, pending});
+    TryMatch(channel);
+  }
+
+ private:
+  struct Transfer {
+    void* ptr;
+    size_t size;
+    std::atomic<int64_t>* pending;
+  };
+  struct Channel {
+    std::mutex mutex;
+    std::deque<Transfer> sends;
+    std::deque<Transfer> recvs;
+  };
+
+  void TryMatch(Channel* channel) {
+    while (!channel->sends.empty() && !channel->recvs.empty()) {
+      const Transfer send = channel->sends.front();
+      const Transfer recv = channel->recvs.front();
+      channel->sends.pop_front();
+      channel->recvs.pop_front();
+      CHECK_LE(send.size, recv.size);
+      std::memcpy(recv.ptr, send.ptr, send.size);
+      --*send.pending;
+      --*recv.pending;
+    }
+  }
+
+  const int64_t num_ranks_;
+  std::vector<Channel> channels_;
+};
+
+class LoopbackTransport final : public CpuCollectiveTransport {
+ public:
+  LoopbackTransport(LoopbackNetwork* network, int64_t rank_index)
+      : CpuCollectiveTransport(network->num_ranks(), rank_index), network_(network) {}
+  ~LoopbackTransport() override = default;
+
+  Maybe<void> AsyncSend(int64_t peer_index, const void* ptr, size_t size,
+                        std::atomic<int64_t>* pending) override {
+    ++*pending;
+    network_->PostSend(rank_index(), peer_index, ptr, size, pending);
+    return Maybe<void>::Ok();
+  }
+  Maybe<void> AsyncRecv(int64_t peer_index, void* ptr, size_t size,
+                        std::atomic<int64_t>* pending) override {
+    ++*pending;
+    network_->PostRecv(peer_index, rank_index(), ptr, size, pending);
+    return Maybe<void>::Ok();
+  }
+
+ private:
+  LoopbackNetwork* network_;
+};
+
+// Runs Collective(transport) on num_ranks threads, one per rank
+void RunOnRanks(int64_t num_ranks,
+                const std::function<Maybe<void>(CpuCollectiveTransport*)>& Collective) {
+  LoopbackNetwork network(num_ranks);
+  std::vector<std::thread> threads;
+  FOR_RANGE(int64_t, rank, 0, num_ranks) {
+    threads.emplace_back([&network, &Collective, rank]() {
+      LoopbackTransport transport(&network, rank);
+      ASSERT_TRUE(Collective(&transport).IsOk());
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+}
+
+// element i of rank r
+int64_t Value(int64_t rank, int64_t i) { return (rank + 1) * 1000003 + i * 7 % 1013; }
+
+using AllReduceFn = std::function<Maybe<void>(const void*, void*, size_t, DataType, ReduceType,
+                                                CpuCollectiveTransport*)>;
+
+Maybe<void> RingAllReduce(const void* in, void* out, size_t elem_cnt, DataType dtype,
+                          ReduceType reduce_type, CpuCollectiveTransport* transport) {
+  return CpuRingAllReduce(in, out, elem_cnt, dtype, reduce_type, transport, kChunkBytes);
+}
+
+void TestAllReduce(const AllReduceFn& AllReduce, ReduceType reduce_type, bool inplace) {
+  for (int64_t num_ranks : {1, 2, 3, 5}) {
+    for (int64_t elem_cnt : {0, 1, 3, 4099, 20011}) {
+      std::vector<std::vector<int64_t>> ins(num_ranks, std::vector<int64_t>(elem_cnt));
+      std::vector<std::vector<int64_t>> outs(num_ranks, std::vector<int64_t>(elem_cnt));
+      std::vector<int64_t> expected(elem_cnt);
+      FOR_RANGE(int64_t, i, 0, elem_cnt) {
+        FOR_RANGE(int64_t, rank, 0, num_ranks) {
+          ins.at(rank).at(i) = Value(rank, i);
+          expected.at(i) = (rank == 0) ? Value(rank, i)
+                           : (reduce_type == kSum) ? expected.at(i) + Value(rank, i)
+                                                   : std::max(expected.at(i), Value(rank, i));
+        }
+      }
+      RunOnRanks(num_ranks, [&](CpuCollectiveTransport* transport) -> Maybe<void> {
+        const int64_t rank = transport->rank_index();
+        int64_t* out = inplace ? ins.at(rank).data() : outs.at(rank).data();
+        return AllReduce(ins.at(rank).data(), out, elem_cnt, DataType::kInt64, reduce_type,
+                         transport);
+      });
+      FOR_RANGE(int64_t, rank, 0, num_ranks) {
+        ASSERT_EQ(inplace ? ins.at(rank) : outs.at(rank), expected)
+            << "num_ranks " << num_ranks << ", elem_cnt " << elem_cnt << ", rank " << rank;
+      }
+    }
+  }
+}
+
+double BenchmarkAllReduce(const AllReduceFn& AllReduce, int64_t num_ranks, int64_t elem_cnt) {
+  std::vector<std::vector<float>> ins(num_ranks, std::vector<float>(elem_cnt, 1));
+  std::vector<std::vector<float>> outs(num_ranks, std::vector<float>(elem_cnt));
+  const int64_t iter_num = 5;
+  const double ms = oneflow::test::MeasureMs([&]() {
+    FOR_RANGE(int64_t, iter, 0, iter_num) {
+      RunOnRanks(num_ranks, [&](CpuCollectiveTransport* transport) -> Maybe<void> {
+        const int64_t rank = transport->rank_index();
+        return AllReduce(ins.at(rank).data(), outs.at(rank).data(), elem_cnt, DataType::kFloat,
+                         kSum, transport);
+      });
+    }
+  });
+  const double seconds = ms / 1e3 / iter_num;
+  return elem_cnt * sizeof(float) / seconds / 1e9;
+}
+
+}  // namespace
+
+TEST(CpuCollective, ring_all_reduce) {
+  TestAllReduce(&RingAllReduce, kSum, false);
+  TestAllReduce(&RingAllReduce, kMax, false);
+  TestAllReduce(&RingAllReduce, kSum, true);
+}
+
+TEST(CpuCollective, tree_all_reduce) {
+  TestAllReduce(&CpuTreeAllReduce, kSum, false);
+  TestAllReduce(&CpuTreeAllReduce, kMax, true);
+}
+
+TEST(CpuCollective, reduce_scatter_and_all_gather) {
+  for (int64_t num_ranks : {1, 2, 4}) {
+    for (int64_t elem_cnt : {0, 1, 5003}) {
+      std::vector<std::vector<int64_t>> ins(num_ranks,
+                                            std::vector<int64_t>(elem_cnt * num_ranks));
+      std::vector<std::vector<int64_t>> scattered(num_ranks, std::vector<int64_t>(elem_cnt));
+      std::vector<std::vector<int64_t>> gathered(num_ranks,
+                                                 std::vector<int64_t>(elem_cnt * num_ranks));
+      std::vector<int64_t> expected(elem_cnt * num_ranks, 0);
+      FOR_RANGE(int64_t, rank, 0, num_ranks) {
+        FOR_RANGE(int64_t, i, 0, elem_cnt * num_ranks) {
+          ins.at(rank).at(i) = Value(rank, i);
+          expected.at(i) += Value(rank, i);
+        }
+      }
+      RunOnRanks(num_ranks, [&](CpuCollectiveTransport* transport) -> Maybe<void> {
+        const int64_t rank = transport->rank_index();
+        JUST(CpuReduceScatter(ins.at(rank).data(), scattered.at(rank).data(), elem_cnt,
+                              DataType::kInt64, kSum, transport, kChunkBytes));
+        return CpuAllGather(scattered.at(rank).data(), gathered.at(rank).data(), elem_cnt,
+                            DataType::kInt64, transport, kChunkBytes);
+      });
+      FOR_RANGE(int64_t, rank, 0, num_ranks) {
+        const auto begin = expected.begin() + rank * elem_cnt;
+        ASSERT_EQ(scattered.at(rank), std::vector<int64_t>(begin, begin + elem_cnt));
+        ASSERT_EQ(gathered.at(rank), expected);
+      }
+    }
+  }
+}
+
+TEST(CpuCollective, DISABLED_benchmark_all_reduce) {
+  const int64_t num_ranks = 4;
+  for (int64_t elem_cnt : {1024, 1024 * 1024}) {
+    LOG(INFO) << "all reduce " << elem_cnt * sizeof(float) << " bytes on " << num_ranks
+              << " loopback ranks: ring " << BenchmarkAllReduce(&RingAllReduce, num_ranks,
+                                                                 elem_cnt)
+              << " GB/s, tree " << BenchmarkAllReduce(&CpuTreeAllReduce, num_ranks, elem_cnt)
+              << " GB/s algorithm bandwidth";
+  }
+}
+
+}  // namespace test
+}  // namespace ccl
+}  // namespace oneflow
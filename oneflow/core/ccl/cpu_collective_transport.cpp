@@ -0,0 +1,78 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ccl/cpu_collective_transport.h"
+#include "oneflow/core/framework/transport_util.h"
+#include "oneflow/core/job/parallel_desc.h"
+#include "oneflow/core/rpc/include/global_process_ctx.h"
+
+namespace oneflow {
+
+namespace ccl {
+
+Maybe<void> InitCollectiveRanks(const ParallelDesc& parallel_desc, std::vector<int64_t>* ranks,
+                                int64_t* rank_index) {
+  CHECK_EQ_OR_RETURN(parallel_desc.parallel_num(), parallel_desc.sorted_machine_ids().size());
+  ranks->resize(parallel_desc.parallel_num());
+  *rank_index = -1;
+  for (int64_t parallel_id = 0; parallel_id < parallel_desc.parallel_num(); ++parallel_id) {
+    int64_t machine_id = JUST(parallel_desc.MachineId4ParallelId(parallel_id));
+    if (machine_id == GlobalProcessCtx::Rank()) { *rank_index = parallel_id; }
+    ranks->at(parallel_id) = machine_id;
+  }
+  CHECK_NE_OR_RETURN(*rank_index, -1);
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> TransportTokenCollectiveTransport::AsyncSend(int64_t peer_index, const void* ptr,
+                                                         size_t size,
+                                                         std::atomic<int64_t>* pending) {
+  NaiveAsyncTransportCtx transport_ctx(
+      transport_token_,
+      [&](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb) -> Maybe<void> {
+        *buffer = const_cast<void*>(ptr);
+        *buffer_size = size;
+        *Cb = [pending] { --*pending; };
+        return Maybe<void>::Ok();
+      },
+      [&](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb) -> Maybe<void> {
+        UNIMPLEMENTED_THEN_RETURN();
+      });
+  ++*pending;
+  return TransportUtil::SendDataToRank(ranks_.at(peer_index), transport_token_, &transport_ctx);
+}
+
+Maybe<void> TransportTokenCollectiveTransport::AsyncRecv(int64_t peer_index, void* ptr,
+                                                         size_t size,
+                                                         std::atomic<int64_t>* pending) {
+  NaiveAsyncTransportCtx transport_ctx(
+      transport_token_,
+      [&](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb) -> Maybe<void> {
+        UNIMPLEMENTED_THEN_RETURN();
+      },
+      [&](void** buffer, std::size_t* buffer_size, std::function<void()>* Cb) -> Maybe<void> {
+        *buffer = ptr;
+        *buffer_size = size;
+        *Cb = [pending] { --*pending; };
+        return Maybe<void>::Ok();
+      });
+  ++*pending;
+  return TransportUtil::ReceiveDataFromRank(ranks_.at(peer_index), transport_token_,
+                                            &transport_ctx);
+}
+
+}  // namespace ccl
+
+}  // namespace oneflow
@@ -0,0 +1,58 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_CCL_CPU_COLLECTIVE_TRANSPORT_H_
+#define ONEFLOW_CORE_CCL_CPU_COLLECTIVE_TRANSPORT_H_
+
+#include <vector>
+#include "oneflow/core/ccl/cpu_collective.h"
+#include "oneflow/core/framework/transport_token.h"
+
+namespace oneflow {
+
+class ParallelDesc;
+
+namespace ccl {
+
+// ranks->at(i) is the rank of parallel id i, *rank_index is the parallel id of this rank
+Maybe<void> InitCollectiveRanks(const ParallelDesc& parallel_desc, std::vector<int64_t>* ranks,
+                                int64_t* rank_index);
+
+// Transport of the eager collectives, which run on threads holding a thread consistent id. The
+// transfers go through TransportUtil with a token made by TransportToken::NewTransportToken.
+class TransportTokenCollectiveTransport final : public CpuCollectiveTransport {
+ public:
+  TransportTokenCollectiveTransport(const std::vector<int64_t>& ranks, int64_t rank_index,
+                                    const TransportToken& transport_token)
+      : CpuCollectiveTransport(ranks.size(), rank_index),
+        ranks_(ranks),
+        transport_token_(transport_token) {}
+  ~TransportTokenCollectiveTransport() override = default;
+
+  Maybe<void> AsyncSend(int64_t peer_index, const void* ptr, size_t size,
+                        std::atomic<int64_t>* pending) override;
+  Maybe<void> AsyncRecv(int64_t peer_index, void* ptr, size_t size,
+                        std::atomic<int64_t>* pending) override;
+
+ private:
+  const std::vector<int64_t> ranks_;
+  const TransportToken transport_token_;
+};
+
+}  // namespace ccl
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_CCL_CPU_COLLECTIVE_TRANSPORT_H_
@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/job/resource_desc.h"
 #include "oneflow/core/job/env_desc.h"
 #include "oneflow/core/job/global_for.h"
+#include "oneflow/core/profiler/timeline.h"
 
 namespace oneflow {
 
@@ -38,6 +39,8 @@ void CommNet::Read(void* actor_read_id, int64_t src_machine_id, void* src_token,
   auto actor_read_ctx = static_cast<ActorReadContext*>(actor_read_id);
   ReadContext* read_ctx = new ReadContext;
   read_ctx->actor_read_ctx = actor_read_ctx;
+  read_ctx->src_machine_id = src_machine_id;
+  read_ctx->timeline_begin_ns = profiler::IsTimelineEnabled() ? profiler::TimelineNowNs() : 0;
   auto do_read = [this, read_ctx, src_machine_id, src_token, dst_token]() {
     DoRead(read_ctx, src_machine_id, src_token, dst_token);
   };
@@ -50,6 +53,11 @@ void CommNet::AddReadCallBack(void* actor_read_id, std::function<void()> callbac
 
 void CommNet::ReadDone(void* read_id) {
   ReadContext* read_ctx = static_cast<ReadContext*>(read_id);
+  if (read_ctx->timeline_begin_ns != 0) {
+    profiler::RecordTimelineEvent(profiler::TimelineCategory::kCommNet, "Read",
+                                  read_ctx->src_machine_id, read_ctx->timeline_begin_ns,
+                                  profiler::TimelineNowNs());
+  }
   ActorReadContext* actor_read_ctx = read_ctx->actor_read_ctx;
   CommNetItem item;
   std::unique_lock<std::mutex> lck(actor_read_ctx->waiting_list_mtx);
@@ -64,6 +64,9 @@ class CommNet {
   struct ActorReadContext;
   struct ReadContext {
     ActorReadContext* actor_read_ctx;
+    int64_t src_machine_id;
+    // 0 if the timeline was disabled when the read was issued
+    int64_t timeline_begin_ns;
   };
   struct ActorReadContext {
     std::mutex waiting_list_mtx;
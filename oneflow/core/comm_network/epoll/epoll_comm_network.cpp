@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
 #include "glog/logging.h"
+#include "oneflow/core/common/balanced_splitter.h"
 #include "oneflow/core/control/ctrl_client.h"
 #include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/job/resource_desc.h"
@@ -110,7 +111,57 @@ void EpollCommNet::SendTransportMsg(int64_t dst_machine_id, const TransportMsg&
 }
 
 void EpollCommNet::SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg) {
-  GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
+  if (msg.msg_type == SocketMsgType::kRequestRead) {
+    SendRequestReadMsg(dst_machine_id, msg);
+  } else {
+    GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
+  }
+}
+
+std::vector<SocketMsg> SplitRequestReadMsg(const SocketMsg& msg, int64_t stripe_num) {
+  const RequestReadMsg& request_read_msg = msg.request_read_msg;
+  CHECK(msg.msg_type == SocketMsgType::kRequestRead);
+  CHECK_EQ(request_read_msg.stripe_num, 1);
+  CHECK_GE(stripe_num, 1);
+  std::vector<SocketMsg> stripe_msgs(stripe_num, msg);
+  BalancedSplitter bs(request_read_msg.byte_size, stripe_num);
+  FOR_RANGE(int64_t, i, 0, stripe_num) {
+    RequestReadMsg* stripe_msg = &stripe_msgs.at(i).request_read_msg;
+    stripe_msg->offset = request_read_msg.offset + bs.At(i).begin();
+    stripe_msg->byte_size = bs.At(i).size();
+    stripe_msg->stripe_num = stripe_num;
+  }
+  return stripe_msgs;
+}
+
+bool StripeReadCounter::StripeDone(void* read_id, int64_t stripe_num) {
+  if (stripe_num == 1) { return true; }
+  std::unique_lock<std::mutex> lck(mutex_);
+  auto it = read_id2remaining_stripe_num_.emplace(read_id, stripe_num).first;
+  it->second -= 1;
+  if (it->second > 0) { return false; }
+  read_id2remaining_stripe_num_.erase(it);
+  return true;
+}
+
+bool StripeReadCounter::Empty() {
+  std::unique_lock<std::mutex> lck(mutex_);
+  return read_id2remaining_stripe_num_.empty();
+}
+
+void EpollCommNet::SendRequestReadMsg(int64_t dst_machine_id, const SocketMsg& msg) {
+  const int64_t stripe_num = std::max<int64_t>(
+      std::min(sockets_per_peer_, msg.request_read_msg.byte_size / min_stripe_bytes_), 1);
+  const int64_t first_socket_idx = stripe_socket_cursor_.fetch_add(stripe_num);
+  const std::vector<SocketMsg> stripe_msgs = SplitRequestReadMsg(msg, stripe_num);
+  FOR_RANGE(int64_t, i, 0, stripe_num) {
+    GetSocketHelper(dst_machine_id, (first_socket_idx + i) % sockets_per_peer_)
+        ->AsyncWrite(stripe_msgs.at(i));
+  }
+}
+
+void EpollCommNet::StripeReadDone(void* read_id, int64_t stripe_num) {
+  if (stripe_read_counter_.StripeDone(read_id, stripe_num)) { ReadDone(read_id); }
 }
 
 SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
@@ -120,7 +171,14 @@ SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
   return mem_desc;
 }
 
-EpollCommNet::EpollCommNet() : CommNetIf() {
+EpollCommNet::EpollCommNet()
+    : CommNetIf(),
+      sockets_per_peer_(ParseIntegerFromEnv("ONEFLOW_COMM_NET_EPOLL_SOCKETS_PER_PEER", 1)),
+      min_stripe_bytes_(
+          ParseIntegerFromEnv("ONEFLOW_COMM_NET_EPOLL_MIN_STRIPE_BYTES", 4 * 1024 * 1024)),
+      stripe_socket_cursor_(0) {
+  CHECK_GE(sockets_per_peer_, 1);
+  CHECK_GE(min_stripe_bytes_, 1);
   pollers_.resize(Global<ResourceDesc, ForSession>::Get()->CommNetWorkerNum(), nullptr);
   for (size_t i = 0; i < pollers_.size(); ++i) { pollers_[i] = new IOEventPoller; }
   InitSockets();
@@ -131,7 +189,7 @@ void EpollCommNet::InitSockets() {
   int64_t this_machine_id = GlobalProcessCtx::Rank();
   auto this_machine = Global<ResourceDesc, ForSession>::Get()->machine(this_machine_id);
   int64_t total_machine_num = Global<ResourceDesc, ForSession>::Get()->process_ranks().size();
-  machine_id2sockfd_.assign(total_machine_num, -1);
+  machine_id2sockfds_.assign(total_machine_num, std::vector<int>(sockets_per_peer_, -1));
   sockfd2helper_.clear();
   size_t poller_idx = 0;
   auto NewSocketHelper = [&](int sockfd) {
@@ -150,7 +208,7 @@ void EpollCommNet::InitSockets() {
       this_listen_port = Global<EnvDesc>::Get()->data_port();
     }
   }
-  CHECK_EQ(SockListen(listen_sockfd, &this_listen_port, total_machine_num), 0);
+  CHECK_EQ(SockListen(listen_sockfd, &this_listen_port, total_machine_num * sockets_per_peer_), 0);
   CHECK_NE(this_listen_port, 0);
   PushPort(this_machine_id, this_listen_port);
   int32_t src_machine_count = 0;
@@ -164,42 +222,52 @@ void EpollCommNet::InitSockets() {
     uint16_t peer_port = PullPort(peer_id);
     auto peer_machine = Global<ResourceDesc, ForSession>::Get()->machine(peer_id);
     sockaddr_in peer_sockaddr = GetSockAddr(peer_machine.addr(), peer_port);
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    const int val = 1;
-    PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
-    PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
-           == 0);
-    ssize_t n = write(sockfd, &this_machine_id, sizeof(int64_t));
-    PCHECK(n == sizeof(int64_t));
-    CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    machine_id2sockfd_[peer_id] = sockfd;
+    FOR_RANGE(int64_t, socket_idx, 0, sockets_per_peer_) {
+      int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+      const int val = 1;
+      PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
+      PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
+             == 0);
+      const int64_t handshake[2] = {this_machine_id, socket_idx};
+      ssize_t n = write(sockfd, handshake, sizeof(handshake));
+      PCHECK(n == sizeof(handshake));
+      CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
+      machine_id2sockfds_[peer_id][socket_idx] = sockfd;
+    }
   }
 
   // accept
-  HashSet<int64_t> processed_ranks;
-  FOR_RANGE(int32_t, idx, 0, src_machine_count) {
+  FOR_RANGE(int64_t, idx, 0, src_machine_count * sockets_per_peer_) {
     sockaddr_in peer_sockaddr;
     socklen_t len = sizeof(peer_sockaddr);
     int sockfd = accept(listen_sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), &len);
     PCHECK(sockfd != -1);
-    int64_t peer_rank;
-    ssize_t n = read(sockfd, &peer_rank, sizeof(int64_t));
-    PCHECK(n == sizeof(int64_t));
+    int64_t handshake[2];
+    ssize_t n = read(sockfd, handshake, sizeof(handshake));
+    PCHECK(n == sizeof(handshake));
+    const int64_t peer_rank = handshake[0];
+    const int64_t socket_idx = handshake[1];
+    CHECK_EQ(machine_id2sockfds_.at(peer_rank).at(socket_idx), -1);
     CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    CHECK(processed_ranks.emplace(peer_rank).second);
-    machine_id2sockfd_[peer_rank] = sockfd;
+    machine_id2sockfds_[peer_rank][socket_idx] = sockfd;
   }
   PCHECK(close(listen_sockfd) == 0);
   ClearPort(this_machine_id);
 
   // useful log
   FOR_RANGE(int64_t, machine_id, 0, total_machine_num) {
-    LOG(INFO) << "machine " << machine_id << " sockfd " << machine_id2sockfd_[machine_id];
+    for (int sockfd : machine_id2sockfds_[machine_id]) {
+      LOG(INFO) << "machine " << machine_id << " sockfd " << sockfd;
+    }
   }
 }
 
 SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id) {
-  int sockfd = machine_id2sockfd_.at(machine_id);
+  return GetSocketHelper(machine_id, 0);
+}
+
+SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id, int64_t socket_idx) {
+  int sockfd = machine_id2sockfds_.at(machine_id).at(socket_idx);
   return sockfd2helper_.at(sockfd);
 }
 
@@ -24,6 +24,30 @@ limitations under the License.
 
 namespace oneflow {
 
+// Splits a RequestRead msg of a single stripe into stripe_num msgs of balanced byte ranges
+std::vector<SocketMsg> SplitRequestReadMsg(const SocketMsg& msg, int64_t stripe_num);
+
+// Counts the received stripes of the reads in flight
+class StripeReadCounter final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(StripeReadCounter);
+  StripeReadCounter() = default;
+  ~StripeReadCounter() = default;
+
+  // returns true if it is the last stripe of the read
+  bool StripeDone(void* read_id, int64_t stripe_num);
+  bool Empty();
+
+ private:
+  std::mutex mutex_;
+  HashMap<void*, int64_t> read_id2remaining_stripe_num_;
+};
+
+// Options are read from the environment and must be the same on all machines:
+//   ONEFLOW_COMM_NET_EPOLL_SOCKETS_PER_PEER: sockets connected to each peer, default 1
+//   ONEFLOW_COMM_NET_EPOLL_MIN_STRIPE_BYTES: a RequestRead body is striped over the sockets of the
+//     peer only if every stripe has at least so many bytes, default 4MiB
+// Actor, transport and RequestWrite msgs always go through the first socket to keep their order.
 class EpollCommNet final : public CommNetIf<SocketMemDesc> {
  public:
   OF_DISALLOW_COPY_AND_MOVE(EpollCommNet);
@@ -32,6 +56,7 @@ class EpollCommNet final : public CommNetIf<SocketMemDesc> {
   void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) override;
   void SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg);
   void SendTransportMsg(int64_t dst_machine_id, const TransportMsg& msg);
+  void StripeReadDone(void* read_id, int64_t stripe_num);
 
  private:
   SocketMemDesc* NewMemDesc(void* ptr, size_t byte_size) override;
@@ -40,11 +65,17 @@ class EpollCommNet final : public CommNetIf<SocketMemDesc> {
   EpollCommNet();
   void InitSockets();
   SocketHelper* GetSocketHelper(int64_t machine_id);
+  SocketHelper* GetSocketHelper(int64_t machine_id, int64_t socket_idx);
+  void SendRequestReadMsg(int64_t dst_machine_id, const SocketMsg& msg);
   void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
 
   std::vector<IOEventPoller*> pollers_;
-  std::vector<int> machine_id2sockfd_;
+  const int64_t sockets_per_peer_;
+  const int64_t min_stripe_bytes_;
+  std::vector<std::vector<int>> machine_id2sockfds_;
   HashMap<int, SocketHelper*> sockfd2helper_;
+  std::atomic<int64_t> stripe_socket_cursor_;
+  StripeReadCounter stripe_read_counter_;
 };
 
 }  // namespace oneflow
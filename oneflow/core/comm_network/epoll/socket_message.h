@@ -58,6 +58,11 @@ struct RequestReadMsg {
   void* src_token;
   void* dst_token;
   void* read_id;
+  // the body is the byte range [offset, offset + byte_size) of the memory, a read is done after
+  // all its stripe_num stripes are received
+  int64_t offset;
+  int64_t byte_size;
+  int64_t stripe_num;
 };
 
 struct SocketMsg {
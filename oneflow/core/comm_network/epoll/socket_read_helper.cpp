@@ -28,7 +28,14 @@ SocketReadHelper::~SocketReadHelper() {
   // do nothing
 }
 
-SocketReadHelper::SocketReadHelper(int sockfd) {
+SocketReadHelper::SocketReadHelper(int sockfd)
+    : SocketReadHelper(sockfd, [](void* read_id, int64_t stripe_num) {
+        Global<EpollCommNet>::Get()->StripeReadDone(read_id, stripe_num);
+      }) {}
+
+SocketReadHelper::SocketReadHelper(
+    int sockfd, const std::function<void(void* read_id, int64_t stripe_num)>& stripe_read_done)
+    : stripe_read_done_(stripe_read_done) {
   sockfd_ = sockfd;
   SwitchToMsgHeadReadHandle();
 }
@@ -83,7 +90,7 @@ void SocketReadHelper::SetStatusWhenMsgHeadDone() {
 
 void SocketReadHelper::SetStatusWhenMsgBodyDone() {
   if (cur_msg_.msg_type == SocketMsgType::kRequestRead) {
-    Global<EpollCommNet>::Get()->ReadDone(cur_msg_.request_read_msg.read_id);
+    stripe_read_done_(cur_msg_.request_read_msg.read_id, cur_msg_.request_read_msg.stripe_num);
   }
   SwitchToMsgHeadReadHandle();
 }
@@ -94,6 +101,10 @@ void SocketReadHelper::SetStatusWhenRequestWriteMsgHeadDone() {
   msg_to_send.request_read_msg.src_token = cur_msg_.request_write_msg.src_token;
   msg_to_send.request_read_msg.dst_token = cur_msg_.request_write_msg.dst_token;
   msg_to_send.request_read_msg.read_id = cur_msg_.request_write_msg.read_id;
+  msg_to_send.request_read_msg.offset = 0;
+  msg_to_send.request_read_msg.byte_size =
+      static_cast<const SocketMemDesc*>(cur_msg_.request_write_msg.src_token)->byte_size;
+  msg_to_send.request_read_msg.stripe_num = 1;
   Global<EpollCommNet>::Get()->SendSocketMsg(cur_msg_.request_write_msg.dst_machine_id,
                                              msg_to_send);
   SwitchToMsgHeadReadHandle();
@@ -101,8 +112,10 @@ void SocketReadHelper::SetStatusWhenRequestWriteMsgHeadDone() {
 
 void SocketReadHelper::SetStatusWhenRequestReadMsgHeadDone() {
   auto mem_desc = static_cast<const SocketMemDesc*>(cur_msg_.request_read_msg.dst_token);
-  read_ptr_ = reinterpret_cast<char*>(mem_desc->mem_ptr);
-  read_size_ = mem_desc->byte_size;
+  CHECK_LE(cur_msg_.request_read_msg.offset + cur_msg_.request_read_msg.byte_size,
+           mem_desc->byte_size);
+  read_ptr_ = reinterpret_cast<char*>(mem_desc->mem_ptr) + cur_msg_.request_read_msg.offset;
+  read_size_ = cur_msg_.request_read_msg.byte_size;
   cur_read_handle_ = &SocketReadHelper::MsgBodyReadHandle;
 }
 
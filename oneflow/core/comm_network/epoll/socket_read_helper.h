@@ -29,6 +29,9 @@ class SocketReadHelper final {
   ~SocketReadHelper();
 
   SocketReadHelper(int sockfd);
+  // stripe_read_done is called after the body of every RequestRead stripe is received
+  SocketReadHelper(int sockfd,
+                   const std::function<void(void* read_id, int64_t stripe_num)>& stripe_read_done);
 
   void NotifyMeSocketReadable();
 
@@ -48,6 +51,7 @@ class SocketReadHelper final {
 #undef MAKE_ENTRY
 
   int sockfd_;
+  std::function<void(void* read_id, int64_t stripe_num)> stripe_read_done_;
 
   SocketMsg cur_msg_;
   bool (SocketReadHelper::*cur_read_handle_)();
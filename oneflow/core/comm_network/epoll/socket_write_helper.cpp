@@ -18,10 +18,17 @@ limitations under the License.
 #include "oneflow/core/comm_network/epoll/socket_write_helper.h"
 #include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
 
+#include <limits.h>
 #include <sys/eventfd.h>
 
 namespace oneflow {
 
+namespace {
+
+const size_t kMaxBatchMsgNum = 64;
+
+}  // namespace
+
 SocketWriteHelper::~SocketWriteHelper() {
   delete cur_msg_queue_;
   cur_msg_queue_ = nullptr;
@@ -40,9 +47,10 @@ SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller) {
                                    std::bind(&SocketWriteHelper::ProcessQueueNotEmptyEvent, this));
   cur_msg_queue_ = new std::queue<SocketMsg>;
   pending_msg_queue_ = new std::queue<SocketMsg>;
+  batch_msgs_.reserve(kMaxBatchMsgNum);
+  batch_iovs_.reserve(2 * kMaxBatchMsgNum);
+  batch_iov_idx_ = 0;
   cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-  write_ptr_ = nullptr;
-  write_size_ = 0;
 }
 
 void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
@@ -71,77 +79,78 @@ void SocketWriteHelper::WriteUntilMsgQueueEmptyOrSocketNotWriteable() {
 }
 
 bool SocketWriteHelper::InitMsgWriteHandle() {
-  if (cur_msg_queue_->empty()) {
-    {
-      std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
-      std::swap(cur_msg_queue_, pending_msg_queue_);
+  batch_msgs_.clear();
+  batch_iovs_.clear();
+  batch_iov_idx_ = 0;
+  while (batch_msgs_.size() < kMaxBatchMsgNum) {
+    if (cur_msg_queue_->empty()) {
+      {
+        std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
+        std::swap(cur_msg_queue_, pending_msg_queue_);
+      }
+      if (cur_msg_queue_->empty()) { break; }
     }
-    if (cur_msg_queue_->empty()) { return false; }
+    AppendMsgToBatch(cur_msg_queue_->front());
+    cur_msg_queue_->pop();
   }
-  cur_msg_ = cur_msg_queue_->front();
-  cur_msg_queue_->pop();
-  write_ptr_ = reinterpret_cast<const char*>(&cur_msg_);
-  write_size_ = sizeof(cur_msg_);
-  cur_write_handle_ = &SocketWriteHelper::MsgHeadWriteHandle;
+  if (batch_msgs_.empty()) { return false; }
+  cur_write_handle_ = &SocketWriteHelper::BatchWriteHandle;
   return true;
 }
 
-bool SocketWriteHelper::MsgHeadWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgHeadDone);
-}
-
-bool SocketWriteHelper::MsgBodyWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgBodyDone);
-}
-
-bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)()) {
-  ssize_t n = write(sockfd_, write_ptr_, write_size_);
-  if (n == write_size_) {
-    (this->*set_cur_write_done)();
-    return true;
-  } else if (n >= 0) {
-    write_ptr_ += n;
-    write_size_ -= n;
-    return true;
-  } else {
+bool SocketWriteHelper::BatchWriteHandle() {
+  const size_t iov_num = std::min<size_t>(batch_iovs_.size() - batch_iov_idx_, IOV_MAX);
+  ssize_t n = writev(sockfd_, batch_iovs_.data() + batch_iov_idx_, iov_num);
+  if (n < 0) {
     CHECK_EQ(n, -1);
     PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
     return false;
   }
-}
-
-void SocketWriteHelper::SetStatusWhenMsgHeadDone() {
-  switch (cur_msg_.msg_type) {
-#define MAKE_ENTRY(x, y) \
-  case SocketMsgType::k##x: return SetStatusWhen##x##MsgHeadDone();
-    OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
-    default: UNIMPLEMENTED();
+  size_t written = n;
+  while (batch_iov_idx_ < batch_iovs_.size()
+         && batch_iovs_.at(batch_iov_idx_).iov_len <= written) {
+    written -= batch_iovs_.at(batch_iov_idx_).iov_len;
+    batch_iov_idx_ += 1;
   }
+  if (batch_iov_idx_ == batch_iovs_.size()) {
+    cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+  } else {
+    // partially written
+    iovec* iov = &batch_iovs_.at(batch_iov_idx_);
+    iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+    iov->iov_len -= written;
+  }
+  return true;
 }
 
-void SocketWriteHelper::SetStatusWhenMsgBodyDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestWriteMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestReadMsgHeadDone() {
-  const void* src_token = cur_msg_.request_read_msg.src_token;
-  auto src_mem_desc = static_cast<const SocketMemDesc*>(src_token);
-  write_ptr_ = reinterpret_cast<const char*>(src_mem_desc->mem_ptr);
-  write_size_ = src_mem_desc->byte_size;
-  cur_write_handle_ = &SocketWriteHelper::MsgBodyWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenActorMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+void SocketWriteHelper::AppendMsgToBatch(const SocketMsg& msg) {
+  // batch_msgs_ never reallocates, iovecs point into it
+  CHECK_LT(batch_msgs_.size(), batch_msgs_.capacity());
+  batch_msgs_.push_back(msg);
+  AppendIovec(&batch_msgs_.back(), sizeof(SocketMsg));
+  if (msg.msg_type == SocketMsgType::kRequestRead) {
+    auto src_mem_desc = static_cast<const SocketMemDesc*>(msg.request_read_msg.src_token);
+    CHECK_LE(msg.request_read_msg.offset + msg.request_read_msg.byte_size,
+             src_mem_desc->byte_size);
+    AppendIovec(static_cast<const char*>(src_mem_desc->mem_ptr) + msg.request_read_msg.offset,
+                msg.request_read_msg.byte_size);
+  }
 }
 
-void SocketWriteHelper::SetStatusWhenTransportMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+void SocketWriteHelper::AppendIovec(const void* ptr, size_t size) {
+  if (size == 0) { return; }
+  if (!batch_iovs_.empty()) {
+    // consecutive msg heads are adjacent in batch_msgs_
+    iovec* last = &batch_iovs_.back();
+    if (static_cast<const char*>(last->iov_base) + last->iov_len == ptr) {
+      last->iov_len += size;
+      return;
+    }
+  }
+  iovec iov;
+  iov.iov_base = const_cast<void*>(ptr);
+  iov.iov_len = size;
+  batch_iovs_.push_back(iov);
 }
 
 }  // namespace oneflow
@@ -21,6 +21,8 @@ limitations under the License.
 
 #ifdef OF_PLATFORM_POSIX
 
+#include <sys/uio.h>
+
 namespace oneflow {
 
 class SocketWriteHelper final {
@@ -41,16 +43,10 @@ class SocketWriteHelper final {
 
   void WriteUntilMsgQueueEmptyOrSocketNotWriteable();
   bool InitMsgWriteHandle();
-  bool MsgHeadWriteHandle();
-  bool MsgBodyWriteHandle();
-
-  bool DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)());
-  void SetStatusWhenMsgHeadDone();
-  void SetStatusWhenMsgBodyDone();
+  bool BatchWriteHandle();
 
-#define MAKE_ENTRY(x, y) void SetStatusWhen##x##MsgHeadDone();
-  OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
+  void AppendMsgToBatch(const SocketMsg& msg);
+  void AppendIovec(const void* ptr, size_t size);
 
   int sockfd_;
   int queue_not_empty_fd_;
@@ -60,10 +56,11 @@ class SocketWriteHelper final {
   std::mutex pending_msg_queue_mtx_;
   std::queue<SocketMsg>* pending_msg_queue_;
 
-  SocketMsg cur_msg_;
+  // queued msgs are written by batches of writev, a RequestRead msg is followed by its body
+  std::vector<SocketMsg> batch_msgs_;
+  std::vector<iovec> batch_iovs_;
+  size_t batch_iov_idx_;
   bool (SocketWriteHelper::*cur_write_handle_)();
-  const char* write_ptr_;
-  size_t write_size_;
 };
 
 }  // namespace oneflow
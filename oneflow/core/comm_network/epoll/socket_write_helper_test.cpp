@@ -0,0 +1,273 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef __linux__
+
+#include "oneflow/core/comm_network/epoll/socket_write_helper.h"
+#include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
+#include "oneflow/core/comm_network/epoll/socket_read_helper.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/common/cpu_test_util.h"
+
+#include <netinet/tcp.h>
+#include <random>
+
+namespace oneflow {
+
+namespace {
+
+void ReadFully(int fd, void* ptr, size_t size) {
+  char* cur = static_cast<char*>(ptr);
+  while (size > 0) {
+    ssize_t n = read(fd, cur, size);
+    PCHECK(n > 0);
+    cur += n;
+    size -= n;
+  }
+}
+
+// Reads msg heads and RequestRead bodies until msg_num msgs are received, returns the body bytes
+int64_t ReadMsgs(int sockfd, int64_t msg_num) {
+  std::vector<char> body;
+  int64_t body_bytes = 0;
+  FOR_RANGE(int64_t, i, 0, msg_num) {
+    SocketMsg msg;
+    ReadFully(sockfd, &msg, sizeof(msg));
+    if (msg.msg_type == SocketMsgType::kRequestRead) {
+      body.resize(std::max<size_t>(body.size(), msg.request_read_msg.byte_size));
+      ReadFully(sockfd, body.data(), msg.request_read_msg.byte_size);
+      body_bytes += msg.request_read_msg.byte_size;
+    }
+  }
+  return body_bytes;
+}
+
+// The reader connects socket2msgs.size() sockets to listen_port and returns the received body
+// bytes after all msgs are received
+int64_t RunReader(uint16_t listen_port, const std::vector<std::vector<SocketMsg>>& socket2msgs) {
+  sockaddr_in sa;
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(listen_port);
+  PCHECK(inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr) == 1);
+  std::vector<std::thread> threads;
+  std::vector<int> sockfds;
+  std::atomic<int64_t> body_bytes(0);
+  FOR_RANGE(int32_t, socket_idx, 0, socket2msgs.size()) {
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0);
+    sockfds.push_back(sockfd);
+    PCHECK(write(sockfd, &socket_idx, sizeof(socket_idx)) == sizeof(socket_idx));
+    const int64_t msg_num = socket2msgs.at(socket_idx).size();
+    threads.emplace_back([sockfd, msg_num, &body_bytes]() {
+      body_bytes += ReadMsgs(sockfd, msg_num);
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  for (int sockfd : sockfds) { PCHECK(close(sockfd) == 0); }
+  return body_bytes;
+}
+
+// Writes socket2msgs through SocketWriteHelpers to a reader thread over loopback tcp, returns the
+// elapsed seconds
+double RunLoopback(const std::vector<std::vector<SocketMsg>>& socket2msgs,
+                   int64_t expected_body_bytes) {
+  const int32_t socket_num = socket2msgs.size();
+  int listen_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in sa;
+  sa.sin_family = AF_INET;
+  sa.sin_port = 0;
+  PCHECK(inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr) == 1);
+  PCHECK(bind(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) == 0);
+  PCHECK(listen(listen_sockfd, socket_num) == 0);
+  socklen_t sa_len = sizeof(sa);
+  PCHECK(getsockname(listen_sockfd, reinterpret_cast<sockaddr*>(&sa), &sa_len) == 0);
+  int64_t body_bytes = 0;
+  std::thread reader([&]() { body_bytes = RunReader(ntohs(sa.sin_port), socket2msgs); });
+  std::vector<int> sockfds(socket_num, -1);
+  FOR_RANGE(int32_t, i, 0, socket_num) {
+    int sockfd = accept(listen_sockfd, nullptr, nullptr);
+    PCHECK(sockfd != -1);
+    const int val = 1;
+    PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
+    int32_t socket_idx = -1;
+    ReadFully(sockfd, &socket_idx, sizeof(socket_idx));
+    sockfds.at(socket_idx) = sockfd;
+  }
+  PCHECK(close(listen_sockfd) == 0);
+  std::vector<std::unique_ptr<IOEventPoller>> pollers;
+  std::vector<std::unique_ptr<SocketWriteHelper>> helpers;
+  FOR_RANGE(int32_t, i, 0, socket_num) {
+    pollers.emplace_back(new IOEventPoller);
+    helpers.emplace_back(new SocketWriteHelper(sockfds.at(i), pollers.back().get()));
+    SocketWriteHelper* helper = helpers.back().get();
+    pollers.back()->AddFd(
+        sockfds.at(i), []() {}, [helper]() { helper->NotifyMeSocketWriteable(); });
+    pollers.back()->Start();
+  }
+  const double ms = test::MeasureMs([&]() {
+    FOR_RANGE(int32_t, i, 0, socket_num) {
+      for (const SocketMsg& msg : socket2msgs.at(i)) { helpers.at(i)->AsyncWrite(msg); }
+    }
+    reader.join();
+  });
+  CHECK_EQ(body_bytes, expected_body_bytes);
+  for (auto& poller : pollers) { poller->Stop(); }
+  // the pollers close the sockets
+  helpers.clear();
+  pollers.clear();
+  return ms / 1e3;
+}
+
+SocketMsg NewActorMsg() {
+  SocketMsg msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_type = SocketMsgType::kActor;
+  return msg;
+}
+
+SocketMsg NewRequestReadMsg(SocketMemDesc* src_mem_desc, SocketMemDesc* dst_mem_desc,
+                            void* read_id) {
+  SocketMsg msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_type = SocketMsgType::kRequestRead;
+  msg.request_read_msg.src_token = src_mem_desc;
+  msg.request_read_msg.dst_token = dst_mem_desc;
+  msg.request_read_msg.read_id = read_id;
+  msg.request_read_msg.offset = 0;
+  msg.request_read_msg.byte_size = src_mem_desc->byte_size;
+  msg.request_read_msg.stripe_num = 1;
+  return msg;
+}
+
+// Splits every body into socket_num stripes the way EpollCommNet does
+std::vector<std::vector<SocketMsg>> StripeBodies(SocketMemDesc* mem_desc, int64_t body_num,
+                                                 int32_t socket_num) {
+  std::vector<std::vector<SocketMsg>> socket2msgs(socket_num);
+  const SocketMsg msg = NewRequestReadMsg(mem_desc, mem_desc, nullptr);
+  FOR_RANGE(int64_t, body_idx, 0, body_num) {
+    const std::vector<SocketMsg> stripe_msgs = SplitRequestReadMsg(msg, socket_num);
+    FOR_RANGE(int32_t, i, 0, socket_num) {
+      socket2msgs.at((body_idx + i) % socket_num).push_back(stripe_msgs.at(i));
+    }
+  }
+  return socket2msgs;
+}
+
+}  // namespace
+
+TEST(SocketWriteHelper, striped_reads_reassemble) {
+  // reads of a few stripes, of a single one and of stripes smaller than a msg head
+  const std::vector<std::pair<int64_t, int64_t>> byte_size_and_stripe_num{
+      {(3 << 20) + 17, 3}, {1 << 20, 2}, {12345, 1}, {5, 4}, {(2 << 20) + 1, 3}};
+  const int32_t socket_num = 3;
+  const int64_t read_num = byte_size_and_stripe_num.size();
+  std::mt19937 gen(0);
+  std::vector<std::vector<char>> srcs;
+  std::vector<std::vector<char>> dsts;
+  std::vector<SocketMemDesc> src_mem_descs(read_num);
+  std::vector<SocketMemDesc> dst_mem_descs(read_num);
+  FOR_RANGE(int64_t, i, 0, read_num) {
+    srcs.emplace_back(byte_size_and_stripe_num.at(i).first);
+    for (char& c : srcs.back()) { c = static_cast<char>(gen()); }
+    dsts.emplace_back(srcs.back().size(), 0);
+    src_mem_descs.at(i).mem_ptr = srcs.back().data();
+    src_mem_descs.at(i).byte_size = srcs.back().size();
+    dst_mem_descs.at(i).mem_ptr = dsts.back().data();
+    dst_mem_descs.at(i).byte_size = dsts.back().size();
+  }
+  // the read ids are the addresses of the done cnts
+  std::vector<std::atomic<int32_t>> read_done_cnts(read_num);
+  for (auto& cnt : read_done_cnts) { cnt = 0; }
+  StripeReadCounter stripe_read_counter;
+  BlockingCounter bc(read_num);
+  auto StripeReadDone = [&](void* read_id, int64_t stripe_num) {
+    if (stripe_read_counter.StripeDone(read_id, stripe_num)) {
+      static_cast<std::atomic<int32_t>*>(read_id)->fetch_add(1);
+      bc.Decrease();
+    }
+  };
+  IOEventPoller write_poller;
+  IOEventPoller read_poller;
+  std::vector<std::unique_ptr<SocketWriteHelper>> write_helpers;
+  std::vector<std::unique_ptr<SocketReadHelper>> read_helpers;
+  // the pollers close the sockets
+  FOR_RANGE(int32_t, i, 0, socket_num) {
+    int pair[2];
+    PCHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+    write_helpers.emplace_back(new SocketWriteHelper(pair[0], &write_poller));
+    SocketWriteHelper* write_helper = write_helpers.back().get();
+    write_poller.AddFd(
+        pair[0], []() {}, [write_helper]() { write_helper->NotifyMeSocketWriteable(); });
+    read_helpers.emplace_back(new SocketReadHelper(pair[1], StripeReadDone));
+    SocketReadHelper* read_helper = read_helpers.back().get();
+    read_poller.AddFdWithOnlyReadHandler(
+        pair[1], [read_helper]() { read_helper->NotifyMeSocketReadable(); });
+  }
+  write_poller.Start();
+  read_poller.Start();
+  // the stripes of a read go through different sockets, so they arrive in any order
+  int64_t socket_cursor = 0;
+  FOR_RANGE(int64_t, i, 0, read_num) {
+    const SocketMsg msg =
+        NewRequestReadMsg(&src_mem_descs.at(i), &dst_mem_descs.at(i), &read_done_cnts.at(i));
+    const std::vector<SocketMsg> stripe_msgs =
+        SplitRequestReadMsg(msg, byte_size_and_stripe_num.at(i).second);
+    int64_t next_offset = 0;
+    for (const SocketMsg& stripe_msg : stripe_msgs) {
+      ASSERT_EQ(stripe_msg.request_read_msg.offset, next_offset);
+      next_offset += stripe_msg.request_read_msg.byte_size;
+    }
+    ASSERT_EQ(next_offset, byte_size_and_stripe_num.at(i).first);
+    for (const SocketMsg& stripe_msg : stripe_msgs) {
+      write_helpers.at(socket_cursor++ % socket_num)->AsyncWrite(stripe_msg);
+    }
+  }
+  bc.WaitUntilCntEqualZero();
+  write_poller.Stop();
+  read_poller.Stop();
+  FOR_RANGE(int64_t, i, 0, read_num) {
+    ASSERT_EQ(read_done_cnts.at(i).load(), 1);
+    ASSERT_TRUE(dsts.at(i) == srcs.at(i)) << "read " << i;
+  }
+  ASSERT_TRUE(stripe_read_counter.Empty());
+}
+
+TEST(SocketWriteHelper, DISABLED_benchmark_msg_rate) {
+  const int64_t msg_num = 256 * 1024;
+  std::vector<std::vector<SocketMsg>> socket2msgs(1,
+                                                  std::vector<SocketMsg>(msg_num, NewActorMsg()));
+  const double seconds = RunLoopback(socket2msgs, 0);
+  LOG(INFO) << "loopback " << msg_num << " msgs of " << sizeof(SocketMsg) << " bytes: "
+            << msg_num / seconds << " msgs/s";
+}
+
+TEST(SocketWriteHelper, DISABLED_benchmark_striped_body) {
+  const int64_t body_num = 64;
+  std::vector<char> body(16 * 1024 * 1024, 1);
+  SocketMemDesc mem_desc;
+  mem_desc.mem_ptr = body.data();
+  mem_desc.byte_size = body.size();
+  for (int32_t socket_num : {1, 2, 4}) {
+    const double seconds =
+        RunLoopback(StripeBodies(&mem_desc, body_num, socket_num), body_num * body.size());
+    LOG(INFO) << "loopback " << body_num << " bodies of " << body.size() << " bytes over "
+              << socket_num << " sockets: " << body_num * body.size() / seconds / 1e9 << " GB/s";
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // __linux__
@@ -0,0 +1,78 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_CPU_TEST_UTIL_H_
+#define ONEFLOW_CORE_COMMON_CPU_TEST_UTIL_H_
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+// Helpers of the tests and benchmarks of the cpu kernels and runtime
+
+namespace oneflow {
+
+namespace test {
+
+template<typename F>
+double MeasureMs(const F& f) {
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// uniform in [low, high), the same for the same seed
+template<typename T>
+std::vector<T> RandomVector(int64_t size, uint32_t seed, T low, T high) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<T> dis(low, high);
+  std::vector<T> vec(size);
+  for (T& val : vec) { val = dis(gen); }
+  return vec;
+}
+
+// Global<ThreadPool> of thread_num threads during the scope
+class ThreadPoolScope final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ThreadPoolScope);
+  explicit ThreadPoolScope(int32_t thread_num) {
+    CHECK(Global<ThreadPool>::Get() == nullptr) << "nested thread pool scopes";
+    Global<ThreadPool>::New(thread_num);
+  }
+  ~ThreadPoolScope() { Global<ThreadPool>::Delete(); }
+};
+
+// Runs every test with a Global<ThreadPool> of all the cores
+class ThreadPoolTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    thread_pool_scope_.reset(
+        new ThreadPoolScope(std::max<int32_t>(std::thread::hardware_concurrency(), 1)));
+  }
+  void TearDown() override { thread_pool_scope_.reset(); }
+
+ private:
+  std::unique_ptr<ThreadPoolScope> thread_pool_scope_;
+};
+
+}  // namespace test
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_CPU_TEST_UTIL_H_
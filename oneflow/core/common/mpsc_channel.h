@@ -0,0 +1,268 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+#define ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+
+#include <atomic>
+#include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// A multi-producer single-consumer alternative to Channel. Send is lock-free while the bounded
+// ring has room, ReceiveMany takes every ready item in one call, and an idle receiver spins for a
+// while before parking, adapting the spin length to how often spinning pays off.
+//
+// Send never blocks: when the ring is full items go to a mutex guarded overflow queue, so a
+// thread may send to a channel it consumes itself and cyclic senders cannot deadlock. Items from
+// the same sender are received in send order. Only one thread may call Receive/ReceiveMany.
+// T must be default constructible and move assignable.
+template<typename T>
+class MpscChannel final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MpscChannel);
+  explicit MpscChannel(size_t capacity);
+  MpscChannel() : MpscChannel(kDefaultCapacity) {}
+  ~MpscChannel() = default;
+
+  template<typename U>
+  ChannelStatus Send(U&& item);
+  ChannelStatus Receive(T* item);
+  ChannelStatus ReceiveMany(std::queue<T>* items);
+  void Close();
+
+ private:
+  static constexpr size_t kDefaultCapacity = 4096;
+  static constexpr int64_t kMinSpinCnt = 16;
+  static constexpr int64_t kMaxSpinCnt = 1 << 14;
+  static constexpr size_t kCacheLineSize = 64;
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  template<typename U>
+  bool TryPushRing(U&& item);
+  bool TryPopRing(T* item);
+  bool IsHeadReady() const {
+    const Cell& cell = cells_[dequeue_pos_ & mask_];
+    return cell.sequence.load(std::memory_order_acquire) == dequeue_pos_ + 1;
+  }
+  bool HasItem() const {
+    return IsHeadReady() || has_overflow_.load(std::memory_order_acquire);
+  }
+  // Returns the number of items moved into items
+  size_t TryReceiveMany(std::queue<T>* items);
+  void WaitUntilHasItemOrClosed();
+  void NotifyIfParked();
+  void WakeUpIfParked();
+
+  // The padding keeps the fields written by senders and by the receiver on separate cache lines.
+  // alignas would over-align the channel, which is a member of objects allocated with plain new.
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  char padding0_[kCacheLineSize];
+  std::atomic<size_t> enqueue_pos_;
+  char padding1_[kCacheLineSize];
+  size_t dequeue_pos_;
+  int64_t spin_cnt_;
+  std::queue<T> received_;
+
+  char padding2_[kCacheLineSize];
+  std::atomic<bool> has_overflow_;
+  std::atomic<bool> is_parked_;
+  std::atomic<bool> is_closed_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::queue<T> overflow_;
+};
+
+template<typename T>
+MpscChannel<T>::MpscChannel(size_t capacity)
+    : enqueue_pos_(0),
+      dequeue_pos_(0),
+      spin_cnt_(kMinSpinCnt),
+      has_overflow_(false),
+      is_parked_(false),
+      is_closed_(false) {
+  size_t ring_size = 2;
+  while (ring_size < capacity) { ring_size *= 2; }
+  cells_.reset(new Cell[ring_size]);
+  mask_ = ring_size - 1;
+  FOR_RANGE(size_t, i, 0, ring_size) { cells_[i].sequence.store(i, std::memory_order_relaxed); }
+}
+
+template<typename T>
+template<typename U>
+bool MpscChannel<T>::TryPushRing(U&& item) {
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  Cell* cell = nullptr;
+  while (true) {
+    cell = &cells_[pos & mask_];
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+  cell->value = std::forward<U>(item);
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+template<typename T>
+bool MpscChannel<T>::TryPopRing(T* item) {
+  Cell* cell = &cells_[dequeue_pos_ & mask_];
+  if (cell->sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) { return false; }
+  *item = std::move(cell->value);
+  cell->sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+  dequeue_pos_ += 1;
+  return true;
+}
+
+template<typename T>
+template<typename U>
+ChannelStatus MpscChannel<T>::Send(U&& item) {
+  if (is_closed_.load(std::memory_order_acquire)) { return kChannelStatusErrorClosed; }
+  // Once some sender overflowed, everyone goes through the overflow queue until the receiver
+  // drains it, otherwise a sender's later items could overtake its overflowed ones.
+  if (!has_overflow_.load(std::memory_order_acquire) && TryPushRing(std::forward<U>(item))) {
+    NotifyIfParked();
+    return kChannelStatusSuccess;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  overflow_.push(std::forward<U>(item));
+  has_overflow_.store(true, std::memory_order_release);
+  WakeUpIfParked();
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+void MpscChannel<T>::NotifyIfParked() {
+  // Pairs with the fence in WaitUntilHasItemOrClosed: either the receiver sees the new item or
+  // this sender sees the receiver parked
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (is_parked_.load(std::memory_order_relaxed)) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    WakeUpIfParked();
+  }
+}
+
+template<typename T>
+void MpscChannel<T>::WakeUpIfParked() {
+  // Called with mutex_ held. Only the first sender after parking pays for the notify.
+  if (is_parked_.load(std::memory_order_relaxed)) {
+    is_parked_.store(false, std::memory_order_relaxed);
+    cond_.notify_one();
+  }
+}
+
+template<typename T>
+size_t MpscChannel<T>::TryReceiveMany(std::queue<T>* items) {
+  const size_t size_before = items->size();
+  T item;
+  if (has_overflow_.load(std::memory_order_acquire)) {
+    // Items claimed in the ring before the overflow was swapped out were sent before the
+    // overflowed ones, so wait for all of them before taking the overflow.
+    std::queue<T> overflow;
+    size_t enqueue_pos = 0;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+      overflow.swap(overflow_);
+      has_overflow_.store(false, std::memory_order_release);
+    }
+    while (dequeue_pos_ < enqueue_pos) {
+      if (TryPopRing(&item)) {
+        items->push(std::move(item));
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    while (!overflow.empty()) {
+      items->push(std::move(overflow.front()));
+      overflow.pop();
+    }
+  }
+  while (TryPopRing(&item)) { items->push(std::move(item)); }
+  return items->size() - size_before;
+}
+
+template<typename T>
+void MpscChannel<T>::WaitUntilHasItemOrClosed() {
+  FOR_RANGE(int64_t, i, 0, spin_cnt_) {
+    if (HasItem()) {
+      if (spin_cnt_ < kMaxSpinCnt) { spin_cnt_ *= 2; }
+      return;
+    }
+    if (i >= kMinSpinCnt) { std::this_thread::yield(); }
+  }
+  if (spin_cnt_ > kMinSpinCnt) { spin_cnt_ /= 2; }
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    is_parked_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (HasItem() || is_closed_.load(std::memory_order_acquire)) { break; }
+    cond_.wait(lock);
+  }
+  is_parked_.store(false, std::memory_order_relaxed);
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::ReceiveMany(std::queue<T>* items) {
+  if (!received_.empty()) {
+    while (!received_.empty()) {
+      items->push(std::move(received_.front()));
+      received_.pop();
+    }
+    TryReceiveMany(items);
+    return kChannelStatusSuccess;
+  }
+  while (TryReceiveMany(items) == 0) {
+    if (is_closed_.load(std::memory_order_acquire) && !HasItem()) {
+      return kChannelStatusErrorClosed;
+    }
+    WaitUntilHasItemOrClosed();
+  }
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::Receive(T* item) {
+  if (received_.empty()) {
+    const ChannelStatus status = ReceiveMany(&received_);
+    if (status != kChannelStatusSuccess) { return status; }
+  }
+  *item = std::move(received_.front());
+  received_.pop();
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+void MpscChannel<T>::Close() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  is_closed_.store(true, std::memory_order_release);
+  cond_.notify_all();
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
@@ -0,0 +1,113 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include <thread>
+#include "oneflow/core/common/mpsc_channel.h"
+
+namespace oneflow {
+namespace test {
+
+namespace {
+
+// Sends msg_num items from each of sender_num threads to one receiver draining them with
+// ReceiveMany, returns the received items per second
+template<typename ChannelT>
+double MeasureItemsPerSecond(ChannelT* channel, int64_t sender_num, int64_t msg_num) {
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> senders;
+  FOR_RANGE(int64_t, i, 0, sender_num) {
+    senders.emplace_back([channel, msg_num]() {
+      FOR_RANGE(int64_t, j, 0, msg_num) { CHECK_EQ(channel->Send(j), kChannelStatusSuccess); }
+    });
+  }
+  std::queue<int64_t> items;
+  int64_t received_num = 0;
+  while (received_num < sender_num * msg_num) {
+    CHECK_EQ(channel->ReceiveMany(&items), kChannelStatusSuccess);
+    received_num += items.size();
+    std::queue<int64_t>().swap(items);
+  }
+  for (std::thread& sender : senders) { sender.join(); }
+  const auto end = std::chrono::steady_clock::now();
+  return received_num / std::chrono::duration<double>(end - start).count();
+}
+
+}  // namespace
+
+TEST(MpscChannel, per_sender_order) {
+  // a tiny ring makes most sends overflow
+  MpscChannel<std::pair<int64_t, int64_t>> channel(16);
+  const int64_t sender_num = 8;
+  const int64_t msg_num = 20000;
+  std::vector<std::thread> senders;
+  FOR_RANGE(int64_t, i, 0, sender_num) {
+    senders.emplace_back([&channel, i, msg_num]() {
+      FOR_RANGE(int64_t, j, 0, msg_num) { channel.Send(std::make_pair(i, j)); }
+    });
+  }
+  std::vector<int64_t> next_seq(sender_num, 0);
+  std::queue<std::pair<int64_t, int64_t>> items;
+  int64_t received_num = 0;
+  while (received_num < sender_num * msg_num) {
+    ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusSuccess);
+    while (!items.empty()) {
+      ASSERT_EQ(items.front().second, next_seq.at(items.front().first));
+      next_seq.at(items.front().first) += 1;
+      items.pop();
+      received_num += 1;
+    }
+  }
+  for (std::thread& sender : senders) { sender.join(); }
+}
+
+TEST(MpscChannel, send_to_self_when_full) {
+  MpscChannel<int> channel(4);
+  FOR_RANGE(int, i, 0, 100) { ASSERT_EQ(channel.Send(i), kChannelStatusSuccess); }
+  FOR_RANGE(int, i, 0, 100) {
+    int item = -1;
+    ASSERT_EQ(channel.Receive(&item), kChannelStatusSuccess);
+    ASSERT_EQ(item, i);
+  }
+}
+
+TEST(MpscChannel, close) {
+  MpscChannel<int> channel;
+  std::thread receiver([&channel]() {
+    int sum = 0;
+    int item = 0;
+    while (channel.Receive(&item) == kChannelStatusSuccess) { sum += item; }
+    ASSERT_EQ(sum, 45);
+  });
+  FOR_RANGE(int, i, 0, 10) { channel.Send(i); }
+  channel.Close();
+  ASSERT_EQ(channel.Send(10), kChannelStatusErrorClosed);
+  receiver.join();
+}
+
+TEST(MpscChannel, DISABLED_benchmark_many_senders) {
+  const int64_t msg_num = 200000;
+  for (int64_t sender_num : {1, 4, 16}) {
+    Channel<int64_t> channel;
+    MpscChannel<int64_t> mpsc_channel;
+    const double channel_items_per_sec = MeasureItemsPerSecond(&channel, sender_num, msg_num);
+    const double mpsc_items_per_sec = MeasureItemsPerSecond(&mpsc_channel, sender_num, msg_num);
+    LOG(INFO) << sender_num << " senders: Channel " << channel_items_per_sec
+              << " items/s, MpscChannel " << mpsc_items_per_sec << " items/s";
+  }
+}
+
+}  // namespace test
+}  // namespace oneflow
@@ -16,6 +16,11 @@ limitations under the License.
 #include "oneflow/core/device/memory_copier.h"
 #include "oneflow/core/common/auto_registration_factory.h"
 #include "oneflow/core/common/nd_index_offset_helper.h"
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/thread/thread_pool.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace oneflow {
 
@@ -162,6 +167,10 @@ void MemoryCopier::Copy(DeviceCtx* ctx, void* dst, const void* src,
   }
 }
 
+void MemoryCopier::CopyBatch(DeviceCtx* ctx, const std::vector<MemoryCopyTask>& tasks) const {
+  for (const MemoryCopyTask& task : tasks) { Copy(ctx, task.dst, task.src, task.desc); }
+}
+
 template<typename T>
 void MemoryCopier::CopyElem(DeviceCtx* ctx, void* dst, const void* src,
                             const MemoryCopyNdDesc& desc) const {
@@ -203,22 +212,240 @@ void MemoryCopier::CopyND(DeviceCtx* ctx, void* dst, const void* src,
   UNIMPLEMENTED();
 }
 
+namespace {
+
+// Pieces of a parallel host copy are about this large
+constexpr int64_t kHostCopyPieceBytes = 256 * 1024;
+// Rows shorter than this are not worth the alignment prologue of non-temporal stores
+constexpr int64_t kHostCopyMinNonTemporalRowBytes = 256;
+
+int64_t HostCopyParallelThreshold() {
+  static const int64_t threshold =
+      ParseIntegerFromEnv("ONEFLOW_HOST_MEMORY_COPIER_PARALLEL_THRESHOLD", 1024 * 1024);
+  return threshold;
+}
+
+int64_t HostCopyNonTemporalThreshold() {
+  static const int64_t threshold = ParseIntegerFromEnv(
+      "ONEFLOW_HOST_MEMORY_COPIER_NON_TEMPORAL_THRESHOLD", 32 * 1024 * 1024);
+  return threshold;
+}
+
+// A host N-d copy as rows of the innermost axis. Axes copied whole are folded into the axis
+// before them, strides are in bytes and dst/src point at the first byte of the copy.
+struct HostNdCopyPlan {
+  unsigned char* dst;
+  const unsigned char* src;
+  int64_t row_bytes;
+  int64_t row_cnt;
+  DimVector outer_extent;
+  DimVector dst_outer_stride;
+  DimVector src_outer_stride;
+};
+
+HostNdCopyPlan MakeHostNdCopyPlan(void* dst, const void* src, const MemoryCopyNdDesc& desc) {
+  const int64_t num_axes = MemoryCopyNdDescGetNumAxes(desc);
+  CHECK_GT(num_axes, 0);
+  DimVector extent;
+  DimVector dst_dim;
+  DimVector src_dim;
+  DimVector dst_pos;
+  DimVector src_pos;
+  FOR_RANGE(int64_t, i, 0, num_axes) {
+    if (i != 0 && desc.dst_shape.At(i) == desc.extent.At(i)
+        && desc.src_shape.At(i) == desc.extent.At(i) && desc.dst_pos.At(i) == 0
+        && desc.src_pos.At(i) == 0) {
+      extent.back() *= desc.extent.At(i);
+      dst_dim.back() *= desc.dst_shape.At(i);
+      src_dim.back() *= desc.src_shape.At(i);
+      dst_pos.back() *= desc.extent.At(i);
+      src_pos.back() *= desc.extent.At(i);
+    } else {
+      extent.push_back(desc.extent.At(i));
+      dst_dim.push_back(desc.dst_shape.At(i));
+      src_dim.push_back(desc.src_shape.At(i));
+      dst_pos.push_back(desc.dst_pos.At(i));
+      src_pos.push_back(desc.src_pos.At(i));
+    }
+  }
+  const int64_t reduced_num_axes = extent.size();
+  HostNdCopyPlan plan;
+  int64_t dst_offset = 0;
+  int64_t src_offset = 0;
+  int64_t dst_stride = 1;
+  int64_t src_stride = 1;
+  plan.outer_extent.resize(reduced_num_axes - 1);
+  plan.dst_outer_stride.resize(reduced_num_axes - 1);
+  plan.src_outer_stride.resize(reduced_num_axes - 1);
+  for (int64_t i = reduced_num_axes - 1; i >= 0; --i) {
+    dst_offset += dst_pos.at(i) * dst_stride;
+    src_offset += src_pos.at(i) * src_stride;
+    if (i != reduced_num_axes - 1) {
+      plan.outer_extent.at(i) = extent.at(i);
+      plan.dst_outer_stride.at(i) = dst_stride;
+      plan.src_outer_stride.at(i) = src_stride;
+    }
+    dst_stride *= dst_dim.at(i);
+    src_stride *= src_dim.at(i);
+  }
+  plan.dst = reinterpret_cast<unsigned char*>(dst) + dst_offset;
+  plan.src = reinterpret_cast<const unsigned char*>(src) + src_offset;
+  plan.row_bytes = extent.back();
+  plan.row_cnt = 1;
+  for (int64_t dim : plan.outer_extent) { plan.row_cnt *= dim; }
+  return plan;
+}
+
+void CopyHostRow(unsigned char* dst, const unsigned char* src, int64_t n, bool non_temporal) {
+#if defined(__SSE2__)
+  if (non_temporal && n >= kHostCopyMinNonTemporalRowBytes) {
+    const int64_t head = (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15;
+    std::memcpy(dst, src, head);
+    int64_t i = head;
+    for (; i + 64 <= n; i += 64) {
+      const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16));
+      const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 32));
+      const __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 48));
+      _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i), v0);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 16), v1);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 32), v2);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i + 48), v3);
+    }
+    std::memcpy(dst + i, src + i, n - i);
+    return;
+  }
+#endif  // __SSE2__
+  std::memcpy(dst, src, n);
+}
+
+void FenceNonTemporalStores(bool non_temporal) {
+#if defined(__SSE2__)
+  if (non_temporal) { _mm_sfence(); }
+#endif  // __SSE2__
+}
+
+// Copies bytes [col_begin, col_end) of rows [row_begin, row_end)
+void CopyHostRows(const HostNdCopyPlan& plan, int64_t row_begin, int64_t row_end,
+                  int64_t col_begin, int64_t col_end, bool non_temporal) {
+  const int64_t num_outer_axes = plan.outer_extent.size();
+  DimVector index(num_outer_axes);
+  int64_t dst_offset = col_begin;
+  int64_t src_offset = col_begin;
+  int64_t remaining = row_begin;
+  for (int64_t i = num_outer_axes - 1; i >= 0; --i) {
+    index.at(i) = remaining % plan.outer_extent.at(i);
+    remaining /= plan.outer_extent.at(i);
+    dst_offset += index.at(i) * plan.dst_outer_stride.at(i);
+    src_offset += index.at(i) * plan.src_outer_stride.at(i);
+  }
+  const int64_t n = col_end - col_begin;
+  for (int64_t row = row_begin; row < row_end; ++row) {
+    CopyHostRow(plan.dst + dst_offset, plan.src + src_offset, n, non_temporal);
+    // advance the outer index like an odometer
+    for (int64_t i = num_outer_axes - 1; i >= 0; --i) {
+      index.at(i) += 1;
+      dst_offset += plan.dst_outer_stride.at(i);
+      src_offset += plan.src_outer_stride.at(i);
+      if (index.at(i) < plan.outer_extent.at(i)) { break; }
+      dst_offset -= index.at(i) * plan.dst_outer_stride.at(i);
+      src_offset -= index.at(i) * plan.src_outer_stride.at(i);
+      index.at(i) = 0;
+    }
+  }
+}
+
+struct HostCopyPiece {
+  int64_t plan_id;
+  int64_t row_begin;
+  int64_t row_end;
+  int64_t col_begin;
+  int64_t col_end;
+};
+
+void CopyHostPlans(const std::vector<HostNdCopyPlan>& plans, int64_t non_temporal_threshold) {
+  int64_t total_bytes = 0;
+  for (const HostNdCopyPlan& plan : plans) { total_bytes += plan.row_bytes * plan.row_cnt; }
+  const bool non_temporal = total_bytes >= non_temporal_threshold;
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (thread_pool == nullptr || thread_pool->thread_num() <= 1
+      || total_bytes < HostCopyParallelThreshold()) {
+    for (const HostNdCopyPlan& plan : plans) {
+      CopyHostRows(plan, 0, plan.row_cnt, 0, plan.row_bytes, non_temporal);
+    }
+    FenceNonTemporalStores(non_temporal);
+    return;
+  }
+  // Rows longer than a piece are split by columns, shorter ones are grouped
+  std::vector<HostCopyPiece> pieces;
+  FOR_RANGE(int64_t, plan_id, 0, plans.size()) {
+    const HostNdCopyPlan& plan = plans.at(plan_id);
+    if (plan.row_bytes >= kHostCopyPieceBytes) {
+      const int64_t col_piece_num =
+          (plan.row_bytes + kHostCopyPieceBytes - 1) / kHostCopyPieceBytes;
+      FOR_RANGE(int64_t, row, 0, plan.row_cnt) {
+        FOR_RANGE(int64_t, j, 0, col_piece_num) {
+          pieces.push_back(HostCopyPiece{plan_id, row, row + 1, j * kHostCopyPieceBytes,
+                                         std::min((j + 1) * kHostCopyPieceBytes, plan.row_bytes)});
+        }
+      }
+    } else {
+      const int64_t rows_per_piece = kHostCopyPieceBytes / plan.row_bytes;
+      for (int64_t row = 0; row < plan.row_cnt; row += rows_per_piece) {
+        pieces.push_back(HostCopyPiece{plan_id, row, std::min(row + rows_per_piece, plan.row_cnt),
+                                       0, plan.row_bytes});
+      }
+    }
+  }
+  thread_pool->ParallelFor(pieces.size(), 1, [&](size_t begin, size_t end) {
+    FOR_RANGE(size_t, i, begin, end) {
+      const HostCopyPiece& piece = pieces.at(i);
+      CopyHostRows(plans.at(piece.plan_id), piece.row_begin, piece.row_end, piece.col_begin,
+                   piece.col_end, non_temporal);
+    }
+    FenceNonTemporalStores(non_temporal);
+  });
+}
+
+}  // namespace
+
+HostMemoryCopier::HostMemoryCopier() : HostMemoryCopier(HostCopyNonTemporalThreshold()) {}
+
+HostMemoryCopier::HostMemoryCopier(int64_t non_temporal_threshold)
+    : non_temporal_threshold_(non_temporal_threshold) {}
+
+void HostMemoryCopier::Copy(DeviceCtx* ctx, void* dst, const void* src,
+                            const MemoryCopyNdDesc& desc) const {
+  if (MemoryCopyNdDescGetNumAxes(desc) == 0) {
+    MemoryCopier::Copy(ctx, dst, src, desc);
+    return;
+  }
+  CheckMemoryCopyNdDesc(desc);
+  CopyHostPlans({MakeHostNdCopyPlan(dst, src, desc)}, non_temporal_threshold_);
+}
+
+void HostMemoryCopier::CopyBatch(DeviceCtx* ctx, const std::vector<MemoryCopyTask>& tasks) const {
+  std::vector<HostNdCopyPlan> plans;
+  plans.reserve(tasks.size());
+  for (const MemoryCopyTask& task : tasks) {
+    if (MemoryCopyNdDescGetNumAxes(task.desc) == 0) {
+      MemoryCopier::Copy(ctx, task.dst, task.src, task.desc);
+    } else {
+      CheckMemoryCopyNdDesc(task.desc);
+      plans.push_back(MakeHostNdCopyPlan(task.dst, task.src, task.desc));
+    }
+  }
+  CopyHostPlans(plans, non_temporal_threshold_);
+}
+
 void HostMemoryCopier::Copy1D(DeviceCtx* ctx, void* dst, const void* src, size_t count) const {
   memcpy(dst, src, count);
 }
 
 void HostMemoryCopier::CopyND(DeviceCtx* ctx, void* dst, const void* src,
                               const MemoryCopyNdDesc& desc) const {
-  const int32_t num_axes = desc.src_shape.NumAxes();
-  if (num_axes == 4) {
-    CopyNDCpuImpl<4>(ctx, dst, src, desc);
-  } else if (num_axes == 5) {
-    CopyNDCpuImpl<5>(ctx, dst, src, desc);
-  } else if (num_axes == 6) {
-    CopyNDCpuImpl<6>(ctx, dst, src, desc);
-  } else {
-    UNIMPLEMENTED();
-  }
+  CheckMemoryCopyNdDesc(desc);
+  CopyHostPlans({MakeHostNdCopyPlan(dst, src, desc)}, non_temporal_threshold_);
 }
 
 #ifdef WITH_CUDA
@@ -34,6 +34,12 @@ struct MemoryCopyNdDesc {
   MemoryCopyNdDesc CreateDimReducedDesc() const;
 };
 
+struct MemoryCopyTask {
+  void* dst;
+  const void* src;
+  MemoryCopyNdDesc desc;
+};
+
 template<int32_t NDIMS>
 void CopyNDCpuImpl(DeviceCtx* ctx, void* dst, const void* src, const MemoryCopyNdDesc& desc);
 #ifdef WITH_CUDA
@@ -48,6 +54,9 @@ class MemoryCopier {
   virtual ~MemoryCopier() = default;
 
   virtual void Copy(DeviceCtx* ctx, void* dst, const void* src, const MemoryCopyNdDesc& desc) const;
+  // The dst regions of the tasks must not overlap. Copiers that can run copies concurrently
+  // dispatch the whole batch at once, others copy the tasks one by one.
+  virtual void CopyBatch(DeviceCtx* ctx, const std::vector<MemoryCopyTask>& tasks) const;
 
   template<typename T>
   void CopyElem(DeviceCtx* ctx, void* dst, const void* src, const MemoryCopyNdDesc& desc) const;
@@ -62,16 +71,26 @@ class MemoryCopier {
                       const MemoryCopyNdDesc& desc) const;
 };
 
+// Copies rows of the innermost axis with memcpy, splitting large copies and batches into pieces
+// run on Global<ThreadPool>. Copies larger than the last level cache use non-temporal stores so
+// that they do not evict the working set of other threads.
 class HostMemoryCopier final : public MemoryCopier {
  public:
   OF_DISALLOW_COPY_AND_MOVE(HostMemoryCopier);
-  HostMemoryCopier() = default;
+  HostMemoryCopier();
+  // copies of at least non_temporal_threshold bytes use non-temporal stores
+  explicit HostMemoryCopier(int64_t non_temporal_threshold);
   ~HostMemoryCopier() override = default;
 
  private:
+  void Copy(DeviceCtx* ctx, void* dst, const void* src,
+            const MemoryCopyNdDesc& desc) const override;
+  void CopyBatch(DeviceCtx* ctx, const std::vector<MemoryCopyTask>& tasks) const override;
   void Copy1D(DeviceCtx* ctx, void* dst, const void* src, size_t count) const override;
   void CopyND(DeviceCtx* ctx, void* dst, const void* src,
               const MemoryCopyNdDesc& desc) const override;
+
+  int64_t non_temporal_threshold_;
 };
 
 #ifdef WITH_CUDA
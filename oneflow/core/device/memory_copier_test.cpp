@@ -0,0 +1,204 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/device/memory_copier.h"
+#include "oneflow/core/common/cpu_test_util.h"
+#include <random>
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+MemoryCopyNdDesc NewDesc(const DimVector& dst_shape, const DimVector& src_shape,
+                         const DimVector& dst_pos, const DimVector& src_pos,
+                         const DimVector& extent) {
+  MemoryCopyNdDesc desc;
+  desc.dst_shape = Shape(dst_shape);
+  desc.src_shape = Shape(src_shape);
+  desc.dst_pos = NdIndex(dst_pos);
+  desc.src_pos = NdIndex(src_pos);
+  desc.extent = Shape(extent);
+  desc.data_type = DataType::kChar;
+  return desc;
+}
+
+// byte by byte reference
+void NaiveCopy(unsigned char* dst, const unsigned char* src, const MemoryCopyNdDesc& desc) {
+  const int64_t num_axes = desc.extent.NumAxes();
+  DimVector index(num_axes, 0);
+  FOR_RANGE(int64_t, i, 0, desc.extent.elem_cnt()) {
+    int64_t remaining = i;
+    int64_t dst_offset = 0;
+    int64_t src_offset = 0;
+    for (int64_t axis = num_axes - 1; axis >= 0; --axis) {
+      index.at(axis) = remaining % desc.extent.At(axis);
+      remaining /= desc.extent.At(axis);
+    }
+    FOR_RANGE(int64_t, axis, 0, num_axes) {
+      dst_offset = dst_offset * desc.dst_shape.At(axis) + desc.dst_pos.At(axis) + index.at(axis);
+      src_offset = src_offset * desc.src_shape.At(axis) + desc.src_pos.At(axis) + index.at(axis);
+    }
+    dst[dst_offset] = src[src_offset];
+  }
+}
+
+// one innermost memcpy at a time on the calling thread, like the copier before it went parallel
+void SerialRowCopy(unsigned char* dst, const unsigned char* src, const MemoryCopyNdDesc& desc) {
+  const int64_t num_axes = desc.extent.NumAxes();
+  const int64_t row_bytes = desc.extent.At(num_axes - 1);
+  const int64_t row_cnt = desc.extent.elem_cnt() / row_bytes;
+  DimVector index(num_axes, 0);
+  FOR_RANGE(int64_t, row, 0, row_cnt) {
+    int64_t remaining = row;
+    for (int64_t axis = num_axes - 2; axis >= 0; --axis) {
+      index.at(axis) = remaining % desc.extent.At(axis);
+      remaining /= desc.extent.At(axis);
+    }
+    int64_t dst_offset = 0;
+    int64_t src_offset = 0;
+    FOR_RANGE(int64_t, axis, 0, num_axes) {
+      dst_offset = dst_offset * desc.dst_shape.At(axis) + desc.dst_pos.At(axis) + index.at(axis);
+      src_offset = src_offset * desc.src_shape.At(axis) + desc.src_pos.At(axis) + index.at(axis);
+    }
+    std::memcpy(dst + dst_offset, src + src_offset, row_bytes);
+  }
+}
+
+std::vector<unsigned char> RandomBytes(int64_t size, std::mt19937* gen) {
+  std::vector<unsigned char> bytes(size);
+  for (auto& byte : bytes) { byte = static_cast<unsigned char>((*gen)()); }
+  return bytes;
+}
+
+const std::vector<MemoryCopyNdDesc>& TestDescs() {
+  static const std::vector<MemoryCopyNdDesc> descs = {
+      NewDesc({100}, {64}, {7}, {3}, {50}),
+      NewDesc({9, 33}, {17, 40}, {2, 5}, {8, 1}, {6, 25}),
+      NewDesc({4, 5, 6, 7}, {4, 5, 6, 7}, {0, 0, 0, 0}, {0, 0, 0, 0}, {4, 5, 6, 7}),
+      NewDesc({3, 8, 5, 16, 9}, {6, 4, 5, 20, 9}, {1, 2, 0, 3, 0}, {2, 0, 0, 1, 0},
+              {2, 4, 5, 13, 9}),
+      // unaligned rows long enough for non-temporal stores, with a tail of less than 64 bytes
+      NewDesc({4, 1000}, {5, 1200}, {1, 3}, {2, 11}, {3, 997}),
+      // large enough to be split into pieces, with rows split by columns
+      NewDesc({3, 1 << 20}, {2, 3 << 19}, {1, 100}, {0, 7}, {2, 1000003}),
+      // large enough to be split into pieces, with short rows grouped
+      NewDesc({8192, 64}, {8192, 256}, {0, 0}, {0, 64}, {8192, 64}),
+      // large enough to be split into pieces, with rows of non-temporal stores grouped
+      NewDesc({4096, 600}, {4096, 700}, {0, 1}, {0, 37}, {4096, 555}),
+  };
+  return descs;
+}
+
+void TestMatchesNaiveCopy(const MemoryCopier& copier) {
+  std::mt19937 gen(0);
+  for (const MemoryCopyNdDesc& desc : TestDescs()) {
+    const std::vector<unsigned char> src = RandomBytes(desc.src_shape.elem_cnt(), &gen);
+    std::vector<unsigned char> expected = RandomBytes(desc.dst_shape.elem_cnt(), &gen);
+    std::vector<unsigned char> dst = expected;
+    NaiveCopy(expected.data(), src.data(), desc);
+    copier.Copy(nullptr, dst.data(), src.data(), desc);
+    ASSERT_TRUE(dst == expected) << desc.extent.ToString();
+  }
+}
+
+}  // namespace
+
+class HostMemoryCopierTest : public ThreadPoolTest {
+ protected:
+  HostMemoryCopier host_copier_;
+  const MemoryCopier& copier() const { return host_copier_; }
+};
+
+TEST_F(HostMemoryCopierTest, matches_naive_copy) { TestMatchesNaiveCopy(copier()); }
+
+TEST_F(HostMemoryCopierTest, non_temporal_stores_match_naive_copy) {
+  // every copy takes the non-temporal path, the serial one below the parallel threshold
+  HostMemoryCopier non_temporal_copier(0);
+  TestMatchesNaiveCopy(non_temporal_copier);
+}
+
+TEST(HostMemoryCopier, non_temporal_stores_without_thread_pool) {
+  HostMemoryCopier non_temporal_copier(0);
+  TestMatchesNaiveCopy(non_temporal_copier);
+}
+
+TEST_F(HostMemoryCopierTest, copy_batch) {
+  // gather 16 S(0) pieces of a [4096, 512] byte tensor into one buffer
+  std::mt19937 gen(1);
+  const int64_t piece_num = 16;
+  const int64_t rows_per_piece = 256;
+  const int64_t cols = 512;
+  std::vector<std::vector<unsigned char>> srcs;
+  std::vector<MemoryCopyTask> tasks;
+  std::vector<unsigned char> dst(piece_num * rows_per_piece * cols, 0);
+  std::vector<unsigned char> expected(dst.size(), 0);
+  FOR_RANGE(int64_t, i, 0, piece_num) {
+    srcs.push_back(RandomBytes(rows_per_piece * cols, &gen));
+    MemoryCopyTask task;
+    task.dst = dst.data();
+    task.src = srcs.back().data();
+    task.desc = NewDesc({piece_num * rows_per_piece, cols}, {rows_per_piece, cols},
+                        {i * rows_per_piece, 0}, {0, 0}, {rows_per_piece, cols});
+    NaiveCopy(expected.data(), srcs.back().data(), task.desc);
+    tasks.push_back(task);
+  }
+  copier().CopyBatch(nullptr, tasks);
+  ASSERT_TRUE(dst == expected);
+}
+
+TEST_F(HostMemoryCopierTest, DISABLED_boxing_like_shapes_benchmark) {
+  // re-sharding a [vocab, hidden] fp32 embedding table between S(0) and S(1) over 4 ranks
+  const int64_t vocab = 262144;
+  const int64_t hidden_bytes = 128 * sizeof(float);
+  const int64_t parallel_num = 4;
+  std::mt19937 gen(2);
+  struct Case {
+    std::string name;
+    MemoryCopyNdDesc desc;
+  };
+  const std::vector<Case> cases = {
+      // S(0) piece -> S(1) piece: short rows out of a long pitch
+      {"S(0)->S(1)",
+       NewDesc({vocab, hidden_bytes / parallel_num}, {vocab / parallel_num, hidden_bytes},
+               {0, 0}, {0, 0}, {vocab / parallel_num, hidden_bytes / parallel_num})},
+      // S(1) piece -> S(0) piece
+      {"S(1)->S(0)",
+       NewDesc({vocab / parallel_num, hidden_bytes}, {vocab, hidden_bytes / parallel_num},
+               {0, 0}, {0, 0}, {vocab / parallel_num, hidden_bytes / parallel_num})},
+      // B -> S(0): one contiguous block
+      {"B->S(0)", NewDesc({vocab / parallel_num, hidden_bytes}, {vocab, hidden_bytes}, {0, 0},
+                          {vocab / parallel_num, 0}, {vocab / parallel_num, hidden_bytes})},
+  };
+  for (const Case& c : cases) {
+    const std::vector<unsigned char> src = RandomBytes(c.desc.src_shape.elem_cnt(), &gen);
+    std::vector<unsigned char> expected(c.desc.dst_shape.elem_cnt(), 0);
+    std::vector<unsigned char> dst(c.desc.dst_shape.elem_cnt(), 0);
+    const double serial_ms =
+        MeasureMs([&] { SerialRowCopy(expected.data(), src.data(), c.desc); });
+    const double copier_ms =
+        MeasureMs([&] { copier().Copy(nullptr, dst.data(), src.data(), c.desc); });
+    ASSERT_TRUE(dst == expected);
+    const double gb = c.desc.extent.elem_cnt() / (1024.0 * 1024.0 * 1024.0);
+    LOG(INFO) << c.name << " " << c.desc.extent.ToString() << ": serial " << serial_ms << " ms ("
+              << gb / (serial_ms / 1000) << " GB/s), host copier " << copier_ms << " ms ("
+              << gb / (copier_ms / 1000) << " GB/s)";
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
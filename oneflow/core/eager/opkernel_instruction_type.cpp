@@ -38,6 +38,7 @@ limitations under the License.
 #include "oneflow/core/register/ofblob.h"
 #include "oneflow/core/vm/symbol_storage.h"
 #include "oneflow/core/operator/op_node_signature_desc.h"
+#include "oneflow/core/profiler/timeline.h"
 #include "oneflow/core/operator/op_conf_symbol.h"
 #include "oneflow/user/kernels/stateful_local_opkernel.h"
 
@@ -579,6 +580,8 @@ struct LocalCallOpKernelUtil final {
 
   static inline Maybe<void> OpKernelCompute(LocalCallOpKernelPhyInstrOperand* operand,
                                             DeviceCtx* device_ctx, user_op::OpKernelState* state) {
+    profiler::TimelineRangeGuard timeline_guard(profiler::TimelineCategory::kKernel,
+                                                operand->opkernel().op_type_name().c_str(), -1);
     JUST(WithComputeContext(operand, device_ctx,
                             [&](user_op::KernelComputeContext* compute_ctx) -> Maybe<void> {
                               operand->user_opkernel()->Compute(compute_ctx, state);
@@ -31,6 +31,7 @@ limitations under the License.
 #include "oneflow/core/eager/eager_oneflow.h"
 #include "oneflow/core/common/container_util.h"
 #include "oneflow/core/rpc/include/global_process_ctx.h"
+#include "oneflow/core/vm/vm_util.h"
 #include "oneflow/core/vm/no_arg_cb_phy_instr_operand.h"
 #include "oneflow/core/vm/access_blob_arg_cb_phy_instr_operand.h"
 #include "oneflow/core/vm/release_tensor_arg_phy_instr_operand.h"
@@ -1636,21 +1637,51 @@ Maybe<void> LogicalRun(const std::function<Maybe<void>(InstructionsBuilder*)>& B
   return Maybe<void>::Ok();
 }
 
-Maybe<void> PhysicalRun(const std::function<Maybe<void>(InstructionsBuilder*)>& Build) {
-  vm::InstructionMsgList instruction_list;
-  vm::cfg::EagerSymbolList eager_symbol_list;
+namespace {
+
+bool IsDeferredSubmitEnabled() {
+  static const bool enabled = ParseBooleanFromEnv("ONEFLOW_VM_DEFERRED_SUBMIT", false);
+  return enabled;
+}
+
+Maybe<void> BuildPhysicalInstructions(
+    const std::function<Maybe<void>(InstructionsBuilder*)>& Build,
+    vm::InstructionMsgList* instruction_list, vm::cfg::EagerSymbolList* eager_symbol_list) {
   InstructionsBuilder instructions_builder(std::make_shared<vm::PhysicalIdGenerator>(),
-                                           &instruction_list, &eager_symbol_list,
+                                           instruction_list, eager_symbol_list,
                                            _ReleasePhysicalObject);
   JUST(Build(&instructions_builder));
   if (debug::RecordingInstructions()) {
-    OBJECT_MSG_LIST_FOR_EACH(instructions_builder.mut_instruction_list(), instruction_msg) {
+    OBJECT_MSG_LIST_FOR_EACH(instruction_list, instruction_msg) {
       debug::RecordInstruction(instruction_msg);
     }
   }
-  JUST(Global<vm::EagerOneflow>::Get()->RunPhysicalInstruction(
-      instructions_builder.mut_instruction_list(), instructions_builder.eager_symbol_list()));
   return Maybe<void>::Ok();
 }
 
+}  // namespace
+
+Maybe<void> PhysicalRun(const std::function<Maybe<void>(InstructionsBuilder*)>& Build) {
+  vm::InstructionMsgList instruction_list;
+  vm::cfg::EagerSymbolList eager_symbol_list;
+  JUST(BuildPhysicalInstructions(Build, &instruction_list, &eager_symbol_list));
+  JUST(Global<vm::EagerOneflow>::Get()->RunPhysicalInstruction(&instruction_list,
+                                                               eager_symbol_list));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> DeferredPhysicalRun(const std::function<Maybe<void>(InstructionsBuilder*)>& Build) {
+  if (!IsDeferredSubmitEnabled()) { return PhysicalRun(Build); }
+  vm::InstructionMsgList instruction_list;
+  vm::cfg::EagerSymbolList eager_symbol_list;
+  JUST(BuildPhysicalInstructions(Build, &instruction_list, &eager_symbol_list));
+  if (eager_symbol_list.eager_symbol_size() > 0) {
+    // The symbols have to be stored before the instructions using them run. vm::Run submits the
+    // deferred instructions ahead of these.
+    return Global<vm::EagerOneflow>::Get()->RunPhysicalInstruction(&instruction_list,
+                                                                   eager_symbol_list);
+  }
+  return vm::DeferredRun(&instruction_list);
+}
+
 }  // namespace oneflow
@@ -471,6 +471,10 @@ Maybe<void> LogicalRun(const std::function<Maybe<void>(InstructionsBuilder*)>& B
 
 Maybe<void> PhysicalRun(const std::function<Maybe<void>(InstructionsBuilder*)>& Build);
 
+// Same as PhysicalRun, except that with ONEFLOW_VM_DEFERRED_SUBMIT=1 the instructions are held
+// back and submitted to the vm together with later ones, see vm::DeferredRun.
+Maybe<void> DeferredPhysicalRun(const std::function<Maybe<void>(InstructionsBuilder*)>& Build);
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_FRAMEWORK_INSTRUCTIONS_BUILDER_H_
@@ -0,0 +1,224 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/mirrored_tensor_infer_cache.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/op_expr.h"
+#include "oneflow/user/kernels/stateful_local_opkernel.h"
+
+namespace oneflow {
+namespace one {
+
+namespace {
+
+int64_t MaxMirroredInferCacheSize() {
+  static const int64_t max_size =
+      ParseIntegerFromEnv("ONEFLOW_EAGER_MIRRORED_INFER_CACHE_SIZE", 1024);
+  return max_size;
+}
+
+class UserOpExprMirroredDeviceInferContext final : public user_op::DeviceInferContext {
+ public:
+  UserOpExprMirroredDeviceInferContext(const UserOpExpr* user_op_expr,
+                                       const MirroredTensorMetaInferArgs* infer_args)
+      : user_op_expr_(user_op_expr),
+        infer_args_(infer_args),
+        composed_attrs_(infer_args->attrs(), user_op_expr->base_attrs()),
+        out_tensor_devices_(user_op_expr_->output_size()) {}
+
+  const std::vector<std::pair<std::string, int32_t>>& inputs() const override {
+    return user_op_expr_->indexed_input_pairs();
+  }
+
+  const std::vector<std::pair<std::string, int32_t>>& outputs() const override {
+    return user_op_expr_->indexed_output_pairs();
+  }
+
+  Symbol<Device>* OutputTensorDevice4ArgNameAndIndex(const std::string& name,
+                                                     int64_t index) override {
+    const auto& arg_tuple = *user_op_expr_->output_arg_tuple();
+    int32_t tuple_index = arg_tuple.TensorTupleIndex4ArgNameAndIndex(name, index);
+    CHECK_GE(tuple_index, 0);
+    CHECK_LT(tuple_index, user_op_expr_->output_size());
+    return &out_tensor_devices_.at(tuple_index);
+  }
+
+  Symbol<Device> InputTensorDevice4ArgNameAndIndex(const std::string& name,
+                                                   int64_t index) const override {
+    const auto& arg_tuple = *user_op_expr_->input_arg_tuple();
+    int32_t tuple_index = arg_tuple.TensorTupleIndex4ArgNameAndIndex(name, index);
+    CHECK_GE(tuple_index, 0);
+    CHECK_LT(tuple_index, user_op_expr_->input_size());
+    return infer_args_->input_mirrored_tensor_metas().at(tuple_index).device();
+  }
+
+  const std::vector<Symbol<Device>>& out_tensor_devices() const { return out_tensor_devices_; }
+
+ private:
+  const std::shared_ptr<const user_op::AttrVal>& Attr4Name(
+      const std::string& attr_name) const override {
+    return composed_attrs_.Attr4Name(attr_name);
+  }
+  const UserOpExpr* user_op_expr_;
+  const MirroredTensorMetaInferArgs* infer_args_;
+  const ComposedAttrMap composed_attrs_;
+  std::vector<Symbol<Device>> out_tensor_devices_;
+};
+
+}  // namespace
+
+size_t InputMirroredTensorMeta::hash_value() const {
+  size_t hash_value = std::hash<Shape>()(shape_);
+  HashCombine(&hash_value, std::hash<Stride>()(stride_));
+  HashCombine(&hash_value, std::hash<int>()(static_cast<int>(data_type_)));
+  HashCombine(&hash_value, std::hash<bool>()(is_dynamic_));
+  HashCombine(&hash_value, std::hash<Symbol<Device>>()(device_));
+  return hash_value;
+}
+
+bool InputMirroredTensorMeta::operator==(const InputMirroredTensorMeta& other) const {
+  return this->data_type_ == other.data_type_ && this->is_dynamic_ == other.is_dynamic_
+         && this->device_ == other.device_ && this->shape_ == other.shape_
+         && this->stride_ == other.stride_;
+}
+
+void InputMirroredTensorMeta::assign(const Shape& shape, const Stride& stride, DataType data_type,
+                                     bool is_dynamic, Symbol<Device> device) {
+  shape_ = shape;
+  stride_ = stride;
+  data_type_ = data_type;
+  is_dynamic_ = is_dynamic;
+  device_ = device;
+}
+
+size_t MirroredTensorMetaInferArgs::hash_value() const {
+  size_t hash_value = std::hash<AttrMap>()(attrs_);
+  HashCombine(&hash_value, std::hash<Symbol<Device>>()(default_device_));
+  const auto& tensor_meta_hash_functor = std::hash<InputMirroredTensorMeta>();
+  for (const auto& tensor_meta : input_mirrored_tensor_metas_) {
+    HashCombine(&hash_value, tensor_meta_hash_functor(tensor_meta));
+  }
+  HashCombine(&hash_value, std::hash<std::vector<bool>>()(is_output_inplace_));
+  return hash_value;
+}
+
+bool MirroredTensorMetaInferArgs::operator==(const MirroredTensorMetaInferArgs& other) const {
+  return this->default_device_ == other.default_device_
+         && this->input_mirrored_tensor_metas_ == other.input_mirrored_tensor_metas_
+         && this->is_output_inplace_ == other.is_output_inplace_ && this->attrs_ == other.attrs_;
+}
+
+Maybe<void> MirroredTensorMetaInferArgs::Init(const AttrMap& attrs, Symbol<Device> default_device,
+                                              const TensorTuple& input_tensors,
+                                              const TensorTuple& output_tensors) {
+  attrs_ = attrs;
+  default_device_ = default_device;
+  input_mirrored_tensor_metas_.resize(input_tensors.size());
+  for (int i = 0; i < input_tensors.size(); ++i) {
+    const auto& tensor_impl = JUST(input_tensors.at(i)->mut_eager_mirrored_tensor_impl());
+    const auto& tensor_meta = *tensor_impl->tensor_meta();
+    static const Stride kEmptyStride;
+    const Stride& stride = tensor_meta.stride_ptr() ? tensor_meta.stride() : kEmptyStride;
+    input_mirrored_tensor_metas_.at(i).assign(tensor_meta.shape(), stride, tensor_meta.dtype(),
+                                              tensor_meta.is_dynamic(), tensor_meta.device());
+  }
+  is_output_inplace_.resize(output_tensors.size());
+  for (int i = 0; i < output_tensors.size(); ++i) {
+    is_output_inplace_.at(i) = static_cast<bool>(output_tensors.at(i));
+  }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<const MirroredTensorInferResult> MirroredTensorInferCache::Infer(
+    const UserOpExpr& user_op_expr, const MirroredTensorMetaInferArgs& infer_args) {
+  auto result = std::make_unique<MirroredTensorInferResult>(user_op_expr.output_size());
+  auto* output_metas = result->mut_output_metas();
+  const auto& input_metas = infer_args.input_mirrored_tensor_metas();
+  Symbol<Device> op_device;
+  bool need_event_record = false;
+  // Infer devices
+  if (!user_op_expr.has_device_infer_fn()) {
+    op_device = infer_args.default_device();
+    for (auto& output_meta : *output_metas) { output_meta.device = op_device; }
+  } else {
+    UserOpExprMirroredDeviceInferContext device_infer_ctx(&user_op_expr, &infer_args);
+    op_device = JUST(user_op_expr.device_infer_fn()(&device_infer_ctx));
+    for (int i = 0; i < output_metas->size(); ++i) {
+      output_metas->at(i).device = device_infer_ctx.out_tensor_devices().at(i);
+    }
+    for (const auto& input_meta : input_metas) {
+      need_event_record = need_event_record || !(*op_device == *input_meta.device());
+    }
+  }
+  result->set_op_device(op_device);
+  result->set_need_check_mem_case(!user_op_expr.has_device_infer_fn());
+  result->set_need_event_record(need_event_record);
+  result->set_op_parallel_desc(JUST(Placement4Device(op_device)).shared_from_symbol());
+
+  // Infer shapes and dtypes
+  std::vector<TensorMeta> input_tensor_metas;
+  input_tensor_metas.reserve(input_metas.size());
+  for (const auto& input_meta : input_metas) {
+    input_tensor_metas.emplace_back(std::make_shared<const Shape>(input_meta.shape()),
+                                    input_meta.data_type());
+    input_tensor_metas.back().set_is_dynamic(input_meta.is_dynamic());
+  }
+  std::vector<TensorMeta> output_tensor_metas;
+  output_tensor_metas.reserve(output_metas->size());
+  for (int i = 0; i < output_metas->size(); ++i) {
+    output_tensor_metas.emplace_back(std::make_shared<const Shape>(), kInvalidDataType);
+  }
+  const auto& device_tag = JUST(op_device->of_type());
+  JUST(user_op_expr.InferLogicalShapeAndDType(
+      infer_args.attrs(), device_tag,
+      [&](int32_t i) -> const TensorMeta* { return &input_tensor_metas.at(i); },
+      [&](int32_t i) -> TensorMeta* { return &output_tensor_metas.at(i); }));
+  for (int i = 0; i < output_metas->size(); ++i) {
+    output_metas->at(i).shape = output_tensor_metas.at(i).shape_ptr();
+    output_metas->at(i).data_type = output_tensor_metas.at(i).data_type();
+    output_metas->at(i).is_dynamic = output_tensor_metas.at(i).is_dynamic();
+  }
+
+  // Kernel choice
+  result->set_kernel(JUST(user_op_expr.MutKernel4Device(op_device)));
+  result->set_instr_type_name(&JUST(op_device->local_call_instruction_name()));
+  return std::shared_ptr<const MirroredTensorInferResult>(std::move(result));
+}
+
+Maybe<const MirroredTensorInferResult> MirroredTensorInferCache::GetOrInfer(
+    const MirroredTensorMetaInferArgs& infer_args) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto iter = cache_.find(infer_args);
+    if (iter != cache_.end()) { return iter->second; }
+  }
+  const auto& user_op_expr = user_op_expr_.lock();
+  CHECK_OR_RETURN(static_cast<bool>(user_op_expr));
+  // inferred without the lock, another thread may insert the same args meanwhile
+  const auto& result = JUST(Infer(*user_op_expr, infer_args));
+  std::unique_lock<std::mutex> lock(mutex_);
+  const auto& emplaced = cache_.emplace(infer_args, result);
+  if (!emplaced.second) { return emplaced.first->second; }
+  keys_.push_back(&emplaced.first->first);
+  while (static_cast<int64_t>(keys_.size()) > MaxMirroredInferCacheSize()) {
+    cache_.erase(cache_.find(*keys_.front()));
+    keys_.pop_front();
+  }
+  return result;
+}
+
+}  // namespace one
+}  // namespace oneflow
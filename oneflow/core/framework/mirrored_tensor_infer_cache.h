@@ -0,0 +1,189 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_FRAMEWORK_MIRRORED_TENSOR_INFER_CACHE_H_
+#define ONEFLOW_CORE_FRAMEWORK_MIRRORED_TENSOR_INFER_CACHE_H_
+
+#include "oneflow/core/common/symbol.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/shape.h"
+#include "oneflow/core/framework/attr_map.h"
+#include "oneflow/core/framework/device.h"
+#include "oneflow/core/framework/stride.h"
+
+namespace oneflow {
+
+class ParallelDesc;
+class StatefulLocalOpKernel;
+
+namespace one {
+
+class TensorTuple;
+class UserOpExpr;
+
+// Shapes and strides are copied by value, tensors may change their shapes in place after the call
+class InputMirroredTensorMeta final {
+ public:
+  InputMirroredTensorMeta() : data_type_(kInvalidDataType), is_dynamic_(false) {}
+  InputMirroredTensorMeta(const InputMirroredTensorMeta&) = default;
+  InputMirroredTensorMeta(InputMirroredTensorMeta&&) = default;
+  ~InputMirroredTensorMeta() = default;
+  InputMirroredTensorMeta& operator=(const InputMirroredTensorMeta&) = default;
+
+  size_t hash_value() const;
+  bool operator==(const InputMirroredTensorMeta& other) const;
+
+  const Shape& shape() const { return shape_; }
+  const Stride& stride() const { return stride_; }
+  DataType data_type() const { return data_type_; }
+  bool is_dynamic() const { return is_dynamic_; }
+  Symbol<Device> device() const { return device_; }
+
+  void assign(const Shape& shape, const Stride& stride, DataType data_type, bool is_dynamic,
+              Symbol<Device> device);
+
+ private:
+  Shape shape_;
+  Stride stride_;
+  DataType data_type_;
+  bool is_dynamic_;
+  Symbol<Device> device_;
+};
+
+class MirroredTensorMetaInferArgs final {
+ public:
+  MirroredTensorMetaInferArgs() = default;
+  MirroredTensorMetaInferArgs(const MirroredTensorMetaInferArgs&) = default;
+  MirroredTensorMetaInferArgs(MirroredTensorMetaInferArgs&&) = default;
+  ~MirroredTensorMetaInferArgs() = default;
+
+  const AttrMap& attrs() const { return attrs_; }
+  Symbol<Device> default_device() const { return default_device_; }
+  const std::vector<InputMirroredTensorMeta>& input_mirrored_tensor_metas() const {
+    return input_mirrored_tensor_metas_;
+  }
+  // whether the output of the same index is given by the caller, i.e. inplace
+  const std::vector<bool>& is_output_inplace() const { return is_output_inplace_; }
+
+  size_t hash_value() const;
+
+  bool operator==(const MirroredTensorMetaInferArgs& other) const;
+
+  // Refills the args in place, so a thread local instance makes cache hits allocation free
+  Maybe<void> Init(const AttrMap& attrs, Symbol<Device> default_device,
+                   const TensorTuple& input_tensors, const TensorTuple& output_tensors);
+
+ private:
+  AttrMap attrs_;
+  Symbol<Device> default_device_;
+  std::vector<InputMirroredTensorMeta> input_mirrored_tensor_metas_;
+  std::vector<bool> is_output_inplace_;
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+namespace std {
+
+template<>
+struct hash<oneflow::one::InputMirroredTensorMeta> final {
+  size_t operator()(const oneflow::one::InputMirroredTensorMeta& val) const {
+    return val.hash_value();
+  }
+};
+
+template<>
+struct hash<oneflow::one::MirroredTensorMetaInferArgs> final {
+  size_t operator()(const oneflow::one::MirroredTensorMetaInferArgs& val) const {
+    return val.hash_value();
+  }
+};
+
+}  // namespace std
+
+namespace oneflow {
+namespace one {
+
+class MirroredTensorInferResult final {
+ public:
+  struct OutputMeta {
+    std::shared_ptr<const Shape> shape;
+    DataType data_type;
+    bool is_dynamic;
+    Symbol<Device> device;
+  };
+
+  explicit MirroredTensorInferResult(size_t output_size) : output_metas_(output_size) {}
+  MirroredTensorInferResult(const MirroredTensorInferResult&) = delete;
+  MirroredTensorInferResult(MirroredTensorInferResult&&) = delete;
+  ~MirroredTensorInferResult() = default;
+
+  const std::vector<OutputMeta>& output_metas() const { return output_metas_; }
+  std::vector<OutputMeta>* mut_output_metas() { return &output_metas_; }
+
+  const Symbol<Device>& op_device() const { return op_device_; }
+  const std::shared_ptr<const ParallelDesc>& op_parallel_desc() const { return op_parallel_desc_; }
+  const std::shared_ptr<StatefulLocalOpKernel>& kernel() const { return kernel_; }
+  const std::string& instr_type_name() const { return *instr_type_name_; }
+  bool need_check_mem_case() const { return need_check_mem_case_; }
+  bool need_event_record() const { return need_event_record_; }
+
+  void set_op_device(const Symbol<Device>& op_device) { op_device_ = op_device; }
+  void set_op_parallel_desc(const std::shared_ptr<const ParallelDesc>& op_parallel_desc) {
+    op_parallel_desc_ = op_parallel_desc;
+  }
+  void set_kernel(const std::shared_ptr<StatefulLocalOpKernel>& kernel) { kernel_ = kernel; }
+  void set_instr_type_name(const std::string* instr_type_name) {
+    instr_type_name_ = instr_type_name;
+  }
+  void set_need_check_mem_case(bool val) { need_check_mem_case_ = val; }
+  void set_need_event_record(bool val) { need_event_record_ = val; }
+
+ private:
+  std::vector<OutputMeta> output_metas_;
+  Symbol<Device> op_device_;
+  std::shared_ptr<const ParallelDesc> op_parallel_desc_;
+  std::shared_ptr<StatefulLocalOpKernel> kernel_;
+  const std::string* instr_type_name_;
+  bool need_check_mem_case_;
+  bool need_event_record_;
+};
+
+// MirroredTensorInferCache caches the inferred output metas, op device and kernel of an eager
+// mirrored op for identical attrs, input metas and inplace outputs. Past
+// ONEFLOW_EAGER_MIRRORED_INFER_CACHE_SIZE (default 1024) entries, e.g. under dynamic shapes, the
+// oldest entry is evicted. The op exprs are shared by threads, so the cache is guarded by a mutex.
+class MirroredTensorInferCache final {
+ public:
+  MirroredTensorInferCache(const std::shared_ptr<const UserOpExpr>& user_op_expr)
+      : user_op_expr_(user_op_expr) {}
+
+  Maybe<const MirroredTensorInferResult> GetOrInfer(const MirroredTensorMetaInferArgs& infer_args);
+
+  static Maybe<const MirroredTensorInferResult> Infer(
+      const UserOpExpr& user_op_expr, const MirroredTensorMetaInferArgs& infer_args);
+
+ private:
+  std::weak_ptr<const UserOpExpr> user_op_expr_;
+  std::mutex mutex_;
+  HashMap<MirroredTensorMetaInferArgs, std::shared_ptr<const MirroredTensorInferResult>> cache_;
+  // keys of cache_ in insertion order, elements of a HashMap keep their addresses
+  std::deque<const MirroredTensorMetaInferArgs*> keys_;
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_FRAMEWORK_MIRRORED_TENSOR_INFER_CACHE_H_
@@ -25,10 +25,12 @@ limitations under the License.
 #include "oneflow/core/functional/scalar.h"
 #include "oneflow/core/graph/op_graph.h"
 #include "oneflow/core/job/compiler.h"
+#include "oneflow/core/job/id_manager.h"
 #include "oneflow/core/job/job_build_and_infer_ctx_mgr.h"
 #include "oneflow/core/job/job_desc.h"
 #include "oneflow/core/job/job_instance.h"
 #include "oneflow/core/job/lazy_mode.h"
+#include "oneflow/core/job/plan_cache.h"
 #include "oneflow/core/job/plan_util.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/vm/vm_util.h"
@@ -189,20 +191,40 @@ Maybe<void> NNGraph::CompileAndInitRuntime() {
 
   auto scope = std::make_unique<GlobalJobDescScope>(job_.job_conf(), job_ctx->job_id());
   if (GlobalProcessCtx::IsThisProcessMaster()) {
-    double start = GetCurTime();
-    // TODO(chengcheng): new memory reused by chunk
-    Compiler().Compile(&job_, &plan_, /* need_job_complete */ true);
-    PlanUtil::GenMemBlockAndChunkWithVariableOpNames4Plan(&plan_, variable_op_names_);
+    const PlanCache* plan_cache = PlanCache::Get();
+    std::string plan_cache_key;
+    if (plan_cache != nullptr) {
+      plan_cache_key = PlanCache::GenKey(job_, job_ctx->job_id(), variable_op_names_);
+    }
+    std::string id_counters;
+    if (plan_cache != nullptr
+        && plan_cache->TryLoad(plan_cache_key, &job_, &plan_, &id_counters)) {
+      // NOTE: the ids of the loaded plan are the ones the compilation would generate. Restoring
+      // the counters exactly, including the ids compilation allocates and drops, keeps the keys
+      // of later graphs the same as with a real compilation.
+      Global<IDMgr>::Get()->RestoreIdCounters(id_counters);
+      Global<IDMgr>::Get()->SkipIdsOfPlan(plan_);
+    } else {
+      double start = GetCurTime();
+      // TODO(chengcheng): new memory reused by chunk
+      Compiler().Compile(&job_, &plan_, /* need_job_complete */ true);
+      PlanUtil::GenMemBlockAndChunkWithVariableOpNames4Plan(&plan_, variable_op_names_);
 
-    LOG(INFO) << "\njob_id: " << job_ctx->job_id() << " , job_name: " << name_
-              << " , compile time: " << (GetCurTime() - start) / 1000000000.0 << " seconds.\n";
-    if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()) {
-      TeePersistentLogStream::Create("job_" + name_ + "_plan")->Write(plan_);
+      const double compile_seconds = (GetCurTime() - start) / 1000000000.0;
+      PlanCache::AddCompileTime(compile_seconds);
+      LOG(INFO) << "\njob_id: " << job_ctx->job_id() << " , job_name: " << name_
+                << " , compile time: " << compile_seconds << " seconds.\n";
+      if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()) {
+        TeePersistentLogStream::Create("job_" + name_ + "_plan")->Write(plan_);
+      }
+      // TODO(chengcheng): test collective boxing for multi-job.
+      PlanUtil::GenCollectiveBoxingPlan(&job_, &plan_);
+      // PlanUtil::SetForceInplaceMemBlock(&plan_); NOTE(chengcheng): only for ssp.
+      PlanUtil::DumpCtrlRegstInfoToPlan(&plan_);
+      if (plan_cache != nullptr) {
+        plan_cache->Store(plan_cache_key, job_, plan_, Global<IDMgr>::Get()->IdCountersToString());
+      }
     }
-    // TODO(chengcheng): test collective boxing for multi-job.
-    PlanUtil::GenCollectiveBoxingPlan(&job_, &plan_);
-    // PlanUtil::SetForceInplaceMemBlock(&plan_); NOTE(chengcheng): only for ssp.
-    PlanUtil::DumpCtrlRegstInfoToPlan(&plan_);
   }
   if (GlobalProcessCtx::WorldSize() > 1) {
     std::string plan_name = "plan:" + job_name();
@@ -30,7 +30,9 @@ Maybe<void> RawCheckNcclP2B(Symbol<PlacedNdSbp> in, Symbol<PlacedNdSbp> out) {
   CHECK_OR_RETURN(EagerBoxingInterpreterUtil::IsAllBroadcastNdSbp(out->nd_sbp()));
 
   CHECK_OR_RETURN(in->placement() == out->placement());
-  CHECK_EQ_OR_RETURN(in->placement()->device_type(), DeviceType::kGPU);
+  // all reduce on cpu runs the ring or tree algorithms of ccl
+  const DeviceType device_type = in->placement()->device_type();
+  CHECK_OR_RETURN(device_type == DeviceType::kGPU || device_type == DeviceType::kCPU);
   return Maybe<void>::Ok();
 }
 
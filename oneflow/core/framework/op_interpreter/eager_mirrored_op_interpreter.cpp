@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/framework/op_interpreter.h"
 #include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
 #include "oneflow/core/framework/instructions_builder.h"
+#include "oneflow/core/framework/mirrored_tensor_infer_cache.h"
 #include "oneflow/core/framework/op_arg_util.h"
 #include "oneflow/core/framework/scope_util.h"
 #include "oneflow/core/framework/session_util.h"
@@ -57,30 +58,6 @@ Maybe<EagerMirroredTensorImpl*> TensorImpl4Tensor(const std::shared_ptr<Tensor>&
   return tensor->mut_eager_mirrored_tensor_impl();
 }
 
-class MutMirroredTensorMeta : public TensorMeta {
- public:
-  MutMirroredTensorMeta() : TensorMeta(std::make_shared<const Shape>(), kInvalidDataType) {}
-  MutMirroredTensorMeta(const MutMirroredTensorMeta&) = default;
-  MutMirroredTensorMeta(MutMirroredTensorMeta&&) = default;
-  ~MutMirroredTensorMeta() override = default;
-};
-
-std::vector<TensorMeta*>* ThreadLocalDefaultOutputMutTensorMetas(int64_t size) {
-  static thread_local std::vector<MutMirroredTensorMeta> struct_vec;
-  static thread_local std::vector<TensorMeta*> ptr_vec;
-  struct_vec.resize(size);
-  ptr_vec.resize(size);
-  if (size == 1) {
-    ptr_vec.at(0) = &struct_vec.at(0);  // unfold loop
-  } else if (size == 2) {
-    ptr_vec.at(0) = &struct_vec.at(0);  // unfold loop
-    ptr_vec.at(1) = &struct_vec.at(1);  // unfold loop
-  } else {
-    for (int i = 0; i < size; ++i) { ptr_vec.at(i) = &struct_vec.at(i); }
-  }
-  return &ptr_vec;
-}
-
 }  // namespace
 
 Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& inputs,
@@ -96,81 +73,54 @@ Maybe<void> NaiveInterpret(const UserOpExpr& user_op_expr, const TensorTuple& in
     }
     input_eager_blob_objects->at(i) = JUST(inputs.at(i)->eager_blob_object());
   }
+
+  // Infer devices, shapes, dtypes and the kernel, or reuse those of the same attrs and input metas
+  static thread_local MirroredTensorMetaInferArgs infer_args;
+  JUST(infer_args.Init(attrs, default_device, inputs, *outputs));
+  const auto& infer_result =
+      JUST(user_op_expr.mut_mirrored_tensor_infer_cache()->GetOrInfer(infer_args));
+  const auto& op_device = infer_result->op_device();
+
   std::shared_ptr<EagerBlobObjectList> output_eager_blob_objects =
       std::make_shared<EagerBlobObjectList>(outputs->size());
-  auto* output_tensor_metas = ThreadLocalDefaultOutputMutTensorMetas(outputs->size());
   for (int i = 0; i < outputs->size(); i++) {
+    const auto& output_meta = infer_result->output_metas().at(i);
     if (!outputs->at(i)) {
       const auto& tensor_impl = std::make_shared<EagerMirroredTensorImpl>();
       outputs->at(i) = std::make_shared<MirroredTensor>(tensor_impl);
-      output_tensor_metas->at(i) = tensor_impl->mut_tensor_meta();
-    } else {
-      bool has_eager_blob_object = JUST(outputs->at(i)->has_eager_blob_object());
-      CHECK_OR_RETURN(has_eager_blob_object);
-      output_eager_blob_objects->at(i) = JUST(outputs->at(i)->eager_blob_object());
-    }
-  }
-  Symbol<Device> op_device;
-  std::shared_ptr<const ParallelDesc> op_parallel_desc;
-  bool need_check_mem_case = true;
-  bool need_event_record = false;
-
-  // Infer devices
-  if (!user_op_expr.has_device_infer_fn()) {
-    op_device = default_device;
-    op_parallel_desc = JUST(Placement4Device(op_device)).shared_from_symbol();
-    for (int i = 0; i < outputs->size(); i++) {
-      auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
-      *JUST(tensor_impl->mut_device()) = default_device;
-    }
-  } else {
-    need_check_mem_case = false;
-    op_device = JUST(user_op_expr.InferDevices(attrs, inputs, outputs));
-    for (const auto& input_tensor : inputs) {
-      const auto& input_device = JUST(input_tensor->device());
-      need_event_record = need_event_record || !(*op_device == *input_device);
-    }
-    op_parallel_desc = JUST(Placement4Device(op_device)).shared_from_symbol();
-  }
-
-  // Infer shapes and dtypes
-  const auto& device_tag = JUST(op_device->of_type());
-  JUST(user_op_expr.InferLogicalShapeAndDType(
-      attrs, device_tag,
-      [&](int32_t i) -> const TensorMeta* {
-        return CHECK_JUST(TensorImpl4Tensor(inputs.at(i)))->mut_tensor_meta();
-      },
-      [&](int32_t i) -> TensorMeta* {
-        // using thread_local TensorMeta pointer if inplace.
-        // using tensor_impl TensorMeta pointer if not inplace.
-        return output_tensor_metas->at(i);
-      }));
-
-  for (int i = 0; i < output_eager_blob_objects->size(); i++) {
-    auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
-    if (!output_eager_blob_objects->at(i)) {
-      tensor_impl->mut_tensor_meta()->set_stride(std::make_shared<Stride>(*tensor_impl->shape()));
+      auto* tensor_meta = tensor_impl->mut_tensor_meta();
+      if (output_meta.device) { *tensor_meta->mut_device() = output_meta.device; }
+      // the shape is copied since the kernel may change it in place
+      tensor_meta->set_shape(std::make_shared<const Shape>(*output_meta.shape));
+      tensor_meta->set_dtype(output_meta.data_type);
+      tensor_meta->set_is_dynamic(output_meta.is_dynamic);
+      tensor_meta->set_stride(std::make_shared<Stride>(*tensor_impl->shape()));
       const auto& dep_object = JUST(GetLocalDepObjectFromDevicePool(op_device));
       JUST(tensor_impl->InitEagerBlobObject(dep_object));
       output_eager_blob_objects->at(i) = JUST(tensor_impl->eager_blob_object());
     } else {
       // output i is inplaced.
-      // check thread_local TensorMeta and tensor_impl TensorMeta.
-      CHECK_OR_RETURN(tensor_impl->tensor_meta()->shape() == output_tensor_metas->at(i)->shape());
-      CHECK_OR_RETURN(tensor_impl->tensor_meta()->dtype() == output_tensor_metas->at(i)->dtype());
+      bool has_eager_blob_object = JUST(outputs->at(i)->has_eager_blob_object());
+      CHECK_OR_RETURN(has_eager_blob_object);
+      auto* tensor_impl = JUST(TensorImpl4Tensor(outputs->at(i)));
+      if (output_meta.device) { *JUST(tensor_impl->mut_device()) = output_meta.device; }
+      CHECK_OR_RETURN(tensor_impl->tensor_meta()->shape() == *output_meta.shape);
+      CHECK_OR_RETURN(tensor_impl->tensor_meta()->dtype() == output_meta.data_type);
+      output_eager_blob_objects->at(i) = JUST(outputs->at(i)->eager_blob_object());
     }
   }
 
-  const auto& kernel = JUST(user_op_expr.MutKernel4Device(op_device));
-  kernel->set_need_check_mem_case(need_check_mem_case);
+  const auto& kernel = infer_result->kernel();
+  kernel->set_need_check_mem_case(infer_result->need_check_mem_case());
 
   for (int64_t index : kernel->output_tuple_indexes4mut2_obns()) {
     output_eager_blob_objects->at(index)->set_is_shape_synced(false);
   }
 
-  const auto& instr_type_name = JUST(op_device->local_call_instruction_name());
-  JUST(PhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
-    if (need_event_record) {
+  const auto& op_parallel_desc = infer_result->op_parallel_desc();
+  const auto& instr_type_name = infer_result->instr_type_name();
+  JUST(DeferredPhysicalRun([&](InstructionsBuilder* builder) -> Maybe<void> {
+    if (infer_result->need_event_record()) {
       for (const auto& input_tensor : inputs) {
         const auto& tensor = JUST(input_tensor->AsMirroredTensor());
         CHECK_OR_RETURN(static_cast<bool>(tensor));
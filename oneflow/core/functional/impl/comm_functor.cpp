@@ -114,22 +114,25 @@ class LocalAllReduceFunctor {
  public:
   LocalAllReduceFunctor() = default;
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& x) const {
-    {
-      const auto& device = JUST(x->device());
-      CHECK_EQ_OR_RETURN(JUST(device->of_type()), "gpu");
+    const auto& device = JUST(x->device());
+    const std::string& device_tag = JUST(device->of_type());
+    CHECK_OR_RETURN(device_tag == "gpu" || device_tag == "cpu");
+    if (device_tag == "gpu") {
       CHECK_EQ_OR_RETURN(device->device_id(), GlobalProcessCtx::LocalRank());
     }
-    static thread_local std::unordered_map<Symbol<RankGroup>, std::shared_ptr<OpExpr>>
-        rank_group2op_expr;
+    static thread_local HashMap<std::string, HashMap<Symbol<RankGroup>, std::shared_ptr<OpExpr>>>
+        device_tag2rank_group2op_expr;
+    auto* rank_group2op_expr = &device_tag2rank_group2op_expr[device_tag];
     const auto& rank_group = JUST(RankGroupScope::CurrentRankGroup());
-    auto iter = rank_group2op_expr.find(rank_group);
+    auto iter = rank_group2op_expr->find(rank_group);
     std::shared_ptr<OpExpr> op_expr;
-    if (iter == rank_group2op_expr.end()) {
+    if (iter == rank_group2op_expr->end()) {
       ParallelConf parallel_conf;
-      parallel_conf.set_device_tag("gpu");
-      JUST(rank_group->ForEachRank([&parallel_conf](int64_t rank) -> Maybe<void> {
+      parallel_conf.set_device_tag(device_tag);
+      JUST(rank_group->ForEachRank([&](int64_t rank) -> Maybe<void> {
+        const int64_t device_id = device_tag == "gpu" ? GlobalProcessCtx::LocalRank(rank) : 0;
         parallel_conf.add_device_name("@" + std::to_string(rank) + ":"
-                                      + std::to_string(GlobalProcessCtx::LocalRank(rank)));
+                                      + std::to_string(device_id));
         return Maybe<void>::Ok();
       }));
 
@@ -139,7 +142,7 @@ class LocalAllReduceFunctor {
                          .Attr("parallel_conf", PbMessage2TxtString(parallel_conf))
                          .Attr<bool>("async_launch", true)
                          .Build());
-      rank_group2op_expr[rank_group] = op_expr;
+      (*rank_group2op_expr)[rank_group] = op_expr;
     } else {
       op_expr = iter->second;
     }
@@ -159,7 +162,8 @@ class ConsistentAllReduceFunctor {
     {
       CHECK_OR_RETURN(x->is_consistent());
       CHECK_OR_RETURN(IsAllPartialSumNdSbp(JUST(x->nd_sbp())));
-      CHECK_EQ_OR_RETURN(JUST(x->parallel_desc())->device_type(), DeviceType::kGPU);
+      const auto& device_type = JUST(x->parallel_desc())->device_type();
+      CHECK_OR_RETURN(device_type == DeviceType::kGPU || device_type == DeviceType::kCPU);
     }
     std::shared_ptr<OpExpr> op_expr =
         JUST(CachedEagerNcclAllReduceOpExpr(JUST(x->parallel_desc())));
@@ -181,7 +185,8 @@ class ConsistentReduceScatterFunctor {
       } else {
         UNIMPLEMENTED_THEN_RETURN();
       }
-      CHECK_EQ_OR_RETURN(JUST(x->parallel_desc())->device_type(), DeviceType::kGPU);
+      const auto& device_type = JUST(x->parallel_desc())->device_type();
+      CHECK_OR_RETURN(device_type == DeviceType::kGPU || device_type == DeviceType::kCPU);
     }
     std::shared_ptr<OpExpr> op_expr =
         JUST(CachedNcclReduceScatterOpExpr(JUST(x->parallel_desc()), op_type));
@@ -196,7 +201,8 @@ class ConsistentAllGatherFunctor {
     {
       CHECK_OR_RETURN(x->is_consistent());
       CHECK_OR_RETURN(IsAllSplitNdSbp(JUST(x->nd_sbp()), 0));
-      CHECK_EQ_OR_RETURN(JUST(x->parallel_desc())->device_type(), DeviceType::kGPU);
+      const auto& device_type = JUST(x->parallel_desc())->device_type();
+      CHECK_OR_RETURN(device_type == DeviceType::kGPU || device_type == DeviceType::kCPU);
     }
     std::shared_ptr<OpExpr> op_expr =
         JUST(CachedEagerNcclAllGatherOpExpr(JUST(x->parallel_desc())));
@@ -0,0 +1,165 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/graph/reachability_index.h"
+
+namespace oneflow {
+
+ReachabilityIndex::ReachabilityIndex(int64_t node_num,
+                                     const std::vector<std::pair<int64_t, int64_t>>& edges) {
+  CHECK_GE(node_num, 0);
+  CHECK_LT(node_num, std::numeric_limits<int32_t>::max());
+  out_edge_offsets_.assign(node_num + 1, 0);
+  for (const auto& edge : edges) {
+    CHECK_GE(edge.first, 0);
+    CHECK_LT(edge.first, edge.second) << "node ids are not in topological order";
+    CHECK_LT(edge.second, node_num);
+    out_edge_offsets_.at(edge.first + 1) += 1;
+  }
+  FOR_RANGE(int64_t, i, 0, node_num) { out_edge_offsets_[i + 1] += out_edge_offsets_[i]; }
+  out_edge_dsts_.resize(edges.size());
+  std::vector<int64_t> cursors(out_edge_offsets_.begin(), out_edge_offsets_.end() - 1);
+  for (const auto& edge : edges) {
+    out_edge_dsts_[cursors[edge.first]++] = static_cast<int32_t>(edge.second);
+  }
+  InitLevels();
+  intervals_.resize(node_num * kNumIntervalLabels);
+  FOR_RANGE(int, label_id, 0, kNumIntervalLabels) { InitIntervals(label_id, label_id % 2 == 1); }
+}
+
+void ReachabilityIndex::InitLevels() {
+  levels_.assign(node_num(), 0);
+  FOR_RANGE(int64_t, src, 0, node_num()) {
+    FOR_RANGE(int64_t, i, out_edge_offsets_[src], out_edge_offsets_[src + 1]) {
+      int32_t* dst_level = &levels_[out_edge_dsts_[i]];
+      *dst_level = std::max(*dst_level, levels_[src] + 1);
+    }
+  }
+}
+
+void ReachabilityIndex::InitIntervals(int label_id, bool reversed_child_order) {
+  const int64_t num = node_num();
+  std::vector<bool> visited(num, false);
+  // (node, number of out edges already visited)
+  std::vector<std::pair<int32_t, int64_t>> stack;
+  int32_t pre_order = 0;
+  int32_t post_order = 0;
+  const auto Visit = [&](int32_t node) {
+    visited[node] = true;
+    intervals_[node * kNumIntervalLabels + label_id].pre = pre_order++;
+    stack.emplace_back(node, 0);
+  };
+  FOR_RANGE(int64_t, root, 0, num) {
+    if (visited[root]) { continue; }
+    Visit(static_cast<int32_t>(root));
+    while (!stack.empty()) {
+      const int32_t node = stack.back().first;
+      const int64_t begin = out_edge_offsets_[node];
+      const int64_t end = out_edge_offsets_[node + 1];
+      int64_t& visited_cnt = stack.back().second;
+      if (visited_cnt < end - begin) {
+        const int64_t edge = reversed_child_order ? end - 1 - visited_cnt : begin + visited_cnt;
+        visited_cnt += 1;
+        const int32_t child = out_edge_dsts_[edge];
+        if (!visited[child]) { Visit(child); }
+        continue;
+      }
+      // all descendants are finished, so their intervals are final
+      Interval* interval = &intervals_[node * kNumIntervalLabels + label_id];
+      interval->post = post_order++;
+      interval->low = interval->post;
+      FOR_RANGE(int64_t, i, begin, end) {
+        const Interval& child = intervals_[out_edge_dsts_[i] * kNumIntervalLabels + label_id];
+        interval->low = std::min(interval->low, child.low);
+      }
+      stack.pop_back();
+    }
+  }
+}
+
+bool ReachabilityIndex::IsReachable(int64_t src, int64_t dst) const {
+  CHECK_GE(src, 0);
+  CHECK_LT(src, node_num());
+  CHECK_GE(dst, 0);
+  CHECK_LT(dst, node_num());
+  if (!MaybeReachable(src, dst)) { return false; }
+  if (IsTreeDescendant(src, dst)) { return true; }
+  std::unique_ptr<SearchScratch> scratch = AcquireScratch();
+  scratch->cur_stamp += 1;
+  if (scratch->cur_stamp == 0) {
+    std::fill(scratch->visit_stamps.begin(), scratch->visit_stamps.end(), 0);
+    scratch->cur_stamp = 1;
+  }
+  const uint32_t stamp = scratch->cur_stamp;
+  std::vector<int32_t>* stack = &scratch->stack;
+  stack->clear();
+  stack->push_back(src);
+  bool found = false;
+  while (!found && !stack->empty()) {
+    const int32_t node = stack->back();
+    stack->pop_back();
+    FOR_RANGE(int64_t, i, out_edge_offsets_[node], out_edge_offsets_[node + 1]) {
+      const int32_t next = out_edge_dsts_[i];
+      if (next == dst) {
+        found = true;
+        break;
+      }
+      if (scratch->visit_stamps[next] == stamp) { continue; }
+      scratch->visit_stamps[next] = stamp;
+      if (!MaybeReachable(next, dst)) { continue; }
+      if (IsTreeDescendant(next, dst)) {
+        found = true;
+        break;
+      }
+      stack->push_back(next);
+    }
+  }
+  ReleaseScratch(std::move(scratch));
+  return found;
+}
+
+size_t ReachabilityIndex::MemoryUsageBytes() const {
+  size_t bytes = out_edge_offsets_.capacity() * sizeof(int64_t)
+                 + out_edge_dsts_.capacity() * sizeof(int32_t)
+                 + levels_.capacity() * sizeof(int32_t) + intervals_.capacity() * sizeof(Interval);
+  std::unique_lock<std::mutex> lock(scratch_mutex_);
+  for (const auto& scratch : free_scratches_) {
+    bytes += scratch->visit_stamps.capacity() * sizeof(uint32_t)
+             + scratch->stack.capacity() * sizeof(int32_t);
+  }
+  return bytes;
+}
+
+std::unique_ptr<ReachabilityIndex::SearchScratch> ReachabilityIndex::AcquireScratch() const {
+  {
+    std::unique_lock<std::mutex> lock(scratch_mutex_);
+    if (!free_scratches_.empty()) {
+      std::unique_ptr<SearchScratch> scratch = std::move(free_scratches_.back());
+      free_scratches_.pop_back();
+      return scratch;
+    }
+  }
+  std::unique_ptr<SearchScratch> scratch(new SearchScratch());
+  scratch->visit_stamps.assign(node_num(), 0);
+  scratch->cur_stamp = 0;
+  return scratch;
+}
+
+void ReachabilityIndex::ReleaseScratch(std::unique_ptr<SearchScratch>&& scratch) const {
+  std::unique_lock<std::mutex> lock(scratch_mutex_);
+  free_scratches_.push_back(std::move(scratch));
+}
+
+}  // namespace oneflow
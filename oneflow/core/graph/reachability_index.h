@@ -0,0 +1,96 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_GRAPH_REACHABILITY_INDEX_H_
+#define ONEFLOW_CORE_GRAPH_REACHABILITY_INDEX_H_
+
+#include <mutex>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Answers reachability queries on a DAG whose nodes are numbered 0..N-1 in topological order.
+//
+// Instead of materializing the O(N^2) transitive closure, every node keeps its topological level
+// and kNumIntervalLabels GRAIL-style labels taken from DFS traversals with different child
+// orders. If dst is reachable from src then every [low, post] interval of dst is nested in the
+// corresponding interval of src and level(src) < level(dst), so most negative queries are
+// answered from the labels alone. The pre/post numbers of the DFS spanning forests answer the
+// positive queries where dst is a tree descendant of src. The remaining queries fall back to a
+// DFS that is pruned by the same labels. Memory is O(N + E).
+class ReachabilityIndex final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ReachabilityIndex);
+  // edges[i] = (src, dst), src < dst is required
+  ReachabilityIndex(int64_t node_num, const std::vector<std::pair<int64_t, int64_t>>& edges);
+  ~ReachabilityIndex() = default;
+
+  int64_t node_num() const { return static_cast<int64_t>(out_edge_offsets_.size()) - 1; }
+  // a node is not reachable from itself
+  bool IsReachable(int64_t src, int64_t dst) const;
+  size_t MemoryUsageBytes() const;
+
+ private:
+  static constexpr int kNumIntervalLabels = 2;
+  struct Interval {
+    int32_t low;
+    int32_t pre;
+    int32_t post;
+  };
+  // visited marks of one fallback search, reused across queries
+  struct SearchScratch {
+    std::vector<uint32_t> visit_stamps;
+    uint32_t cur_stamp;
+    std::vector<int32_t> stack;
+  };
+
+  void InitLevels();
+  void InitIntervals(int label_id, bool reversed_child_order);
+  bool MaybeReachable(int32_t src, int32_t dst) const {
+    if (levels_[src] >= levels_[dst]) { return false; }
+    const Interval* src_intervals = &intervals_[src * kNumIntervalLabels];
+    const Interval* dst_intervals = &intervals_[dst * kNumIntervalLabels];
+    for (int i = 0; i < kNumIntervalLabels; ++i) {
+      if (dst_intervals[i].low < src_intervals[i].low) { return false; }
+      if (dst_intervals[i].post > src_intervals[i].post) { return false; }
+    }
+    return true;
+  }
+  bool IsTreeDescendant(int32_t src, int32_t dst) const {
+    const Interval* src_intervals = &intervals_[src * kNumIntervalLabels];
+    const Interval* dst_intervals = &intervals_[dst * kNumIntervalLabels];
+    for (int i = 0; i < kNumIntervalLabels; ++i) {
+      if (src_intervals[i].pre < dst_intervals[i].pre
+          && dst_intervals[i].post < src_intervals[i].post) {
+        return true;
+      }
+    }
+    return false;
+  }
+  std::unique_ptr<SearchScratch> AcquireScratch() const;
+  void ReleaseScratch(std::unique_ptr<SearchScratch>&& scratch) const;
+
+  // CSR out edges
+  std::vector<int64_t> out_edge_offsets_;
+  std::vector<int32_t> out_edge_dsts_;
+  std::vector<int32_t> levels_;
+  std::vector<Interval> intervals_;
+  mutable std::mutex scratch_mutex_;
+  mutable std::vector<std::unique_ptr<SearchScratch>> free_scratches_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_GRAPH_REACHABILITY_INDEX_H_
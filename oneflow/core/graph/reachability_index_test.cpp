@@ -0,0 +1,232 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <numeric>
+#include <random>
+#include <sys/resource.h>
+#include "oneflow/core/graph/graph.h"
+#include "oneflow/core/common/cpu_test_util.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+class TestEdge;
+
+class TestNode final : public Node<TestNode, TestEdge> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TestNode);
+  TestNode() = default;
+  ~TestNode() override = default;
+};
+
+class TestEdge final : public Edge<TestNode, TestEdge> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TestEdge);
+  TestEdge() = default;
+  ~TestEdge() override = default;
+};
+
+class TestGraph final : public Graph<TestNode, TestEdge> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TestGraph);
+  TestGraph() = default;
+  ~TestGraph() override = default;
+
+  void AddNodes(int64_t num) {
+    FOR_RANGE(int64_t, i, 0, num) { test_nodes_.push_back(NewNode()); }
+  }
+  void AddEdge(int64_t src, int64_t dst) {
+    Connect(test_nodes_.at(src), NewEdge(), test_nodes_.at(dst));
+  }
+  TestNode* node(int64_t i) const { return test_nodes_.at(i); }
+
+ private:
+  std::vector<TestNode*> test_nodes_;
+};
+
+using Edges = std::vector<std::pair<int64_t, int64_t>>;
+
+Edges RandomDagEdges(int64_t node_num, int64_t edge_num, std::mt19937* gen) {
+  Edges edges;
+  std::uniform_int_distribution<int64_t> dis(0, node_num - 1);
+  while (edges.size() < static_cast<size_t>(edge_num)) {
+    const int64_t a = dis(*gen);
+    const int64_t b = dis(*gen);
+    if (a != b) { edges.emplace_back(std::min(a, b), std::max(a, b)); }
+  }
+  return edges;
+}
+
+// depth stages of width parallel chains, like the task graph of a data parallel model;
+// every boxing_interval stages the chains are fully connected by a boxing stage
+Edges TaskGraphLikeEdges(int64_t width, int64_t depth, int64_t boxing_interval) {
+  Edges edges;
+  FOR_RANGE(int64_t, stage, 1, depth) {
+    FOR_RANGE(int64_t, rank, 0, width) {
+      const int64_t dst = stage * width + rank;
+      if (stage % boxing_interval == 0) {
+        FOR_RANGE(int64_t, src_rank, 0, width) {
+          edges.emplace_back((stage - 1) * width + src_rank, dst);
+        }
+      } else {
+        edges.emplace_back((stage - 1) * width + rank, dst);
+      }
+    }
+  }
+  return edges;
+}
+
+// the transitive closure as one ancestor bitset per node, what the graph used to build
+std::vector<std::vector<uint64_t>> DenseAncestors(int64_t node_num, const Edges& edges) {
+  std::vector<std::vector<int64_t>> in_nodes(node_num);
+  for (const auto& edge : edges) { in_nodes.at(edge.second).push_back(edge.first); }
+  const int64_t words = RoundUp(node_num, 64) / 64;
+  std::vector<std::vector<uint64_t>> ancestors(node_num, std::vector<uint64_t>(words, 0));
+  FOR_RANGE(int64_t, node, 0, node_num) {
+    for (int64_t in : in_nodes.at(node)) {
+      ancestors[node][in / 64] |= uint64_t(1) << (in % 64);
+      FOR_RANGE(int64_t, w, 0, words) { ancestors[node][w] |= ancestors[in][w]; }
+    }
+  }
+  return ancestors;
+}
+
+bool DenseIsReachable(const std::vector<std::vector<uint64_t>>& ancestors, int64_t src,
+                      int64_t dst) {
+  return (ancestors.at(dst).at(src / 64) >> (src % 64)) & 1;
+}
+
+std::unique_ptr<TestGraph> NewTestGraph(int64_t node_num, const Edges& edges) {
+  std::unique_ptr<TestGraph> graph(new TestGraph());
+  graph->AddNodes(node_num);
+  for (const auto& edge : edges) { graph->AddEdge(edge.first, edge.second); }
+  return graph;
+}
+
+int64_t PeakRssKBytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+}  // namespace
+
+TEST(ReachabilityIndex, simple) {
+  // 0 -> 1 -> 3, 0 -> 2, 4
+  ReachabilityIndex index(5, {{0, 1}, {1, 3}, {0, 2}});
+  ASSERT_TRUE(index.IsReachable(0, 1));
+  ASSERT_TRUE(index.IsReachable(0, 3));
+  ASSERT_TRUE(index.IsReachable(0, 2));
+  ASSERT_FALSE(index.IsReachable(0, 0));
+  ASSERT_FALSE(index.IsReachable(1, 0));
+  ASSERT_FALSE(index.IsReachable(2, 3));
+  ASSERT_FALSE(index.IsReachable(0, 4));
+  ASSERT_FALSE(index.IsReachable(4, 3));
+}
+
+TEST(ReachabilityIndex, random_dag) {
+  std::mt19937 gen(0);
+  for (int64_t edges_per_node : {1, 2, 4, 16}) {
+    const int64_t node_num = 1000;
+    const Edges edges = RandomDagEdges(node_num, node_num * edges_per_node, &gen);
+    const auto ancestors = DenseAncestors(node_num, edges);
+    ReachabilityIndex index(node_num, edges);
+    FOR_RANGE(int64_t, src, 0, node_num) {
+      FOR_RANGE(int64_t, dst, 0, node_num) {
+        ASSERT_EQ(index.IsReachable(src, dst), DenseIsReachable(ancestors, src, dst));
+      }
+    }
+  }
+}
+
+TEST(ReachabilityIndex, graph_predicator) {
+  // node ids of the graph are shuffled against the topological order of the index
+  std::mt19937 gen(1);
+  const int64_t node_num = 500;
+  const Edges edges = RandomDagEdges(node_num, node_num * 3, &gen);
+  const auto ancestors = DenseAncestors(node_num, edges);
+  std::vector<int64_t> perm(node_num);
+  std::iota(perm.begin(), perm.end(), 0);
+  std::shuffle(perm.begin(), perm.end(), gen);
+  Edges permuted_edges;
+  for (const auto& edge : edges) {
+    permuted_edges.emplace_back(perm[edge.first], perm[edge.second]);
+  }
+  const auto graph = NewTestGraph(node_num, permuted_edges);
+  const auto IsReachable = graph->MakePredicatorIsReachable();
+  FOR_RANGE(int64_t, src, 0, node_num) {
+    FOR_RANGE(int64_t, dst, 0, node_num) {
+      ASSERT_EQ(IsReachable(graph->node(perm[src]), graph->node(perm[dst])),
+                DenseIsReachable(ancestors, src, dst));
+    }
+  }
+}
+
+TEST(ReachabilityIndex, DISABLED_large_graph_benchmark) {
+  std::mt19937 gen(2);
+  struct Case {
+    std::string name;
+    int64_t node_num;
+    Edges edges;
+    bool run_dense;
+  };
+  const std::vector<Case> cases = {
+      {"task graph like 64x256", 64 * 256, TaskGraphLikeEdges(64, 256, 8), true},
+      {"task graph like 64x2048", 64 * 2048, TaskGraphLikeEdges(64, 2048, 8), false},
+      {"random 16k", 16384, RandomDagEdges(16384, 16384 * 3, &gen), true},
+      {"random 128k", 131072, RandomDagEdges(131072, 131072 * 3, &gen), false},
+  };
+  const int64_t query_num = 100000;
+  for (const Case& c : cases) {
+    std::vector<std::pair<int64_t, int64_t>> queries;
+    std::uniform_int_distribution<int64_t> dis(0, c.node_num - 1);
+    FOR_RANGE(int64_t, i, 0, query_num) { queries.emplace_back(dis(gen), dis(gen)); }
+
+    const auto graph = NewTestGraph(c.node_num, c.edges);
+    const int64_t rss_before = PeakRssKBytes();
+    std::function<bool(const TestNode*, const TestNode*)> IsReachable;
+    const double build_ms = MeasureMs([&] { IsReachable = graph->MakePredicatorIsReachable(); });
+    const int64_t rss_after = PeakRssKBytes();
+    int64_t reachable_cnt = 0;
+    const double query_ms = MeasureMs([&] {
+      for (const auto& q : queries) {
+        reachable_cnt += IsReachable(graph->node(q.first), graph->node(q.second));
+      }
+    });
+    ReachabilityIndex index(c.node_num, c.edges);
+    LOG(INFO) << c.name << " (" << c.node_num << " nodes, " << c.edges.size()
+              << " edges): index build " << build_ms << " ms, index size "
+              << index.MemoryUsageBytes() / 1024 << " KB, peak rss +" << rss_after - rss_before
+              << " KB, " << query_num << " queries " << query_ms << " ms (" << reachable_cnt
+              << " reachable); dense closure would be "
+              << c.node_num * c.node_num / 8 / 1024 / 1024 << " MB";
+    if (c.run_dense) {
+      std::vector<std::vector<uint64_t>> ancestors;
+      const double dense_ms = MeasureMs([&] { ancestors = DenseAncestors(c.node_num, c.edges); });
+      for (const auto& q : queries) {
+        ASSERT_EQ(IsReachable(graph->node(q.first), graph->node(q.second)),
+                  DenseIsReachable(ancestors, q.first, q.second));
+      }
+      LOG(INFO) << c.name << ": dense closure build " << dense_ms << " ms";
+    }
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -16,8 +16,10 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_GRAPH_TASK_ID_GENERATOR_H_
 #define ONEFLOW_CORE_GRAPH_TASK_ID_GENERATOR_H_
 
+#include <map>
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/common/id_util.h"
+#include "oneflow/core/graph/id_serialization.h"
 
 namespace oneflow {
 
@@ -30,6 +32,13 @@ class TaskIdGenerator final {
   ~TaskIdGenerator() = default;
 
   TaskId Generate(const StreamId& stream_id);
+  // Makes the task indexes generated on the stream greater than task_index
+  void SkipTo(const StreamId& stream_id, task_index_t task_index);
+  // The next task index of every stream used, ordered by the serialized stream id
+  std::map<int64_t, task_index_t> GetSerializedStreamId2TaskIndexCounter() const;
+  // Replaces the states of all streams by the ones GetSerializedStreamId2TaskIndexCounter returned
+  void SetSerializedStreamId2TaskIndexCounter(
+      const std::map<int64_t, task_index_t>& serialized_stream_id2task_index_counter);
 
  private:
   HashMap<StreamId, task_index_t> stream_id2task_index_counter_;
@@ -40,6 +49,29 @@ inline TaskId TaskIdGenerator::Generate(const StreamId& stream_id) {
   return TaskId{stream_id, task_index};
 }
 
+inline void TaskIdGenerator::SkipTo(const StreamId& stream_id, task_index_t task_index) {
+  task_index_t* counter = &stream_id2task_index_counter_[stream_id];
+  *counter = std::max<task_index_t>(*counter, task_index + 1);
+}
+
+inline std::map<int64_t, TaskIdGenerator::task_index_t>
+TaskIdGenerator::GetSerializedStreamId2TaskIndexCounter() const {
+  std::map<int64_t, task_index_t> serialized_stream_id2task_index_counter;
+  for (const auto& pair : stream_id2task_index_counter_) {
+    serialized_stream_id2task_index_counter.emplace(SerializeStreamIdToInt64(pair.first),
+                                                    pair.second);
+  }
+  return serialized_stream_id2task_index_counter;
+}
+
+inline void TaskIdGenerator::SetSerializedStreamId2TaskIndexCounter(
+    const std::map<int64_t, task_index_t>& serialized_stream_id2task_index_counter) {
+  stream_id2task_index_counter_.clear();
+  for (const auto& pair : serialized_stream_id2task_index_counter) {
+    stream_id2task_index_counter_.emplace(DeserializeStreamIdFromInt64(pair.first), pair.second);
+  }
+}
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_GRAPH_TASK_ID_GENERATOR_H_
@@ -52,6 +52,68 @@ int64_t IDMgr::PickCpuThrdIdEvenly(int64_t machine_id) {
   return SerializeStreamIdToInt64(stream_id);
 }
 
+std::string IDMgr::IdCountersToString() const {
+  std::string str = "regst_desc:" + std::to_string(regst_desc_id_count_)
+                    + ",mem_block:" + std::to_string(mem_block_id_count_)
+                    + ",chunk:" + std::to_string(chunk_id_count_) + ",task:";
+  for (const auto& pair : task_id_gen_.GetSerializedStreamId2TaskIndexCounter()) {
+    str += std::to_string(pair.first) + "/" + std::to_string(pair.second) + ";";
+  }
+  return str;
+}
+
+void IDMgr::RestoreIdCounters(const std::string& id_counters) {
+  const std::string task_prefix = ",task:";
+  const size_t task_pos = id_counters.find(task_prefix);
+  CHECK_NE(task_pos, std::string::npos) << id_counters;
+  long long regst_desc_id_count = 0;
+  long long mem_block_id_count = 0;
+  long long chunk_id_count = 0;
+  const std::string head = id_counters.substr(0, task_pos);
+  CHECK_EQ(sscanf(head.c_str(), "regst_desc:%lld,mem_block:%lld,chunk:%lld", &regst_desc_id_count,
+                  &mem_block_id_count, &chunk_id_count),
+           3)
+      << id_counters;
+  std::map<int64_t, TaskIdGenerator::task_index_t> serialized_stream_id2task_index_counter;
+  size_t begin = task_pos + task_prefix.size();
+  while (begin < id_counters.size()) {
+    const size_t end = id_counters.find(';', begin);
+    CHECK_NE(end, std::string::npos) << id_counters;
+    long long serialized_stream_id = 0;
+    unsigned long long task_index_counter = 0;
+    CHECK_EQ(sscanf(id_counters.substr(begin, end - begin).c_str(), "%lld/%llu",
+                    &serialized_stream_id, &task_index_counter),
+             2)
+        << id_counters;
+    serialized_stream_id2task_index_counter.emplace(serialized_stream_id, task_index_counter);
+    begin = end + 1;
+  }
+  regst_desc_id_count_ = regst_desc_id_count;
+  mem_block_id_count_ = mem_block_id_count;
+  chunk_id_count_ = chunk_id_count;
+  task_id_gen_.SetSerializedStreamId2TaskIndexCounter(serialized_stream_id2task_index_counter);
+}
+
+void IDMgr::SkipIdsOfPlan(const Plan& plan) {
+  for (const TaskProto& task : plan.task()) {
+    const TaskId task_id = DeserializeTaskIdFromInt64(task.task_id());
+    task_id_gen_.SkipTo(task_id.stream_id(), task_id.task_index());
+    for (const auto& pair : task.produced_regst_desc()) {
+      const RegstDescProto& regst_desc = pair.second;
+      regst_desc_id_count_ = std::max(regst_desc_id_count_, regst_desc.regst_desc_id() + 1);
+      mem_block_id_count_ = std::max(mem_block_id_count_, regst_desc.mem_block_id() + 1);
+      mem_block_id_count_ =
+          std::max(mem_block_id_count_, regst_desc.separated_header_mem_block_id() + 1);
+    }
+  }
+  for (const MemBlockProto& mem_block : plan.block_chunk_list().mem_block()) {
+    mem_block_id_count_ = std::max(mem_block_id_count_, mem_block.mem_block_id() + 1);
+  }
+  for (const ChunkProto& chunk : plan.block_chunk_list().chunk()) {
+    chunk_id_count_ = std::max(chunk_id_count_, chunk.chunk_id() + 1);
+  }
+}
+
 IDMgr::IDMgr() {
   CHECK_LT((Global<ResourceDesc, ForSession>::Get()->process_ranks().size()),
            static_cast<int64_t>(1) << machine_id_bit_num_);
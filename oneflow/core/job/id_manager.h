@@ -22,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/device/stream_index.h"
 #include "oneflow/core/graph/task_id_generator.h"
+#include "oneflow/core/job/plan.pb.h"
 
 namespace oneflow {
 
@@ -34,6 +35,15 @@ class IDMgr final {
   int64_t NewMemBlockId() { return mem_block_id_count_++; }
   int64_t NewChunkId() { return chunk_id_count_++; }
 
+  // The states of the id counters. Compiling the same job from the same states generates the same
+  // ids, so a cached plan is only valid for the states it was compiled from.
+  std::string IdCountersToString() const;
+  // Sets the id counters to the states IdCountersToString returned, e.g. the states right after
+  // compiling a plan which is loaded from the cache instead
+  void RestoreIdCounters(const std::string& id_counters);
+  // Makes the ids generated later different from the ones of a plan loaded rather than compiled
+  void SkipIdsOfPlan(const Plan& plan);
+
   // GetFromThrdId
   DeviceType GetDeviceTypeFromThrdId(int64_t thrd_id) const;
   int64_t GetGpuPhyIdFromThrdId(int64_t thrd_id) const;
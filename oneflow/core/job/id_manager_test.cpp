@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/job/id_manager.h"
 #include "oneflow/core/job/global_for.h"
+#include "oneflow/core/graph/id_serialization.h"
 
 namespace oneflow {
 
@@ -72,4 +73,57 @@ TEST(IDMgr, compile_regst_desc_id) {
   Delete();
 }
 
+TEST(IDMgr, restore_id_counters) {
+  New();
+  const StreamId cpu_stream_id(DeviceId(0, DeviceType::kCPU, 0), 1);
+  const StreamId gpu_stream_id(DeviceId(1, DeviceType::kGPU, 2), 3);
+  FOR_RANGE(int64_t, i, 0, 3) { Global<IDMgr>::Get()->NewRegstDescId(); }
+  FOR_RANGE(int64_t, i, 0, 4) { Global<IDMgr>::Get()->NewMemBlockId(); }
+  FOR_RANGE(int64_t, i, 0, 5) { Global<IDMgr>::Get()->NewChunkId(); }
+  FOR_RANGE(int64_t, i, 0, 6) {
+    Global<IDMgr>::Get()->GetTaskIdGenerator()->Generate(cpu_stream_id);
+  }
+  Global<IDMgr>::Get()->GetTaskIdGenerator()->Generate(gpu_stream_id);
+  const std::string id_counters = Global<IDMgr>::Get()->IdCountersToString();
+  Delete();
+  New();
+  // ids generated before restoring are dropped
+  Global<IDMgr>::Get()->NewRegstDescId();
+  const StreamId other_stream_id(DeviceId(0, DeviceType::kCPU, 0), 2);
+  Global<IDMgr>::Get()->GetTaskIdGenerator()->Generate(other_stream_id);
+  Global<IDMgr>::Get()->RestoreIdCounters(id_counters);
+  ASSERT_EQ(Global<IDMgr>::Get()->IdCountersToString(), id_counters);
+  ASSERT_EQ(Global<IDMgr>::Get()->NewRegstDescId(), 3);
+  ASSERT_EQ(Global<IDMgr>::Get()->NewMemBlockId(), 4);
+  ASSERT_EQ(Global<IDMgr>::Get()->NewChunkId(), 5);
+  TaskIdGenerator* task_id_gen = Global<IDMgr>::Get()->GetTaskIdGenerator();
+  ASSERT_EQ(task_id_gen->Generate(cpu_stream_id).task_index(), 6U);
+  ASSERT_EQ(task_id_gen->Generate(gpu_stream_id).task_index(), 1U);
+  Delete();
+}
+
+TEST(IDMgr, skip_ids_of_plan) {
+  New();
+  const StreamId stream_id(DeviceId(0, DeviceType::kCPU, 0), 1);
+  Plan plan;
+  TaskProto* task = plan.add_task();
+  task->set_task_id(SerializeTaskIdToInt64(TaskId(stream_id, 5)));
+  RegstDescProto* regst_desc = &(*task->mutable_produced_regst_desc())["out"];
+  regst_desc->set_regst_desc_id(7);
+  regst_desc->set_mem_block_id(9);
+  regst_desc->set_separated_header_mem_block_id(-1);
+  plan.mutable_block_chunk_list()->add_chunk()->set_chunk_id(4);
+  Global<IDMgr>::Get()->SkipIdsOfPlan(plan);
+  ASSERT_EQ(Global<IDMgr>::Get()->NewRegstDescId(), 8);
+  ASSERT_EQ(Global<IDMgr>::Get()->NewMemBlockId(), 10);
+  ASSERT_EQ(Global<IDMgr>::Get()->NewChunkId(), 5);
+  TaskIdGenerator* task_id_gen = Global<IDMgr>::Get()->GetTaskIdGenerator();
+  ASSERT_EQ(task_id_gen->Generate(stream_id).task_index(), 6U);
+  // skipping never moves a counter back
+  Global<IDMgr>::Get()->SkipIdsOfPlan(plan);
+  ASSERT_EQ(Global<IDMgr>::Get()->NewRegstDescId(), 9);
+  ASSERT_EQ(task_id_gen->Generate(stream_id).task_index(), 7U);
+  Delete();
+}
+
 }  // namespace oneflow
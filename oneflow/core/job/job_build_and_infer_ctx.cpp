@@ -1011,6 +1011,9 @@ Maybe<void> LazyJobBuildAndInferCtx::Complete() {
     JUST(DoPass("PipelineBufferPass"));
     JUST(DoPass("DumpVariableInfoPass"));
   }
+  // NOTE: the sbp signature confs hold only user hints and pass constraints until they are dumped,
+  // so the search has to run before
+  JUST(DoPass("AutoParallelPass"));
   JUST(DoPass("DumpBlobParallelConfPass"));
   JUST(CheckJob());
   return Maybe<void>::Ok();
@@ -0,0 +1,226 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/plan_cache.h"
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <unistd.h>
+#include <fstream>
+#include <mutex>
+#include "oneflow/core/common/protobuf.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/id_manager.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/version.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+namespace {
+
+// bump it when the layout of entries or the meaning of plans changes
+constexpr uint64_t kPlanCacheFormatVersion = 2;
+constexpr char kPlanCacheMagic[] = "OFPLANCE";
+constexpr size_t kPlanCacheMagicSize = sizeof(kPlanCacheMagic) - 1;
+
+uint64_t Fnv1aHash(const char* data, size_t size) {
+  uint64_t hash = 14695981039346656037ULL;
+  FOR_RANGE(size_t, i, 0, size) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+void AppendUInt64(uint64_t val, std::string* str) {
+  str->append(reinterpret_cast<const char*>(&val), sizeof(val));
+}
+
+void AppendSection(const std::string& section, std::string* str) {
+  AppendUInt64(section.size(), str);
+  str->append(section);
+}
+
+// Reads the section at *offset and moves *offset past it, returns false if out of range
+bool ReadSection(const std::string& str, size_t* offset, std::string* section) {
+  uint64_t size = 0;
+  if (str.size() < *offset + sizeof(size)) { return false; }
+  std::memcpy(&size, str.data() + *offset, sizeof(size));
+  *offset += sizeof(size);
+  if (str.size() - *offset < size) { return false; }
+  section->assign(str.data() + *offset, size);
+  *offset += size;
+  return true;
+}
+
+// The default serialization orders map entries arbitrarily, keys need the same bytes for the
+// same messages
+std::string DeterministicSerialize(const PbMessage& message) {
+  std::string str;
+  {
+    google::protobuf::io::StringOutputStream string_stream(&str);
+    google::protobuf::io::CodedOutputStream coded_stream(&string_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    CHECK(message.SerializeToCodedStream(&coded_stream));
+  }
+  return str;
+}
+
+std::mutex* StatsMutex() {
+  static std::mutex mutex;
+  return &mutex;
+}
+
+PlanCacheStats* MutStats() {
+  static PlanCacheStats stats;
+  return &stats;
+}
+
+void UpdateStats(const std::function<void(PlanCacheStats*)>& Update) {
+  std::unique_lock<std::mutex> lock(*StatsMutex());
+  Update(MutStats());
+}
+
+}  // namespace
+
+PlanCache* PlanCache::Get() {
+  static std::unique_ptr<PlanCache> plan_cache = []() -> std::unique_ptr<PlanCache> {
+    const std::string dir = GetStringFromEnv("ONEFLOW_PLAN_CACHE_DIR", "");
+    if (dir.empty()) { return nullptr; }
+    return std::make_unique<PlanCache>(dir);
+  }();
+  return plan_cache.get();
+}
+
+PlanCacheStats PlanCache::GetStats() {
+  std::unique_lock<std::mutex> lock(*StatsMutex());
+  return *MutStats();
+}
+
+void PlanCache::AddCompileTime(double seconds) {
+  UpdateStats([&](PlanCacheStats* stats) {
+    stats->compile_count += 1;
+    stats->compile_seconds += seconds;
+  });
+}
+
+std::string PlanCache::GenKey(const Job& job, int64_t job_id,
+                              const HashSet<std::string>& variable_op_names) {
+  std::string key;
+  AppendUInt64(kPlanCacheFormatVersion, &key);
+  AppendSection(GetOneFlowGitVersion(), &key);
+  AppendUInt64(job_id, &key);
+  AppendUInt64(GlobalProcessCtx::WorldSize(), &key);
+  AppendUInt64(GlobalProcessCtx::NumOfProcessPerNode(), &key);
+  const Resource& resource = Global<ResourceDesc, ForSession>::Get()->resource();
+  AppendSection(DeterministicSerialize(resource), &key);
+  AppendSection(Global<IDMgr>::Get()->IdCountersToString(), &key);
+  // the variables sharing memory with eager tensors
+  std::vector<std::string> sorted_variable_op_names(variable_op_names.begin(),
+                                                    variable_op_names.end());
+  std::sort(sorted_variable_op_names.begin(), sorted_variable_op_names.end());
+  AppendUInt64(sorted_variable_op_names.size(), &key);
+  for (const std::string& op_name : sorted_variable_op_names) { AppendSection(op_name, &key); }
+  AppendSection(DeterministicSerialize(job), &key);
+  return key;
+}
+
+std::string PlanCache::EntryPath(const std::string& key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.plan",
+           static_cast<unsigned long long>(Fnv1aHash(key.data(), key.size())));
+  return JoinPath(dir_, name);
+}
+
+bool PlanCache::TryLoad(const std::string& key, Job* job, Plan* plan,
+                        std::string* id_counters) const {
+  const double start = GetCurTime();
+  const std::string path = EntryPath(key);
+  // an entry which exists but is not taken is counted as invalid
+  const auto Miss = [&](bool invalid) {
+    if (invalid) { LOG(WARNING) << "Ignore the invalid plan cache entry " << path; }
+    UpdateStats([&](PlanCacheStats* stats) {
+      stats->miss_count += 1;
+      stats->invalid_count += invalid;
+    });
+    return false;
+  };
+  std::ifstream in_stream(path, std::ifstream::in | std::ifstream::binary);
+  if (!in_stream.is_open()) { return Miss(false); }
+  const std::string entry((std::istreambuf_iterator<char>(in_stream)),
+                          std::istreambuf_iterator<char>());
+  uint64_t checksum = 0;
+  if (entry.size() < kPlanCacheMagicSize + sizeof(checksum)
+      || entry.compare(0, kPlanCacheMagicSize, kPlanCacheMagic) != 0) {
+    return Miss(true);
+  }
+  const size_t body_end = entry.size() - sizeof(checksum);
+  std::memcpy(&checksum, entry.data() + body_end, sizeof(checksum));
+  if (checksum != Fnv1aHash(entry.data(), body_end)) { return Miss(true); }
+  size_t offset = kPlanCacheMagicSize;
+  std::string entry_key;
+  std::string job_str;
+  std::string plan_str;
+  std::string entry_id_counters;
+  if (!ReadSection(entry, &offset, &entry_key) || !ReadSection(entry, &offset, &job_str)
+      || !ReadSection(entry, &offset, &plan_str) || !ReadSection(entry, &offset, &entry_id_counters)
+      || offset != body_end) {
+    return Miss(true);
+  }
+  // the entry of another key with the same hash, or of a stale key
+  if (entry_key != key) { return Miss(true); }
+  Job loaded_job;
+  Plan loaded_plan;
+  if (!loaded_job.ParseFromString(job_str) || !loaded_plan.ParseFromString(plan_str)) {
+    return Miss(true);
+  }
+  *job = std::move(loaded_job);
+  *plan = std::move(loaded_plan);
+  *id_counters = std::move(entry_id_counters);
+  const double seconds = (GetCurTime() - start) / 1e9;
+  UpdateStats([&](PlanCacheStats* stats) {
+    stats->hit_count += 1;
+    stats->load_seconds += seconds;
+  });
+  LOG(INFO) << "Load the plan of job " << job->job_conf().job_name() << " from " << path << " in "
+            << seconds << " seconds";
+  return true;
+}
+
+void PlanCache::Store(const std::string& key, const Job& job, const Plan& plan,
+                      const std::string& id_counters) const {
+  std::string entry(kPlanCacheMagic, kPlanCacheMagicSize);
+  AppendSection(key, &entry);
+  AppendSection(job.SerializeAsString(), &entry);
+  AppendSection(plan.SerializeAsString(), &entry);
+  AppendSection(id_counters, &entry);
+  AppendUInt64(Fnv1aHash(entry.data(), entry.size()), &entry);
+  LocalFS()->RecursivelyCreateDirIfNotExist(dir_);
+  const std::string path = EntryPath(key);
+  const std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  std::ofstream out_stream(tmp_path, std::ofstream::out | std::ofstream::binary);
+  out_stream.write(entry.data(), entry.size());
+  out_stream.close();
+  if (!out_stream.good()) {
+    LOG(WARNING) << "Failed to write the plan cache entry " << tmp_path;
+    if (LocalFS()->FileExists(tmp_path)) { LocalFS()->DelFile(tmp_path); }
+    return;
+  }
+  LocalFS()->RenameFile(tmp_path, path);
+}
+
+}  // namespace oneflow
@@ -0,0 +1,73 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_PLAN_CACHE_H_
+#define ONEFLOW_CORE_JOB_PLAN_CACHE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/job/job.pb.h"
+#include "oneflow/core/job/plan.pb.h"
+
+namespace oneflow {
+
+struct PlanCacheStats {
+  int64_t hit_count = 0;
+  int64_t miss_count = 0;
+  // entries found but rejected as stale or corrupted, also counted as misses
+  int64_t invalid_count = 0;
+  int64_t compile_count = 0;
+  double compile_seconds = 0;
+  double load_seconds = 0;
+};
+
+// A content addressed on-disk cache of the plans compiled by nn.Graph, in the directory of the
+// environment variable ONEFLOW_PLAN_CACHE_DIR. An entry is the completed job, the plan and the
+// states of the id counters after compiling it, keyed on everything the compilation depends on:
+// the job before completion, the job id, the resource, the world size, the OneFlow version and
+// the states of the id counters before compiling. Entries store the full key, which is compared
+// on loading besides the checksum of the file, so neither a hash collision nor a truncated file
+// is taken as a hit. Entries are written to a temporary file and renamed, so processes may share
+// the directory.
+class PlanCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PlanCache);
+  explicit PlanCache(const std::string& dir) : dir_(dir) {}
+  ~PlanCache() = default;
+
+  // The cache of ONEFLOW_PLAN_CACHE_DIR, nullptr if it is not set
+  static PlanCache* Get();
+  // The stats of this process, the compilations are counted with or without the cache
+  static PlanCacheStats GetStats();
+  static void AddCompileTime(double seconds);
+
+  static std::string GenKey(const Job& job, int64_t job_id,
+                            const HashSet<std::string>& variable_op_names);
+
+  // Returns false on a miss, the outputs are left unchanged then
+  bool TryLoad(const std::string& key, Job* job, Plan* plan, std::string* id_counters) const;
+  // id_counters is IDMgr::IdCountersToString() right after compiling the plan. A failed store is
+  // logged and only loses the entry.
+  void Store(const std::string& key, const Job& job, const Plan& plan,
+             const std::string& id_counters) const;
+
+  std::string EntryPath(const std::string& key) const;
+
+ private:
+  std::string dir_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_PLAN_CACHE_H_
@@ -0,0 +1,168 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <fstream>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/id_manager.h"
+#include "oneflow/core/job/plan_cache.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+Job NewJob(const std::string& job_name) {
+  Job job;
+  job.mutable_job_conf()->set_job_name(job_name);
+  return job;
+}
+
+Plan NewPlan(int64_t regst_num) {
+  Plan plan;
+  plan.mutable_block_chunk_list();
+  plan.mutable_job_confs();
+  plan.mutable_collective_boxing_plan();
+  auto* ctrl_regst_desc_id2producer_task_id =
+      plan.mutable_ctrl_regst_desc_info()->mutable_ctrl_regst_desc_id2producer_task_id();
+  FOR_RANGE(int64_t, i, 0, regst_num) { (*ctrl_regst_desc_id2producer_task_id)[i] = i * 2; }
+  return plan;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream in_stream(path, std::ifstream::in | std::ifstream::binary);
+  return std::string((std::istreambuf_iterator<char>(in_stream)),
+                     std::istreambuf_iterator<char>());
+}
+
+void WriteFile(const std::string& path, const std::string& content) {
+  std::ofstream out_stream(path, std::ofstream::out | std::ofstream::binary);
+  out_stream.write(content.data(), content.size());
+}
+
+void NewGlobals() {
+  EnvProto env_proto;
+  auto* machine = env_proto.add_machine();
+  machine->set_id(0);
+  machine->set_addr("192.168.1.0");
+  env_proto.set_ctrl_port(9527);
+  Global<EnvDesc>::New(env_proto);
+  Global<ProcessCtx>::New();
+  Global<ProcessCtx>::Get()->mutable_ctrl_addr()->Add();
+  Global<ProcessCtx>::Get()->set_rank(0);
+  Global<ProcessCtx>::Get()->set_node_size(1);
+  Resource resource;
+  resource.set_machine_num(1);
+  resource.set_gpu_device_num(0);
+  resource.set_cpu_device_num(4);
+  Global<ResourceDesc, ForSession>::New(resource, GlobalProcessCtx::NumOfProcessPerNode());
+  Global<IDMgr>::New();
+}
+
+void DeleteGlobals() {
+  Global<IDMgr>::Delete();
+  Global<ProcessCtx>::Delete();
+  Global<ResourceDesc, ForSession>::Delete();
+  Global<EnvDesc>::Delete();
+}
+
+}  // namespace
+
+TEST(PlanCache, store_and_load) {
+  const std::string dir = JoinPath(GetCwd(), "tmp_test_plan_cache_dir");
+  const PlanCache plan_cache(dir);
+  const std::string key = "key";
+  Job job;
+  Plan plan;
+  std::string id_counters;
+  const PlanCacheStats stats_before = PlanCache::GetStats();
+  ASSERT_FALSE(plan_cache.TryLoad(key, &job, &plan, &id_counters));
+  plan_cache.Store(key, NewJob("job"), NewPlan(3), "id_counters");
+  ASSERT_TRUE(plan_cache.TryLoad(key, &job, &plan, &id_counters));
+  ASSERT_EQ(job.job_conf().job_name(), "job");
+  ASSERT_EQ(id_counters, "id_counters");
+  ASSERT_EQ(plan.ctrl_regst_desc_info().ctrl_regst_desc_id2producer_task_id().size(), 3);
+  ASSERT_EQ(plan.ctrl_regst_desc_info().ctrl_regst_desc_id2producer_task_id().at(2), 4);
+  const PlanCacheStats stats = PlanCache::GetStats();
+  ASSERT_EQ(stats.hit_count - stats_before.hit_count, 1);
+  ASSERT_EQ(stats.miss_count - stats_before.miss_count, 1);
+  ASSERT_EQ(stats.invalid_count - stats_before.invalid_count, 0);
+  LocalFS()->RecursivelyDeleteDir(dir);
+}
+
+TEST(PlanCache, reject_invalid_entries) {
+  const std::string dir = JoinPath(GetCwd(), "tmp_test_plan_cache_invalid_dir");
+  const PlanCache plan_cache(dir);
+  plan_cache.Store("key", NewJob("job"), NewPlan(3), "id_counters");
+  const std::string entry = ReadFile(plan_cache.EntryPath("key"));
+  Job job = NewJob("unchanged");
+  Plan plan;
+  std::string id_counters = "unchanged";
+  const PlanCacheStats stats_before = PlanCache::GetStats();
+  // the entry of another key at the path of this key, as a hash collision
+  WriteFile(plan_cache.EntryPath("other_key"), entry);
+  ASSERT_FALSE(plan_cache.TryLoad("other_key", &job, &plan, &id_counters));
+  // truncated
+  WriteFile(plan_cache.EntryPath("key"), entry.substr(0, entry.size() / 2));
+  ASSERT_FALSE(plan_cache.TryLoad("key", &job, &plan, &id_counters));
+  // corrupted
+  std::string corrupted = entry;
+  corrupted[corrupted.size() / 2] ^= 1;
+  WriteFile(plan_cache.EntryPath("key"), corrupted);
+  ASSERT_FALSE(plan_cache.TryLoad("key", &job, &plan, &id_counters));
+  ASSERT_EQ(job.job_conf().job_name(), "unchanged");
+  ASSERT_EQ(id_counters, "unchanged");
+  const PlanCacheStats stats = PlanCache::GetStats();
+  ASSERT_EQ(stats.invalid_count - stats_before.invalid_count, 3);
+  ASSERT_EQ(stats.hit_count - stats_before.hit_count, 0);
+  // stored again
+  plan_cache.Store("key", NewJob("job"), NewPlan(3), "id_counters");
+  ASSERT_TRUE(plan_cache.TryLoad("key", &job, &plan, &id_counters));
+  LocalFS()->RecursivelyDeleteDir(dir);
+}
+
+TEST(PlanCache, gen_key) {
+  NewGlobals();
+  const HashSet<std::string> variable_op_names{"var_0", "var_1", "var_2"};
+  const std::string key = PlanCache::GenKey(NewJob("job"), 0, variable_op_names);
+  ASSERT_EQ(PlanCache::GenKey(NewJob("job"), 0, variable_op_names), key);
+  // the order of the variables does not matter
+  HashSet<std::string> reordered_variable_op_names;
+  reordered_variable_op_names.reserve(16);
+  for (const std::string& op_name : {"var_2", "var_0", "var_1"}) {
+    reordered_variable_op_names.insert(op_name);
+  }
+  ASSERT_EQ(PlanCache::GenKey(NewJob("job"), 0, reordered_variable_op_names), key);
+  ASSERT_NE(PlanCache::GenKey(NewJob("other_job"), 0, variable_op_names), key);
+  ASSERT_NE(PlanCache::GenKey(NewJob("job"), 1, variable_op_names), key);
+  ASSERT_NE(PlanCache::GenKey(NewJob("job"), 0, HashSet<std::string>{"var_0"}), key);
+  // the ids the compilation generates depend on the states of the id counters
+  Global<IDMgr>::Get()->NewRegstDescId();
+  const std::string key_after_new_id = PlanCache::GenKey(NewJob("job"), 0, variable_op_names);
+  ASSERT_NE(key_after_new_id, key);
+  Global<IDMgr>::Get()->NewChunkId();
+  ASSERT_NE(PlanCache::GenKey(NewJob("job"), 0, variable_op_names), key_after_new_id);
+  DeleteGlobals();
+}
+
+}  // namespace test
+
+}  // namespace oneflow
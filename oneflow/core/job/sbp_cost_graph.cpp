@@ -0,0 +1,257 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/sbp_cost_graph.h"
+
+namespace oneflow {
+
+namespace {
+
+// a chain node is only eliminated if the table of its replacing edge is not too large
+constexpr int64_t kMaxChainTableSize = 1 << 20;
+constexpr int64_t kMaxLocalSearchRoundCnt = 64;
+
+int64_t ArgMin(const std::vector<double>& costs) {
+  return std::min_element(costs.begin(), costs.end()) - costs.begin();
+}
+
+class EliminationGraph final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(EliminationGraph);
+  explicit EliminationGraph(const std::vector<std::vector<double>>& node2costs)
+      : node2costs_(node2costs), node2neighbor2edge_(node2costs.size()) {}
+  ~EliminationGraph() = default;
+
+  int64_t candidate_num(int64_t node) const { return node2costs_.at(node).size(); }
+  const std::vector<double>& costs(int64_t node) const { return node2costs_.at(node); }
+  std::vector<double>* mut_costs(int64_t node) { return &node2costs_.at(node); }
+  const std::map<int64_t, int64_t>& neighbor2edge(int64_t node) const {
+    return node2neighbor2edge_.at(node);
+  }
+
+  double EdgeCost(int64_t edge, int64_t node, int64_t choice, int64_t neighbor_choice) const {
+    const Edge& e = edges_.at(edge);
+    if (e.src == node) { return e.costs[choice * candidate_num(e.dst) + neighbor_choice]; }
+    CHECK_EQ(e.dst, node);
+    return e.costs[neighbor_choice * candidate_num(e.dst) + choice];
+  }
+
+  void AddEdge(int64_t src, int64_t dst, const std::vector<double>& costs) {
+    CHECK_NE(src, dst);
+    CHECK_EQ(costs.size(), candidate_num(src) * candidate_num(dst));
+    const auto& it = node2neighbor2edge_.at(src).find(dst);
+    if (it == node2neighbor2edge_.at(src).end()) {
+      const int64_t edge = edges_.size();
+      edges_.push_back(Edge{src, dst, costs});
+      node2neighbor2edge_.at(src).emplace(dst, edge);
+      node2neighbor2edge_.at(dst).emplace(src, edge);
+      return;
+    }
+    // parallel edges are merged
+    Edge* e = &edges_.at(it->second);
+    FOR_RANGE(int64_t, i, 0, candidate_num(src)) {
+      FOR_RANGE(int64_t, j, 0, candidate_num(dst)) {
+        const double cost = costs[i * candidate_num(dst) + j];
+        if (e->src == src) {
+          e->costs[i * candidate_num(dst) + j] += cost;
+        } else {
+          e->costs[j * candidate_num(src) + i] += cost;
+        }
+      }
+    }
+  }
+
+  void RemoveNode(int64_t node) {
+    for (const auto& pair : node2neighbor2edge_.at(node)) {
+      node2neighbor2edge_.at(pair.first).erase(node);
+    }
+    node2neighbor2edge_.at(node).clear();
+  }
+
+ private:
+  struct Edge {
+    int64_t src;
+    int64_t dst;
+    std::vector<double> costs;
+  };
+
+  std::vector<std::vector<double>> node2costs_;
+  std::vector<std::map<int64_t, int64_t>> node2neighbor2edge_;
+  std::vector<Edge> edges_;
+};
+
+// how to restore the choice of an eliminated node from the choices of its former neighbours
+struct EliminationRecord {
+  int64_t node;
+  std::vector<int64_t> neighbors;
+  // indexed by the choices of neighbors, row major
+  std::vector<int64_t> choice_table;
+};
+
+}  // namespace
+
+int64_t SbpCostGraph::AddNode(std::vector<double>&& costs) {
+  CHECK(!costs.empty());
+  node2costs_.push_back(std::move(costs));
+  return node2costs_.size() - 1;
+}
+
+void SbpCostGraph::AddEdge(int64_t src, int64_t dst, std::vector<double>&& costs) {
+  CHECK_NE(src, dst);
+  CHECK_EQ(costs.size(), candidate_num(src) * candidate_num(dst));
+  edges_.push_back(EdgeCost{src, dst, std::move(costs)});
+}
+
+double SbpCostGraph::Cost4Choice(const std::vector<int64_t>& node2choice) const {
+  CHECK_EQ(node2choice.size(), node_num());
+  double cost = 0;
+  FOR_RANGE(int64_t, node, 0, node_num()) { cost += node2costs_.at(node).at(node2choice.at(node)); }
+  for (const EdgeCost& edge : edges_) {
+    cost += edge.costs.at(node2choice.at(edge.src) * candidate_num(edge.dst)
+                          + node2choice.at(edge.dst));
+  }
+  return cost;
+}
+
+std::vector<int64_t> SbpCostGraph::Search(const std::vector<int64_t>& init_node2choice,
+                                          SbpCostGraphSearchStat* stat) const {
+  CHECK_EQ(init_node2choice.size(), node_num());
+  EliminationGraph graph(node2costs_);
+  for (const EdgeCost& edge : edges_) { graph.AddEdge(edge.src, edge.dst, edge.costs); }
+
+  // step 1: eliminate nodes with at most two neighbours
+  std::vector<bool> is_eliminated(node_num(), false);
+  std::vector<EliminationRecord> records;
+  std::queue<int64_t> queue;
+  FOR_RANGE(int64_t, node, 0, node_num()) { queue.push(node); }
+  while (!queue.empty()) {
+    const int64_t node = queue.front();
+    queue.pop();
+    if (is_eliminated.at(node)) { continue; }
+    const auto& neighbor2edge = graph.neighbor2edge(node);
+    const std::vector<double>& costs = graph.costs(node);
+    EliminationRecord record;
+    record.node = node;
+    if (neighbor2edge.empty()) {
+      record.choice_table.push_back(ArgMin(costs));
+      stat->isolated_eliminated_cnt += 1;
+    } else if (neighbor2edge.size() == 1) {
+      const int64_t neighbor = neighbor2edge.begin()->first;
+      const int64_t edge = neighbor2edge.begin()->second;
+      record.neighbors.push_back(neighbor);
+      std::vector<double>* neighbor_costs = graph.mut_costs(neighbor);
+      FOR_RANGE(int64_t, neighbor_choice, 0, graph.candidate_num(neighbor)) {
+        int64_t best_choice = -1;
+        double best_cost = 0;
+        FOR_RANGE(int64_t, choice, 0, costs.size()) {
+          const double cost = costs[choice] + graph.EdgeCost(edge, node, choice, neighbor_choice);
+          if (best_choice == -1 || cost < best_cost) {
+            best_choice = choice;
+            best_cost = cost;
+          }
+        }
+        record.choice_table.push_back(best_choice);
+        neighbor_costs->at(neighbor_choice) += best_cost;
+      }
+      queue.push(neighbor);
+      stat->leaf_eliminated_cnt += 1;
+    } else if (neighbor2edge.size() == 2) {
+      const int64_t lhs = neighbor2edge.begin()->first;
+      const int64_t lhs_edge = neighbor2edge.begin()->second;
+      const int64_t rhs = neighbor2edge.rbegin()->first;
+      const int64_t rhs_edge = neighbor2edge.rbegin()->second;
+      const int64_t lhs_num = graph.candidate_num(lhs);
+      const int64_t rhs_num = graph.candidate_num(rhs);
+      if (lhs_num * rhs_num > kMaxChainTableSize) { continue; }
+      record.neighbors = {lhs, rhs};
+      std::vector<double> bypass_costs(lhs_num * rhs_num);
+      FOR_RANGE(int64_t, lhs_choice, 0, lhs_num) {
+        FOR_RANGE(int64_t, rhs_choice, 0, rhs_num) {
+          int64_t best_choice = -1;
+          double best_cost = 0;
+          FOR_RANGE(int64_t, choice, 0, costs.size()) {
+            const double cost = costs[choice] + graph.EdgeCost(lhs_edge, node, choice, lhs_choice)
+                                + graph.EdgeCost(rhs_edge, node, choice, rhs_choice);
+            if (best_choice == -1 || cost < best_cost) {
+              best_choice = choice;
+              best_cost = cost;
+            }
+          }
+          record.choice_table.push_back(best_choice);
+          bypass_costs[lhs_choice * rhs_num + rhs_choice] = best_cost;
+        }
+      }
+      graph.RemoveNode(node);
+      // may merge with an existing edge and make lhs or rhs eliminable
+      graph.AddEdge(lhs, rhs, bypass_costs);
+      queue.push(lhs);
+      queue.push(rhs);
+      stat->chain_eliminated_cnt += 1;
+    } else {
+      continue;
+    }
+    graph.RemoveNode(node);
+    is_eliminated.at(node) = true;
+    records.push_back(std::move(record));
+  }
+
+  // step 2: local search on the core
+  std::vector<int64_t> node2choice(init_node2choice);
+  std::vector<int64_t> core_nodes;
+  FOR_RANGE(int64_t, node, 0, node_num()) {
+    if (!is_eliminated.at(node)) { core_nodes.push_back(node); }
+  }
+  stat->core_node_cnt = core_nodes.size();
+  const auto LocalCost = [&](int64_t node, int64_t choice) -> double {
+    double cost = graph.costs(node).at(choice);
+    for (const auto& pair : graph.neighbor2edge(node)) {
+      cost += graph.EdgeCost(pair.second, node, choice, node2choice.at(pair.first));
+    }
+    return cost;
+  };
+  FOR_RANGE(int64_t, round, 0, core_nodes.empty() ? 0 : kMaxLocalSearchRoundCnt) {
+    stat->local_search_round_cnt += 1;
+    bool changed = false;
+    for (int64_t node : core_nodes) {
+      int64_t best_choice = node2choice.at(node);
+      double best_cost = LocalCost(node, best_choice);
+      FOR_RANGE(int64_t, choice, 0, graph.candidate_num(node)) {
+        const double cost = LocalCost(node, choice);
+        if (cost < best_cost) {
+          best_choice = choice;
+          best_cost = cost;
+        }
+      }
+      if (best_choice != node2choice.at(node)) {
+        node2choice.at(node) = best_choice;
+        changed = true;
+      }
+    }
+    if (!changed) { break; }
+  }
+
+  // step 3: restore eliminated nodes
+  for (auto it = records.rbegin(); it != records.rend(); ++it) {
+    int64_t index = 0;
+    for (int64_t neighbor : it->neighbors) {
+      index = index * graph.candidate_num(neighbor) + node2choice.at(neighbor);
+    }
+    node2choice.at(it->node) = it->choice_table.at(index);
+  }
+  if (Cost4Choice(node2choice) > Cost4Choice(init_node2choice)) { return init_node2choice; }
+  return node2choice;
+}
+
+}  // namespace oneflow
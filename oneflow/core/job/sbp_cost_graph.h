@@ -0,0 +1,70 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_SBP_COST_GRAPH_H_
+#define ONEFLOW_CORE_JOB_SBP_COST_GRAPH_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+struct SbpCostGraphSearchStat {
+  int64_t isolated_eliminated_cnt = 0;
+  int64_t leaf_eliminated_cnt = 0;
+  int64_t chain_eliminated_cnt = 0;
+  int64_t core_node_cnt = 0;
+  int64_t local_search_round_cnt = 0;
+};
+
+// A graph of nodes that each pick one of their candidates (sbp signatures of an op), with a cost
+// per candidate on every node and a cost per pair of candidates on every edge. Search() looks for
+// the choice with the least total cost:
+//   1. nodes with at most two neighbours are eliminated exactly: a leaf folds its best cost into
+//      its neighbour, a node on a chain is replaced by an edge between its two neighbours;
+//   2. the remaining core is improved by local search starting from the given choice;
+//   3. eliminated nodes are restored in reverse order from the tables recorded in step 1.
+// On series-parallel graphs step 1 eliminates everything and the result is optimal.
+class SbpCostGraph final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SbpCostGraph);
+  SbpCostGraph() = default;
+  ~SbpCostGraph() = default;
+
+  int64_t node_num() const { return node2costs_.size(); }
+  int64_t candidate_num(int64_t node) const { return node2costs_.at(node).size(); }
+
+  // returns the id of the new node
+  int64_t AddNode(std::vector<double>&& costs);
+  // costs[i * candidate_num(dst) + j] is the cost when src picks i and dst picks j
+  void AddEdge(int64_t src, int64_t dst, std::vector<double>&& costs);
+
+  double Cost4Choice(const std::vector<int64_t>& node2choice) const;
+  std::vector<int64_t> Search(const std::vector<int64_t>& init_node2choice,
+                              SbpCostGraphSearchStat* stat) const;
+
+ private:
+  struct EdgeCost {
+    int64_t src;
+    int64_t dst;
+    std::vector<double> costs;
+  };
+
+  std::vector<std::vector<double>> node2costs_;
+  std::vector<EdgeCost> edges_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_SBP_COST_GRAPH_H_
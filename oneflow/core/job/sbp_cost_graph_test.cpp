@@ -0,0 +1,112 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/sbp_cost_graph.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+std::vector<double> RandomCosts(int64_t size, std::mt19937* gen) {
+  std::uniform_real_distribution<double> dis(0, 10);
+  std::vector<double> costs(size);
+  for (double& cost : costs) { cost = dis(*gen); }
+  return costs;
+}
+
+double BruteForceMinCost(const SbpCostGraph& graph) {
+  std::vector<int64_t> node2choice(graph.node_num(), 0);
+  double min_cost = graph.Cost4Choice(node2choice);
+  while (true) {
+    int64_t node = 0;
+    while (node < graph.node_num() && ++node2choice[node] == graph.candidate_num(node)) {
+      node2choice[node] = 0;
+      node += 1;
+    }
+    if (node == graph.node_num()) { break; }
+    min_cost = std::min(min_cost, graph.Cost4Choice(node2choice));
+  }
+  return min_cost;
+}
+
+// edges[i] connects node i + 1 to a random former node, so the graph is a tree
+void AddRandomTree(SbpCostGraph* graph, int64_t node_num, std::mt19937* gen) {
+  FOR_RANGE(int64_t, i, 0, node_num) { graph->AddNode(RandomCosts(1 + (*gen)() % 4, gen)); }
+  FOR_RANGE(int64_t, dst, 1, node_num) {
+    const int64_t src = (*gen)() % dst;
+    graph->AddEdge(src, dst,
+                   RandomCosts(graph->candidate_num(src) * graph->candidate_num(dst), gen));
+  }
+}
+
+}  // namespace
+
+TEST(SbpCostGraph, chain) {
+  // 0 -> 1 -> 2, every node prefers candidate 0 but the edges punish a change of candidates
+  SbpCostGraph graph;
+  graph.AddNode({0, 1});
+  graph.AddNode({5, 0});
+  graph.AddNode({0, 1});
+  graph.AddEdge(0, 1, {0, 10, 10, 0});
+  graph.AddEdge(1, 2, {0, 10, 10, 0});
+  SbpCostGraphSearchStat stat;
+  const std::vector<int64_t> node2choice = graph.Search({0, 1, 0}, &stat);
+  ASSERT_EQ(node2choice, std::vector<int64_t>({1, 1, 1}));
+  ASSERT_DOUBLE_EQ(graph.Cost4Choice(node2choice), 2);
+  ASSERT_EQ(stat.core_node_cnt, 0);
+}
+
+TEST(SbpCostGraph, tree_is_optimal) {
+  std::mt19937 gen(0);
+  FOR_RANGE(int, trial, 0, 100) {
+    SbpCostGraph graph;
+    AddRandomTree(&graph, 2 + trial % 7, &gen);
+    SbpCostGraphSearchStat stat;
+    const auto node2choice = graph.Search(std::vector<int64_t>(graph.node_num(), 0), &stat);
+    ASSERT_EQ(stat.core_node_cnt, 0);
+    ASSERT_NEAR(graph.Cost4Choice(node2choice), BruteForceMinCost(graph), 1e-9);
+  }
+}
+
+TEST(SbpCostGraph, never_worse_than_init) {
+  std::mt19937 gen(1);
+  FOR_RANGE(int, trial, 0, 100) {
+    SbpCostGraph graph;
+    const int64_t node_num = 4 + trial % 5;
+    AddRandomTree(&graph, node_num, &gen);
+    // extra edges make cycles that cannot be fully eliminated
+    FOR_RANGE(int64_t, i, 0, node_num) {
+      const int64_t src = gen() % node_num;
+      const int64_t dst = gen() % node_num;
+      if (src == dst) { continue; }
+      graph.AddEdge(src, dst,
+                    RandomCosts(graph.candidate_num(src) * graph.candidate_num(dst), &gen));
+    }
+    std::vector<int64_t> init_node2choice(node_num);
+    FOR_RANGE(int64_t, node, 0, node_num) {
+      init_node2choice[node] = gen() % graph.candidate_num(node);
+    }
+    SbpCostGraphSearchStat stat;
+    const auto node2choice = graph.Search(init_node2choice, &stat);
+    ASSERT_LE(graph.Cost4Choice(node2choice), graph.Cost4Choice(init_node2choice) + 1e-9);
+    ASSERT_GE(graph.Cost4Choice(node2choice), BruteForceMinCost(graph) - 1e-9);
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
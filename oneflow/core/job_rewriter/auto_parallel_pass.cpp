@@ -0,0 +1,435 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/framework/user_op_registry_manager.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/sbp_cost_graph.h"
+#include "oneflow/core/job/sbp_parallel.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/persistence/tee_persistent_log_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr double kInfeasibleCost = 1e30;
+
+double LogicalBytes(const BlobDesc& blob_desc) {
+  return static_cast<double>(blob_desc.shape().elem_cnt())
+         * GetSizeOfDataType(blob_desc.data_type());
+}
+
+double PerRankBytes(const cfg::SbpParallel& sbp_parallel, double logical_bytes,
+                    int64_t parallel_num) {
+  return sbp_parallel.has_split_parallel() ? logical_bytes / parallel_num : logical_bytes;
+}
+
+// Bytes each rank sends or receives to turn src_sbp on src_pd into dst_sbp on dst_pd, named after
+// the SubTskGphBuilder that TaskGraph is expected to pick for it. Collectives are costed as ring
+// algorithms.
+double BoxingBytesPerRank(const cfg::SbpParallel& src_sbp, const ParallelDesc& src_pd,
+                          const cfg::SbpParallel& dst_sbp, const ParallelDesc& dst_pd,
+                          double logical_bytes, std::string* builder) {
+  if (src_pd == dst_pd) {
+    const int64_t parallel_num = src_pd.parallel_num();
+    if (parallel_num == 1 || src_sbp == dst_sbp) {
+      *builder = "OneToOne";
+      return 0;
+    }
+    if (dst_sbp.has_partial_sum_parallel()) {
+      if (src_sbp.has_broadcast_parallel()) {
+        *builder = "NaiveB2P";
+        return 0;
+      }
+      *builder = "Infeasible";
+      return kInfeasibleCost;
+    }
+    *builder = src_pd.device_type() == DeviceType::kGPU ? "CollectiveBoxing" : "SliceBoxing";
+    const double ring_bytes = logical_bytes * (parallel_num - 1) / parallel_num;
+    if (src_sbp.has_split_parallel() && dst_sbp.has_split_parallel()) {
+      // all2all
+      return ring_bytes / parallel_num;
+    } else if (src_sbp.has_split_parallel() && dst_sbp.has_broadcast_parallel()) {
+      // all-gather
+      return ring_bytes;
+    } else if (src_sbp.has_partial_sum_parallel() && dst_sbp.has_split_parallel()) {
+      // reduce-scatter
+      return ring_bytes;
+    } else if (src_sbp.has_partial_sum_parallel() && dst_sbp.has_broadcast_parallel()) {
+      // all-reduce
+      return 2 * ring_bytes;
+    } else {
+      // B -> S is a local slice
+      *builder = "SliceBoxing";
+      return 0;
+    }
+  }
+  if (dst_sbp.has_partial_sum_parallel()) {
+    if (src_sbp.has_broadcast_parallel()) {
+      *builder = "NaiveB2P";
+      return logical_bytes;
+    }
+    *builder = "Infeasible";
+    return kInfeasibleCost;
+  }
+  if (src_sbp.has_broadcast_parallel() && dst_pd.parallel_num() == 1) {
+    *builder = "B21";
+    return logical_bytes;
+  }
+  if (src_sbp.has_broadcast_parallel() && dst_sbp.has_broadcast_parallel()) {
+    *builder = "NaiveB2B";
+    return logical_bytes;
+  }
+  *builder = "SliceBoxing";
+  const double src_factor = src_sbp.has_partial_sum_parallel() ? src_pd.parallel_num() : 1;
+  return src_factor * PerRankBytes(dst_sbp, logical_bytes, dst_pd.parallel_num());
+}
+
+struct SbpCost {
+  double compute = 0;
+  double memory = 0;
+  std::map<std::string, double> builder2boxing_bytes;
+
+  double boxing() const {
+    double bytes = 0;
+    for (const auto& pair : builder2boxing_bytes) { bytes += pair.second; }
+    return bytes;
+  }
+  double total() const { return compute + memory + boxing(); }
+  std::string ToString() const {
+    std::stringstream ss;
+    ss << total() << " (compute " << compute << ", memory " << memory << ", boxing " << boxing();
+    for (const auto& pair : builder2boxing_bytes) {
+      ss << ", " << pair.first << " " << pair.second;
+    }
+    ss << ")";
+    return ss.str();
+  }
+};
+
+std::string SbpSignatureToString(const Operator& op, const cfg::SbpSignature& sbp_signature) {
+  std::string ret;
+  const auto& bn2sbp = sbp_signature.bn_in_op2sbp_parallel();
+  op.ForEachBnInOp([&](const std::string& bn) {
+    const auto& it = bn2sbp.find(bn);
+    if (it == bn2sbp.end()) { return; }
+    if (!ret.empty()) { ret += ", "; }
+    ret += bn + ":" + SbpParallelToString(it->second);
+  });
+  return ret;
+}
+
+bool IsConsistentWithHint(const cfg::SbpSignature& sbp_signature, const SbpSignature& hint) {
+  const auto& bn2sbp = sbp_signature.bn_in_op2sbp_parallel();
+  for (const auto& pair : hint.bn_in_op2sbp_parallel()) {
+    const auto& it = bn2sbp.find(pair.first);
+    if (it == bn2sbp.end() || !(it->second == cfg::SbpParallel(pair.second))) { return false; }
+  }
+  return true;
+}
+
+// Only user ops that pick their signature from GetSbpSignatures are searched. System ops, user
+// ops with their own SbpSignatureInferFn and mirrored ops keep the signature inferred greedily.
+Maybe<bool> IsSearchable(const OpNode* op_node) {
+  const Operator& op = op_node->op();
+  if (op_node->parallel_desc().hierarchy()->NumAxes() != 1) { return false; }
+  if (op_node->parallel_desc().parallel_num() == 1) { return false; }
+  if (!op.op_conf().has_user_conf()) { return false; }
+  const std::string& op_type_name = op.op_conf().user_conf().op_type_name();
+  const auto* val = user_op::UserOpRegistryMgr::Get().GetOpRegistryResult(op_type_name);
+  if (val == nullptr || val->sbp_signature_infer_fn) { return false; }
+  for (const auto& obn : op.output_bns()) {
+    if (JUST(op.OptMirroredParallel4BnInOp(obn))->has_mirrored_parallel()) { return false; }
+  }
+  return true;
+}
+
+class SbpSearchProblem final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SbpSearchProblem);
+  SbpSearchProblem(const OpGraph& op_graph, const JobParallelViewConf& job_parallel_view_conf,
+                   double computation_cost_ratio, double memory_cost_ratio)
+      : op_graph_(op_graph),
+        job_parallel_view_conf_(job_parallel_view_conf),
+        computation_cost_ratio_(computation_cost_ratio),
+        memory_cost_ratio_(memory_cost_ratio) {}
+  ~SbpSearchProblem() = default;
+
+  Maybe<void> Init();
+
+  const SbpCostGraph& cost_graph() const { return cost_graph_; }
+  const std::vector<const OpNode*>& id2op_node() const { return id2op_node_; }
+  int64_t searchable_cnt() const { return searchable_cnt_; }
+  // candidate 0 of every op is its greedily inferred signature
+  std::vector<int64_t> GreedyChoice() const { return std::vector<int64_t>(id2op_node_.size(), 0); }
+  const cfg::SbpSignature& Candidate(int64_t id, int64_t choice) const {
+    return id2candidates_.at(id).at(choice);
+  }
+  SbpCost Cost4Choice(const std::vector<int64_t>& id2choice) const;
+
+ private:
+  Maybe<void> InitCandidates(const OpNode* op_node, std::vector<cfg::SbpSignature>* candidates);
+  bool IsValidCandidate(const OpNode* op_node, const cfg::SbpSignature& sbp_signature) const;
+  // nodes on nd hierarchies have no candidates and take no part in the search
+  bool IsOneDim(int64_t id) const { return !id2candidates_.at(id).empty(); }
+  void ComputeNodeCost(int64_t id, const cfg::SbpSignature& sbp_signature, double* compute,
+                       double* memory) const;
+  void ForEachBoxing(const OpEdge* op_edge, const cfg::SbpSignature& src_sbp_signature,
+                     const cfg::SbpSignature& dst_sbp_signature,
+                     const std::function<void(const std::string&, double)>& Handler) const;
+
+  const OpGraph& op_graph_;
+  const JobParallelViewConf& job_parallel_view_conf_;
+  double computation_cost_ratio_;
+  double memory_cost_ratio_;
+  HashMap<const OpNode*, int64_t> op_node2id_;
+  std::vector<const OpNode*> id2op_node_;
+  std::vector<std::vector<cfg::SbpSignature>> id2candidates_;
+  std::vector<const OpEdge*> one_dim_op_edges_;
+  int64_t searchable_cnt_ = 0;
+  SbpCostGraph cost_graph_;
+};
+
+Maybe<void> SbpSearchProblem::Init() {
+  JUST(op_graph_.TopoForEachNodeWithErrorCaptured([&](OpNode* op_node) -> Maybe<void> {
+    const int64_t id = id2op_node_.size();
+    op_node2id_.emplace(op_node, id);
+    id2op_node_.push_back(op_node);
+    id2candidates_.emplace_back();
+    JUST(InitCandidates(op_node, &id2candidates_.back()));
+    std::vector<double> costs;
+    for (const cfg::SbpSignature& candidate : id2candidates_.back()) {
+      double compute = 0;
+      double memory = 0;
+      ComputeNodeCost(id, candidate, &compute, &memory);
+      costs.push_back(compute + memory);
+    }
+    if (costs.empty()) { costs.push_back(0); }
+    CHECK_EQ_OR_RETURN(cost_graph_.AddNode(std::move(costs)), id);
+    return Maybe<void>::Ok();
+  }));
+  op_graph_.ForEachEdge([&](const OpEdge* op_edge) {
+    const int64_t src = op_node2id_.at(op_edge->src_node());
+    const int64_t dst = op_node2id_.at(op_edge->dst_node());
+    if (!IsOneDim(src) || !IsOneDim(dst)) { return; }
+    one_dim_op_edges_.push_back(op_edge);
+    const int64_t dst_num = cost_graph_.candidate_num(dst);
+    std::vector<double> costs(cost_graph_.candidate_num(src) * dst_num, 0);
+    FOR_RANGE(int64_t, i, 0, cost_graph_.candidate_num(src)) {
+      FOR_RANGE(int64_t, j, 0, dst_num) {
+        ForEachBoxing(op_edge, Candidate(src, i), Candidate(dst, j),
+                      [&](const std::string&, double bytes) { costs[i * dst_num + j] += bytes; });
+      }
+    }
+    cost_graph_.AddEdge(src, dst, std::move(costs));
+  });
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> SbpSearchProblem::InitCandidates(const OpNode* op_node,
+                                             std::vector<cfg::SbpSignature>* candidates) {
+  const Operator& op = op_node->op();
+  const ParallelDesc& parallel_desc = op_node->parallel_desc();
+  if (parallel_desc.hierarchy()->NumAxes() != 1) { return Maybe<void>::Ok(); }
+  candidates->push_back(op_node->sbp_signature());
+  if (!JUST(IsSearchable(op_node))) { return Maybe<void>::Ok(); }
+  searchable_cnt_ += 1;
+  const auto LogicalBlobDesc4Ibn = [&](const std::string& ibn) -> Maybe<const BlobDesc&> {
+    return op_graph_.GetLogicalBlobDesc(op.BnInOp2Lbi(ibn));
+  };
+  cfg::SbpSignatureList sbp_sig_list;
+  JUST(op.GetSbpSignaturesIf(LogicalBlobDesc4Ibn, parallel_desc, &sbp_sig_list));
+  // sbp already set in the job, e.g. by user annotations, is kept
+  const auto& op_name2sbp_signature_conf = job_parallel_view_conf_.op_name2sbp_signature_conf();
+  const auto& hint_it = op_name2sbp_signature_conf.find(op.op_name());
+  for (const cfg::SbpSignature& sbp_signature : sbp_sig_list.sbp_signature()) {
+    if (std::find(candidates->begin(), candidates->end(), sbp_signature) != candidates->end()) {
+      continue;
+    }
+    if (hint_it != op_name2sbp_signature_conf.end()
+        && !IsConsistentWithHint(sbp_signature, hint_it->second)) {
+      continue;
+    }
+    if (IsValidCandidate(op_node, sbp_signature)) { candidates->push_back(sbp_signature); }
+  }
+  return Maybe<void>::Ok();
+}
+
+bool SbpSearchProblem::IsValidCandidate(const OpNode* op_node,
+                                        const cfg::SbpSignature& sbp_signature) const {
+  const Operator& op = op_node->op();
+  const auto& bn2sbp = sbp_signature.bn_in_op2sbp_parallel();
+  bool is_valid = true;
+  op.ForEachBnInOp([&](const std::string& bn) {
+    if (!is_valid) { return; }
+    if (std::find(op.tmp_bns().begin(), op.tmp_bns().end(), bn) != op.tmp_bns().end()) { return; }
+    const auto& it = bn2sbp.find(bn);
+    if (it == bn2sbp.end()) {
+      is_valid = false;
+      return;
+    }
+    if (!it->second.has_split_parallel()) { return; }
+    // same rule as Operator::FilterAndCheckValidSbpSignatureListByLogicalShape
+    const Shape& shape = op_graph_.GetLogicalBlobDesc(op.BnInOp2Lbi(bn)).shape();
+    const int64_t axis = it->second.split_parallel().axis();
+    if (axis < 0 || axis >= shape.NumAxes()
+        || shape.At(axis) < op_node->parallel_desc().parallel_num()) {
+      is_valid = false;
+    }
+  });
+  return is_valid;
+}
+
+void SbpSearchProblem::ComputeNodeCost(int64_t id, const cfg::SbpSignature& sbp_signature,
+                                       double* compute, double* memory) const {
+  const OpNode* op_node = id2op_node_.at(id);
+  const Operator& op = op_node->op();
+  const int64_t parallel_num = op_node->parallel_desc().parallel_num();
+  const auto& bn2sbp = sbp_signature.bn_in_op2sbp_parallel();
+  const auto PerRankBytes4Bn = [&](const std::string& bn) -> double {
+    const double logical_bytes = LogicalBytes(op_graph_.GetLogicalBlobDesc(op.BnInOp2Lbi(bn)));
+    return PerRankBytes(bn2sbp.at(bn), logical_bytes, parallel_num);
+  };
+  // the bytes an op reads and writes on every rank stand in for its compute time
+  for (const auto& ibn : op.input_bns()) {
+    *compute += computation_cost_ratio_ * PerRankBytes4Bn(ibn);
+  }
+  for (const auto& obn : op.output_bns()) {
+    const double bytes = PerRankBytes4Bn(obn);
+    *compute += computation_cost_ratio_ * bytes;
+    *memory += memory_cost_ratio_ * bytes;
+  }
+}
+
+void SbpSearchProblem::ForEachBoxing(
+    const OpEdge* op_edge, const cfg::SbpSignature& src_sbp_signature,
+    const cfg::SbpSignature& dst_sbp_signature,
+    const std::function<void(const std::string&, double)>& Handler) const {
+  const ParallelDesc& src_pd = op_edge->src_node()->parallel_desc();
+  const ParallelDesc& dst_pd = op_edge->dst_node()->parallel_desc();
+  for (const LogicalBlobId& lbi : op_edge->lbis()) {
+    const double logical_bytes = LogicalBytes(op_graph_.GetLogicalBlobDesc(lbi));
+    const cfg::SbpParallel& src_sbp =
+        src_sbp_signature.bn_in_op2sbp_parallel().at(op_edge->lbi2obn().at(lbi));
+    for (const std::string& ibn : op_edge->lbi2ibns().at(lbi)) {
+      const cfg::SbpParallel& dst_sbp = dst_sbp_signature.bn_in_op2sbp_parallel().at(ibn);
+      std::string builder;
+      const double bytes =
+          BoxingBytesPerRank(src_sbp, src_pd, dst_sbp, dst_pd, logical_bytes, &builder);
+      Handler(builder, bytes);
+    }
+  }
+}
+
+SbpCost SbpSearchProblem::Cost4Choice(const std::vector<int64_t>& id2choice) const {
+  SbpCost cost;
+  FOR_RANGE(int64_t, id, 0, id2op_node_.size()) {
+    if (!IsOneDim(id)) { continue; }
+    ComputeNodeCost(id, Candidate(id, id2choice.at(id)), &cost.compute, &cost.memory);
+  }
+  for (const OpEdge* op_edge : one_dim_op_edges_) {
+    const int64_t src = op_node2id_.at(op_edge->src_node());
+    const int64_t dst = op_node2id_.at(op_edge->dst_node());
+    ForEachBoxing(op_edge, Candidate(src, id2choice.at(src)), Candidate(dst, id2choice.at(dst)),
+                  [&](const std::string& builder, double bytes) {
+                    cost.builder2boxing_bytes[builder] += bytes;
+                  });
+  }
+  return cost;
+}
+
+class AutoParallelPass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AutoParallelPass);
+  AutoParallelPass() = default;
+  ~AutoParallelPass() override = default;
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().job_conf().enable_auto_parallel();
+  }
+  Maybe<void> Apply(const OpGraph& op_graph, const JobDesc& job_desc, Job* job) const;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    return Apply(op_graph, ctx->job_desc(), job);
+  }
+};
+
+Maybe<void> AutoParallelPass::Apply(const OpGraph& op_graph, const JobDesc& job_desc,
+                                    Job* job) const {
+  const JobConfigProto& job_conf = job_desc.job_conf();
+  SbpSearchProblem problem(op_graph, job->job_parallel_view_conf(),
+                           job_conf.auto_parallel_computation_cost_ratio(),
+                           job_conf.auto_parallel_memory_cost_ratio());
+  JUST(problem.Init());
+  const std::vector<int64_t> greedy_choice = problem.GreedyChoice();
+  SbpCostGraphSearchStat stat;
+  const std::vector<int64_t> chosen_choice = problem.cost_graph().Search(greedy_choice, &stat);
+
+  // The plan is a full sbp signature conf for every op with a choice, also for those keeping
+  // their greedy signature, since later OpGraph constructions would otherwise re-infer them
+  // against their neighbours' new sbp. Candidates agree with existing confs, so overwriting
+  // them keeps user annotations.
+  auto* job_parallel_view_conf = job->mutable_job_parallel_view_conf();
+  int64_t changed_cnt = 0;
+  FOR_RANGE(int64_t, id, 0, chosen_choice.size()) {
+    if (problem.cost_graph().candidate_num(id) <= 1) { continue; }
+    if (chosen_choice.at(id) != greedy_choice.at(id)) { changed_cnt += 1; }
+    const std::string& op_name = problem.id2op_node().at(id)->op().op_name();
+    const cfg::SbpSignature& sbp_signature = problem.Candidate(id, chosen_choice.at(id));
+    sbp_signature.ToProto(
+        &(*job_parallel_view_conf->mutable_op_name2sbp_signature_conf())[op_name]);
+    cfg::NdSbpSignature nd_sbp_signature;
+    SbpSignatureToNdSbpSignature(sbp_signature, &nd_sbp_signature);
+    nd_sbp_signature.ToProto(
+        &(*job_parallel_view_conf->mutable_op_name2nd_sbp_signature_conf())[op_name]);
+  }
+
+  LOG(INFO) << "AutoParallelPass job " << job_desc.job_name() << ": searched "
+            << problem.searchable_cnt() << " of " << op_graph.node_num() << " ops, eliminated "
+            << stat.isolated_eliminated_cnt << " isolated, " << stat.leaf_eliminated_cnt
+            << " leaf and " << stat.chain_eliminated_cnt << " chain ops, " << stat.core_node_cnt
+            << " core ops in " << stat.local_search_round_cnt << " local search rounds";
+  LOG(INFO) << "AutoParallelPass job " << job_desc.job_name() << ": predicted cost of greedy "
+            << "signatures " << problem.Cost4Choice(greedy_choice).ToString()
+            << ", of chosen signatures " << problem.Cost4Choice(chosen_choice).ToString() << ", "
+            << changed_cnt << " ops changed";
+  if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()) {
+    auto log_stream =
+        TeePersistentLogStream::Create("auto_parallel_" + std::to_string(job_desc.job_id()));
+    const std::string sep = "\t";
+    (*log_stream) << "op_name" << sep << "greedy" << sep << "chosen"
+                  << "\n";
+    FOR_RANGE(int64_t, id, 0, chosen_choice.size()) {
+      const Operator& op = problem.id2op_node().at(id)->op();
+      if (problem.cost_graph().candidate_num(id) == 1) { continue; }
+      (*log_stream) << op.op_name() << sep
+                    << SbpSignatureToString(op, problem.Candidate(id, greedy_choice.at(id))) << sep
+                    << SbpSignatureToString(op, problem.Candidate(id, chosen_choice.at(id)))
+                    << "\n";
+    }
+  }
+  return Maybe<void>::Ok();
+}
+
+REGISTER_JOB_PASS("AutoParallelPass", AutoParallelPass);
+
+}  // namespace
+
+}  // namespace oneflow
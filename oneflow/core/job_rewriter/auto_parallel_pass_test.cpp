@@ -0,0 +1,160 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/control/ctrl_bootstrap.pb.h"
+#include "oneflow/core/framework/user_op_conf.h"
+#include "oneflow/core/graph/op_graph.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/job_desc.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/sbp_parallel.h"
+#include "oneflow/core/job_rewriter/job_pass.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+constexpr int64_t kReluNum = 16;
+
+class AutoParallelPassTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    Global<ProcessCtx>::New();
+    Global<ProcessCtx>::Get()->mutable_ctrl_addr()->Add();
+    Global<ProcessCtx>::Get()->set_rank(0);
+    Global<ProcessCtx>::Get()->set_node_size(1);
+    Resource resource;
+    resource.set_machine_num(1);
+    resource.set_cpu_device_num(2);
+    Global<ResourceDesc, ForSession>::New(resource);
+  }
+  void TearDown() override {
+    Global<ResourceDesc, ForSession>::Delete();
+    Global<ProcessCtx>::Delete();
+  }
+};
+
+std::string ReluName(int64_t i) { return "relu_" + std::to_string(i); }
+
+void SetBroadcastBlobConf(InterfaceBlobConf* blob_conf) {
+  blob_conf->mutable_shape()->add_dim(64);
+  blob_conf->mutable_shape()->add_dim(64);
+  blob_conf->set_data_type(DataType::kFloat);
+  blob_conf->mutable_nd_sbp()->add_sbp_parallel()->mutable_broadcast_parallel();
+}
+
+// x(B) -> relu_0 -> ... -> relu_15 -> y(B) on 2 cpu devices. The greedy inference keeps every
+// relu on B, since B -> S is priced as a copy. Splitting halves the compute and memory of every
+// relu at the price of one all-gather in front of y.
+Job NewReluChainJob(bool enable_auto_parallel) {
+  Job job;
+  job.mutable_job_conf()->set_job_name("relu_chain");
+  job.mutable_job_conf()->set_enable_auto_parallel(enable_auto_parallel);
+  PlacementGroup* placement_group = job.mutable_placement()->add_placement_group();
+  placement_group->mutable_parallel_conf()->set_device_tag("cpu");
+  placement_group->mutable_parallel_conf()->add_device_name("0:0-1");
+
+  OperatorConf x_conf;
+  x_conf.set_name("x");
+  x_conf.set_device_tag("cpu");
+  x_conf.mutable_input_conf()->set_out("out");
+  SetBroadcastBlobConf(x_conf.mutable_input_conf()->mutable_blob_conf());
+  *job.mutable_net()->add_op() = x_conf;
+  placement_group->mutable_op_set()->add_op_name("x");
+  std::string lbn = "x/out";
+  FOR_RANGE(int64_t, i, 0, kReluNum) {
+    OperatorConf relu_conf = user_op::UserOpConfWrapperBuilder(ReluName(i))
+                                 .Op("relu")
+                                 .Input("in", lbn)
+                                 .Output("out")
+                                 .Build()
+                                 .op_conf();
+    relu_conf.set_device_tag("cpu");
+    *job.mutable_net()->add_op() = relu_conf;
+    placement_group->mutable_op_set()->add_op_name(ReluName(i));
+    lbn = ReluName(i) + "/out_0";
+  }
+  OperatorConf y_conf;
+  y_conf.set_name("y");
+  y_conf.set_device_tag("cpu");
+  y_conf.mutable_output_conf()->set_in(lbn);
+  y_conf.mutable_output_conf()->set_out("out");
+  SetBroadcastBlobConf(y_conf.mutable_output_conf()->mutable_blob_conf());
+  *job.mutable_net()->add_op() = y_conf;
+  placement_group->mutable_op_set()->add_op_name("y");
+  return job;
+}
+
+void ApplyAutoParallelPass(Job* job) {
+  JobDesc job_desc(job->job_conf(), 0);
+  JobPassCtx job_pass_ctx(job_desc);
+  CHECK_JUST(JobPass4Name("AutoParallelPass")(job, &job_pass_ctx));
+}
+
+// the sbp of the relu outputs as applied by an OpGraph of the job
+std::vector<bool> IsReluOutSplit(const Job& job) {
+  const OpGraph op_graph(job);
+  std::vector<bool> ret;
+  FOR_RANGE(int64_t, i, 0, kReluNum) {
+    const OpNode* op_node = op_graph.OpNode4OpName(ReluName(i));
+    const auto& bn2sbp = op_node->sbp_signature().bn_in_op2sbp_parallel();
+    ret.push_back(bn2sbp.at("out_0").has_split_parallel());
+  }
+  return ret;
+}
+
+}  // namespace
+
+TEST_F(AutoParallelPassTest, disabled_keeps_greedy_signatures) {
+  Job job = NewReluChainJob(false);
+  ApplyAutoParallelPass(&job);
+  ASSERT_EQ(job.job_parallel_view_conf().op_name2sbp_signature_conf_size(), 0);
+  for (bool is_split : IsReluOutSplit(job)) { ASSERT_FALSE(is_split); }
+}
+
+TEST_F(AutoParallelPassTest, splits_broadcast_relu_chain) {
+  Job job = NewReluChainJob(true);
+  ApplyAutoParallelPass(&job);
+  const auto& op_name2sbp_signature_conf =
+      job.job_parallel_view_conf().op_name2sbp_signature_conf();
+  FOR_RANGE(int64_t, i, 0, kReluNum) {
+    ASSERT_TRUE(op_name2sbp_signature_conf.find(ReluName(i)) != op_name2sbp_signature_conf.end());
+  }
+  for (bool is_split : IsReluOutSplit(job)) { ASSERT_TRUE(is_split); }
+}
+
+TEST_F(AutoParallelPassTest, keeps_user_sbp_hints) {
+  Job job = NewReluChainJob(true);
+  // pin relu_0 on B, as a user annotation of the job would
+  cfg::SbpSignature hint;
+  (*hint.mutable_bn_in_op2sbp_parallel())["in_0"].mutable_broadcast_parallel();
+  (*hint.mutable_bn_in_op2sbp_parallel())["out_0"].mutable_broadcast_parallel();
+  cfg::NdSbpSignature nd_hint;
+  SbpSignatureToNdSbpSignature(hint, &nd_hint);
+  auto* job_parallel_view_conf = job.mutable_job_parallel_view_conf();
+  hint.ToProto(&(*job_parallel_view_conf->mutable_op_name2sbp_signature_conf())[ReluName(0)]);
+  nd_hint.ToProto(&(*job_parallel_view_conf->mutable_op_name2nd_sbp_signature_conf())[ReluName(0)]);
+  ApplyAutoParallelPass(&job);
+  const std::vector<bool> is_split = IsReluOutSplit(job);
+  ASSERT_FALSE(is_split.front());
+  ASSERT_TRUE(is_split.back());
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/kernel/kernel.h"
 #include "oneflow/core/operator/operator.h"
 #include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -57,11 +58,9 @@ class ModelInitKernel final : public Kernel {
         return snapshot;
       }
     };
-    const auto InitializeWithSnapshot = [&](const std::string& snapshot_path,
-                                            const std::string& key, Blob* blob) {
-      SnapshotReader* reader = GetSnapshotReader(snapshot_path);
-      reader->Read(key, blob);
-    };
+    std::vector<std::pair<SnapshotReader*, std::string>> var_id2reader_and_key(num_var);
+    std::vector<Blob*> var_id2out(num_var);
+    std::vector<int64_t> snapshot_var_ids;
     FOR_RANGE(int64_t, i, 0, num_var) {
       Blob* out_i = ctx->BnInOp2Blob(GenRepeatedBn("out", i));
       const VariableOpConf& original_variable_conf = conf.original_variable_conf(i);
@@ -76,12 +75,19 @@ class ModelInitKernel final : public Kernel {
         const std::string key = original_variable_conf.initialize_with_snapshot().has_key()
                                     ? original_variable_conf.initialize_with_snapshot().key()
                                     : var_lbn;
-        InitializeWithSnapshot(original_variable_conf.initialize_with_snapshot().path(), key,
-                               out_i);
+        var_id2reader_and_key.at(i) = std::make_pair(
+            GetSnapshotReader(original_variable_conf.initialize_with_snapshot().path()), key);
+        var_id2out.at(i) = out_i;
+        snapshot_var_ids.push_back(i);
       } else {
         UNIMPLEMENTED();
       }
     }
+    MultiThreadLoop(snapshot_var_ids.size(), [&](size_t j) {
+      const int64_t i = snapshot_var_ids.at(j);
+      const auto& reader_and_key = var_id2reader_and_key.at(i);
+      reader_and_key.first->Read(reader_and_key.second, var_id2out.at(i));
+    });
   }
 };
 
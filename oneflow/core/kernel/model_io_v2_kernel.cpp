@@ -22,6 +22,7 @@ limitations under the License.
 #include "oneflow/core/job/job_desc.h"
 #include "oneflow/core/operator/operator.h"
 #include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -189,6 +190,41 @@ class AutoSyncBlobAccessor<DeviceType::kCPU> final {
   Blob* underlying_;
 };
 
+// Restores the variables over the thread pool. Host copies of device variables take memory, so
+// they are restored in batches of at most ONEFLOW_SNAPSHOT_RESTORE_BATCH_BYTES.
+template<DeviceType device_type>
+void ParallelRestore(DeviceCtx* ctx, const std::vector<Blob*>& refs,
+                     const std::function<void(int64_t i, Blob* host_blob)>& Restore) {
+  static const int64_t max_batch_bytes =
+      ParseIntegerFromEnv("ONEFLOW_SNAPSHOT_RESTORE_BATCH_BYTES", 1LL << 30);
+  const int64_t num_var = refs.size();
+  int64_t batch_begin = 0;
+  while (batch_begin < num_var) {
+    int64_t batch_end = batch_begin + 1;
+    if (device_type == DeviceType::kCPU) {
+      batch_end = num_var;
+    } else {
+      int64_t batch_bytes = refs.at(batch_begin)->ByteSizeOfBlobBody();
+      while (batch_end < num_var
+             && batch_bytes + refs.at(batch_end)->ByteSizeOfBlobBody() <= max_batch_bytes) {
+        batch_bytes += refs.at(batch_end)->ByteSizeOfBlobBody();
+        batch_end += 1;
+      }
+    }
+    std::vector<std::unique_ptr<AutoSyncBlobAccessor<device_type>>> accessors;
+    accessors.reserve(batch_end - batch_begin);
+    FOR_RANGE(int64_t, i, batch_begin, batch_end) {
+      accessors.emplace_back(new AutoSyncBlobAccessor<device_type>(ctx, refs.at(i), false, true));
+    }
+    MultiThreadLoop(batch_end - batch_begin, [&](size_t j) {
+      Restore(batch_begin + j, accessors.at(j)->host_blob());
+    });
+    // the accessors copy the restored host blobs to the device on destruction
+    accessors.clear();
+    batch_begin = batch_end;
+  }
+}
+
 }  // namespace
 
 template<DeviceType device_type>
@@ -240,29 +276,40 @@ class ModelInitV2Kernel final : public Kernel {
   void Forward(const KernelContext* ctx) const override { ForwardDataContent(ctx); }
   void ForwardDataContent(const KernelContext* ctx) const override {
     const ModelInitV2OpConf& conf = this->op_conf().model_init_v2_conf();
-
+    std::vector<Blob*> refs(conf.variable_op_name_size());
+    FOR_RANGE(int64_t, i, 0, conf.variable_op_name_size()) {
+      refs.at(i) = ctx->BnInOp2Blob(GenRepeatedBn("ref", i));
+    }
+    HashMap<std::string, std::unique_ptr<const SnapshotReader>> path2reader;
     FOR_RANGE(int64_t, i, 0, conf.variable_op_name_size()) {
-      Blob* ref = ctx->BnInOp2Blob(GenRepeatedBn("ref", i));
-      const DataType data_type = ref->data_type();
       const VariableOpConf& original_variable_conf = conf.original_variable_conf(i);
-      AutoSyncBlobAccessor<device_type> ref_accessor(ctx->device_ctx(), ref, false, true);
+      if (original_variable_conf.has_initialize_with_snapshot()) {
+        const std::string& path = original_variable_conf.initialize_with_snapshot().path();
+        if (path2reader.find(path) == path2reader.end()) {
+          path2reader[path].reset(new SnapshotReader(path));
+        }
+      }
+    }
+    ParallelRestore<device_type>(ctx->device_ctx(), refs, [&](int64_t i, Blob* host_blob) {
+      const DataType data_type = host_blob->data_type();
+      const VariableOpConf& original_variable_conf = conf.original_variable_conf(i);
       if (original_variable_conf.has_initializer()) {
         std::mt19937 random_seed_gen(seeds_.at(i));
         InitializeWithConfUtil::SwitchInitializeWithConf(
             SwitchCase(data_type), original_variable_conf.initializer(), random_seed_gen(),
-            ref_accessor.host_blob());
+            host_blob);
       } else if (original_variable_conf.has_initialize_with_snapshot()) {
         const auto& snapshot_conf = original_variable_conf.initialize_with_snapshot();
         const std::string& var_lbn =
             GenLogicalBlobName(conf.variable_op_name(i), original_variable_conf.out());
         const std::string key = snapshot_conf.has_key() ? snapshot_conf.key() : var_lbn;
         const Shape logical_blob_shape(original_variable_conf.shape());
-        const SnapshotReader reader(snapshot_conf.path());
-        reader.Read(key, logical_blob_shape, tensor_slice_views_.at(i), ref_accessor.host_blob());
+        path2reader.at(snapshot_conf.path())
+            ->Read(key, logical_blob_shape, tensor_slice_views_.at(i), host_blob);
       } else {
         UNIMPLEMENTED();
       }
-    }
+    });
   }
 
   std::vector<int64_t> seeds_;
@@ -302,16 +349,18 @@ class ModelLoadV2Kernel final : public Kernel {
     const ModelLoadV2OpConf& conf = this->op_conf().model_load_v2_conf();
     const Blob* path = ctx->BnInOp2Blob("path");
     const std::string snapshot_path = SyncReadStringFromBlob<device_type>(ctx->device_ctx(), path);
-    SnapshotReader reader(snapshot_path);
+    const SnapshotReader reader(snapshot_path);
+    std::vector<Blob*> refs(conf.variable_op_name_size());
     FOR_RANGE(int64_t, i, 0, conf.variable_op_name_size()) {
-      Blob* ref = ctx->BnInOp2Blob(GenRepeatedBn("ref", i));
+      refs.at(i) = ctx->BnInOp2Blob(GenRepeatedBn("ref", i));
+    }
+    ParallelRestore<device_type>(ctx->device_ctx(), refs, [&](int64_t i, Blob* host_blob) {
       const VariableOpConf& original_variable_conf = conf.original_variable_conf(i);
       const Shape logical_blob_shape(original_variable_conf.shape());
       const std::string& var_lbn =
           GenLogicalBlobName(conf.variable_op_name(i), original_variable_conf.out());
-      AutoSyncBlobAccessor<device_type> ref_accessor(ctx->device_ctx(), ref, false, true);
-      reader.Read(var_lbn, logical_blob_shape, tensor_slice_views_.at(i), ref_accessor.host_blob());
-    }
+      reader.Read(var_lbn, logical_blob_shape, tensor_slice_views_.at(i), host_blob);
+    });
   }
   std::vector<TensorSliceView> tensor_slice_views_;
 };
@@ -381,8 +430,11 @@ class ModelSaveV2Kernel final : public Kernel {
     const Blob* path_blob = ctx->BnInOp2Blob("path");
     const std::string snapshot_path =
         SyncReadStringFromBlob<device_type>(ctx->device_ctx(), path_blob);
-    SnapshotWriter writer(snapshot_path);
+    // the reader waits for the previous async save, whose keys the writer checks against
     SnapshotReader reader(snapshot_path);
+    SnapshotWriter writer(snapshot_path);
+    // parts are merged and deleted right away, they never go into packed shards
+    SnapshotWriter part_writer(snapshot_path, false, false);
     FOR_RANGE(int64_t, i, 0, conf.variable_op_name_size()) {
       if (!need_do_saves_.at(i)) { continue; }
       *(counters_.at(i)) += 1;
@@ -391,16 +443,20 @@ class ModelSaveV2Kernel final : public Kernel {
       const VariableOpConf& original_variable_conf = conf.original_variable_conf(i);
       const Shape logical_blob_shape(original_variable_conf.shape());
       const DataType data_type = original_variable_conf.data_type();
-      AutoSyncBlobAccessor<device_type> in_accessor(ctx->device_ctx(), in_blob, true, false);
       const std::string var_lbn =
           GenLogicalBlobName(conf.variable_op_name(i), original_variable_conf.out());
       const bool is_broadcast = ShapeView(logical_blob_shape) == in_blob->shape();
-      if (is_broadcast) { CHECK_EQ(variable_part_id2slice_views.size(), 1); }
-      const std::string key = is_broadcast ? var_lbn
-                                           : GetTmpPartKey(var_lbn, part_ids_.at(i),
-                                                           variable_part_id2slice_views.size());
-      writer.Write(key, in_accessor.host_blob());
-      if (!is_broadcast) {
+      if (is_broadcast) {
+        CHECK_EQ(variable_part_id2slice_views.size(), 1);
+        writer.Write(var_lbn, in_blob, [&](char* dst) {
+          SyncCopyToHost<device_type>(ctx->device_ctx(), in_blob->dptr(), dst,
+                                      in_blob->ByteSizeOfBlobBody());
+        });
+      } else {
+        AutoSyncBlobAccessor<device_type> in_accessor(ctx->device_ctx(), in_blob, true, false);
+        part_writer.Write(GetTmpPartKey(var_lbn, part_ids_.at(i),
+                                        variable_part_id2slice_views.size()),
+                          in_accessor.host_blob());
         const std::string rpc_key =
             snapshot_path + "-" + var_lbn + "-Counter-" + std::to_string(*(counters_.at(i)));
         int32_t counter = Global<CtrlClient>::Get()->IncreaseCount(rpc_key);
@@ -420,6 +476,8 @@ class ModelSaveV2Kernel final : public Kernel {
         Global<CtrlClient>::Get()->EraseCount(rpc_key);
       }
     }
+    // snapshot_done is left to the caller, which knows when all the ranks are done. Async writes
+    // go on after the return, snapshot readers wait for them before loading.
   }
   std::vector<std::unique_ptr<int64_t>> counters_;
   std::vector<std::vector<TensorSliceView>> part_id2slice_views_;
@@ -18,6 +18,7 @@ limitations under the License.
 #include <iostream>
 #include "oneflow/core/operator/operator.h"
 #include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/thread/thread_manager.h"
 
 namespace oneflow {
 
@@ -49,14 +50,19 @@ class ModelLoadKernel final : public Kernel {
     const ModelLoadOpConf& conf = this->op_conf().model_load_conf();
     const Blob* path_blob = ctx->BnInOp2Blob("path");
     const std::string path(path_blob->dptr<char>(), path_blob->shape_view().elem_cnt());
-    SnapshotReader reader(path);
+    const SnapshotReader reader(path);
+    std::vector<int64_t> loaded_var_ids;
+    std::vector<std::string> var_id2key(conf.out_size());
+    std::vector<Blob*> var_id2out(conf.out_size());
     FOR_RANGE(int64_t, i, 0, conf.out_size()) {
       const VariableOpConf& original_variable_conf = conf.original_variable_conf(i);
       Blob* out_i = ctx->BnInOp2Blob(GenRepeatedBn("out", i));
       const std::string key =
           GenLogicalBlobName(conf.variable_op_name(i), original_variable_conf.out());
       if (reader.HasKey(key)) {
-        reader.Read(key, out_i);
+        var_id2key.at(i) = key;
+        var_id2out.at(i) = out_i;
+        loaded_var_ids.push_back(i);
       } else {
         std::cout << "WARNING! CANNOT find variable path in : " << JoinPath(path, key)
                   << ". It will be initialized. \n";
@@ -68,6 +74,10 @@ class ModelLoadKernel final : public Kernel {
                                                          random_seed_gen(), out_i);
       }
     }
+    MultiThreadLoop(loaded_var_ids.size(), [&](size_t j) {
+      const int64_t i = loaded_var_ids.at(j);
+      reader.Read(var_id2key.at(i), var_id2out.at(i));
+    });
   }
 };
 
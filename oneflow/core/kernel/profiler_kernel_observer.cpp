@@ -22,10 +22,12 @@ namespace oneflow {
 void ProfilerKernelObserver::WillForwardDataContent(const KernelContext* kernel_ctx,
                                                     const Kernel* kernel) {
   OF_PROFILER_ONLY_CODE(profiler::TraceKernelForwardDataContentStart(kernel_ctx, kernel));
+  profiler::TimelineKernelForwardDataContentStart(kernel);
 }
 
 void ProfilerKernelObserver::DidForwardDataContent(const KernelContext* kernel_ctx,
                                                    const Kernel* kernel) {
+  profiler::TimelineKernelForwardDataContentEnd(kernel);
   OF_PROFILER_ONLY_CODE(profiler::TraceKernelForwardDataContentEnd(kernel_ctx, kernel));
 }
 
@@ -96,11 +96,13 @@ const SliceBoxingConf& SliceBoxingCopyKernel<device_type, T>::GetCustomizedBoxin
 template<DeviceType device_type, typename T>
 void SliceBoxingCopyKernel<device_type, T>::ForwardDataContent(const KernelContext* ctx) const {
   Blob* out = ctx->BnInOp2Blob("out");
+  std::vector<MemoryCopyTask> tasks;
+  tasks.reserve(this->op_attribute().input_bns().size());
   FOR_RANGE(int64_t, i, 0, this->op_attribute().input_bns().size()) {
     const Blob* in_i = ctx->BnInOp2Blob(GenRepeatedBn("in", i));
-    this->tensor_slice_copier_vec().at(i)->Copy(ctx->device_ctx(), *this->memory_copier(), out,
-                                                in_i);
+    tasks.push_back(this->tensor_slice_copier_vec().at(i)->NewCopyTask(out, in_i));
   }
+  this->memory_copier()->CopyBatch(ctx->device_ctx(), tasks);
 }
 
 template<DeviceType device_type, typename T>
@@ -0,0 +1,88 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/memory/host_mem_zero_filler.h"
+#include "oneflow/core/device/node_device_descriptor_manager.h"
+#include "oneflow/core/device/cuda_device_descriptor.h"
+#include "oneflow/core/graph/id_serialization.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr size_t kZeroFillPieceSize = 4 << 20;  // 4MiB
+
+std::shared_ptr<const device::TopologyDescriptor> GetLocalTopology() {
+  auto* manager = Global<device::NodeDeviceDescriptorManager>::Get();
+  if (manager == nullptr) { return nullptr; }
+  return manager->GetLocalNodeDeviceDescriptor()->Topology();
+}
+
+}  // namespace
+
+std::shared_ptr<const device::TopologyMemoryAffinityDescriptor>
+HostMemZeroFiller::MemoryAffinity4ThrdId(int64_t thrd_id) {
+  if (thrd_id < 0) { return nullptr; }
+  auto it = thrd_id2memory_affinity_.find(thrd_id);
+  if (it != thrd_id2memory_affinity_.end()) { return it->second; }
+  std::shared_ptr<const device::TopologyMemoryAffinityDescriptor> memory_affinity;
+#ifdef WITH_CUDA
+  // GpuThread binds itself to the NUMA node of its device, see SetAffinityByDevice
+  const StreamId stream_id = DeserializeStreamIdFromInt64(thrd_id);
+  auto* manager = Global<device::NodeDeviceDescriptorManager>::Get();
+  if (stream_id.device_id().device_type() == DeviceType::kGPU && manager != nullptr) {
+    auto node_desc = manager->GetLocalNodeDeviceDescriptor();
+    auto cuda_device = std::dynamic_pointer_cast<const device::CudaDeviceDescriptor>(
+        node_desc->GetDevice(device::kCudaDeviceDescriptorClassName,
+                             stream_id.device_id().device_index()));
+    if (cuda_device) {
+      memory_affinity = node_desc->Topology()->GetMemoryAffinityByPCIBusID(cuda_device->PCIBusID());
+    }
+  }
+#endif  // WITH_CUDA
+  thrd_id2memory_affinity_.emplace(thrd_id, memory_affinity);
+  return memory_affinity;
+}
+
+void HostMemZeroFiller::Add(char* ptr, size_t size, int64_t thrd_id_hint) {
+  const auto memory_affinity = MemoryAffinity4ThrdId(thrd_id_hint);
+  for (size_t offset = 0; offset < size; offset += kZeroFillPieceSize) {
+    pieces_.push_back(Piece{ptr + offset, std::min(kZeroFillPieceSize, size - offset),
+                            memory_affinity});
+  }
+}
+
+void HostMemZeroFiller::Run() {
+  const auto topology = GetLocalTopology();
+  Global<ThreadPool>::Get()->ParallelFor(pieces_.size(), 1, [&](size_t begin, size_t end) {
+    FOR_RANGE(size_t, i, begin, end) {
+      const Piece& piece = pieces_.at(i);
+      std::shared_ptr<const device::TopologyMemoryAffinityDescriptor> saved_affinity;
+      if (topology && piece.memory_affinity) { saved_affinity = topology->GetMemoryAffinity(); }
+      // the pool thread keeps its affinity when it cannot be restored, see GetCudaMallocHostFn
+      if (saved_affinity) {
+        topology->SetMemoryAffinity(piece.memory_affinity);
+        std::memset(piece.ptr, 0, piece.size);
+        topology->SetMemoryAffinity(saved_affinity);
+      } else {
+        std::memset(piece.ptr, 0, piece.size);
+      }
+    }
+  });
+  pieces_.clear();
+}
+
+}  // namespace oneflow
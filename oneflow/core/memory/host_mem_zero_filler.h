@@ -0,0 +1,54 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_MEMORY_HOST_MEM_ZERO_FILLER_H_
+#define ONEFLOW_CORE_MEMORY_HOST_MEM_ZERO_FILLER_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/device/topology_descriptor.h"
+
+namespace oneflow {
+
+// HostMemZeroFiller zero fills uninitialized host memory on the compute thread pool, so the pages
+// are first touched in parallel rather than all by the calling thread. A range whose thread id
+// hint is a device thread is touched under the memory affinity of that device, which places its
+// pages on the NUMA node the consuming actor thread is bound to.
+class HostMemZeroFiller final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(HostMemZeroFiller);
+  HostMemZeroFiller() = default;
+  ~HostMemZeroFiller() = default;
+
+  void Add(char* ptr, size_t size, int64_t thrd_id_hint);
+  void Run();
+
+ private:
+  struct Piece {
+    char* ptr;
+    size_t size;
+    std::shared_ptr<const device::TopologyMemoryAffinityDescriptor> memory_affinity;
+  };
+
+  std::shared_ptr<const device::TopologyMemoryAffinityDescriptor> MemoryAffinity4ThrdId(
+      int64_t thrd_id);
+
+  std::vector<Piece> pieces_;
+  HashMap<int64_t, std::shared_ptr<const device::TopologyMemoryAffinityDescriptor>>
+      thrd_id2memory_affinity_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_MEMORY_HOST_MEM_ZERO_FILLER_H_
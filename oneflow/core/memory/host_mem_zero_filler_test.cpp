@@ -0,0 +1,48 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/memory/host_mem_zero_filler.h"
+#include "oneflow/core/common/cpu_test_util.h"
+
+namespace oneflow {
+
+namespace test {
+
+TEST(HostMemZeroFiller, fills_ranges_in_parallel) {
+  ThreadPoolScope thread_pool_scope(4);
+  // ranges of a few pieces, of less than one and of a size which is no multiple of the piece size
+  const std::vector<std::pair<size_t, size_t>> ranges{
+      {0, 9 << 20}, {(9 << 20) + 64, 100}, {(10 << 20) + 3, (5 << 20) + 17}};
+  std::vector<char> buffer(16 << 20, 0x5a);
+  HostMemZeroFiller zero_filler;
+  for (const auto& range : ranges) {
+    zero_filler.Add(buffer.data() + range.first, range.second, -1);
+  }
+  zero_filler.Run();
+  std::vector<bool> in_range(buffer.size(), false);
+  for (const auto& range : ranges) {
+    FOR_RANGE(size_t, i, range.first, range.first + range.second) { in_range.at(i) = true; }
+  }
+  FOR_RANGE(size_t, i, 0, buffer.size()) { ASSERT_EQ(buffer.at(i), in_range.at(i) ? 0 : 0x5a); }
+  // the pieces are dropped by Run
+  std::fill(buffer.begin(), buffer.end(), 0x5a);
+  zero_filler.Run();
+  for (char c : buffer) { ASSERT_EQ(c, 0x5a); }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
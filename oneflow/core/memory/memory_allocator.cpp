@@ -86,6 +86,9 @@ void* MemoryAllocatorImpl::AllocateUnPinnedHostMem(size_t size) {
 
 void MemoryAllocatorImpl::DeallocateUnPinnedHostMem(void* ptr) { free(ptr); }
 
+MemoryAllocator::MemoryAllocator()
+    : lazy_zero_fill_(ParseBooleanFromEnv("ONEFLOW_MEMORY_ALLOCATOR_LAZY_ZERO_FILL", false)) {}
+
 MemoryAllocator::~MemoryAllocator() {
   for (std::function<void()> deleter : deleters_) { deleter(); }
 }
@@ -109,6 +112,12 @@ char* MemoryAllocator::Allocate(MemoryCase mem_case, std::size_t size) {
   return dptr;
 }
 
+char* MemoryAllocator::AllocateUninitialized(MemoryCase mem_case, std::size_t size) {
+  char* dptr = static_cast<char*>(MemoryAllocatorImpl::Allocate(mem_case, size));
+  deleters_.push_front(std::bind(&MemoryAllocator::Deallocate, this, dptr, mem_case));
+  return dptr;
+}
+
 void MemoryAllocator::Deallocate(char* dptr, MemoryCase mem_case) {
   MemoryAllocatorImpl::Deallocate(static_cast<void*>(dptr), mem_case);
 }
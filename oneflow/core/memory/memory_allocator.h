@@ -24,16 +24,22 @@ namespace oneflow {
 class MemoryAllocator final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(MemoryAllocator);
-  MemoryAllocator() = default;
+  MemoryAllocator();
   ~MemoryAllocator();
 
   char* Allocate(MemoryCase mem_case, std::size_t size);
+  // The memory is not zero filled, host pages are left untouched until their first write
+  char* AllocateUninitialized(MemoryCase mem_case, std::size_t size);
+  // Whether regsts fully overwritten by their producers skip zero filling, which is enabled by
+  // ONEFLOW_MEMORY_ALLOCATOR_LAZY_ZERO_FILL
+  bool lazy_zero_fill() const { return lazy_zero_fill_; }
   template<typename T>
   T* PlacementNew(T* mem_ptr);
 
  private:
   void Deallocate(char* dptr, MemoryCase mem_case);
 
+  const bool lazy_zero_fill_;
   std::mutex deleters_mutex_;
   std::list<std::function<void()>> deleters_;
 };
@@ -0,0 +1,169 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_NDARRAY_CPU_NDARRAY_REDUCE_H_
+#define ONEFLOW_CORE_NDARRAY_CPU_NDARRAY_REDUCE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/ndarray/binary_func.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace cpu_ndarray_reduce {
+
+// Independent accumulators of a contiguous reduction, 8 lanes fill an AVX2 register of float and
+// let the compiler vectorize without reassociating the reduction.
+constexpr int64_t kLaneNum = 8;
+// Contiguous ranges up to this length are reduced by the lanes serially, longer ones are split in
+// halves recursively. The rounding error of sum grows with log(n) instead of n.
+constexpr int64_t kPairwiseBlockSize = 256;
+// Rows of a column reduction up to this number, or up to kPairwiseBlockSize elements for narrow
+// matrices, are reduced serially, more are split in halves
+constexpr int64_t kPairwiseBlockRowNum = 16;
+// Columns of a column reduction are reduced in blocks of this width, so that the partial results
+// stay in L1 cache.
+constexpr int64_t kColBlockSize = 256;
+// Approximate number of elements of a task of ParallelForTasks
+constexpr int64_t kTaskElemNum = 32 * 1024;
+
+template<typename T, template<typename> class binary_func>
+inline T Invoke(const T& a, const T& b) {
+  return static_cast<T>(binary_func<T>::Invoke(a, b));
+}
+
+template<typename T, template<typename> class binary_func>
+T PairwiseReduce(const T* x, int64_t n) {
+  if (n < 2 * kLaneNum) {
+    T reduced = UnitOfBinaryFunc<T, binary_func>::Val();
+    for (int64_t i = 0; i < n; ++i) { reduced = Invoke<T, binary_func>(reduced, x[i]); }
+    return reduced;
+  }
+  if (n <= kPairwiseBlockSize) {
+    T lanes[kLaneNum];
+    std::fill(lanes, lanes + kLaneNum, UnitOfBinaryFunc<T, binary_func>::Val());
+    int64_t i = 0;
+    for (; i + kLaneNum <= n; i += kLaneNum) {
+      for (int64_t j = 0; j < kLaneNum; ++j) {
+        lanes[j] = Invoke<T, binary_func>(lanes[j], x[i + j]);
+      }
+    }
+    for (; i < n; ++i) { lanes[0] = Invoke<T, binary_func>(lanes[0], x[i]); }
+    for (int64_t width = kLaneNum / 2; width > 0; width /= 2) {
+      for (int64_t j = 0; j < width; ++j) {
+        lanes[j] = Invoke<T, binary_func>(lanes[j], lanes[j + width]);
+      }
+    }
+    return lanes[0];
+  }
+  const int64_t half = n / 2 / kLaneNum * kLaneNum;
+  return Invoke<T, binary_func>(PairwiseReduce<T, binary_func>(x, half),
+                                PairwiseReduce<T, binary_func>(x + half, n - half));
+}
+
+// y[j] = reduce of x[i * row_stride + j] over i in [0, row_num), for j in [0, col_num)
+template<typename T, template<typename> class binary_func>
+void PairwiseColReduce(const T* x, int64_t row_num, int64_t col_num, int64_t row_stride, T* y) {
+  CHECK_LE(col_num, kColBlockSize);
+  if (row_num <= std::max(kPairwiseBlockRowNum, kPairwiseBlockSize / col_num)) {
+    std::copy(x, x + col_num, y);
+    for (int64_t i = 1; i < row_num; ++i) {
+      const T* row = x + i * row_stride;
+      for (int64_t j = 0; j < col_num; ++j) { y[j] = Invoke<T, binary_func>(y[j], row[j]); }
+    }
+    return;
+  }
+  const int64_t half = row_num / 2;
+  T second_half[kColBlockSize];
+  PairwiseColReduce<T, binary_func>(x, half, col_num, row_stride, y);
+  PairwiseColReduce<T, binary_func>(x + half * row_stride, row_num - half, col_num, row_stride,
+                                    second_half);
+  for (int64_t j = 0; j < col_num; ++j) { y[j] = Invoke<T, binary_func>(y[j], second_half[j]); }
+}
+
+// Reduces the (row_num, col_num) matrix x over its rows. The rows are split in chunks of about
+// kTaskElemNum elements, whose partial results are reduced again.
+template<typename T, template<typename> class binary_func>
+void ColReduce(const T* x, int64_t row_num, int64_t col_num, T* y) {
+  const int64_t chunk_row_num = std::max(kPairwiseBlockRowNum, kTaskElemNum / col_num);
+  const int64_t chunk_num = (row_num + chunk_row_num - 1) / chunk_row_num;
+  const int64_t col_block_num = (col_num + kColBlockSize - 1) / kColBlockSize;
+  std::vector<T> partial_buf(chunk_num == 1 ? 0 : chunk_num * col_num);
+  T* partial = chunk_num == 1 ? y : partial_buf.data();
+  const int64_t task_elem_num = std::min(chunk_row_num, row_num) * std::min(col_num, kColBlockSize);
+  ParallelForTasks(chunk_num * col_block_num, std::max<int64_t>(kTaskElemNum / task_elem_num, 1),
+                   [&](int64_t begin, int64_t end) {
+                     for (int64_t task = begin; task < end; ++task) {
+                       const int64_t chunk = task / col_block_num;
+                       const int64_t col = task % col_block_num * kColBlockSize;
+                       const int64_t row = chunk * chunk_row_num;
+                       PairwiseColReduce<T, binary_func>(
+                           x + row * col_num + col, std::min(chunk_row_num, row_num - row),
+                           std::min(kColBlockSize, col_num - col), col_num,
+                           partial + chunk * col_num + col);
+                     }
+                   });
+  if (chunk_num > 1) {
+    ColReduce<T, binary_func>(partial, chunk_num, col_num, y);
+  }
+}
+
+}  // namespace cpu_ndarray_reduce
+
+// Reduces x viewed as a (x_num, y_num, z_num) cube over its x and z axes into the y_num elements
+// of y. Scalar, matrix row and matrix column reductions are the cubes of (1, 1, n), (1, n, w) and
+// (n, w, 1). Partial results go to buffers of their own rather than the tmp storage of the
+// callers, which may be x itself.
+template<typename T, template<typename> class binary_func>
+void CpuNdarrayReduceXZ(const T* x, int64_t x_num, int64_t y_num, int64_t z_num, T* y) {
+  using namespace cpu_ndarray_reduce;
+  if (y_num == 0) { return; }
+  if (x_num == 0 || z_num == 0) {
+    std::fill(y, y + y_num, UnitOfBinaryFunc<T, binary_func>::Val());
+    return;
+  }
+  if (z_num == 1) { return ColReduce<T, binary_func>(x, x_num, y_num, y); }
+  // each contiguous row of z_num elements is reduced in chunks of about kTaskElemNum elements
+  const int64_t chunk_num = (z_num + kTaskElemNum - 1) / kTaskElemNum;
+  const int64_t chunk_size = (z_num + chunk_num - 1) / chunk_num;
+  // partial results of the (x, chunk, y) tasks, a (x_num * chunk_num, y_num) matrix
+  const bool direct = (x_num == 1 && chunk_num == 1);
+  std::vector<T> partial_buf(direct ? 0 : x_num * chunk_num * y_num);
+  T* partial = direct ? y : partial_buf.data();
+  ParallelForTasks(x_num * chunk_num * y_num,
+                   std::max<int64_t>(kTaskElemNum / std::min(chunk_size, z_num), 1),
+                   [&](int64_t begin, int64_t end) {
+                     if (chunk_num == 1) {
+                       for (int64_t task = begin; task < end; ++task) {
+                         partial[task] = PairwiseReduce<T, binary_func>(x + task * z_num, z_num);
+                       }
+                       return;
+                     }
+                     for (int64_t task = begin; task < end; ++task) {
+                       const int64_t i = task / (chunk_num * y_num);
+                       const int64_t chunk = task / y_num % chunk_num;
+                       const int64_t j = task % y_num;
+                       const int64_t offset = chunk * chunk_size;
+                       partial[task] = PairwiseReduce<T, binary_func>(
+                           x + (i * y_num + j) * z_num + offset,
+                           std::min(chunk_size, z_num - offset));
+                     }
+                   });
+  if (!direct) { ColReduce<T, binary_func>(partial, x_num * chunk_num, y_num, y); }
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_NDARRAY_CPU_NDARRAY_REDUCE_H_
@@ -0,0 +1,154 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <thread>
+#include "oneflow/core/ndarray/cpu_ndarray_reduce.h"
+#include "oneflow/core/common/cpu_test_util.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+struct Cube {
+  int64_t x_num;
+  int64_t y_num;
+  int64_t z_num;
+  int64_t elem_num() const { return x_num * y_num * z_num; }
+};
+
+// the per-axis reduction the CPU went through before
+template<typename T, template<typename> class binary_func>
+void NaiveReduceXZ(const T* x, const Cube& cube, T* y) {
+  FOR_RANGE(int64_t, j, 0, cube.y_num) {
+    T reduced = UnitOfBinaryFunc<T, binary_func>::Val();
+    FOR_RANGE(int64_t, i, 0, cube.x_num) {
+      FOR_RANGE(int64_t, k, 0, cube.z_num) {
+        reduced = binary_func<T>::Invoke(reduced, x[(i * cube.y_num + j) * cube.z_num + k]);
+      }
+    }
+    y[j] = reduced;
+  }
+}
+
+const std::vector<Cube>& TestCubes() {
+  // scalar, row, column and XZ cube reductions, with rows longer than a parallel task
+  static const std::vector<Cube> cubes{
+      {1, 1, 0}, {1, 1, 1}, {1, 1, 7}, {1, 1, 100003}, {1, 3, 5}, {1, 100, 1000},
+      {1, 5, 70001}, {3, 1, 1}, {20000, 3, 1}, {1000, 300, 1}, {7, 5, 3}, {64, 30, 49},
+      {3, 2, 40000}, {100, 1, 100}};
+  return cubes;
+}
+
+void TestReduceSumAndMax() {
+  for (const Cube& cube : TestCubes()) {
+    const std::vector<float> x = RandomVector<float>(cube.elem_num(), cube.elem_num(), -1, 1);
+    std::vector<float> y(cube.y_num);
+    std::vector<float> expected(cube.y_num);
+    CpuNdarrayReduceXZ<float, BinaryFuncSum>(x.data(), cube.x_num, cube.y_num, cube.z_num,
+                                             y.data());
+    // sum in double as the reference
+    std::vector<double> x_double(x.begin(), x.end());
+    std::vector<double> expected_double(cube.y_num);
+    NaiveReduceXZ<double, BinaryFuncSum>(x_double.data(), cube, expected_double.data());
+    FOR_RANGE(int64_t, j, 0, cube.y_num) {
+      ASSERT_NEAR(y.at(j), expected_double.at(j), 1e-5 * cube.x_num * cube.z_num)
+          << cube.x_num << " " << cube.y_num << " " << cube.z_num;
+    }
+    CpuNdarrayReduceXZ<float, BinaryFuncMax>(x.data(), cube.x_num, cube.y_num, cube.z_num,
+                                             y.data());
+    NaiveReduceXZ<float, BinaryFuncMax>(x.data(), cube, expected.data());
+    ASSERT_EQ(y, expected) << cube.x_num << " " << cube.y_num << " " << cube.z_num;
+  }
+}
+
+double SecondsOf(const std::function<void()>& Run) {
+  Run();
+  const int64_t iter_num = 5;
+  return MeasureMs([&]() { FOR_RANGE(int64_t, iter, 0, iter_num) { Run(); } }) / 1e3 / iter_num;
+}
+
+}  // namespace
+
+TEST(CpuNdarrayReduce, sum_and_max) { TestReduceSumAndMax(); }
+
+TEST(CpuNdarrayReduce, sum_and_max_on_thread_pool) {
+  ThreadPoolScope thread_pool_scope(4);
+  TestReduceSumAndMax();
+}
+
+TEST(CpuNdarrayReduce, same_results_on_thread_pool) {
+  for (const Cube& cube : TestCubes()) {
+    const std::vector<float> x = RandomVector<float>(cube.elem_num(), cube.elem_num(), -1, 1);
+    std::vector<float> serial(cube.y_num);
+    std::vector<float> parallel(cube.y_num);
+    CpuNdarrayReduceXZ<float, BinaryFuncSum>(x.data(), cube.x_num, cube.y_num, cube.z_num,
+                                             serial.data());
+    {
+      ThreadPoolScope thread_pool_scope(3);
+      CpuNdarrayReduceXZ<float, BinaryFuncSum>(x.data(), cube.x_num, cube.y_num, cube.z_num,
+                                               parallel.data());
+    }
+    ASSERT_EQ(serial, parallel);
+  }
+}
+
+TEST(CpuNdarrayReduce, pairwise_sum_accuracy) {
+  const int64_t n = 1 << 24;
+  const std::vector<float> x(n, 0.1f);
+  const double expected = static_cast<double>(0.1f) * n;
+  float naive = 0;
+  NaiveReduceXZ<float, BinaryFuncSum>(x.data(), Cube{1, 1, n}, &naive);
+  float scalar = 0;
+  CpuNdarrayReduceXZ<float, BinaryFuncSum>(x.data(), 1, 1, n, &scalar);
+  float col = 0;
+  CpuNdarrayReduceXZ<float, BinaryFuncSum>(x.data(), n, 1, 1, &col);
+  ASSERT_GT(std::abs(naive - expected) / expected, 1e-2);
+  ASSERT_LT(std::abs(scalar - expected) / expected, 1e-5);
+  ASSERT_LT(std::abs(col - expected) / expected, 1e-5);
+}
+
+TEST(CpuNdarrayReduce, DISABLED_benchmark) {
+  ThreadPoolScope thread_pool_scope(std::max<int32_t>(std::thread::hardware_concurrency(), 1));
+  // (N, W) shapes of softmax and reduce ops reduced over W, and of bias grads reduced over N
+  const std::vector<std::pair<int64_t, int64_t>> shapes{
+      {1, 1 << 24}, {64, 1 << 18}, {4096, 4096}, {65536, 256}, {1 << 20, 16}, {1 << 22, 4}};
+  for (const auto& shape : shapes) {
+    const int64_t n = shape.first;
+    const int64_t w = shape.second;
+    const std::vector<float> x = RandomVector<float>(n * w, n * w, -1, 1);
+    std::vector<float> y(std::max(n, w));
+    const double gb = n * w * sizeof(float) / 1e9;
+    const double row_naive = SecondsOf([&]() {
+      NaiveReduceXZ<float, BinaryFuncSum>(x.data(), Cube{1, n, w}, y.data());
+    });
+    const double row = SecondsOf(
+        [&]() { CpuNdarrayReduceXZ<float, BinaryFuncSum>(x.data(), 1, n, w, y.data()); });
+    const double col_naive = SecondsOf([&]() {
+      NaiveReduceXZ<float, BinaryFuncSum>(x.data(), Cube{n, w, 1}, y.data());
+    });
+    const double col = SecondsOf(
+        [&]() { CpuNdarrayReduceXZ<float, BinaryFuncSum>(x.data(), n, w, 1, y.data()); });
+    LOG(INFO) << "reduce sum (" << n << ", " << w << ") over W: " << gb / row_naive
+              << " GB/s naive, " << gb / row << " GB/s; over N: " << gb / col_naive
+              << " GB/s naive, " << gb / col << " GB/s";
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -0,0 +1,162 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/async_snapshot_saver.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/device/cuda_util.h"
+
+namespace oneflow {
+
+namespace {
+
+char* AllocateStagingMemory(size_t size, bool pinned) {
+  void* ptr = nullptr;
+#ifdef WITH_CUDA
+  if (pinned) {
+    int32_t dev = 0;
+    OF_CUDA_CHECK(cudaGetDevice(&dev));
+    NumaAwareCudaMallocHost(dev, &ptr, size);
+    if (ptr != nullptr) { return static_cast<char*>(ptr); }
+  }
+#endif
+  ptr = malloc(size);
+  CHECK_NOTNULL(ptr);
+  return static_cast<char*>(ptr);
+}
+
+void FreeStagingMemory(char* data, bool pinned) {
+#ifdef WITH_CUDA
+  if (pinned) {
+    OF_CUDA_CHECK(cudaFreeHost(data));
+    return;
+  }
+#endif
+  free(data);
+}
+
+}  // namespace
+
+SnapshotStagingBuffer::~SnapshotStagingBuffer() {
+  saver_->ReleaseStagingBuffer(data_, capacity_, pinned_);
+}
+
+AsyncSnapshotSaver::AsyncSnapshotSaver()
+    : AsyncSnapshotSaver(ParseIntegerFromEnv("ONEFLOW_SNAPSHOT_ASYNC_THREAD_NUM", 2),
+                         ParseIntegerFromEnv("ONEFLOW_SNAPSHOT_ASYNC_STAGING_BYTES", 2LL << 30)) {}
+
+AsyncSnapshotSaver::AsyncSnapshotSaver(int64_t thread_num, size_t max_staging_bytes)
+    : max_staging_bytes_(max_staging_bytes),
+      next_channel_(0),
+      staging_bytes_(0),
+      in_use_staging_bytes_(0),
+      pending_task_cnt_(0) {
+  CHECK_GT(thread_num, 0);
+  FOR_RANGE(int64_t, i, 0, thread_num) {
+    channels_.emplace_back(new Channel<std::function<void()>>());
+    Channel<std::function<void()>>* channel = channels_.back().get();
+    threads_.emplace_back([this, channel]() {
+      std::function<void()> task;
+      while (channel->Receive(&task) == kChannelStatusSuccess) {
+        task();
+        task = nullptr;
+        std::unique_lock<std::mutex> lock(pending_mutex_);
+        pending_task_cnt_ -= 1;
+        if (pending_task_cnt_ == 0) { pending_cond_.notify_all(); }
+      }
+    });
+  }
+}
+
+AsyncSnapshotSaver::~AsyncSnapshotSaver() {
+  WaitAll();
+  for (auto& channel : channels_) { channel->Close(); }
+  for (auto& thread : threads_) { thread.join(); }
+  CHECK_EQ(in_use_staging_bytes_, 0);
+  for (const CachedBuffer& buffer : cached_buffers_) { FreeCachedBuffer(buffer); }
+}
+
+std::shared_ptr<SnapshotStagingBuffer> AsyncSnapshotSaver::AcquireStagingBuffer(size_t size,
+                                                                               bool pinned) {
+  std::unique_lock<std::mutex> lock(staging_mutex_);
+  while (true) {
+    // best fit among the cached buffers, checkpoints usually save the same sizes every time
+    auto best = cached_buffers_.end();
+    for (auto it = cached_buffers_.begin(); it != cached_buffers_.end(); ++it) {
+      if (it->pinned == pinned && it->capacity >= size && it->capacity <= size * 2
+          && (best == cached_buffers_.end() || it->capacity < best->capacity)) {
+        best = it;
+      }
+    }
+    if (best != cached_buffers_.end()) {
+      const CachedBuffer buffer = *best;
+      cached_buffers_.erase(best);
+      in_use_staging_bytes_ += buffer.capacity;
+      return std::shared_ptr<SnapshotStagingBuffer>(
+          new SnapshotStagingBuffer(this, buffer.data, size, buffer.capacity, pinned));
+    }
+    // a buffer larger than the limit is still allowed when nothing else is staged
+    if (staging_bytes_ + size <= max_staging_bytes_ || staging_bytes_ == 0) {
+      staging_bytes_ += size;
+      in_use_staging_bytes_ += size;
+      char* data = AllocateStagingMemory(size, pinned);
+      return std::shared_ptr<SnapshotStagingBuffer>(
+          new SnapshotStagingBuffer(this, data, size, size, pinned));
+    }
+    if (!cached_buffers_.empty()) {
+      FreeCachedBuffer(cached_buffers_.back());
+      staging_bytes_ -= cached_buffers_.back().capacity;
+      cached_buffers_.pop_back();
+    } else {
+      staging_cond_.wait(lock);
+    }
+  }
+}
+
+void AsyncSnapshotSaver::ReleaseStagingBuffer(char* data, size_t capacity, bool pinned) {
+  {
+    std::unique_lock<std::mutex> lock(staging_mutex_);
+    in_use_staging_bytes_ -= capacity;
+    cached_buffers_.push_back(CachedBuffer{data, capacity, pinned});
+  }
+  staging_cond_.notify_all();
+}
+
+void AsyncSnapshotSaver::FreeCachedBuffer(const CachedBuffer& buffer) {
+  FreeStagingMemory(buffer.data, buffer.pinned);
+}
+
+int64_t AsyncSnapshotSaver::NewChannel() { return next_channel_++ % channels_.size(); }
+
+void AsyncSnapshotSaver::Schedule(int64_t channel, std::function<void()> Task) {
+  {
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    pending_task_cnt_ += 1;
+  }
+  CHECK_EQ(channels_.at(channel)->Send(std::move(Task)), kChannelStatusSuccess);
+}
+
+void AsyncSnapshotSaver::WaitChannel(int64_t channel) {
+  // the tasks of a channel run in order, so the earlier ones are done once this one runs
+  BlockingCounter counter(1);
+  Schedule(channel, [&counter]() { counter.Decrease(); });
+  counter.WaitUntilCntEqualZero();
+}
+
+void AsyncSnapshotSaver::WaitAll() {
+  std::unique_lock<std::mutex> lock(pending_mutex_);
+  pending_cond_.wait(lock, [this]() { return pending_task_cnt_ == 0; });
+}
+
+}  // namespace oneflow
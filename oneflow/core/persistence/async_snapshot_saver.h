@@ -0,0 +1,96 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_ASYNC_SNAPSHOT_SAVER_H_
+#define ONEFLOW_CORE_PERSISTENCE_ASYNC_SNAPSHOT_SAVER_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/channel.h"
+
+namespace oneflow {
+
+class AsyncSnapshotSaver;
+
+// Host memory holding the data of a save until it is on disk
+class SnapshotStagingBuffer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SnapshotStagingBuffer);
+  ~SnapshotStagingBuffer();
+
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  friend class AsyncSnapshotSaver;
+  SnapshotStagingBuffer(AsyncSnapshotSaver* saver, char* data, size_t size, size_t capacity,
+                        bool pinned)
+      : saver_(saver), data_(data), size_(size), capacity_(capacity), pinned_(pinned) {}
+
+  AsyncSnapshotSaver* saver_;
+  char* data_;
+  size_t size_;
+  size_t capacity_;
+  bool pinned_;
+};
+
+// Writes snapshots on background threads. Saves copy their data into staging buffers and return,
+// the staging memory is bounded, so a save blocks while earlier ones still hold too much of it.
+class AsyncSnapshotSaver final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AsyncSnapshotSaver);
+  AsyncSnapshotSaver();
+  AsyncSnapshotSaver(int64_t thread_num, size_t max_staging_bytes);
+  // waits for the saves in flight
+  ~AsyncSnapshotSaver();
+
+  // pinned buffers are page locked for fast copies from cuda devices
+  std::shared_ptr<SnapshotStagingBuffer> AcquireStagingBuffer(size_t size, bool pinned);
+  // tasks scheduled on one channel run in order
+  int64_t NewChannel();
+  void Schedule(int64_t channel, std::function<void()> Task);
+  // waits for the tasks scheduled on the channel so far, not to be called from a saver thread
+  void WaitChannel(int64_t channel);
+  void WaitAll();
+
+ private:
+  friend class SnapshotStagingBuffer;
+  struct CachedBuffer {
+    char* data;
+    size_t capacity;
+    bool pinned;
+  };
+  void ReleaseStagingBuffer(char* data, size_t capacity, bool pinned);
+  void FreeCachedBuffer(const CachedBuffer& buffer);
+
+  const size_t max_staging_bytes_;
+  std::vector<std::unique_ptr<Channel<std::function<void()>>>> channels_;
+  std::vector<std::thread> threads_;
+  std::atomic<int64_t> next_channel_;
+
+  std::mutex staging_mutex_;
+  std::condition_variable staging_cond_;
+  // staged bytes, including the cached buffers
+  size_t staging_bytes_;
+  size_t in_use_staging_bytes_;
+  std::vector<CachedBuffer> cached_buffers_;
+
+  std::mutex pending_mutex_;
+  std::condition_variable pending_cond_;
+  int64_t pending_task_cnt_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_ASYNC_SNAPSHOT_SAVER_H_
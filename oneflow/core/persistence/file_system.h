@@ -69,6 +69,10 @@ class WritableFile {
   // persisted, depending on the implementation.
   virtual void Flush() = 0;
 
+  // Flushes the file and syncs its contents to the storage device, so that they survive an OS or
+  // machine crash.
+  virtual void Sync() { Flush(); }
+
  private:
 };
 
@@ -34,6 +34,7 @@ class PersistentOutStream final {
   PersistentOutStream& Write(const char* s, size_t n);
 
   void Flush();
+  void Sync();
 
  private:
   std::unique_ptr<fs::WritableFile> file_;
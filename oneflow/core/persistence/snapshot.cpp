@@ -14,26 +14,157 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/persistence/snapshot.h"
+#include <random>
+#include "oneflow/core/common/global.h"
 #include "oneflow/core/common/str_util.h"
-#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/async_snapshot_saver.h"
 #include "oneflow/core/persistence/persistent_out_stream.h"
-#include "oneflow/core/register/tensor_slice_copier.h"
-#include "oneflow/core/device/cpu_device_context.h"
+#include "oneflow/core/register/blob.h"
 
 namespace oneflow {
 
 namespace {
 
+constexpr char kPackedIndexSuffix[] = ".snapshot_index";
+constexpr char kPackedShardSuffix[] = ".snapshot_shard";
+// runs of a slice closer than this are read at once together with the gap between them
+constexpr int64_t kMaxSliceReadGapBytes = 64 << 10;
+constexpr int64_t kMaxSliceReadGroupBytes = 16 << 20;
+
 std::string GenDataFilePath(const std::string& root, const std::string& key) {
   return JoinPath(root, key);
 }
 
+bool EndsWith(const std::string& str, const std::string& suffix) {
+  return str.size() >= suffix.size()
+         && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void ForEachPackedIndexEntry(const std::string& root,
+                             const std::function<void(const SnapshotIndexEntry&)>& Handler) {
+  if (!SnapshotFS()->IsDirectory(root)) { return; }
+  for (const std::string& name : SnapshotFS()->ListDir(root)) {
+    if (!EndsWith(name, kPackedIndexSuffix)) { continue; }
+    const std::string path = JoinPath(root, name);
+    std::string content(SnapshotFS()->GetFileSize(path), '\0');
+    std::unique_ptr<fs::RandomAccessFile> file;
+    SnapshotFS()->NewRandomAccessFile(path, &file);
+    file->Read(0, content.size(), &content[0]);
+    SnapshotIndex index;
+    CHECK(index.ParseFromString(content)) << "corrupted snapshot index, path: " << path;
+    for (const SnapshotIndexEntry& entry : index.entry()) { Handler(entry); }
+  }
+}
+
+std::string GenPackedName() {
+  static std::atomic<int64_t> counter(0);
+  std::random_device rd;
+  const uint64_t nonce = (static_cast<uint64_t>(rd()) << 32) | rd();
+  return "packed-" + std::to_string(nonce) + "-" + std::to_string(counter++);
+}
+
+std::string GenShardName(const std::string& packed_name, int64_t shard_id) {
+  return packed_name + "-" + std::to_string(shard_id) + kPackedShardSuffix;
+}
+
+// Copies `slice` of a row major blob of `logical_blob_shape`, which starts at `base_offset` of
+// `file`, into dst. Only the contiguous runs of the slice are read, runs close to each other are
+// grouped into one read.
+void ReadSlice(const fs::RandomAccessFile& file, uint64_t base_offset,
+               const Shape& logical_blob_shape, DataType data_type, const TensorSliceView& slice,
+               char* dst) {
+  const int64_t elem_cnt = slice.shape().elem_cnt();
+  if (elem_cnt == 0) { return; }
+  const int64_t size_of_data_type = GetSizeOfDataType(data_type);
+  const int64_t num_axes = logical_blob_shape.NumAxes();
+  if (num_axes == 0) {
+    file.Read(base_offset, size_of_data_type, dst);
+    return;
+  }
+  // the axes after contiguous_axis are covered entirely by the slice
+  int64_t contiguous_axis = num_axes - 1;
+  while (contiguous_axis > 0 && slice.At(contiguous_axis).begin() == 0
+         && slice.At(contiguous_axis).size() == logical_blob_shape.At(contiguous_axis)) {
+    contiguous_axis -= 1;
+  }
+  const int64_t run_bytes =
+      slice.At(contiguous_axis).size() * logical_blob_shape.Count(contiguous_axis + 1)
+      * size_of_data_type;
+  const int64_t num_runs = elem_cnt * size_of_data_type / run_bytes;
+  std::vector<int64_t> run_offsets(num_runs);
+  std::vector<int64_t> run_index(contiguous_axis, 0);
+  FOR_RANGE(int64_t, i, 0, num_runs) {
+    int64_t offset =
+        slice.At(contiguous_axis).begin() * logical_blob_shape.Count(contiguous_axis + 1);
+    FOR_RANGE(int64_t, axis, 0, contiguous_axis) {
+      offset += (slice.At(axis).begin() + run_index.at(axis)) * logical_blob_shape.Count(axis + 1);
+    }
+    run_offsets.at(i) = base_offset + offset * size_of_data_type;
+    for (int64_t axis = contiguous_axis - 1; axis >= 0; --axis) {
+      run_index.at(axis) += 1;
+      if (run_index.at(axis) < slice.At(axis).size()) { break; }
+      run_index.at(axis) = 0;
+    }
+  }
+  std::vector<char> buffer;
+  int64_t group_begin = 0;
+  while (group_begin < num_runs) {
+    int64_t group_end = group_begin + 1;
+    while (group_end < num_runs
+           && run_offsets.at(group_end) - (run_offsets.at(group_end - 1) + run_bytes)
+                  <= kMaxSliceReadGapBytes
+           && run_offsets.at(group_end) + run_bytes - run_offsets.at(group_begin)
+                  <= kMaxSliceReadGroupBytes) {
+      group_end += 1;
+    }
+    char* group_dst = dst + group_begin * run_bytes;
+    const int64_t group_bytes =
+        run_offsets.at(group_end - 1) + run_bytes - run_offsets.at(group_begin);
+    if (group_bytes == (group_end - group_begin) * run_bytes) {
+      file.Read(run_offsets.at(group_begin), group_bytes, group_dst);
+    } else {
+      buffer.resize(group_bytes);
+      file.Read(run_offsets.at(group_begin), group_bytes, buffer.data());
+      FOR_RANGE(int64_t, i, group_begin, group_end) {
+        std::memcpy(dst + i * run_bytes,
+                    buffer.data() + run_offsets.at(i) - run_offsets.at(group_begin), run_bytes);
+      }
+    }
+    group_begin = group_end;
+  }
+}
+
 }  // namespace
 
 SnapshotReader::SnapshotReader(const std::string& snapshot_root_path)
-    : root_path_(snapshot_root_path) {}
+    : root_path_(snapshot_root_path) {
+  // async saves return before their files are written, including the one of the save kernel which
+  // builds a reader of its own, so a save also waits for the previous one here
+  AsyncSnapshotSaver* saver = Global<AsyncSnapshotSaver>::Get();
+  if (saver != nullptr) { saver->WaitAll(); }
+  LoadPackedIndexes();
+}
+
+void SnapshotReader::LoadPackedIndexes() {
+  ForEachPackedIndexEntry(root_path_, [&](const SnapshotIndexEntry& entry) {
+    CHECK(key2packed_entry_.emplace(entry.key(), entry).second)
+        << "duplicated key " << entry.key() << " in snapshot " << root_path_;
+  });
+}
+
+const fs::RandomAccessFile* SnapshotReader::GetShardFile(const std::string& shard) const {
+  std::lock_guard<std::mutex> lock(shard_files_mutex_);
+  auto it = shard2file_.find(shard);
+  if (it == shard2file_.end()) {
+    std::unique_ptr<fs::RandomAccessFile> file;
+    SnapshotFS()->NewRandomAccessFile(JoinPath(root_path_, shard), &file);
+    it = shard2file_.emplace(shard, std::move(file)).first;
+  }
+  return it->second.get();
+}
 
 bool SnapshotReader::HasKey(const std::string& key) const {
+  if (key2packed_entry_.find(key) != key2packed_entry_.end()) { return true; }
   const std::string path = GenDataFilePath(root_path_, key);
   return SnapshotFS()->FileExists(path);
 }
@@ -48,23 +179,23 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
                           DataType data_type, const TensorSliceView& slice, char* dst) const {
   const TensorSliceView logical_blob_slice(logical_blob_shape);
   CHECK(logical_blob_slice.Contains(slice));
-  const std::string path = GenDataFilePath(root_path_, key);
   const int64_t logical_blob_size = logical_blob_shape.elem_cnt() * GetSizeOfDataType(data_type);
-  CHECK_EQ(SnapshotFS()->GetFileSize(path), logical_blob_size)
-      << "unexpected model snapshot size, path: " << path;
-  if (slice.shape().Count(1) == logical_blob_shape.Count(1)) {
-    PersistentInStream in_stream(
-        SnapshotFS(), path,
-        slice.At(0).begin() * slice.shape().Count(1) * GetSizeOfDataType(data_type));
-    in_stream.ReadFully(dst, slice.shape().elem_cnt() * GetSizeOfDataType(data_type));
+  const auto packed_it = key2packed_entry_.find(key);
+  if (packed_it != key2packed_entry_.end()) {
+    const SnapshotIndexEntry& entry = packed_it->second;
+    CHECK_EQ(entry.size(), logical_blob_size)
+        << "unexpected model snapshot size, key: " << key << ", shard: " << entry.shard();
+    if (entry.has_data_type()) { CHECK_EQ(entry.data_type(), data_type) << "key: " << key; }
+    if (entry.has_shape()) { CHECK_EQ(Shape(entry.shape()), logical_blob_shape) << "key: " << key; }
+    ReadSlice(*GetShardFile(entry.shard()), entry.offset(), logical_blob_shape, data_type, slice,
+              dst);
   } else {
-    std::vector<char> buffer(logical_blob_size);
-    PersistentInStream in_stream(SnapshotFS(), path);
-    in_stream.ReadFully(buffer.data(), logical_blob_size);
-    TensorSliceCopier copier(slice, logical_blob_slice, data_type);
-    CpuDeviceCtx device_ctx;
-    std::unique_ptr<MemoryCopier> host_memory_copier(NewDefaultMemoryCopier(DeviceType::kCPU));
-    copier.Copy(&device_ctx, *host_memory_copier, dst, buffer.data());
+    const std::string path = GenDataFilePath(root_path_, key);
+    CHECK_EQ(SnapshotFS()->GetFileSize(path), logical_blob_size)
+        << "unexpected model snapshot size, path: " << path;
+    std::unique_ptr<fs::RandomAccessFile> file;
+    SnapshotFS()->NewRandomAccessFile(path, &file);
+    ReadSlice(*file, 0, logical_blob_shape, data_type, slice, dst);
   }
 }
 
@@ -74,10 +205,122 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
   Read(key, logical_blob_shape, blob->data_type(), slice, blob->mut_dptr<char>());
 }
 
-void SnapshotReader::Close() {}
+void SnapshotReader::Close() {
+  std::lock_guard<std::mutex> lock(shard_files_mutex_);
+  shard2file_.clear();
+}
+
+SnapshotFileWriter::SnapshotFileWriter(const std::string& root_path, bool packed, bool sync)
+    : root_path_(root_path),
+      packed_(packed),
+      sync_(sync),
+      shard_id_(0),
+      shard_size_(0),
+      packed_index_flushed_(false) {
+  if (packed_) {
+    packed_name_ = GenPackedName();
+    // keys of the snapshot saved into the root before, which a packed write would duplicate
+    ForEachPackedIndexEntry(root_path_, [&](const SnapshotIndexEntry& entry) {
+      existing_packed_keys_.insert(entry.key());
+    });
+  }
+}
+
+SnapshotFileWriter::~SnapshotFileWriter() {
+  if (packed_) { FlushPackedIndex(); }
+}
+
+void SnapshotFileWriter::Write(const std::string& key, const char* data, size_t size,
+                               DataType data_type, const Shape& shape) {
+  if (packed_) {
+    WritePacked(key, data, size, data_type, shape);
+    return;
+  }
+  const std::string path = GenDataFilePath(root_path_, key);
+  const std::string dir_path = Dirname(path);
+  SnapshotFS()->CreateDirIfNotExist(dir_path);
+  CHECK(!SnapshotFS()->FileExists(path));
+  PersistentOutStream out_stream(SnapshotFS(), path);
+  out_stream.Write(data, size);
+  if (sync_) { out_stream.Sync(); }
+}
+
+void SnapshotFileWriter::WritePacked(const std::string& key, const char* data, size_t size,
+                                     DataType data_type, const Shape& shape) {
+  CHECK(!packed_index_flushed_) << "write to a closed snapshot, key: " << key;
+  CHECK(packed_keys_.insert(key).second) << "duplicated key " << key << " in snapshot";
+  // as in the unpacked path, a key of an existing snapshot is never written over
+  CHECK(existing_packed_keys_.count(key) == 0)
+      << "key " << key << " exists in snapshot " << root_path_;
+  static const int64_t max_shard_size =
+      ParseIntegerFromEnv("ONEFLOW_SNAPSHOT_PACKED_SHARD_SIZE", 1LL << 30);
+  if (shard_stream_ && shard_size_ > 0 && shard_size_ + size > max_shard_size) {
+    CloseShard();
+    shard_id_ += 1;
+    shard_size_ = 0;
+  }
+  const std::string shard = GenShardName(packed_name_, shard_id_);
+  if (!shard_stream_) {
+    shard_stream_.reset(new PersistentOutStream(SnapshotFS(), JoinPath(root_path_, shard)));
+  }
+  SnapshotIndexEntry* entry = packed_index_.add_entry();
+  entry->set_key(key);
+  entry->set_shard(shard);
+  entry->set_offset(shard_size_);
+  entry->set_size(size);
+  if (data_type != DataType::kInvalidDataType) {
+    entry->set_data_type(data_type);
+    shape.ToProto(entry->mutable_shape());
+  }
+  shard_stream_->Write(data, size);
+  shard_size_ += size;
+}
+
+void SnapshotFileWriter::CloseShard() {
+  if (!shard_stream_) { return; }
+  if (sync_) { shard_stream_->Sync(); }
+  shard_stream_.reset();
+}
+
+void SnapshotFileWriter::FlushPackedIndex() {
+  if (packed_index_flushed_) { return; }
+  packed_index_flushed_ = true;
+  CloseShard();
+  if (packed_index_.entry_size() == 0) { return; }
+  // readers pick up index files only, so shards become visible once complete
+  const std::string path = JoinPath(root_path_, packed_name_ + kPackedIndexSuffix);
+  const std::string tmp_path = path + ".tmp";
+  {
+    PersistentOutStream out_stream(SnapshotFS(), tmp_path);
+    out_stream << packed_index_.SerializeAsString();
+    if (sync_) { out_stream.Sync(); }
+  }
+  SnapshotFS()->RenameFile(tmp_path, path);
+}
+
+void SnapshotFileWriter::Close() {
+  if (packed_) { FlushPackedIndex(); }
+  const std::string path = JoinPath(root_path_, "snapshot_done");
+  const std::string tmp_path = path + ".tmp";
+  {
+    PersistentOutStream out_stream(SnapshotFS(), tmp_path);
+    if (sync_) { out_stream.Sync(); }
+  }
+  SnapshotFS()->RenameFile(tmp_path, path);
+}
 
 SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path)
-    : root_path_(snapshot_root_path) {
+    : SnapshotWriter(snapshot_root_path, ParseBooleanFromEnv("ONEFLOW_SNAPSHOT_PACKED", false),
+                     ParseBooleanFromEnv("ONEFLOW_SNAPSHOT_ASYNC", false)) {}
+
+SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path, bool packed)
+    : SnapshotWriter(snapshot_root_path, packed, false) {}
+
+SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path, bool packed, bool async)
+    : root_path_(snapshot_root_path),
+      async_(async),
+      async_channel_(-1),
+      file_writer_(new SnapshotFileWriter(snapshot_root_path, packed, async)) {
   OfCallOnce("SnapshotWriteCheckRootPath-" + snapshot_root_path, [&]() {
     if (SnapshotFS()->FileExists(snapshot_root_path)) {
       CHECK(SnapshotFS()->IsDirectory(snapshot_root_path))
@@ -88,23 +331,73 @@ SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path)
       SnapshotFS()->CreateDir(snapshot_root_path);
     }
   });
+  if (async_) {
+    CHECK_NOTNULL(Global<AsyncSnapshotSaver>::Get());
+    async_channel_ = Global<AsyncSnapshotSaver>::Get()->NewChannel();
+  }
 }
 
 void SnapshotWriter::Write(const std::string& key, const char* data, size_t size) {
-  const std::string path = GenDataFilePath(root_path_, key);
-  const std::string dir_path = Dirname(path);
-  SnapshotFS()->CreateDirIfNotExist(dir_path);
-  CHECK(!SnapshotFS()->FileExists(path));
-  PersistentOutStream out_stream(SnapshotFS(), path);
-  out_stream.Write(data, size);
+  if (async_) {
+    WriteAsync(key, size, DataType::kInvalidDataType, Shape(), false,
+               [&](char* dst) { std::memcpy(dst, data, size); });
+  } else {
+    file_writer_->Write(key, data, size, DataType::kInvalidDataType, Shape());
+  }
 }
 
 void SnapshotWriter::Write(const std::string& key, const Blob* blob) {
-  Write(key, blob->dptr<char>(), blob->ByteSizeOfBlobBody());
+  Shape shape;
+  blob->shape().ToShape(&shape);
+  const size_t size = blob->ByteSizeOfBlobBody();
+  if (async_) {
+    WriteAsync(key, size, blob->data_type(), shape, false,
+               [&](char* dst) { std::memcpy(dst, blob->dptr(), size); });
+  } else {
+    file_writer_->Write(key, blob->dptr<char>(), size, blob->data_type(), shape);
+  }
+}
+
+void SnapshotWriter::Write(const std::string& key, const Blob* blob,
+                           const std::function<void(char* dst)>& CopyBody) {
+  Shape shape;
+  blob->shape().ToShape(&shape);
+  const size_t size = blob->ByteSizeOfBlobBody();
+  if (async_) {
+    WriteAsync(key, size, blob->data_type(), shape, blob->mem_case().has_device_cuda_mem(),
+               CopyBody);
+  } else {
+    std::vector<char> body(size);
+    CopyBody(body.data());
+    file_writer_->Write(key, body.data(), size, blob->data_type(), shape);
+  }
+}
+
+void SnapshotWriter::WriteAsync(const std::string& key, size_t size, DataType data_type,
+                                const Shape& shape, bool pinned,
+                                const std::function<void(char* dst)>& CopyData) {
+  AsyncSnapshotSaver* saver = Global<AsyncSnapshotSaver>::Get();
+  // blocks while earlier saves still hold too much staging memory
+  std::shared_ptr<SnapshotStagingBuffer> staging = saver->AcquireStagingBuffer(size, pinned);
+  CopyData(staging->data());
+  std::shared_ptr<SnapshotFileWriter> file_writer = file_writer_;
+  saver->Schedule(async_channel_, [file_writer, staging, key, data_type, shape]() {
+    file_writer->Write(key, staging->data(), staging->size(), data_type, shape);
+  });
+}
+
+void SnapshotWriter::Wait() {
+  if (async_) { Global<AsyncSnapshotSaver>::Get()->WaitChannel(async_channel_); }
 }
 
 void SnapshotWriter::Close() {
-  PersistentOutStream out_stream(SnapshotFS(), JoinPath(root_path_, "snapshot_done"));
+  if (async_) {
+    std::shared_ptr<SnapshotFileWriter> file_writer = file_writer_;
+    Global<AsyncSnapshotSaver>::Get()->Schedule(async_channel_,
+                                                [file_writer]() { file_writer->Close(); });
+  } else {
+    file_writer_->Close();
+  }
 }
 
 }  // namespace oneflow
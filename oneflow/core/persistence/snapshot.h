@@ -18,16 +18,23 @@ limitations under the License.
 
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/snapshot.pb.h"
 #include "oneflow/core/register/tensor_slice_view.h"
 
 namespace oneflow {
 
 class Blob;
+class PersistentOutStream;
+
+// A snapshot stores each key either in a file of its own under the root, or, when packed, in a
+// few large shard files described by index files. Readers accept both at once.
 
 class SnapshotReader final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SnapshotReader);
   SnapshotReader() = delete;
+  // waits for the async saves in flight
   explicit SnapshotReader(const std::string& snapshot_root_path);
   ~SnapshotReader() = default;
 
@@ -40,22 +47,79 @@ class SnapshotReader final {
   void Close();
 
  private:
+  void LoadPackedIndexes();
+  const fs::RandomAccessFile* GetShardFile(const std::string& shard) const;
+
+  const std::string root_path_;
+  HashMap<std::string, SnapshotIndexEntry> key2packed_entry_;
+  mutable std::mutex shard_files_mutex_;
+  mutable HashMap<std::string, std::unique_ptr<fs::RandomAccessFile>> shard2file_;
+};
+
+// Writes the files of a snapshot on the thread it is called on
+class SnapshotFileWriter final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SnapshotFileWriter);
+  // sync writers fsync the files before they are published
+  SnapshotFileWriter(const std::string& root_path, bool packed, bool sync);
+  ~SnapshotFileWriter();
+
+  // data_type is kInvalidDataType if unknown
+  void Write(const std::string& key, const char* data, size_t size, DataType data_type,
+             const Shape& shape);
+  void Close();
+
+ private:
+  void WritePacked(const std::string& key, const char* data, size_t size, DataType data_type,
+                   const Shape& shape);
+  void CloseShard();
+  void FlushPackedIndex();
+
   const std::string root_path_;
+  const bool packed_;
+  const bool sync_;
+  std::string packed_name_;
+  int64_t shard_id_;
+  int64_t shard_size_;
+  std::unique_ptr<PersistentOutStream> shard_stream_;
+  SnapshotIndex packed_index_;
+  HashSet<std::string> packed_keys_;
+  HashSet<std::string> existing_packed_keys_;
+  bool packed_index_flushed_;
 };
 
 class SnapshotWriter final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SnapshotWriter);
   SnapshotWriter() = delete;
+  // packed if ONEFLOW_SNAPSHOT_PACKED is set, async if ONEFLOW_SNAPSHOT_ASYNC is set
   explicit SnapshotWriter(const std::string& snapshot_root_path);
+  SnapshotWriter(const std::string& snapshot_root_path, bool packed);
+  // Async writers copy the data into staging buffers of Global<AsyncSnapshotSaver> and return.
+  // The saver writes and fsyncs the files in the background, Close publishes snapshot_done after
+  // all of them.
+  SnapshotWriter(const std::string& snapshot_root_path, bool packed, bool async);
   ~SnapshotWriter() = default;
 
   void Write(const std::string& key, const char* data, size_t size);
   void Write(const std::string& key, const Blob* blob);
+  // CopyBody copies the body of blob to the host memory at dst, so that device blobs go to pinned
+  // staging buffers directly
+  void Write(const std::string& key, const Blob* blob,
+             const std::function<void(char* dst)>& CopyBody);
+  // Blocks until the data of the writes so far is in the files. Async writers wait for their own
+  // saves only.
+  void Wait();
   void Close();
 
  private:
+  void WriteAsync(const std::string& key, size_t size, DataType data_type, const Shape& shape,
+                  bool pinned, const std::function<void(char* dst)>& CopyData);
+
   const std::string root_path_;
+  const bool async_;
+  int64_t async_channel_;
+  std::shared_ptr<SnapshotFileWriter> file_writer_;
 };
 
 }  // namespace oneflow
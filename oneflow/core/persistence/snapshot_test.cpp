@@ -0,0 +1,187 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/ctrl_bootstrap.pb.h"
+#include "oneflow/core/persistence/async_snapshot_saver.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/snapshot.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+// PersistentOutStream names its files after the ctrl address of this process
+struct GlobalProcessCtxScope final {
+  GlobalProcessCtxScope() {
+    Global<ProcessCtx>::New();
+    Address* addr = Global<ProcessCtx>::Get()->mutable_ctrl_addr()->Add();
+    addr->set_host("localhost");
+    addr->set_port(0);
+    Global<ProcessCtx>::Get()->set_rank(0);
+    Global<ProcessCtx>::Get()->set_node_size(1);
+  }
+  ~GlobalProcessCtxScope() { Global<ProcessCtx>::Delete(); }
+};
+
+std::vector<float> NewBlobData(const Shape& shape) {
+  std::vector<float> data(shape.elem_cnt());
+  FOR_RANGE(int64_t, i, 0, shape.elem_cnt()) { data.at(i) = static_cast<float>(i); }
+  return data;
+}
+
+std::vector<float> SliceBlobData(const std::vector<float>& data, const Shape& shape,
+                                 const TensorSliceView& slice) {
+  std::vector<float> sliced;
+  FOR_RANGE(int64_t, i, slice.At(0).begin(), slice.At(0).end()) {
+    FOR_RANGE(int64_t, j, slice.At(1).begin(), slice.At(1).end()) {
+      FOR_RANGE(int64_t, k, slice.At(2).begin(), slice.At(2).end()) {
+        sliced.push_back(data.at((i * shape.At(1) + j) * shape.At(2) + k));
+      }
+    }
+  }
+  return sliced;
+}
+
+void TestWriteAndReadSlices(bool packed, bool async) {
+  GlobalProcessCtxScope scope;
+  const std::string root = JoinPath(GetCwd(), std::string("tmp_test_snapshot")
+                                                  + (packed ? "_packed" : "")
+                                                  + (async ? "_async" : ""));
+  const Shape shape({4, 6, 5});
+  const std::vector<float> data = NewBlobData(shape);
+  // staging holds less than two blobs, the second write waits for the first one
+  if (async) { Global<AsyncSnapshotSaver>::New(2, data.size() * sizeof(float) * 3 / 2); }
+  {
+    SnapshotWriter writer(root, packed, async);
+    writer.Write("var_0/out", reinterpret_cast<const char*>(data.data()),
+                 data.size() * sizeof(float));
+    writer.Write("var_1/out", reinterpret_cast<const char*>(data.data()),
+                 data.size() * sizeof(float));
+    writer.Close();
+  }
+  if (async) {
+    Global<AsyncSnapshotSaver>::Get()->WaitAll();
+    Global<AsyncSnapshotSaver>::Delete();
+  }
+  ASSERT_TRUE(SnapshotFS()->FileExists(JoinPath(root, "snapshot_done")));
+  ASSERT_EQ(SnapshotFS()->FileExists(JoinPath(root, "var_0/out")), !packed);
+  const SnapshotReader reader(root);
+  ASSERT_TRUE(reader.HasKey("var_0/out"));
+  ASSERT_TRUE(reader.HasKey("var_1/out"));
+  ASSERT_FALSE(reader.HasKey("var_2/out"));
+  const std::vector<TensorSliceView> slices = {
+      TensorSliceView(shape),
+      TensorSliceView({Range(1, 3), Range(0, 6), Range(0, 5)}),
+      TensorSliceView({Range(1, 3), Range(2, 5), Range(0, 5)}),
+      TensorSliceView({Range(0, 4), Range(1, 2), Range(1, 4)}),
+      TensorSliceView({Range(2, 2), Range(0, 6), Range(0, 5)}),
+  };
+  for (const TensorSliceView& slice : slices) {
+    const std::vector<float> expected = SliceBlobData(data, shape, slice);
+    std::vector<float> sliced(slice.shape().elem_cnt());
+    reader.Read("var_1/out", shape, DataType::kFloat, slice,
+                reinterpret_cast<char*>(sliced.data()));
+    ASSERT_EQ(sliced, expected);
+  }
+  SnapshotFS()->RecursivelyDeleteDir(root);
+}
+
+}  // namespace
+
+TEST(Snapshot, write_and_read_slices) { TestWriteAndReadSlices(false, false); }
+
+TEST(Snapshot, write_and_read_packed_slices) { TestWriteAndReadSlices(true, false); }
+
+TEST(Snapshot, async_write_and_read_slices) { TestWriteAndReadSlices(false, true); }
+
+TEST(Snapshot, async_write_and_read_packed_slices) { TestWriteAndReadSlices(true, true); }
+
+TEST(Snapshot, async_wait_without_close) {
+  GlobalProcessCtxScope scope;
+  const std::string root = JoinPath(GetCwd(), "tmp_test_snapshot_async_wait");
+  const std::vector<float> data = NewBlobData(Shape({4, 6, 5}));
+  Global<AsyncSnapshotSaver>::New(2, data.size() * sizeof(float) * 3 / 2);
+  {
+    SnapshotWriter writer(root, false, true);
+    writer.Write("var_0/out", reinterpret_cast<const char*>(data.data()),
+                 data.size() * sizeof(float));
+    writer.Write("var_1/out", reinterpret_cast<const char*>(data.data()),
+                 data.size() * sizeof(float));
+    writer.Wait();
+    ASSERT_TRUE(SnapshotFS()->FileExists(JoinPath(root, "var_0/out")));
+    ASSERT_TRUE(SnapshotFS()->FileExists(JoinPath(root, "var_1/out")));
+    ASSERT_FALSE(SnapshotFS()->FileExists(JoinPath(root, "snapshot_done")));
+  }
+  const SnapshotReader reader(root);
+  std::vector<float> loaded(data.size());
+  reader.Read("var_1/out", Shape({4, 6, 5}), DataType::kFloat, TensorSliceView(Shape({4, 6, 5})),
+              reinterpret_cast<char*>(loaded.data()));
+  ASSERT_EQ(loaded, data);
+  Global<AsyncSnapshotSaver>::Delete();
+  SnapshotFS()->RecursivelyDeleteDir(root);
+}
+
+TEST(Snapshot, async_read_waits_for_writes) {
+  GlobalProcessCtxScope scope;
+  const std::vector<float> data = NewBlobData(Shape({4, 6, 5}));
+  Global<AsyncSnapshotSaver>::New(2, data.size() * sizeof(float) * 3 / 2);
+  FOR_RANGE(int64_t, packed, 0, 2) {
+    const std::string root =
+        JoinPath(GetCwd(), "tmp_test_snapshot_async_read_" + std::to_string(packed));
+    {
+      // the writer returns without waiting, as the save kernel does
+      SnapshotWriter writer(root, packed == 1, true);
+      FOR_RANGE(int64_t, i, 0, 4) {
+        writer.Write("var_" + std::to_string(i) + "/out",
+                     reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float));
+      }
+    }
+    const SnapshotReader reader(root);
+    FOR_RANGE(int64_t, i, 0, 4) {
+      std::vector<float> loaded(data.size());
+      reader.Read("var_" + std::to_string(i) + "/out", Shape({4, 6, 5}), DataType::kFloat,
+                  TensorSliceView(Shape({4, 6, 5})), reinterpret_cast<char*>(loaded.data()));
+      ASSERT_EQ(loaded, data);
+    }
+    SnapshotFS()->RecursivelyDeleteDir(root);
+  }
+  Global<AsyncSnapshotSaver>::Delete();
+}
+
+TEST(Snapshot, packed_write_into_existing_snapshot) {
+  GlobalProcessCtxScope scope;
+  const std::string root = JoinPath(GetCwd(), "tmp_test_snapshot_packed_existing");
+  const std::vector<float> data = NewBlobData(Shape({4, 6, 5}));
+  // a second packed writer adds keys next to the index of the first one, as the save kernels of
+  // different ranks do
+  FOR_RANGE(int64_t, i, 0, 2) {
+    SnapshotWriter writer(root, true);
+    writer.Write("var_" + std::to_string(i) + "/out", reinterpret_cast<const char*>(data.data()),
+                 data.size() * sizeof(float));
+  }
+  const SnapshotReader reader(root);
+  ASSERT_TRUE(reader.HasKey("var_0/out"));
+  ASSERT_TRUE(reader.HasKey("var_1/out"));
+  SnapshotFS()->RecursivelyDeleteDir(root);
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -16,6 +16,7 @@ limitations under the License.
 
 #include "oneflow/core/profiler/kernel.h"
 #include "oneflow/core/profiler/profiler.h"
+#include "oneflow/core/profiler/timeline.h"
 #include "oneflow/core/kernel/kernel.h"
 #include "oneflow/core/device/cuda_device_context.h"
 
@@ -42,6 +43,8 @@ thread_local cudaEvent_t cuda_memory_bandwidth_profile_start_event = nullptr;
 thread_local cudaEvent_t cuda_memory_bandwidth_profile_end_event = nullptr;
 #endif  // WITH_CUDA
 
+thread_local int64_t timeline_kernel_begin_ns = 0;
+
 }  // namespace
 
 void TraceKernelForwardDataContentStart(const KernelContext* kernel_ctx, const Kernel* kernel) {
@@ -101,6 +104,17 @@ void TraceKernelForwardDataContentEnd(const KernelContext* kernel_ctx, const Ker
 #endif  // WITH_CUDA
 }
 
+void TimelineKernelForwardDataContentStart(const Kernel* kernel) {
+  if (IsTimelineEnabled()) { timeline_kernel_begin_ns = TimelineNowNs(); }
+}
+
+void TimelineKernelForwardDataContentEnd(const Kernel* kernel) {
+  if (timeline_kernel_begin_ns == 0) { return; }
+  RecordTimelineEvent(TimelineCategory::kKernel, kernel->op_conf().name(), -1,
+                      timeline_kernel_begin_ns, TimelineNowNs());
+  timeline_kernel_begin_ns = 0;
+}
+
 }  // namespace profiler
 
 }  // namespace oneflow
@@ -30,6 +30,11 @@ void TraceKernelForwardDataContentStart(const KernelContext* kernel_ctx, const K
 
 void TraceKernelForwardDataContentEnd(const KernelContext* kernel_ctx, const Kernel* kernel);
 
+// Host side launch range of the kernel on the timeline
+void TimelineKernelForwardDataContentStart(const Kernel* kernel);
+
+void TimelineKernelForwardDataContentEnd(const Kernel* kernel);
+
 }  // namespace profiler
 
 }  // namespace oneflow
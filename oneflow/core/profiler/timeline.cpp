@@ -0,0 +1,256 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/timeline.h"
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/control/ctrl_bootstrap.pb.h"
+#include <iomanip>
+
+namespace oneflow {
+
+namespace profiler {
+
+std::atomic<bool> timeline_enabled(false);
+
+namespace {
+
+struct TimelineEvent {
+  int64_t begin_ns;
+  int64_t end_ns;
+  int64_t id;
+  TimelineCategory category;
+  char name[kMaxTimelineEventNameLen + 1];
+};
+
+// Single producer ring, only the owner thread appends. cursor_ is published with release order
+// after the event is written so that readers see complete events below it.
+class TimelineBuffer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TimelineBuffer);
+  TimelineBuffer(size_t capacity, int64_t tid)
+      : events_(capacity), mask_(capacity - 1), cursor_(0), cleared_cursor_(0), tid_(tid) {
+    CHECK_EQ(capacity & mask_, 0);
+  }
+  ~TimelineBuffer() = default;
+
+  int64_t tid() const { return tid_; }
+
+  void Append(TimelineCategory category, const char* name, int64_t id, int64_t begin_ns,
+              int64_t end_ns) {
+    const uint64_t cursor = cursor_.load(std::memory_order_relaxed);
+    TimelineEvent* event = &events_[cursor & mask_];
+    event->begin_ns = begin_ns;
+    event->end_ns = end_ns;
+    event->id = id;
+    event->category = category;
+    std::strncpy(event->name, name, kMaxTimelineEventNameLen);
+    event->name[kMaxTimelineEventNameLen] = '\0';
+    cursor_.store(cursor + 1, std::memory_order_release);
+  }
+
+  void Clear() { cleared_cursor_.store(cursor_.load(std::memory_order_acquire)); }
+
+  void ForEachEvent(const std::function<void(const TimelineEvent&)>& Handler) const {
+    const uint64_t end = cursor_.load(std::memory_order_acquire);
+    uint64_t begin = cleared_cursor_.load();
+    if (end - begin > events_.size()) { begin = end - events_.size(); }
+    for (uint64_t i = begin; i < end; ++i) { Handler(events_[i & mask_]); }
+  }
+
+ private:
+  std::vector<TimelineEvent> events_;
+  const uint64_t mask_;
+  std::atomic<uint64_t> cursor_;
+  std::atomic<uint64_t> cleared_cursor_;
+  const int64_t tid_;
+};
+
+// Buffers outlive their threads so that events of exited threads can still be exported.
+class TimelineBufferRegistry final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TimelineBufferRegistry);
+  TimelineBufferRegistry() {
+    const int64_t size = ParseIntegerFromEnv("ONEFLOW_PROFILER_TIMELINE_BUFFER_SIZE", 1 << 16);
+    capacity_ = 1;
+    while (capacity_ < size) { capacity_ <<= 1; }
+  }
+  ~TimelineBufferRegistry() = default;
+
+  std::shared_ptr<TimelineBuffer> NewBuffer() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    buffers_.emplace_back(std::make_shared<TimelineBuffer>(capacity_, buffers_.size()));
+    return buffers_.back();
+  }
+
+  std::vector<std::shared_ptr<TimelineBuffer>> buffers() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return buffers_;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  size_t capacity_;
+  std::vector<std::shared_ptr<TimelineBuffer>> buffers_;
+};
+
+TimelineBufferRegistry* GetTimelineBufferRegistry() {
+  static TimelineBufferRegistry registry;
+  return &registry;
+}
+
+TimelineBuffer* GetThisThreadTimelineBuffer() {
+  thread_local std::shared_ptr<TimelineBuffer> buffer = GetTimelineBufferRegistry()->NewBuffer();
+  return buffer.get();
+}
+
+const std::chrono::steady_clock::time_point& TimelineEpoch() {
+  static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+  return epoch;
+}
+
+void InitTimeline() {
+  TimelineEpoch();
+  if (ParseBooleanFromEnv("ONEFLOW_PROFILER_TIMELINE", false)) { TimelineStart(); }
+}
+
+COMMAND(InitTimeline());
+
+const char* TimelineCategoryName(TimelineCategory category) {
+  switch (category) {
+    case TimelineCategory::kKernel: return "kernel";
+    case TimelineCategory::kActor: return "actor";
+    case TimelineCategory::kInstruction: return "instruction";
+    case TimelineCategory::kCommNet: return "comm_net";
+    default: UNIMPLEMENTED(); return "";
+  }
+}
+
+std::string EscapeJsonString(const char* str) {
+  std::string escaped;
+  for (const char* c = str; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      escaped.push_back('\\');
+      escaped.push_back(*c);
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      escaped.push_back(' ');
+    } else {
+      escaped.push_back(*c);
+    }
+  }
+  return escaped;
+}
+
+void ForEachTimelineEvent(const std::function<void(int64_t tid, const TimelineEvent&)>& Handler) {
+  for (const auto& buffer : GetTimelineBufferRegistry()->buffers()) {
+    const int64_t tid = buffer->tid();
+    buffer->ForEachEvent([&](const TimelineEvent& event) { Handler(tid, event); });
+  }
+}
+
+}  // namespace
+
+int64_t TimelineNowNs() {
+  // offset by one so that 0 can mean "not recorded"
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+                                                              - TimelineEpoch())
+             .count()
+         + 1;
+}
+
+void RecordTimelineEvent(TimelineCategory category, const char* name, int64_t id,
+                         int64_t begin_ns, int64_t end_ns) {
+  GetThisThreadTimelineBuffer()->Append(category, name, id, begin_ns, end_ns);
+}
+
+void TimelineStart() { timeline_enabled.store(true); }
+
+void TimelineStop() { timeline_enabled.store(false); }
+
+void TimelineClear() {
+  for (const auto& buffer : GetTimelineBufferRegistry()->buffers()) { buffer->Clear(); }
+}
+
+std::string TimelineChromeTraceJson() {
+  const int64_t pid = Global<ProcessCtx>::Get() == nullptr ? 0 : GlobalProcessCtx::Rank();
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  ss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool is_first = true;
+  ForEachTimelineEvent([&](int64_t tid, const TimelineEvent& event) {
+    if (!is_first) { ss << ","; }
+    is_first = false;
+    ss << "\n{\"name\":\"" << EscapeJsonString(event.name) << "\",\"cat\":\""
+       << TimelineCategoryName(event.category) << "\",\"ph\":\"X\",\"pid\":" << pid
+       << ",\"tid\":" << tid << ",\"ts\":" << event.begin_ns / 1000.0
+       << ",\"dur\":" << (event.end_ns - event.begin_ns) / 1000.0;
+    if (event.id >= 0) { ss << ",\"args\":{\"id\":" << event.id << "}"; }
+    ss << "}";
+  });
+  ss << "\n]}\n";
+  return ss.str();
+}
+
+std::string TimelineSummaryTable() {
+  struct Stat {
+    int64_t count = 0;
+    int64_t total_ns = 0;
+    int64_t min_ns = std::numeric_limits<int64_t>::max();
+    int64_t max_ns = 0;
+  };
+  // key: ((category, id), name)
+  using Key = std::pair<std::pair<int8_t, int64_t>, std::string>;
+  HashMap<Key, Stat> key2stat;
+  ForEachTimelineEvent([&](int64_t, const TimelineEvent& event) {
+    const Key key(std::make_pair(static_cast<int8_t>(event.category), event.id),
+                  std::string(event.name));
+    Stat& stat = key2stat[key];
+    const int64_t dur_ns = event.end_ns - event.begin_ns;
+    stat.count += 1;
+    stat.total_ns += dur_ns;
+    stat.min_ns = std::min(stat.min_ns, dur_ns);
+    stat.max_ns = std::max(stat.max_ns, dur_ns);
+  });
+  using Row = std::pair<Key, Stat>;
+  std::vector<Row> rows(key2stat.begin(), key2stat.end());
+  std::sort(rows.begin(), rows.end(), [](const Row& lhs, const Row& rhs) {
+    return lhs.second.total_ns > rhs.second.total_ns;
+  });
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  ss << std::left << std::setw(12) << "category" << std::setw(48) << "name" << std::right
+     << std::setw(20) << "id" << std::setw(10) << "count" << std::setw(14) << "total(ms)"
+     << std::setw(12) << "avg(us)" << std::setw(12) << "min(us)" << std::setw(12) << "max(us)"
+     << "\n";
+  for (const Row& row : rows) {
+    const Stat& stat = row.second;
+    ss << std::left << std::setw(12)
+       << TimelineCategoryName(static_cast<TimelineCategory>(row.first.first.first))
+       << std::setw(48) << row.first.second << std::right << std::setw(20);
+    if (row.first.first.second >= 0) {
+      ss << row.first.first.second;
+    } else {
+      ss << "-";
+    }
+    ss << std::setw(10) << stat.count << std::setw(14) << stat.total_ns / 1e6 << std::setw(12)
+       << stat.total_ns / 1e3 / stat.count << std::setw(12) << stat.min_ns / 1e3 << std::setw(12)
+       << stat.max_ns / 1e3 << "\n";
+  }
+  return ss.str();
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
@@ -0,0 +1,93 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PROFILER_TIMELINE_H_
+#define ONEFLOW_CORE_PROFILER_TIMELINE_H_
+
+#include <cstring>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+// A host side timeline profiler that is always compiled in. Events are appended to per thread
+// ring buffers without locking, so a disabled timeline costs one relaxed load per hook and an
+// enabled one a clock read and a copy into the ring. Once the ring of a thread is full the
+// oldest events are overwritten.
+
+enum class TimelineCategory : int8_t {
+  kKernel = 0,
+  kActor = 1,
+  kInstruction = 2,
+  kCommNet = 3,
+};
+
+constexpr size_t kMaxTimelineEventNameLen = 63;
+
+extern std::atomic<bool> timeline_enabled;
+
+inline bool IsTimelineEnabled() { return timeline_enabled.load(std::memory_order_relaxed); }
+
+int64_t TimelineNowNs();
+
+// name is truncated to a fixed length, id < 0 means the event has no id
+void RecordTimelineEvent(TimelineCategory category, const char* name, int64_t id,
+                         int64_t begin_ns, int64_t end_ns);
+inline void RecordTimelineEvent(TimelineCategory category, const std::string& name, int64_t id,
+                                int64_t begin_ns, int64_t end_ns) {
+  RecordTimelineEvent(category, name.c_str(), id, begin_ns, end_ns);
+}
+
+void TimelineStart();
+void TimelineStop();
+// drops the events recorded so far
+void TimelineClear();
+
+// Exporting reads the rings of all threads, it should be done after TimelineStop() since events
+// recorded concurrently may be overwritten while being read.
+std::string TimelineChromeTraceJson();
+// per (category, name, id) count and total/avg/min/max duration, sorted by total duration
+std::string TimelineSummaryTable();
+
+// Records the scope as one event. name is copied when the scope is entered, so it only needs to
+// live until the constructor returns.
+class TimelineRangeGuard final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TimelineRangeGuard);
+  TimelineRangeGuard(TimelineCategory category, const char* name, int64_t id)
+      : category_(category), id_(id), begin_ns_(0) {
+    if (IsTimelineEnabled()) {
+      std::strncpy(name_, name, kMaxTimelineEventNameLen);
+      name_[kMaxTimelineEventNameLen] = '\0';
+      begin_ns_ = TimelineNowNs();
+    }
+  }
+  ~TimelineRangeGuard() {
+    if (begin_ns_ != 0) { RecordTimelineEvent(category_, name_, id_, begin_ns_, TimelineNowNs()); }
+  }
+
+ private:
+  TimelineCategory category_;
+  int64_t id_;
+  int64_t begin_ns_;
+  char name_[kMaxTimelineEventNameLen + 1];
+};
+
+}  // namespace profiler
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PROFILER_TIMELINE_H_
@@ -0,0 +1,78 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/profiler/timeline.h"
+
+namespace oneflow {
+
+namespace profiler {
+
+namespace {
+
+int64_t CountSubstr(const std::string& str, const std::string& sub) {
+  int64_t cnt = 0;
+  for (size_t pos = str.find(sub); pos != std::string::npos; pos = str.find(sub, pos + 1)) {
+    cnt += 1;
+  }
+  return cnt;
+}
+
+}  // namespace
+
+TEST(Timeline, record_only_when_enabled) {
+  TimelineStop();
+  TimelineClear();
+  { TimelineRangeGuard guard(TimelineCategory::kActor, "disabled_range", 1); }
+  TimelineStart();
+  { TimelineRangeGuard guard(TimelineCategory::kActor, "enabled_range", 2); }
+  std::thread thread([]() {
+    TimelineRangeGuard guard(TimelineCategory::kInstruction, "other_thread_\"range\"", -1);
+  });
+  thread.join();
+  TimelineStop();
+  const std::string json = TimelineChromeTraceJson();
+  ASSERT_EQ(CountSubstr(json, "disabled_range"), 0);
+  ASSERT_EQ(CountSubstr(json, "\"name\":\"enabled_range\",\"cat\":\"actor\""), 1);
+  ASSERT_EQ(CountSubstr(json, "\"args\":{\"id\":2}"), 1);
+  // events of exited threads are kept, and names are escaped
+  ASSERT_EQ(CountSubstr(json, "other_thread_\\\"range\\\""), 1);
+  TimelineClear();
+  ASSERT_EQ(CountSubstr(TimelineChromeTraceJson(), "enabled_range"), 0);
+}
+
+TEST(Timeline, ring_keeps_latest_events) {
+  const int64_t capacity = ParseIntegerFromEnv("ONEFLOW_PROFILER_TIMELINE_BUFFER_SIZE", 1 << 16);
+  TimelineClear();
+  TimelineStart();
+  std::thread thread([capacity]() {
+    FOR_RANGE(int64_t, i, 0, capacity + 100) {
+      const int64_t now = TimelineNowNs();
+      RecordTimelineEvent(TimelineCategory::kKernel, i < 100 ? "oldest" : "latest", -1, now, now);
+    }
+  });
+  thread.join();
+  TimelineStop();
+  const std::string json = TimelineChromeTraceJson();
+  ASSERT_EQ(CountSubstr(json, "\"oldest\""), 0);
+  ASSERT_EQ(CountSubstr(json, "\"latest\""), capacity);
+  const std::string table = TimelineSummaryTable();
+  ASSERT_NE(table.find("latest"), std::string::npos);
+  ASSERT_EQ(table.find("oldest"), std::string::npos);
+  TimelineClear();
+}
+
+}  // namespace profiler
+
+}  // namespace oneflow
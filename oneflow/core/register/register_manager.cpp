@@ -23,6 +23,7 @@ limitations under the License.
 #include "oneflow/core/memory/memory_case.pb.h"
 #include "oneflow/core/memory/memory_allocator.h"
 #include "oneflow/core/memory/chunk_manager.h"
+#include "oneflow/core/memory/host_mem_zero_filler.h"
 
 namespace oneflow {
 
@@ -101,10 +102,17 @@ void RegstMgr::AddPlan(const Plan& plan,
     }
   }
 
+  MemoryAllocator* allocator = Global<MemoryAllocator>::Get();
+  HostMemZeroFiller zero_filler;
   for (auto& pair : zone_id2packed_chunk) {
     PackedChunkInfo* packed_chunk = &pair.second;
-    char* ptr =
-        Global<MemoryAllocator>::Get()->Allocate(packed_chunk->mem_case, packed_chunk->size);
+    // with lazy zero fill, host blocks are zero filled below in parallel and NUMA aware, except
+    // for reused blocks whose producers overwrite them
+    const bool lazy_zero_fill =
+        allocator->lazy_zero_fill() && packed_chunk->mem_case.has_host_mem();
+    char* ptr = lazy_zero_fill
+                    ? allocator->AllocateUninitialized(packed_chunk->mem_case, packed_chunk->size)
+                    : allocator->Allocate(packed_chunk->mem_case, packed_chunk->size);
     // sort blocks as thrd id
     std::vector<const MemBlockProto*>* blocks = &(packed_chunk->blocks);
     std::sort(blocks->begin(), blocks->end(),
@@ -117,10 +125,14 @@ void RegstMgr::AddPlan(const Plan& plan,
     int64_t offset = 0;
     for (const MemBlockProto* block : packed_chunk->blocks) {
       CHECK(mem_block_id2ptr_.emplace(block->mem_block_id(), ptr + offset).second);
+      if (lazy_zero_fill && !block->enable_reuse_mem()) {
+        zero_filler.Add(ptr + offset, block->mem_size(), block->thrd_id_hint());
+      }
       offset += block->mem_size();
     }
     CHECK_EQ(offset, packed_chunk->size);
   }
+  zero_filler.Run();
 
   for (int64_t mem_block_id : all_block_ids) {
     CHECK(mem_block_id2ptr_.find(mem_block_id) != mem_block_id2ptr_.end());
@@ -65,11 +65,24 @@ void TensorSliceCopier::Copy(DeviceCtx* ctx, const MemoryCopier& copier, void* d
 
 void TensorSliceCopier::Copy(DeviceCtx* ctx, const MemoryCopier& copier, Blob* dst_blob,
                              const Blob* src_blob) const {
+  const MemoryCopyTask task = NewCopyTask(dst_blob, src_blob);
+  Copy(ctx, copier, task.dst, task.src);
+}
+
+MemoryCopyTask TensorSliceCopier::NewCopyTask(void* dst, const void* src) const {
+  MemoryCopyTask task;
+  task.dst = dst;
+  task.src = src;
+  task.desc = memory_copy_nd_desc_;
+  return task;
+}
+
+MemoryCopyTask TensorSliceCopier::NewCopyTask(Blob* dst_blob, const Blob* src_blob) const {
   CHECK_EQ(dst_blob->data_type(), data_type_);
   CHECK_EQ(src_blob->data_type(), data_type_);
   CHECK_EQ(dst_view_.shape().elem_cnt(), dst_blob->shape().elem_cnt());
   CHECK_EQ(src_view_.shape().elem_cnt(), src_blob->shape().elem_cnt());
-  Copy(ctx, copier, dst_blob->mut_dptr(), src_blob->dptr());
+  return NewCopyTask(dst_blob->mut_dptr(), src_blob->dptr());
 }
 
 }  // namespace oneflow
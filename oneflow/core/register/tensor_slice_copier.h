@@ -34,6 +34,9 @@ class TensorSliceCopier final {
 
   void Copy(DeviceCtx* ctx, const MemoryCopier& copier, void* dst, const void* src) const;
   void Copy(DeviceCtx* ctx, const MemoryCopier& copier, Blob* dst_blob, const Blob* src_blob) const;
+  // for MemoryCopier::CopyBatch
+  MemoryCopyTask NewCopyTask(void* dst, const void* src) const;
+  MemoryCopyTask NewCopyTask(Blob* dst_blob, const Blob* src_blob) const;
 
  private:
   MemoryCopyNdDesc memory_copy_nd_desc_;
@@ -18,10 +18,25 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/actor/actor.h"
 #include "oneflow/core/actor/light_actor.h"
+#include "oneflow/core/profiler/timeline.h"
 
 namespace oneflow {
 
-Thread::Thread() {
+namespace {
+
+const char* TimelineName4ActorMsg(const ActorMsg& msg) {
+  switch (msg.msg_type()) {
+    case ActorMsgType::kRegstMsg: return "RegstMsg";
+    case ActorMsgType::kEordMsg: return "EordMsg";
+    case ActorMsgType::kCmdMsg: return "CmdMsg";
+    default: return "Msg";
+  }
+}
+
+}  // namespace
+
+Thread::Thread()
+    : msg_channel_(ParseIntegerFromEnv("ONEFLOW_THREAD_MAILBOX_CAPACITY", 4096)) {
   local_msg_queue_enabled_ =
       ParseBooleanFromEnv("ONEFLOW_THREAD_ENABLE_LOCAL_MESSAGE_QUEUE", false);
   light_actor_enabled_ = ParseBooleanFromEnv("ONEFLOW_ACTOR_ENABLE_LIGHT_ACTOR", false);
@@ -59,7 +74,12 @@ void Thread::PollMsgChannel(const ThreadCtx& thread_ctx) {
     int64_t actor_id = msg.dst_actor_id();
     auto actor_it = id2actor_ptr_.find(actor_id);
     CHECK(actor_it != id2actor_ptr_.end());
-    int process_msg_ret = actor_it->second->ProcessMsg(msg);
+    int process_msg_ret = 0;
+    {
+      profiler::TimelineRangeGuard timeline_guard(profiler::TimelineCategory::kActor,
+                                                  TimelineName4ActorMsg(msg), actor_id);
+      process_msg_ret = actor_it->second->ProcessMsg(msg);
+    }
     if (process_msg_ret == 1) {
       LOG(INFO) << "thread " << thrd_id_ << " deconstruct actor " << actor_id;
       auto job_id_it = id2job_id_.find(actor_id);
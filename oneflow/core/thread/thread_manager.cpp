@@ -18,8 +18,6 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/thread/cpu_thread.h"
 #include "oneflow/core/thread/gpu_thread.h"
-#include "oneflow/core/common/balanced_splitter.h"
-#include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/control/global_process_ctx.h"
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/common/id_util.h"
@@ -27,6 +25,12 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+constexpr size_t kMultiThreadLoopRangesPerThread = 4;
+
+}  // namespace
+
 ThreadMgr::~ThreadMgr() {
   for (auto& thread_pair : threads_) {
     ActorMsg msg = ActorMsg::BuildCommandMsg(-1, ActorCmd::kStopThread);
@@ -62,17 +66,13 @@ void SingleThreadLoop(size_t num, std::function<void(size_t i)> Callback) {
 }
 
 void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback) {
-  size_t thread_num = Global<ThreadPool>::Get()->thread_num();
-  thread_num = std::min(num, thread_num);
-  BalancedSplitter bs(num, thread_num);
-  BlockingCounter bc(thread_num);
-  FOR_RANGE(size_t, range_id, 0, thread_num) {
-    Global<ThreadPool>::Get()->AddWork([&bc, &bs, range_id, Callback] {
-      FOR_RANGE(size_t, i, bs.At(range_id).begin(), bs.At(range_id).end()) { Callback(i); }
-      bc.Decrease();
-    });
-  }
-  bc.WaitUntilCntEqualZero();
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  // several ranges per thread so that a slow range can be split and stolen
+  const size_t grain_size = std::max<size_t>(
+      num / (static_cast<size_t>(thread_pool->thread_num()) * kMultiThreadLoopRangesPerThread), 1);
+  thread_pool->ParallelFor(num, grain_size, [&Callback](size_t begin, size_t end) {
+    FOR_RANGE(size_t, i, begin, end) { Callback(i); }
+  });
 }
 
 }  // namespace oneflow
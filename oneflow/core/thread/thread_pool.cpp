@@ -17,28 +17,184 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+constexpr int32_t kSpinRoundsBeforeIdle = 64;
+
+thread_local const ThreadPool* cur_thread_pool = nullptr;
+thread_local int32_t cur_worker_id = -1;
+
+}  // namespace
+
+struct ThreadPool::ParallelForCtx final {
+  ParallelForCtx(size_t num, size_t grain_size,
+                 const std::function<void(size_t, size_t)>* Callback)
+      : remaining(num), grain_size(grain_size), Callback(Callback) {}
+
+  std::atomic<size_t> remaining;
+  const size_t grain_size;
+  const std::function<void(size_t, size_t)>* Callback;
+  std::mutex mutex;
+  std::condition_variable cond;
+  // split halves not started yet, the larger ones in front, guarded by mutex
+  std::deque<std::pair<size_t, size_t>> pending_ranges;
+};
+
 ThreadPool::ThreadPool(int32_t thread_num)
-    : work_chans_(thread_num), threads_(thread_num), work_cnt_(0) {
+    : pending_work_cnt_(0), idle_thread_cnt_(0), closed_(false) {
+  FOR_RANGE(int32_t, i, 0, thread_num) {
+    local_queues_.emplace_back(new WorkStealingQueue<Work>());
+  }
+  threads_.resize(thread_num);
   FOR_RANGE(int32_t, i, 0, thread_num) {
-    Channel<std::function<void()>>* chan = &(work_chans_.at(i));
-    threads_[i] = std::thread([chan]() {
-      std::function<void()> work;
-      while (chan->Receive(&work) == kChannelStatusSuccess) { work(); }
-    });
+    threads_[i] = std::thread([this, i]() { WorkerLoop(i); });
   }
 }
 
 ThreadPool::~ThreadPool() {
-  FOR_RANGE(int32_t, i, 0, work_chans_.size()) {
-    work_chans_.at(i).Close();
-    threads_.at(i).join();
+  {
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    closed_ = true;
+  }
+  idle_cond_.notify_all();
+  for (std::thread& thread : threads_) { thread.join(); }
+}
+
+void ThreadPool::AddWork(const std::function<void()>& work) { Submit(new Work(work)); }
+
+int32_t ThreadPool::CurWorkerId() const { return cur_thread_pool == this ? cur_worker_id : -1; }
+
+void ThreadPool::Submit(Work* work) {
+  const int32_t worker_id = CurWorkerId();
+  if (worker_id >= 0) {
+    local_queues_.at(worker_id)->Push(work);
+  } else {
+    std::unique_lock<std::mutex> lock(global_queue_mutex_);
+    global_queue_.push_back(work);
+  }
+  // pairs with WaitForWork: either the idle worker sees the new work or we see the idle worker
+  pending_work_cnt_.fetch_add(1);
+  if (idle_thread_cnt_.load() > 0) {
+    { std::unique_lock<std::mutex> lock(idle_mutex_); }
+    idle_cond_.notify_one();
+  }
+}
+
+ThreadPool::Work* ThreadPool::TryGetWork(int32_t worker_id) {
+  Work* work = nullptr;
+  if (worker_id >= 0) { work = local_queues_.at(worker_id)->Pop(); }
+  if (work == nullptr) {
+    std::unique_lock<std::mutex> lock(global_queue_mutex_);
+    if (!global_queue_.empty()) {
+      work = global_queue_.front();
+      global_queue_.pop_front();
+    }
+  }
+  const int32_t queue_num = local_queues_.size();
+  for (int32_t i = 1; work == nullptr && i <= queue_num; ++i) {
+    const int32_t victim = (worker_id + i + queue_num) % queue_num;
+    if (victim == worker_id) { continue; }
+    work = local_queues_.at(victim)->Steal();
   }
+  if (work != nullptr) { pending_work_cnt_.fetch_sub(1, std::memory_order_relaxed); }
+  return work;
 }
 
-void ThreadPool::AddWork(const std::function<void()>& work) {
-  const size_t cur_chan_idx =
-      work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_chans_.size();
-  work_chans_.at(cur_chan_idx).Send(work);
+bool ThreadPool::WaitForWork() {
+  std::unique_lock<std::mutex> lock(idle_mutex_);
+  idle_thread_cnt_.fetch_add(1);
+  idle_cond_.wait(lock, [this]() { return pending_work_cnt_.load() > 0 || closed_; });
+  idle_thread_cnt_.fetch_sub(1);
+  // pending works are drained before exiting, as the channel based pool did
+  return pending_work_cnt_.load() > 0;
+}
+
+void ThreadPool::WorkerLoop(int32_t worker_id) {
+  cur_thread_pool = this;
+  cur_worker_id = worker_id;
+  int32_t idle_rounds = 0;
+  while (true) {
+    Work* work = TryGetWork(worker_id);
+    if (work != nullptr) {
+      (*work)();
+      delete work;
+      idle_rounds = 0;
+    } else if (idle_rounds < kSpinRoundsBeforeIdle) {
+      ++idle_rounds;
+      std::this_thread::yield();
+    } else if (!WaitForWork()) {
+      break;
+    }
+  }
+}
+
+void ThreadPool::RunRange(const std::shared_ptr<ParallelForCtx>& ctx, size_t begin, size_t end) {
+  while (end - begin > ctx->grain_size) {
+    const size_t mid = begin + (end - begin) / 2;
+    {
+      std::unique_lock<std::mutex> lock(ctx->mutex);
+      ctx->pending_ranges.emplace_back(mid, end);
+    }
+    // the work finds nothing to run if the caller has already run the range
+    Submit(new Work([this, ctx]() { TryRunPendingRange(ctx, true); }));
+    end = mid;
+  }
+  (*ctx->Callback)(begin, end);
+  const size_t size = end - begin;
+  if (ctx->remaining.fetch_sub(size) == size) {
+    std::unique_lock<std::mutex> lock(ctx->mutex);
+    ctx->cond.notify_all();
+  }
+}
+
+bool ThreadPool::TryRunPendingRange(const std::shared_ptr<ParallelForCtx>& ctx, bool largest) {
+  std::pair<size_t, size_t> range;
+  {
+    std::unique_lock<std::mutex> lock(ctx->mutex);
+    if (ctx->pending_ranges.empty()) { return false; }
+    if (largest) {
+      range = ctx->pending_ranges.front();
+      ctx->pending_ranges.pop_front();
+    } else {
+      range = ctx->pending_ranges.back();
+      ctx->pending_ranges.pop_back();
+    }
+  }
+  RunRange(ctx, range.first, range.second);
+  return true;
+}
+
+void ThreadPool::ParallelFor(size_t num, size_t grain_size,
+                             const std::function<void(size_t, size_t)>& Callback) {
+  if (num == 0) { return; }
+  grain_size = std::max<size_t>(grain_size, 1);
+  if (num <= grain_size || threads_.empty()) {
+    Callback(0, num);
+    return;
+  }
+  auto ctx = std::make_shared<ParallelForCtx>(num, grain_size, &Callback);
+  RunRange(ctx, 0, num);
+  const int32_t worker_id = CurWorkerId();
+  if (worker_id >= 0) {
+    // nested call, run the ranges of this call left to the caller instead of blocking a worker
+    while (ctx->remaining.load() > 0) {
+      if (!TryRunPendingRange(ctx, false)) { std::this_thread::yield(); }
+    }
+  } else {
+    std::unique_lock<std::mutex> lock(ctx->mutex);
+    ctx->cond.wait(lock, [&ctx]() { return ctx->remaining.load() == 0; });
+  }
+}
+
+void ParallelForTasks(int64_t num, int64_t grain_size,
+                      const std::function<void(int64_t begin, int64_t end)>& Callback) {
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (thread_pool == nullptr || thread_pool->thread_num() <= 1 || num <= grain_size) {
+    Callback(0, num);
+    return;
+  }
+  thread_pool->ParallelFor(num, grain_size,
+                           [&Callback](size_t begin, size_t end) { Callback(begin, end); });
 }
 
 }  // namespace oneflow
@@ -17,7 +17,7 @@ limitations under the License.
 #define ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 
 #include "oneflow/core/common/util.h"
-#include "oneflow/core/common/channel.h"
+#include "oneflow/core/thread/work_stealing_queue.h"
 
 namespace oneflow {
 
@@ -30,14 +30,44 @@ class ThreadPool final {
 
   int32_t thread_num() const { return threads_.size(); }
   void AddWork(const std::function<void()>& work);
+  // Calls Callback(begin, end) on disjoint sub-ranges covering [0, num) and blocks until all of
+  // them are done. Ranges are split in halves lazily, down to grain_size, so that idle workers
+  // steal the large halves of a slow range. It is safe to call from inside pool work: a waiting
+  // worker keeps running the pending ranges of its own call instead of blocking, but never other
+  // works, which may wait for something the caller holds.
+  void ParallelFor(size_t num, size_t grain_size,
+                   const std::function<void(size_t begin, size_t end)>& Callback);
 
  private:
-  std::vector<Channel<std::function<void()>>> work_chans_;
-  std::vector<std::thread> threads_;
+  struct ParallelForCtx;
+  using Work = std::function<void()>;
+
+  void Submit(Work* work);
+  Work* TryGetWork(int32_t worker_id);
+  bool WaitForWork();
+  void WorkerLoop(int32_t worker_id);
+  void RunRange(const std::shared_ptr<ParallelForCtx>& ctx, size_t begin, size_t end);
+  bool TryRunPendingRange(const std::shared_ptr<ParallelForCtx>& ctx, bool largest);
+  int32_t CurWorkerId() const;
 
-  std::atomic<size_t> work_cnt_;
+  std::vector<std::unique_ptr<WorkStealingQueue<Work>>> local_queues_;
+  std::mutex global_queue_mutex_;
+  std::deque<Work*> global_queue_;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cond_;
+  std::atomic<int64_t> pending_work_cnt_;
+  std::atomic<int32_t> idle_thread_cnt_;
+  std::atomic<bool> closed_;
+  std::vector<std::thread> threads_;
 };
 
+// Calls Callback(begin, end) on sub-ranges covering [0, num) over Global<ThreadPool>, or once on
+// [0, num) in the calling thread if there is no pool, the pool has a single thread or num is at
+// most grain_size. Kernels which split their tasks by the shape only, never by the number of
+// threads, get the same results with any pool.
+void ParallelForTasks(int64_t num, int64_t grain_size,
+                      const std::function<void(int64_t begin, int64_t end)>& Callback);
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_THREAD_THREAD_POOL_H_
@@ -0,0 +1,153 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/common/cpu_test_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// set on a worker while it waits in a nested ParallelFor
+thread_local bool in_nested_parallel_for = false;
+
+void BusyWork(size_t i, size_t heavy_num) {
+  // uneven workload: the leading indices cost 32x more, e.g. large jpegs in a batch
+  const size_t rounds = i < heavy_num ? 32 * 1024 : 1024;
+  volatile double sum = 0;
+  FOR_RANGE(size_t, j, 0, rounds) { sum = sum + static_cast<double>(j) * 0.5; }
+}
+
+// The static splitting MultiThreadLoop used before work stealing
+void StaticSplitLoop(ThreadPool* thread_pool, size_t num,
+                     const std::function<void(size_t)>& Callback) {
+  const size_t thread_num = std::min<size_t>(num, thread_pool->thread_num());
+  BalancedSplitter bs(num, thread_num);
+  BlockingCounter bc(thread_num);
+  FOR_RANGE(size_t, range_id, 0, thread_num) {
+    thread_pool->AddWork([&bc, &bs, range_id, &Callback] {
+      FOR_RANGE(size_t, i, bs.At(range_id).begin(), bs.At(range_id).end()) { Callback(i); }
+      bc.Decrease();
+    });
+  }
+  bc.WaitUntilCntEqualZero();
+}
+
+}  // namespace
+
+TEST(ThreadPool, parallel_for_visits_each_index_once) {
+  ThreadPool thread_pool(4);
+  const size_t num = 10007;
+  std::vector<std::atomic<int32_t>> visits(num);
+  for (auto& visit : visits) { visit = 0; }
+  thread_pool.ParallelFor(num, 7, [&](size_t begin, size_t end) {
+    FOR_RANGE(size_t, i, begin, end) { visits.at(i).fetch_add(1); }
+  });
+  FOR_RANGE(size_t, i, 0, num) { ASSERT_EQ(visits.at(i).load(), 1); }
+}
+
+TEST(ThreadPool, nested_parallel_for) {
+  ThreadPool thread_pool(2);
+  const size_t outer_num = 16;
+  const size_t inner_num = 128;
+  std::atomic<size_t> cnt(0);
+  thread_pool.ParallelFor(outer_num, 1, [&](size_t begin, size_t end) {
+    FOR_RANGE(size_t, i, begin, end) {
+      thread_pool.ParallelFor(inner_num, 1, [&](size_t inner_begin, size_t inner_end) {
+        cnt.fetch_add(inner_end - inner_begin);
+      });
+    }
+  });
+  ASSERT_EQ(cnt.load(), outer_num * inner_num);
+}
+
+TEST(ThreadPool, nested_parallel_for_runs_only_its_own_ranges) {
+  ThreadPool thread_pool(2);
+  const int32_t unrelated_work_num = 8;
+  std::atomic<int32_t> unrelated_work_in_wait_cnt(0);
+  BlockingCounter bc(unrelated_work_num + 1);
+  thread_pool.AddWork([&]() {
+    FOR_RANGE(int32_t, i, 0, unrelated_work_num) {
+      thread_pool.AddWork([&]() {
+        if (in_nested_parallel_for) { unrelated_work_in_wait_cnt.fetch_add(1); }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        bc.Decrease();
+      });
+    }
+    in_nested_parallel_for = true;
+    thread_pool.ParallelFor(16, 1, [](size_t begin, size_t end) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    });
+    in_nested_parallel_for = false;
+    bc.Decrease();
+  });
+  bc.WaitUntilCntEqualZero();
+  ASSERT_EQ(unrelated_work_in_wait_cnt.load(), 0);
+}
+
+TEST(ThreadPool, single_thread_add_work_in_order) {
+  std::vector<int32_t> order;
+  {
+    ThreadPool thread_pool(1);
+    FOR_RANGE(int32_t, i, 0, 100) {
+      thread_pool.AddWork([&order, i]() { order.push_back(i); });
+    }
+  }
+  ASSERT_EQ(order.size(), 100);
+  FOR_RANGE(int32_t, i, 0, 100) { ASSERT_EQ(order.at(i), i); }
+}
+
+TEST(ThreadPool, parallel_for_tasks) {
+  const int64_t num = 1000;
+  std::vector<std::pair<int64_t, int64_t>> ranges;
+  // without the global pool, the whole range runs in the calling thread
+  ParallelForTasks(num, 1, [&](int64_t begin, int64_t end) { ranges.emplace_back(begin, end); });
+  ASSERT_EQ(ranges.size(), 1U);
+  ASSERT_EQ(ranges.at(0).first, 0);
+  ASSERT_EQ(ranges.at(0).second, num);
+  test::ThreadPoolScope thread_pool_scope(4);
+  std::vector<std::atomic<int32_t>> visits(num);
+  for (auto& visit : visits) { visit = 0; }
+  ParallelForTasks(num, 7, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) { visits.at(i).fetch_add(1); }
+  });
+  FOR_RANGE(int64_t, i, 0, num) { ASSERT_EQ(visits.at(i).load(), 1); }
+  // no more tasks than grain_size
+  ranges.clear();
+  ParallelForTasks(num, num, [&](int64_t begin, int64_t end) { ranges.emplace_back(begin, end); });
+  ASSERT_EQ(ranges.size(), 1U);
+}
+
+TEST(ThreadPool, DISABLED_benchmark_uneven_workload) {
+  const int32_t thread_num = std::max<int32_t>(std::thread::hardware_concurrency(), 2);
+  ThreadPool thread_pool(thread_num);
+  const size_t num = 64 * thread_num;
+  const size_t heavy_num = num / 8;
+  const double static_ms = test::MeasureMs([&]() {
+    StaticSplitLoop(&thread_pool, num, [heavy_num](size_t i) { BusyWork(i, heavy_num); });
+  });
+  const double stealing_ms = test::MeasureMs([&]() {
+    thread_pool.ParallelFor(num, 1, [heavy_num](size_t begin, size_t end) {
+      FOR_RANGE(size_t, i, begin, end) { BusyWork(i, heavy_num); }
+    });
+  });
+  LOG(INFO) << "uneven workload of " << num << " items on " << thread_num
+            << " threads: static split " << static_ms << " ms, work stealing " << stealing_ms
+            << " ms";
+}
+
+}  // namespace oneflow
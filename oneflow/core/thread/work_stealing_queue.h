@@ -0,0 +1,134 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_THREAD_WORK_STEALING_QUEUE_H_
+#define ONEFLOW_CORE_THREAD_WORK_STEALING_QUEUE_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Chase-Lev deque. The owner thread pushes and pops at the bottom, other threads steal from the
+// top. Memory orders follow "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et
+// al., PPoPP'13). Retired buffers are kept alive until destruction because a thief may still be
+// reading from them.
+template<typename T>
+class WorkStealingQueue final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WorkStealingQueue);
+  explicit WorkStealingQueue(int64_t log2_capacity = 8) : top_(0), bottom_(0) {
+    buffers_.emplace_back(new Buffer(log2_capacity));
+    buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+  }
+  ~WorkStealingQueue() = default;
+
+  // owner thread only
+  void Push(T* item) {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    if (b - t > buffer->capacity() - 1) { buffer = Grow(buffer, t, b); }
+    buffer->Put(b, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // owner thread only, returns nullptr if empty
+  T* Pop() {
+    const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T* item = buffer->Get(b);
+    if (t == b) {
+      // last item, race against thieves
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // any thread, returns nullptr if empty or if the race against another thief is lost
+  T* Steal() {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) { return nullptr; }
+    T* item = buffer_.load(std::memory_order_acquire)->Get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  bool Empty() const {
+    const int64_t b = bottom_.load(std::memory_order_relaxed);
+    const int64_t t = top_.load(std::memory_order_relaxed);
+    return b <= t;
+  }
+
+ private:
+  class Buffer final {
+   public:
+    OF_DISALLOW_COPY_AND_MOVE(Buffer);
+    explicit Buffer(int64_t log2_capacity)
+        : mask_((static_cast<int64_t>(1) << log2_capacity) - 1),
+          log2_capacity_(log2_capacity),
+          items_(new std::atomic<T*>[static_cast<size_t>(1) << log2_capacity]) {}
+    ~Buffer() = default;
+
+    int64_t capacity() const { return mask_ + 1; }
+    int64_t log2_capacity() const { return log2_capacity_; }
+    T* Get(int64_t i) const { return items_[i & mask_].load(std::memory_order_acquire); }
+    void Put(int64_t i, T* item) { items_[i & mask_].store(item, std::memory_order_release); }
+
+   private:
+    const int64_t mask_;
+    const int64_t log2_capacity_;
+    std::unique_ptr<std::atomic<T*>[]> items_;
+  };
+
+  Buffer* Grow(Buffer* old_buffer, int64_t t, int64_t b) {
+    buffers_.emplace_back(new Buffer(old_buffer->log2_capacity() + 1));
+    Buffer* new_buffer = buffers_.back().get();
+    for (int64_t i = t; i < b; ++i) { new_buffer->Put(i, old_buffer->Get(i)); }
+    buffer_.store(new_buffer, std::memory_order_release);
+    return new_buffer;
+  }
+
+  static constexpr size_t kCacheLineSize = 64;
+
+  // Thieves write top_ and the owner writes bottom_, the padding keeps them on separate cache
+  // lines without over-aligning the queue, which is allocated with plain new.
+  std::atomic<int64_t> top_;
+  char padding_[kCacheLineSize];
+  std::atomic<int64_t> bottom_;
+  std::atomic<Buffer*> buffer_;
+  // owned by the owner thread
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_THREAD_WORK_STEALING_QUEUE_H_
@@ -14,17 +14,364 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <cstdlib>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif  // __linux__
 #include "oneflow/core/vm/cpu_allocator.h"
 #include "oneflow/core/common/util.h"
 
 namespace oneflow {
 namespace vm {
 
+namespace {
+
+constexpr size_t kSmallClassMaxSize = 256;
+constexpr size_t kSmallClassNum = kSmallClassMaxSize / kHostAlignSize;
+constexpr size_t kClassNumPerPowerOfTwo = 4;
+constexpr size_t kHugePageSize = 2 << 20;                     // 2MiB
+constexpr size_t kThreadCacheMaxBlockSize = 256 << 10;        // 256KiB
+constexpr int64_t kDefaultMaxCachedSize = 64 << 20;           // 64MiB
+constexpr int64_t kDefaultThreadCacheBytes = 4 << 20;         // 4MiB
+constexpr int64_t kDefaultReleaseWatermarkBytes = 2LL << 30;  // 2GiB
+constexpr int64_t kDefaultThreadCacheTrimInterval = 65536;
+
+// Size classes:
+//   64, 128, 192, 256,
+//   320, 384, 448, 512,
+//   640, 768, 896, 1024, ...
+size_t ClassIndex4Size(size_t size) {
+  if (size <= kSmallClassMaxSize) { return RoundUp(size, kHostAlignSize) / kHostAlignSize - 1; }
+  const int32_t log2_floor = 63 ^ __builtin_clzll(size - 1);
+  const size_t step_log2 = log2_floor - 2;
+  const size_t k = ((size - 1 - (static_cast<size_t>(1) << log2_floor)) >> step_log2) + 1;
+  return kSmallClassNum - 1 + (log2_floor - 8) * kClassNumPerPowerOfTwo + k;
+}
+
+size_t ClassSize4ClassIndex(size_t class_index) {
+  if (class_index < kSmallClassNum) { return (class_index + 1) * kHostAlignSize; }
+  const size_t group = (class_index - kSmallClassNum) / kClassNumPerPowerOfTwo;
+  const size_t k = (class_index - kSmallClassNum) % kClassNumPerPowerOfTwo + 1;
+  const size_t log2_floor = group + 8;
+  return (static_cast<size_t>(1) << log2_floor) + (k << (log2_floor - 2));
+}
+
+}  // namespace
+
+double CpuAllocator::Stat::hit_rate() const {
+  if (allocate_cnt == 0) { return 0; }
+  return static_cast<double>(cache_hit_cnt) / allocate_cnt;
+}
+
+double CpuAllocator::Stat::fragmentation() const {
+  if (os_bytes == 0) { return 0; }
+  return 1.0 - static_cast<double>(requested_bytes) / os_bytes;
+}
+
+/*static*/ CpuAllocator::Options CpuAllocator::OptionsFromEnv() {
+  Options options;
+  options.max_cached_size =
+      ParseIntegerFromEnv("ONEFLOW_VM_CPU_ALLOCATOR_MAX_CACHED_SIZE", kDefaultMaxCachedSize);
+  options.thread_cache_bytes =
+      ParseIntegerFromEnv("ONEFLOW_VM_CPU_ALLOCATOR_THREAD_CACHE_BYTES", kDefaultThreadCacheBytes);
+  options.release_watermark_bytes = ParseIntegerFromEnv(
+      "ONEFLOW_VM_CPU_ALLOCATOR_RELEASE_WATERMARK_BYTES", kDefaultReleaseWatermarkBytes);
+  options.enable_thp = ParseBooleanFromEnv("ONEFLOW_VM_CPU_ALLOCATOR_ENABLE_THP", false);
+  options.thread_cache_trim_interval = ParseIntegerFromEnv(
+      "ONEFLOW_VM_CPU_ALLOCATOR_THREAD_CACHE_TRIM_INTERVAL", kDefaultThreadCacheTrimInterval);
+  return options;
+}
+
+struct CpuAllocator::CentralCache final {
+  explicit CentralCache(const Options& options)
+      : max_cached_size(options.max_cached_size),
+        thread_cache_bytes(options.thread_cache_bytes),
+        release_watermark_bytes(options.release_watermark_bytes),
+        enable_thp(options.enable_thp),
+        thread_cache_trim_interval(options.thread_cache_trim_interval),
+        class_num(max_cached_size > 0 ? ClassIndex4Size(max_cached_size) + 1 : 0),
+        bins(class_num),
+        allocate_cnt(0),
+        cache_hit_cnt(0),
+        os_allocate_cnt(0),
+        os_release_cnt(0),
+        os_bytes(0),
+        in_use_bytes(0),
+        requested_bytes(0),
+        cached_bytes(0) {
+    FOR_RANGE(size_t, i, 0, class_num) {
+      CHECK_EQ(ClassIndex4Size(ClassSize4ClassIndex(i)), i);
+      CHECK_EQ(ClassSize4ClassIndex(i) % kHostAlignSize, 0);
+    }
+  }
+
+  ~CentralCache() {
+    for (auto& bin : bins) {
+      for (char* ptr : bin) { std::free(ptr); }
+    }
+  }
+
+  bool IsCachedSize(size_t size) const { return static_cast<int64_t>(size) <= max_cached_size; }
+
+  size_t OsAlignment4Size(size_t size) const {
+    return enable_thp && size >= kHugePageSize ? kHugePageSize : kHostAlignSize;
+  }
+
+  char* AllocateFromOs(size_t size) {
+    const size_t alignment = OsAlignment4Size(size);
+    const size_t os_size = RoundUp(size, alignment);
+    char* ptr = reinterpret_cast<char*>(aligned_alloc(alignment, os_size));
+    CHECK(ptr != nullptr) << "Error! : Out of host memory when allocate size : " << size;
+#ifdef __linux__
+    if (alignment == kHugePageSize) { madvise(ptr, os_size, MADV_HUGEPAGE); }
+#endif  // __linux__
+    os_allocate_cnt.fetch_add(1, std::memory_order_relaxed);
+    os_bytes.fetch_add(os_size, std::memory_order_relaxed);
+    return ptr;
+  }
+
+  // size is the one passed to AllocateFromOs
+  void ReleaseToOs(char* ptr, size_t size) {
+    std::free(ptr);
+    os_release_cnt.fetch_add(1, std::memory_order_relaxed);
+    os_bytes.fetch_sub(RoundUp(size, OsAlignment4Size(size)), std::memory_order_relaxed);
+  }
+
+  char* TryPop(size_t class_index) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto* bin = &bins.at(class_index);
+    if (bin->empty()) { return nullptr; }
+    char* ptr = bin->back();
+    bin->pop_back();
+    return ptr;
+  }
+
+  void Push(size_t class_index, char* ptr) {
+    std::unique_lock<std::mutex> lock(mutex);
+    bins.at(class_index).push_back(ptr);
+    ReleaseAboveWatermark();
+  }
+
+  // requires mutex held, larger classes are released first
+  void ReleaseAboveWatermark() {
+    if (release_watermark_bytes < 0) { return; }
+    for (int64_t i = class_num - 1; i >= 0; --i) {
+      if (cached_bytes.load(std::memory_order_relaxed) <= release_watermark_bytes) { return; }
+      const size_t class_size = ClassSize4ClassIndex(i);
+      auto* bin = &bins.at(i);
+      while (!bin->empty()
+             && cached_bytes.load(std::memory_order_relaxed) > release_watermark_bytes) {
+        ReleaseToOs(bin->back(), class_size);
+        bin->pop_back();
+        cached_bytes.fetch_sub(class_size, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  const int64_t max_cached_size;
+  const int64_t thread_cache_bytes;
+  const int64_t release_watermark_bytes;
+  const bool enable_thp;
+  const int64_t thread_cache_trim_interval;
+  const size_t class_num;
+
+  std::mutex mutex;
+  std::vector<std::vector<char*>> bins;
+
+  // the thread caches of all threads, in front of the mutex of any thread cache in lock order
+  std::mutex thread_caches_mutex;
+  std::vector<ThreadCache*> thread_caches;
+
+  std::atomic<int64_t> allocate_cnt;
+  std::atomic<int64_t> cache_hit_cnt;
+  std::atomic<int64_t> os_allocate_cnt;
+  std::atomic<int64_t> os_release_cnt;
+  std::atomic<int64_t> os_bytes;
+  std::atomic<int64_t> in_use_bytes;
+  std::atomic<int64_t> requested_bytes;
+  std::atomic<int64_t> cached_bytes;
+};
+
+// ThreadCache outlives its CpuAllocator if the thread does, so it only keeps a weak reference to
+// the CentralCache and releases its memory to the OS when the CentralCache is gone. Its mutex is
+// only contended by trims, and never held while taking the mutex of the CentralCache.
+struct CpuAllocator::ThreadCache final {
+  ThreadCache(uint64_t allocator_uid, const std::shared_ptr<CentralCache>& central_cache)
+      : allocator_uid(allocator_uid),
+        central_cache(central_cache),
+        bins(central_cache->class_num),
+        cached_bytes(0),
+        is_idle(false) {
+    std::unique_lock<std::mutex> lock(central_cache->thread_caches_mutex);
+    central_cache->thread_caches.push_back(this);
+  }
+
+  ~ThreadCache() {
+    std::shared_ptr<CentralCache> central = central_cache.lock();
+    if (central) {
+      std::unique_lock<std::mutex> lock(central->thread_caches_mutex);
+      auto* thread_caches = &central->thread_caches;
+      thread_caches->erase(std::find(thread_caches->begin(), thread_caches->end(), this));
+    }
+    FOR_RANGE(size_t, i, 0, bins.size()) {
+      for (char* ptr : bins.at(i)) {
+        if (central) {
+          central->Push(i, ptr);
+        } else {
+          std::free(ptr);
+        }
+      }
+    }
+  }
+
+  // moves out every cached block, requires mutex held
+  std::vector<std::vector<char*>> TakeAll() {
+    std::vector<std::vector<char*>> ret(bins.size());
+    ret.swap(bins);
+    cached_bytes = 0;
+    return ret;
+  }
+
+  const uint64_t allocator_uid;
+  const std::weak_ptr<CentralCache> central_cache;
+  std::mutex mutex;
+  std::vector<std::vector<char*>> bins;
+  int64_t cached_bytes;
+  // unused since the last trim
+  bool is_idle;
+};
+
+CpuAllocator::CpuAllocator() : CpuAllocator(OptionsFromEnv()) {}
+
+CpuAllocator::CpuAllocator(const Options& options)
+    : Allocator(), uid_(NewUid()), central_cache_(std::make_shared<CentralCache>(options)) {}
+
+uint64_t CpuAllocator::NewUid() {
+  static std::atomic<uint64_t> uid(0);
+  return uid.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<std::unique_ptr<CpuAllocator::ThreadCache>>* CpuAllocator::MutThreadCaches() {
+  static thread_local std::vector<std::unique_ptr<ThreadCache>> thread_caches;
+  return &thread_caches;
+}
+
+CpuAllocator::ThreadCache* CpuAllocator::GetOrCreateThreadCache() {
+  auto* thread_caches = MutThreadCaches();
+  for (const auto& thread_cache : *thread_caches) {
+    if (thread_cache->allocator_uid == uid_) { return thread_cache.get(); }
+  }
+  // drop caches of destructed allocators
+  thread_caches->erase(std::remove_if(thread_caches->begin(), thread_caches->end(),
+                                      [](const std::unique_ptr<ThreadCache>& thread_cache) {
+                                        return thread_cache->central_cache.expired();
+                                      }),
+                       thread_caches->end());
+  thread_caches->emplace_back(new ThreadCache(uid_, central_cache_));
+  return thread_caches->back().get();
+}
+
 void CpuAllocator::Allocate(char** mem_ptr, std::size_t size) {
-  *mem_ptr = reinterpret_cast<char*>(aligned_alloc(kHostAlignSize, size));
+  if (size == 0) {
+    *mem_ptr = nullptr;
+    return;
+  }
+  CentralCache* central = central_cache_.get();
+  const int64_t allocate_cnt = central->allocate_cnt.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (central->thread_cache_trim_interval > 0
+      && allocate_cnt % central->thread_cache_trim_interval == 0) {
+    TrimIdleThreadCaches();
+  }
+  central->requested_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (!central->IsCachedSize(size)) {
+    const size_t aligned_size = RoundUp(size, kHostAlignSize);
+    *mem_ptr = central->AllocateFromOs(aligned_size);
+    central->in_use_bytes.fetch_add(aligned_size, std::memory_order_relaxed);
+    return;
+  }
+  const size_t class_index = ClassIndex4Size(size);
+  const size_t class_size = ClassSize4ClassIndex(class_index);
+  char* ptr = nullptr;
+  if (class_size <= kThreadCacheMaxBlockSize) {
+    ThreadCache* thread_cache = GetOrCreateThreadCache();
+    std::unique_lock<std::mutex> lock(thread_cache->mutex);
+    thread_cache->is_idle = false;
+    auto* bin = &thread_cache->bins.at(class_index);
+    if (!bin->empty()) {
+      ptr = bin->back();
+      bin->pop_back();
+      thread_cache->cached_bytes -= class_size;
+    }
+  }
+  if (ptr == nullptr) { ptr = central->TryPop(class_index); }
+  if (ptr != nullptr) {
+    central->cache_hit_cnt.fetch_add(1, std::memory_order_relaxed);
+    central->cached_bytes.fetch_sub(class_size, std::memory_order_relaxed);
+  } else {
+    ptr = central->AllocateFromOs(class_size);
+  }
+  central->in_use_bytes.fetch_add(class_size, std::memory_order_relaxed);
+  *mem_ptr = ptr;
 }
 
-void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) { std::free(mem_ptr); }
+void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) {
+  if (mem_ptr == nullptr) { return; }
+  CentralCache* central = central_cache_.get();
+  central->requested_bytes.fetch_sub(size, std::memory_order_relaxed);
+  if (!central->IsCachedSize(size)) {
+    const size_t aligned_size = RoundUp(size, kHostAlignSize);
+    central->in_use_bytes.fetch_sub(aligned_size, std::memory_order_relaxed);
+    central->ReleaseToOs(mem_ptr, aligned_size);
+    return;
+  }
+  const size_t class_index = ClassIndex4Size(size);
+  const size_t class_size = ClassSize4ClassIndex(class_index);
+  central->in_use_bytes.fetch_sub(class_size, std::memory_order_relaxed);
+  central->cached_bytes.fetch_add(class_size, std::memory_order_relaxed);
+  if (class_size <= kThreadCacheMaxBlockSize) {
+    ThreadCache* thread_cache = GetOrCreateThreadCache();
+    std::unique_lock<std::mutex> lock(thread_cache->mutex);
+    thread_cache->is_idle = false;
+    if (thread_cache->cached_bytes + class_size <= central->thread_cache_bytes) {
+      thread_cache->bins.at(class_index).push_back(mem_ptr);
+      thread_cache->cached_bytes += class_size;
+      return;
+    }
+  }
+  central->Push(class_index, mem_ptr);
+}
+
+void CpuAllocator::TrimIdleThreadCaches() {
+  CentralCache* central = central_cache_.get();
+  std::unique_lock<std::mutex> lock(central->thread_caches_mutex);
+  for (ThreadCache* thread_cache : central->thread_caches) {
+    std::vector<std::vector<char*>> taken_bins;
+    {
+      std::unique_lock<std::mutex> thread_cache_lock(thread_cache->mutex);
+      if (!thread_cache->is_idle) {
+        thread_cache->is_idle = true;
+        continue;
+      }
+      taken_bins = thread_cache->TakeAll();
+    }
+    FOR_RANGE(size_t, i, 0, taken_bins.size()) {
+      for (char* ptr : taken_bins.at(i)) { central->Push(i, ptr); }
+    }
+  }
+}
+
+CpuAllocator::Stat CpuAllocator::GetStat() const {
+  const CentralCache* central = central_cache_.get();
+  Stat stat;
+  stat.allocate_cnt = central->allocate_cnt.load(std::memory_order_relaxed);
+  stat.cache_hit_cnt = central->cache_hit_cnt.load(std::memory_order_relaxed);
+  stat.os_allocate_cnt = central->os_allocate_cnt.load(std::memory_order_relaxed);
+  stat.os_release_cnt = central->os_release_cnt.load(std::memory_order_relaxed);
+  stat.os_bytes = central->os_bytes.load(std::memory_order_relaxed);
+  stat.in_use_bytes = central->in_use_bytes.load(std::memory_order_relaxed);
+  stat.requested_bytes = central->requested_bytes.load(std::memory_order_relaxed);
+  stat.cached_bytes = central->cached_bytes.load(std::memory_order_relaxed);
+  return stat;
+}
 
 COMMAND(Global<CpuAllocator>::SetAllocated(new CpuAllocator()));
 
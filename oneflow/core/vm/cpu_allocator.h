@@ -17,18 +17,84 @@ limitations under the License.
 #define ONEFLOW_CORE_VM_CPU_ALLOCATOR_H_
 
 #include <cstdint>
+#include <memory>
+#include <vector>
 #include "oneflow/core/vm/allocator.h"
 
 namespace oneflow {
 namespace vm {
 
+// CpuAllocator caches freed host memory in size-class bins instead of returning it to the OS.
+//
+// Sizes up to 256 bytes are rounded up to multiples of kHostAlignSize, larger sizes are rounded
+// up to one of four classes per power of two, so the internal waste is at most 25%. Sizes larger
+// than the max cached size are allocated from and released to the OS directly.
+//
+// Freed memory first goes to a small per-thread cache, then to the central bins shared by all
+// threads. When the total cached bytes exceed the release watermark, the central bins give memory
+// back to the OS. Thread caches left unused between two trims hand their memory over to the
+// central bins, so that threads gone idle do not pin it.
+//
+// Options are read from the environment by the default constructor:
+//   ONEFLOW_VM_CPU_ALLOCATOR_MAX_CACHED_SIZE: largest cached allocation, default 64MiB
+//   ONEFLOW_VM_CPU_ALLOCATOR_THREAD_CACHE_BYTES: per-thread cache capacity, default 4MiB
+//   ONEFLOW_VM_CPU_ALLOCATOR_RELEASE_WATERMARK_BYTES: default 2GiB, negative to disable
+//   ONEFLOW_VM_CPU_ALLOCATOR_ENABLE_THP: madvise transparent huge pages, default false
+//   ONEFLOW_VM_CPU_ALLOCATOR_THREAD_CACHE_TRIM_INTERVAL: allocations between two trims of the
+//     idle thread caches, default 65536, non-positive to only trim on TrimIdleThreadCaches()
 class CpuAllocator final : public Allocator {
  public:
-  explicit CpuAllocator() = default;
+  struct Options {
+    int64_t max_cached_size;
+    int64_t thread_cache_bytes;
+    int64_t release_watermark_bytes;
+    bool enable_thp;
+    int64_t thread_cache_trim_interval;
+  };
+
+  struct Stat {
+    int64_t allocate_cnt = 0;
+    int64_t cache_hit_cnt = 0;
+    int64_t os_allocate_cnt = 0;
+    int64_t os_release_cnt = 0;
+    // bytes currently held from the OS, i.e. in_use_bytes + cached_bytes plus the padding of the
+    // allocations rounded up to huge pages
+    int64_t os_bytes = 0;
+    // size-class bytes handed out to users
+    int64_t in_use_bytes = 0;
+    // bytes the users asked for, at most in_use_bytes
+    int64_t requested_bytes = 0;
+    int64_t cached_bytes = 0;
+
+    double hit_rate() const;
+    // fraction of the bytes held from the OS that do not back user data
+    double fragmentation() const;
+  };
+
+  static Options OptionsFromEnv();
+
+  CpuAllocator();
+  explicit CpuAllocator(const Options& options);
   ~CpuAllocator() override = default;
 
   void Allocate(char** mem_ptr, std::size_t size) override;
   void Deallocate(char* mem_ptr, std::size_t size) override;
+
+  // Moves the memory of the thread caches unused since the last trim to the central bins
+  void TrimIdleThreadCaches();
+
+  Stat GetStat() const;
+
+ private:
+  struct CentralCache;
+  struct ThreadCache;
+
+  ThreadCache* GetOrCreateThreadCache();
+  static uint64_t NewUid();
+  static std::vector<std::unique_ptr<ThreadCache>>* MutThreadCaches();
+
+  const uint64_t uid_;
+  std::shared_ptr<CentralCache> central_cache_;
 };
 
 }  // namespace vm
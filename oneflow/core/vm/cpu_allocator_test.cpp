@@ -0,0 +1,197 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <future>
+#include "oneflow/core/vm/cpu_allocator.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace {
+
+CpuAllocator::Options TestOptions() {
+  CpuAllocator::Options options;
+  options.max_cached_size = 64 << 20;
+  options.thread_cache_bytes = 4 << 20;
+  options.release_watermark_bytes = -1;
+  options.enable_thp = false;
+  options.thread_cache_trim_interval = 0;
+  return options;
+}
+
+// Deallocates ptrs of size on a thread that stays alive until the returned promise is set
+std::thread DeallocateOnIdleThread(CpuAllocator* a, const std::vector<char*>& ptrs, size_t size,
+                                   std::promise<void>* exit_promise) {
+  std::promise<void> deallocated;
+  std::future<void> deallocated_future = deallocated.get_future();
+  std::future<void> exit_future = exit_promise->get_future();
+  std::thread thread(
+      [a, ptrs, size](std::promise<void> deallocated, std::future<void> exit_future) {
+        for (char* ptr : ptrs) { a->Deallocate(ptr, size); }
+        deallocated.set_value();
+        exit_future.wait();
+      },
+      std::move(deallocated), std::move(exit_future));
+  deallocated_future.wait();
+  return thread;
+}
+
+}  // namespace
+
+TEST(CpuAllocator, reuse_cached_memory) {
+  CpuAllocator a;
+  std::vector<char*> ptrs;
+  for (int i = 0; i < 512; ++i) {
+    char* ptr = nullptr;
+    a.Allocate(&ptr, 1000 + i);
+    ASSERT_TRUE(ptr != nullptr);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % kHostAlignSize, 0);
+    std::memset(ptr, i % 128, 1000 + i);
+    ptrs.push_back(ptr);
+  }
+  std::sort(ptrs.begin(), ptrs.end());
+  for (int i = 1; i < 512; ++i) { ASSERT_TRUE(ptrs.at(i) != ptrs.at(i - 1)); }
+  for (int i = 0; i < 512; ++i) { a.Deallocate(ptrs.at(i), 1000 + i); }
+  const CpuAllocator::Stat first_round = a.GetStat();
+  ASSERT_EQ(first_round.cache_hit_cnt, 0);
+  ASSERT_EQ(first_round.in_use_bytes, 0);
+  ASSERT_EQ(first_round.requested_bytes, 0);
+  ASSERT_EQ(first_round.os_bytes, first_round.cached_bytes);
+
+  for (int i = 0; i < 512; ++i) {
+    char* ptr = nullptr;
+    a.Allocate(&ptr, 1000 + i);
+    ptrs.at(i) = ptr;
+  }
+  const CpuAllocator::Stat second_round = a.GetStat();
+  ASSERT_EQ(second_round.cache_hit_cnt, 512);
+  ASSERT_EQ(second_round.os_allocate_cnt, first_round.os_allocate_cnt);
+  ASSERT_EQ(second_round.os_bytes, second_round.in_use_bytes + second_round.cached_bytes);
+  ASSERT_GT(second_round.fragmentation(), 0);
+  ASSERT_LT(second_round.fragmentation(), 0.25);
+  for (int i = 0; i < 512; ++i) { a.Deallocate(ptrs.at(i), 1000 + i); }
+}
+
+TEST(CpuAllocator, cross_thread_deallocate) {
+  CpuAllocator a;
+  const int32_t num = 1024;
+  std::vector<char*> ptrs(num);
+  std::thread producer([&]() {
+    for (int i = 0; i < num; ++i) { a.Allocate(&ptrs.at(i), 4096); }
+  });
+  producer.join();
+  std::thread consumer([&]() {
+    for (int i = 0; i < num; ++i) { a.Deallocate(ptrs.at(i), 4096); }
+  });
+  consumer.join();
+  // the consumer thread has exited, its thread cache went back to the central bins
+  for (int i = 0; i < num; ++i) { a.Allocate(&ptrs.at(i), 4096); }
+  const CpuAllocator::Stat stat = a.GetStat();
+  ASSERT_EQ(stat.cache_hit_cnt, num);
+  ASSERT_EQ(stat.os_allocate_cnt, num);
+  for (int i = 0; i < num; ++i) { a.Deallocate(ptrs.at(i), 4096); }
+}
+
+TEST(CpuAllocator, large_allocation_bypasses_cache) {
+  CpuAllocator a;
+  const size_t size = 256 << 20;
+  char* ptr = nullptr;
+  a.Allocate(&ptr, size);
+  ASSERT_TRUE(ptr != nullptr);
+  a.Deallocate(ptr, size);
+  const CpuAllocator::Stat stat = a.GetStat();
+  ASSERT_EQ(stat.os_release_cnt, 1);
+  ASSERT_EQ(stat.os_bytes, 0);
+  ASSERT_EQ(stat.cached_bytes, 0);
+}
+
+TEST(CpuAllocator, os_bytes_count_huge_page_padding) {
+  CpuAllocator::Options options = TestOptions();
+  options.enable_thp = true;
+  options.max_cached_size = 4 << 20;
+  CpuAllocator a(options);
+  // cached in the 3.5MiB class, taken from the OS as two huge pages
+  const size_t cached_size = (3 << 20) + 1;
+  // bypasses the cache, taken from the OS as three huge pages
+  const size_t large_size = (5 << 20) + 1;
+  const int64_t large_aligned_size = RoundUp(large_size, kHostAlignSize);
+  char* cached_ptr = nullptr;
+  char* large_ptr = nullptr;
+  a.Allocate(&cached_ptr, cached_size);
+  a.Allocate(&large_ptr, large_size);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(cached_ptr) % (2 << 20), 0);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(large_ptr) % (2 << 20), 0);
+  CpuAllocator::Stat stat = a.GetStat();
+  ASSERT_EQ(stat.in_use_bytes, (7 << 19) + large_aligned_size);
+  ASSERT_EQ(stat.os_bytes, (4 << 20) + (6 << 20));
+  ASSERT_GT(stat.os_bytes, stat.in_use_bytes + stat.cached_bytes);
+  a.Deallocate(large_ptr, large_size);
+  a.Deallocate(cached_ptr, cached_size);
+  stat = a.GetStat();
+  ASSERT_EQ(stat.os_bytes, 4 << 20);
+  ASSERT_EQ(stat.cached_bytes, 7 << 19);
+}
+
+TEST(CpuAllocator, trim_idle_thread_caches) {
+  CpuAllocator::Options options = TestOptions();
+  // thread caches are exempt from the watermark, the central bins keep nothing
+  options.release_watermark_bytes = 0;
+  CpuAllocator a(options);
+  const int32_t num = 256;
+  const size_t size = 4096;
+  const int64_t bytes = num * size;
+  std::vector<char*> ptrs(num);
+  for (int i = 0; i < num; ++i) { a.Allocate(&ptrs.at(i), size); }
+  std::promise<void> exit_promise;
+  std::thread idle_thread = DeallocateOnIdleThread(&a, ptrs, size, &exit_promise);
+  ASSERT_EQ(a.GetStat().os_bytes, bytes);
+  // the first trim only marks the thread cache idle
+  a.TrimIdleThreadCaches();
+  ASSERT_EQ(a.GetStat().os_bytes, bytes);
+  a.TrimIdleThreadCaches();
+  const CpuAllocator::Stat stat = a.GetStat();
+  ASSERT_EQ(stat.os_bytes, 0);
+  ASSERT_EQ(stat.cached_bytes, 0);
+  ASSERT_EQ(stat.os_release_cnt, num);
+  exit_promise.set_value();
+  idle_thread.join();
+}
+
+TEST(CpuAllocator, trim_every_interval) {
+  CpuAllocator::Options options = TestOptions();
+  options.thread_cache_trim_interval = 64;
+  CpuAllocator a(options);
+  const int32_t num = 256;
+  std::vector<char*> ptrs(num);
+  for (int i = 0; i < num; ++i) { a.Allocate(&ptrs.at(i), 4096); }
+  std::promise<void> exit_promise;
+  std::thread idle_thread = DeallocateOnIdleThread(&a, ptrs, 4096, &exit_promise);
+  // other allocations trim the idle thread cache, whose memory then serves this thread
+  for (int i = 0; i < 128; ++i) {
+    char* ptr = nullptr;
+    a.Allocate(&ptr, 64);
+    a.Deallocate(ptr, 64);
+  }
+  for (int i = 0; i < num; ++i) { a.Allocate(&ptrs.at(i), 4096); }
+  const CpuAllocator::Stat stat = a.GetStat();
+  ASSERT_EQ(stat.os_allocate_cnt, num + 1);
+  for (int i = 0; i < num; ++i) { a.Deallocate(ptrs.at(i), 4096); }
+  exit_promise.set_value();
+  idle_thread.join();
+}
+
+}  // namespace vm
+}  // namespace oneflow
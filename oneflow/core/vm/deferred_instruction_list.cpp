@@ -0,0 +1,84 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/deferred_instruction_list.h"
+
+namespace oneflow {
+namespace vm {
+
+DeferredInstructionList::DeferredInstructionList(
+    int64_t max_batch_size, const std::function<Maybe<void>(InstructionMsgList*)>& Submit)
+    : max_batch_size_(max_batch_size), Submit_(Submit) {}
+
+DeferredInstructionList::~DeferredInstructionList() {
+  // Whoever waits on the results of the pending instructions would hang if they were dropped
+  const auto& ret = TRY(Flush());
+  if (!ret.IsOk()) { LOG(WARNING) << "failed to flush deferred instructions"; }
+}
+
+size_t DeferredInstructionList::size() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return instruction_list_.size();
+}
+
+Maybe<void> DeferredInstructionList::Defer(InstructionMsgList* instr_msg_list) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const std::thread::id this_thread = std::this_thread::get_id();
+  if (owner_ != this_thread) {
+    JUST(FlushLocked());
+    owner_ = this_thread;
+  }
+  instr_msg_list->MoveTo(&instruction_list_);
+  if (static_cast<int64_t>(instruction_list_.size()) >= max_batch_size_) { JUST(FlushLocked()); }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> DeferredInstructionList::Submit(InstructionMsgList* instr_msg_list) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!instruction_list_.empty()) {
+      // The lock is held while submitting, so that nothing issued by a thread taking it later
+      // overtakes the deferred instructions
+      InstructionMsgList batch;
+      instruction_list_.MoveTo(&batch);
+      instr_msg_list->MoveTo(&batch);
+      return Submit_(&batch);
+    }
+  }
+  // Nothing is deferred, so there is no order to keep with other threads. Submitting without the
+  // lock keeps threads blocked in the vm high water mark from stalling the others.
+  return Submit_(instr_msg_list);
+}
+
+Maybe<void> DeferredInstructionList::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return FlushLocked();
+}
+
+Maybe<void> DeferredInstructionList::FlushIfOwnedByThisThread() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (owner_ != std::this_thread::get_id()) { return Maybe<void>::Ok(); }
+  return FlushLocked();
+}
+
+Maybe<void> DeferredInstructionList::FlushLocked() {
+  if (instruction_list_.empty()) { return Maybe<void>::Ok(); }
+  InstructionMsgList batch;
+  instruction_list_.MoveTo(&batch);
+  return Submit_(&batch);
+}
+
+}  // namespace vm
+}  // namespace oneflow
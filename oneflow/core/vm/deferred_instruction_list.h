@@ -0,0 +1,69 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_DEFERRED_INSTRUCTION_LIST_H_
+#define ONEFLOW_CORE_VM_DEFERRED_INSTRUCTION_LIST_H_
+
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/vm/instruction.msg.h"
+
+namespace oneflow {
+namespace vm {
+
+// Instructions held back to hand them to the vm in batches. Deferred instructions always go to
+// Submit ahead of instructions submitted later through the same list, and are flushed when the
+// list is destroyed at the latest.
+//
+// One list is shared by all the issuing threads, and the instructions it holds are those of a
+// single thread, its owner. Whatever another thread defers or submits goes after the instructions
+// of the owner, so tensors written by deferred instructions may be handed to or released on any
+// thread: the instructions using them there always reach the vm after their producers.
+class DeferredInstructionList final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(DeferredInstructionList);
+  DeferredInstructionList(int64_t max_batch_size,
+                          const std::function<Maybe<void>(InstructionMsgList*)>& Submit);
+  ~DeferredInstructionList();
+
+  size_t size() const;
+
+  // Keeps the instructions of instr_msg_list, flushes once max_batch_size of them are pending or
+  // when they come from a thread other than the owner
+  Maybe<void> Defer(InstructionMsgList* instr_msg_list);
+  // Submits the deferred instructions followed by instr_msg_list in one batch
+  Maybe<void> Submit(InstructionMsgList* instr_msg_list);
+  Maybe<void> Flush();
+  // Flushes only if the calling thread owns the deferred instructions, e.g. when it exits
+  Maybe<void> FlushIfOwnedByThisThread();
+
+ private:
+  // with mutex_ held
+  Maybe<void> FlushLocked();
+
+  const int64_t max_batch_size_;
+  const std::function<Maybe<void>(InstructionMsgList*)> Submit_;
+  mutable std::mutex mutex_;
+  std::thread::id owner_;
+  InstructionMsgList instruction_list_;
+};
+
+}  // namespace vm
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_VM_DEFERRED_INSTRUCTION_LIST_H_
@@ -0,0 +1,180 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <thread>
+#include "oneflow/core/vm/deferred_instruction_list.h"
+#include "oneflow/core/vm/vm_util.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace vm {
+namespace test {
+
+namespace {
+
+// Stands in for the vm: keeps every submitted instruction and the size of each batch
+struct FakeVm {
+  std::function<Maybe<void>(InstructionMsgList*)> MakeSubmit() {
+    return [this](InstructionMsgList* instr_msg_list) -> Maybe<void> {
+      batch_sizes.push_back(instr_msg_list->size());
+      instr_msg_list->MoveTo(&received);
+      return Maybe<void>::Ok();
+    };
+  }
+  std::vector<InstructionMsg*> ReceivedInstructions() {
+    std::vector<InstructionMsg*> ret;
+    OBJECT_MSG_LIST_FOR_EACH_PTR(&received, instr_msg) { ret.push_back(instr_msg); }
+    return ret;
+  }
+
+  std::vector<size_t> batch_sizes;
+  InstructionMsgList received;
+};
+
+InstructionMsg* PushNop(InstructionMsgList* list) {
+  auto instr_msg = NewInstruction("Nop");
+  list->PushBack(instr_msg.Mutable());
+  return instr_msg.Mutable();
+}
+
+}  // namespace
+
+TEST(DeferredInstructionList, defer_until_max_batch_size) {
+  FakeVm fake_vm;
+  DeferredInstructionList deferred_list(4, fake_vm.MakeSubmit());
+  std::vector<InstructionMsg*> issued;
+  FOR_RANGE(int, i, 0, 3) {
+    InstructionMsgList list;
+    issued.push_back(PushNop(&list));
+    CHECK_JUST(deferred_list.Defer(&list));
+    ASSERT_TRUE(list.empty());
+  }
+  ASSERT_EQ(deferred_list.size(), 3U);
+  ASSERT_TRUE(fake_vm.batch_sizes.empty());
+  InstructionMsgList list;
+  issued.push_back(PushNop(&list));
+  CHECK_JUST(deferred_list.Defer(&list));
+  ASSERT_EQ(deferred_list.size(), 0U);
+  ASSERT_EQ(fake_vm.batch_sizes, std::vector<size_t>({4}));
+  ASSERT_EQ(fake_vm.ReceivedInstructions(), issued);
+}
+
+// PhysicalRun, syncs and ops creating eager symbols all end in vm::Run, i.e. Submit
+TEST(DeferredInstructionList, submit_after_deferred) {
+  FakeVm fake_vm;
+  DeferredInstructionList deferred_list(64, fake_vm.MakeSubmit());
+  std::vector<InstructionMsg*> issued;
+  FOR_RANGE(int, i, 0, 2) {
+    InstructionMsgList list;
+    issued.push_back(PushNop(&list));
+    CHECK_JUST(deferred_list.Defer(&list));
+  }
+  InstructionMsgList list;
+  issued.push_back(PushNop(&list));
+  issued.push_back(PushNop(&list));
+  CHECK_JUST(deferred_list.Submit(&list));
+  ASSERT_EQ(deferred_list.size(), 0U);
+  ASSERT_EQ(fake_vm.batch_sizes, std::vector<size_t>({4}));
+  ASSERT_EQ(fake_vm.ReceivedInstructions(), issued);
+  CHECK_JUST(deferred_list.Submit(&list));
+  ASSERT_EQ(fake_vm.batch_sizes, std::vector<size_t>({4, 0}));
+}
+
+TEST(DeferredInstructionList, flush) {
+  FakeVm fake_vm;
+  DeferredInstructionList deferred_list(64, fake_vm.MakeSubmit());
+  CHECK_JUST(deferred_list.Flush());
+  ASSERT_TRUE(fake_vm.batch_sizes.empty());
+  InstructionMsgList list;
+  PushNop(&list);
+  PushNop(&list);
+  CHECK_JUST(deferred_list.Defer(&list));
+  CHECK_JUST(deferred_list.Flush());
+  ASSERT_EQ(fake_vm.batch_sizes, std::vector<size_t>({2}));
+  CHECK_JUST(deferred_list.Flush());
+  ASSERT_EQ(fake_vm.batch_sizes, std::vector<size_t>({2}));
+}
+
+TEST(DeferredInstructionList, flush_at_destruction) {
+  FakeVm fake_vm;
+  {
+    DeferredInstructionList deferred_list(64, fake_vm.MakeSubmit());
+    InstructionMsgList list;
+    PushNop(&list);
+    CHECK_JUST(deferred_list.Defer(&list));
+  }
+  ASSERT_EQ(fake_vm.batch_sizes, std::vector<size_t>({1}));
+}
+
+// a tensor written by the deferred instructions of one thread and used on another
+TEST(DeferredInstructionList, other_threads_go_after_deferred) {
+  FakeVm fake_vm;
+  DeferredInstructionList deferred_list(64, fake_vm.MakeSubmit());
+  std::vector<InstructionMsg*> issued;
+  auto DeferTwoOnThread = [&]() {
+    std::thread thread([&]() {
+      InstructionMsgList list;
+      issued.push_back(PushNop(&list));
+      issued.push_back(PushNop(&list));
+      CHECK_JUST(deferred_list.Defer(&list));
+    });
+    thread.join();
+  };
+  DeferTwoOnThread();
+  {
+    InstructionMsgList list;
+    issued.push_back(PushNop(&list));
+    CHECK_JUST(deferred_list.Defer(&list));
+  }
+  ASSERT_EQ(fake_vm.batch_sizes, std::vector<size_t>({2}));
+  ASSERT_EQ(deferred_list.size(), 1U);
+  CHECK_JUST(deferred_list.Flush());
+  DeferTwoOnThread();
+  {
+    InstructionMsgList list;
+    issued.push_back(PushNop(&list));
+    CHECK_JUST(deferred_list.Submit(&list));
+  }
+  ASSERT_EQ(fake_vm.batch_sizes, std::vector<size_t>({2, 1, 3}));
+  ASSERT_EQ(fake_vm.ReceivedInstructions(), issued);
+}
+
+TEST(DeferredInstructionList, flush_if_owned_by_this_thread) {
+  FakeVm fake_vm;
+  DeferredInstructionList deferred_list(64, fake_vm.MakeSubmit());
+  InstructionMsgList list;
+  PushNop(&list);
+  CHECK_JUST(deferred_list.Defer(&list));
+  std::thread exiting_thread([&]() {
+    CHECK_JUST(deferred_list.FlushIfOwnedByThisThread());
+    ASSERT_EQ(deferred_list.size(), 1U);
+    InstructionMsgList thread_list;
+    PushNop(&thread_list);
+    CHECK_JUST(deferred_list.Defer(&thread_list));
+    CHECK_JUST(deferred_list.FlushIfOwnedByThisThread());
+    ASSERT_EQ(deferred_list.size(), 0U);
+  });
+  exiting_thread.join();
+  ASSERT_EQ(fake_vm.batch_sizes, std::vector<size_t>({1, 1}));
+  PushNop(&list);
+  CHECK_JUST(deferred_list.Defer(&list));
+  std::thread other_thread([&]() { CHECK_JUST(deferred_list.FlushIfOwnedByThisThread()); });
+  other_thread.join();
+  ASSERT_EQ(deferred_list.size(), 1U);
+}
+
+}  // namespace test
+}  // namespace vm
+}  // namespace oneflow
@@ -0,0 +1,82 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <chrono>
+#include "oneflow/core/vm/vm_util.h"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/vm/virtual_machine.msg.h"
+#include "oneflow/core/vm/vm_desc.msg.h"
+#include "oneflow/core/vm/test_util.h"
+
+namespace oneflow {
+namespace vm {
+namespace test {
+
+namespace {
+
+void RunUntilEmpty(VirtualMachine* vm) {
+  while (!vm->Empty()) {
+    vm->Schedule();
+    OBJECT_MSG_LIST_FOR_EACH_PTR(vm->mut_thread_ctx_list(), t) { t->TryReceiveAndRun(); }
+  }
+}
+
+// Issues op_num Nop instructions mutating the same object, submitting batch_size of them per
+// Receive the way deferred eager submission does, and returns the ops/second. The vm is drained
+// every kDrainInterval ops so that it never reaches the instruction high water mark.
+double MeasureOpsPerSecond(int64_t op_num, int64_t batch_size) {
+  const int64_t kDrainInterval = 256;
+  auto vm_desc = ObjectMsgPtr<VmDesc>::New(TestUtil::NewVmResourceDesc().Get());
+  TestUtil::AddStreamDescByInstrNames(vm_desc.Mutable(), {"Nop", "NewObject"});
+  auto vm = ObjectMsgPtr<VirtualMachine>::New(vm_desc.Get());
+  InstructionMsgList list;
+  const int64_t object_id = TestUtil::NewObject(&list, "cpu", "0:0");
+  CHECK_JUST(vm->Receive(&list));
+  RunUntilEmpty(vm.Mutable());
+  const auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int64_t, i, 0, op_num) {
+    auto instr_msg = NewInstruction("Nop");
+    instr_msg->add_mut_operand(object_id);
+    list.EmplaceBack(std::move(instr_msg));
+    if (static_cast<int64_t>(list.size()) == batch_size || i + 1 == op_num) {
+      CHECK_JUST(vm->Receive(&list));
+    }
+    if ((i + 1) % kDrainInterval == 0) { RunUntilEmpty(vm.Mutable()); }
+  }
+  RunUntilEmpty(vm.Mutable());
+  const auto end = std::chrono::steady_clock::now();
+  CHECK(list.empty());
+  return op_num / std::chrono::duration<double>(end - start).count();
+}
+
+}  // namespace
+
+TEST(InstructionBatchSubmit, all_instructions_done) {
+  TestResourceDescScope scope(1, 1);
+  for (int64_t batch_size : {1, 7, 64}) { MeasureOpsPerSecond(1000, batch_size); }
+}
+
+TEST(InstructionBatchSubmit, DISABLED_benchmark_ops_per_second) {
+  TestResourceDescScope scope(1, 1);
+  const int64_t op_num = 100000;
+  for (int64_t batch_size : {1, 8, 64, 256}) {
+    LOG(INFO) << "batch size " << batch_size << ": " << MeasureOpsPerSecond(op_num, batch_size)
+              << " ops/s";
+  }
+}
+
+}  // namespace test
+}  // namespace vm
+}  // namespace oneflow
@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <chrono>
 #include <typeinfo>
 #include "oneflow/core/vm/oneflow_vm.h"
 #include "oneflow/core/vm/instruction.msg.h"
@@ -127,15 +128,68 @@ void ControlSync(vm::VirtualMachine* vm) {
 OneflowVM::~OneflowVM() {
   ControlSync(mut_vm());
   exiting_ = true;
+  mut_vm()->mut_scheduler_notifier()->Notify();
   schedule_thread_.join();
   CHECK(!vm_);
 }
 
+namespace {
+
+// Rounds of scheduling without progress keep spinning for this long before the scheduler parks,
+// negative to never park
+int64_t SchedulerSpinMicroseconds() {
+  static const int64_t spin_us = ParseIntegerFromEnv("ONEFLOW_VM_SCHEDULER_SPIN_US", 100);
+  return spin_us;
+}
+
+// While instructions are in flight, completions of asynchronous streams (e.g. cuda events) are
+// not notified, so the parked scheduler wakes up to poll them at this interval
+int64_t SchedulerPollMicroseconds() {
+  static const int64_t poll_us = ParseIntegerFromEnv("ONEFLOW_VM_SCHEDULER_POLL_US", 50);
+  return poll_us;
+}
+
+void LogSchedulerStat(const vm::SchedulerNotifier::Stat& stat) {
+  LOG(INFO) << "vm scheduler: idle " << stat.idle_percentage() << "%, " << stat.park_cnt
+            << " parks, " << stat.wakeup_cnt << " wakeups of avg latency "
+            << stat.avg_wakeup_latency_us() << " us and max latency "
+            << stat.wakeup_latency_ns_max / 1000.0 << " us, " << stat.notify_cnt << " notifies";
+}
+
+}  // namespace
+
 void OneflowVM::Loop(const std::function<void()>& Initializer) {
   Initializer();
   auto* vm = mut_vm();
-  while (!exiting_) { vm->Schedule(); }
+  auto* notifier = vm->mut_scheduler_notifier();
+  const int64_t spin_us = SchedulerSpinMicroseconds();
+  const int64_t poll_us = SchedulerPollMicroseconds();
+  auto spin_begin = std::chrono::steady_clock::now();
+  while (true) {
+    // reads the epoch before exiting_, so a Notify() after exiting_ is set always wakes us up
+    const int64_t epoch = notifier->epoch();
+    if (exiting_) { break; }
+    const bool has_pending_msg = vm->pending_msg_list().size() > 0;
+    const int64_t flying_instruction_cnt = vm->flying_instruction_cnt();
+    vm->Schedule();
+    if (spin_us < 0 || has_pending_msg || vm->flying_instruction_cnt() != flying_instruction_cnt) {
+      spin_begin = std::chrono::steady_clock::now();
+      continue;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration_cast<std::chrono::microseconds>(now - spin_begin).count() < spin_us) {
+      continue;
+    }
+    // parks until notified when idle, polls in flight instructions otherwise. A timeout keeps
+    // spin_begin, so an unproductive poll parks again right away.
+    if (notifier->WaitUntilNotified(epoch, vm->Empty() ? -1 : poll_us)) {
+      spin_begin = std::chrono::steady_clock::now();
+    }
+  }
   while (!mut_vm()->Empty()) { vm->Schedule(); }
+  if (ParseBooleanFromEnv("ONEFLOW_VM_SCHEDULER_LOG_STAT", false)) {
+    LogSchedulerStat(notifier->GetStat());
+  }
   CHECK_JUST(ForEachThreadCtx(vm_.Mutable(), [&](vm::ThreadCtx* thread_ctx) -> Maybe<void> {
     thread_ctx->mut_pending_instruction_list()->Close();
     return Maybe<void>::Ok();
@@ -0,0 +1,110 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <chrono>
+#include "oneflow/core/vm/scheduler_notifier.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+double SchedulerNotifier::Stat::avg_wakeup_latency_us() const {
+  if (wakeup_cnt == 0) { return 0; }
+  return static_cast<double>(wakeup_latency_ns_sum) / wakeup_cnt / 1000;
+}
+
+double SchedulerNotifier::Stat::idle_percentage() const {
+  if (elapsed_ns == 0) { return 0; }
+  return 100.0 * parked_ns / elapsed_ns;
+}
+
+SchedulerNotifier::SchedulerNotifier()
+    : epoch_(0),
+      parked_(false),
+      last_notify_ns_(0),
+      start_ns_(NowNs()),
+      notify_cnt_(0),
+      park_cnt_(0),
+      wakeup_cnt_(0),
+      wakeup_latency_ns_sum_(0),
+      wakeup_latency_ns_max_(0),
+      parked_ns_(0) {}
+
+void SchedulerNotifier::Notify() {
+  notify_cnt_.fetch_add(1, std::memory_order_relaxed);
+  // pairs with the parked_ store and the epoch_ load in WaitUntilNotified, so either the
+  // scheduler sees the new epoch or we see it parked
+  epoch_.fetch_add(1);
+  if (parked_.load()) {
+    last_notify_ns_.store(NowNs(), std::memory_order_relaxed);
+    { std::unique_lock<std::mutex> lock(mutex_); }
+    cond_.notify_one();
+  }
+}
+
+bool SchedulerNotifier::WaitUntilNotified(int64_t epoch, int64_t timeout_us) {
+  const auto IsNotified = [&]() { return epoch_.load() != epoch; };
+  const int64_t park_begin_ns = NowNs();
+  bool notified = false;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    parked_.store(true);
+    if (timeout_us < 0) {
+      cond_.wait(lock, IsNotified);
+      notified = true;
+    } else {
+      notified = cond_.wait_for(lock, std::chrono::microseconds(timeout_us), IsNotified);
+    }
+    parked_.store(false);
+  }
+  const int64_t park_end_ns = NowNs();
+  park_cnt_.fetch_add(1, std::memory_order_relaxed);
+  parked_ns_.fetch_add(park_end_ns - park_begin_ns, std::memory_order_relaxed);
+  const int64_t notify_ns = last_notify_ns_.load(std::memory_order_relaxed);
+  if (notified && notify_ns > park_begin_ns) {
+    const int64_t latency_ns = park_end_ns - notify_ns;
+    wakeup_cnt_.fetch_add(1, std::memory_order_relaxed);
+    wakeup_latency_ns_sum_.fetch_add(latency_ns, std::memory_order_relaxed);
+    wakeup_latency_ns_max_.store(
+        std::max(wakeup_latency_ns_max_.load(std::memory_order_relaxed), latency_ns),
+        std::memory_order_relaxed);
+  }
+  return notified;
+}
+
+SchedulerNotifier::Stat SchedulerNotifier::GetStat() const {
+  Stat stat;
+  stat.notify_cnt = notify_cnt_.load(std::memory_order_relaxed);
+  stat.park_cnt = park_cnt_.load(std::memory_order_relaxed);
+  stat.wakeup_cnt = wakeup_cnt_.load(std::memory_order_relaxed);
+  stat.wakeup_latency_ns_sum = wakeup_latency_ns_sum_.load(std::memory_order_relaxed);
+  stat.wakeup_latency_ns_max = wakeup_latency_ns_max_.load(std::memory_order_relaxed);
+  stat.parked_ns = parked_ns_.load(std::memory_order_relaxed);
+  stat.elapsed_ns = NowNs() - start_ns_;
+  return stat;
+}
+
+}  // namespace vm
+}  // namespace oneflow
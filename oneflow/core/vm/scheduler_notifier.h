@@ -0,0 +1,83 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_VM_SCHEDULER_NOTIFIER_H_
+#define ONEFLOW_CORE_VM_SCHEDULER_NOTIFIER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace oneflow {
+namespace vm {
+
+// SchedulerNotifier lets the scheduler thread park while the virtual machine has nothing to do.
+//
+// Every Notify() bumps an epoch. The scheduler reads the epoch before a round of scheduling and,
+// if the round made no progress, waits until the epoch moves on. Notify() only takes the mutex
+// when the scheduler is parked, so producers pay an atomic increment on the fast path.
+class SchedulerNotifier final {
+ public:
+  struct Stat {
+    int64_t notify_cnt = 0;
+    int64_t park_cnt = 0;
+    // parks ended by Notify() rather than by the timeout
+    int64_t wakeup_cnt = 0;
+    // from the Notify() to the parked scheduler running again
+    int64_t wakeup_latency_ns_sum = 0;
+    int64_t wakeup_latency_ns_max = 0;
+    int64_t parked_ns = 0;
+    int64_t elapsed_ns = 0;
+
+    double avg_wakeup_latency_us() const;
+    double idle_percentage() const;
+  };
+
+  SchedulerNotifier(const SchedulerNotifier&) = delete;
+  SchedulerNotifier(SchedulerNotifier&&) = delete;
+  SchedulerNotifier();
+  ~SchedulerNotifier() = default;
+
+  int64_t epoch() const { return epoch_.load(); }
+
+  void Notify();
+  // Blocks until the epoch differs from `epoch' or timeout_us passes, a negative timeout_us waits
+  // forever. Returns false on timeout.
+  bool WaitUntilNotified(int64_t epoch, int64_t timeout_us);
+
+  Stat GetStat() const;
+
+ private:
+  std::atomic<int64_t> epoch_;
+  std::atomic<bool> parked_;
+  std::atomic<int64_t> last_notify_ns_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  const int64_t start_ns_;
+
+  std::atomic<int64_t> notify_cnt_;
+  // written by the scheduler thread only
+  std::atomic<int64_t> park_cnt_;
+  std::atomic<int64_t> wakeup_cnt_;
+  std::atomic<int64_t> wakeup_latency_ns_sum_;
+  std::atomic<int64_t> wakeup_latency_ns_max_;
+  std::atomic<int64_t> parked_ns_;
+};
+
+}  // namespace vm
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_VM_SCHEDULER_NOTIFIER_H_
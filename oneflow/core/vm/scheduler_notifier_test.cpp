@@ -0,0 +1,129 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <thread>
+#include "oneflow/core/vm/scheduler_notifier.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/common/cpu_test_util.h"
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/control/ctrl_bootstrap.pb.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/vm/no_arg_cb_phy_instr_operand.h"
+#include "oneflow/core/vm/oneflow_vm.h"
+#include "oneflow/core/vm/test_util.h"
+#include "oneflow/core/vm/virtual_machine_scope.h"
+#include "oneflow/core/vm/vm_util.h"
+
+namespace oneflow {
+namespace vm {
+namespace test {
+
+namespace {
+
+// A Global<OneflowVM> of a single process with a cpu device, whose scheduler thread runs
+// OneflowVM::Loop
+class OneflowVMScope final {
+ public:
+  OneflowVMScope(const OneflowVMScope&) = delete;
+  OneflowVMScope(OneflowVMScope&&) = delete;
+  OneflowVMScope() {
+    *Global<Maybe<bool>, MultiClient>::Get() = false;
+    resource_desc_scope_.reset(new TestResourceDescScope(0, 1));
+    virtual_machine_scope_.reset(
+        new VirtualMachineScope(Global<ResourceDesc, ForSession>::Get()->resource()));
+  }
+  ~OneflowVMScope() {
+    virtual_machine_scope_.reset();
+    resource_desc_scope_.reset();
+    Global<Maybe<bool>, MultiClient>::SetAllocated(
+        new Maybe<bool>(Error::InvalidValueError("is_multi_client is not set")));
+  }
+
+  SchedulerNotifier::Stat GetStat() const {
+    return Global<OneflowVM>::Get()->mut_vm()->mut_scheduler_notifier()->GetStat();
+  }
+
+ private:
+  std::unique_ptr<TestResourceDescScope> resource_desc_scope_;
+  std::unique_ptr<VirtualMachineScope> virtual_machine_scope_;
+};
+
+// Runs a Nop through vm::Run and waits until a callback instruction after it is done
+void RunNopAndWait() {
+  BlockingCounter bc(1);
+  InstructionMsgList list;
+  list.EmplaceBack(NewInstruction("Nop"));
+  auto callback = NewInstruction("CtrlComputeRankFrontSeqCallback");
+  callback->add_int64_operand(GlobalProcessCtx::Rank());
+  *callback->mutable_phy_instr_operand() =
+      std::make_shared<NoArgCbPhyInstrOperand>([&bc]() { bc.Decrease(); });
+  list.EmplaceBack(std::move(callback));
+  CHECK_JUST(Run(&list));
+  bc.WaitUntilCntEqualZero();
+}
+
+// Runs op_num Nops one by one with gap_us between them, returns the average round trip in us
+double MeasureRoundTripUs(int64_t op_num, int64_t gap_us) {
+  double round_trip_ms_sum = 0;
+  FOR_RANGE(int64_t, i, 0, op_num) {
+    std::this_thread::sleep_for(std::chrono::microseconds(gap_us));
+    round_trip_ms_sum += MeasureMs(&RunNopAndWait);
+  }
+  return round_trip_ms_sum * 1000 / op_num;
+}
+
+}  // namespace
+
+TEST(SchedulerNotifier, wait_timeout) {
+  SchedulerNotifier notifier;
+  ASSERT_FALSE(notifier.WaitUntilNotified(notifier.epoch(), 100));
+  const int64_t epoch = notifier.epoch();
+  notifier.Notify();
+  ASSERT_TRUE(notifier.WaitUntilNotified(epoch, -1));
+  ASSERT_EQ(notifier.GetStat().park_cnt, 2);
+}
+
+TEST(SchedulerNotifier, vm_loop_no_lost_wakeup) {
+  OneflowVMScope vm_scope;
+  // back to back, and with gaps longer than the default spin time so that the scheduler parks
+  FOR_RANGE(int64_t, i, 0, 2000) { RunNopAndWait(); }
+  FOR_RANGE(int64_t, i, 0, 200) {
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+    RunNopAndWait();
+  }
+  const SchedulerNotifier::Stat stat = vm_scope.GetStat();
+  ASSERT_GT(stat.notify_cnt, 0);
+  ASSERT_GT(stat.park_cnt, 0);
+}
+
+TEST(SchedulerNotifier, DISABLED_benchmark_vm_round_trip) {
+  OneflowVMScope vm_scope;
+  const int64_t op_num = 500;
+  // ONEFLOW_VM_SCHEDULER_SPIN_US picks the spin time, negative for the busy loop
+  for (int64_t gap_us : {0, 200}) {
+    const SchedulerNotifier::Stat stat_before = vm_scope.GetStat();
+    const double round_trip_us = MeasureRoundTripUs(op_num, gap_us);
+    const SchedulerNotifier::Stat stat = vm_scope.GetStat();
+    LOG(INFO) << "gap " << gap_us << " us: nop round trip " << round_trip_us << " us, "
+              << stat.park_cnt - stat_before.park_cnt << " parks, wakeup latency "
+              << stat.avg_wakeup_latency_us() << " us, idle " << stat.idle_percentage() << "%";
+  }
+}
+
+}  // namespace test
+}  // namespace vm
+}  // namespace oneflow
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/vm/instruction.msg.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/object_msg/object_msg.h"
+#include "oneflow/core/profiler/timeline.h"
 
 namespace oneflow {
 namespace vm {
@@ -42,6 +43,9 @@ const StreamTypeId& LookupInferStreamTypeId(const StreamTypeId& compute_stream_t
 }
 
 void StreamType::Run(Instruction* instruction) const {
+  profiler::TimelineRangeGuard timeline_guard(
+      profiler::TimelineCategory::kInstruction,
+      instruction->instr_msg().instr_type_name().c_str(), -1);
   const auto& stream_type_id = instruction->stream().stream_id().stream_type_id();
   auto interpret_type = stream_type_id.interpret_type();
   if (interpret_type == InterpretType::kCompute) {
@@ -54,6 +58,8 @@ void StreamType::Run(Instruction* instruction) const {
 }
 
 void StreamType::Run(VirtualMachine* vm, InstructionMsg* instr_msg) const {
+  profiler::TimelineRangeGuard timeline_guard(profiler::TimelineCategory::kInstruction,
+                                              instr_msg->instr_type_name().c_str(), -1);
   InterpretType interpret_type = instr_msg->instr_type_id().stream_type_id().interpret_type();
   if (interpret_type == InterpretType::kCompute) {
     Compute(vm, instr_msg);
@@ -65,6 +71,9 @@ void StreamType::Run(VirtualMachine* vm, InstructionMsg* instr_msg) const {
 }
 
 void StreamType::Run(VirtualMachine* vm, Instruction* instruction) const {
+  profiler::TimelineRangeGuard timeline_guard(
+      profiler::TimelineCategory::kInstruction,
+      instruction->instr_msg().instr_type_name().c_str(), -1);
   auto interpret_type = instruction->stream().stream_id().stream_type_id().interpret_type();
   if (interpret_type == InterpretType::kCompute) {
     Compute(vm, instruction);
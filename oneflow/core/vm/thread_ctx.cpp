@@ -28,10 +28,13 @@ ObjectMsgConditionListStatus ThreadCtx::ReceiveAndRun() {
   const StreamType& stream_type = stream_rt_desc().stream_type();
   OBJECT_MSG_LIST(Instruction, pending_instruction_link) tmp_list;
   ObjectMsgConditionListStatus status = mut_pending_instruction_list()->MoveTo(&tmp_list);
+  const bool has_instruction = !tmp_list.empty();
   OBJECT_MSG_LIST_FOR_EACH(&tmp_list, instruction) {
     tmp_list.Erase(instruction.Mutable());
     stream_type.Run(instruction.Mutable());
   }
+  // instructions of synchronous streams are done now, let the scheduler release them
+  if (has_instruction && has_scheduler_notifier()) { mut_scheduler_notifier()->Notify(); }
   return status;
 }
 
@@ -19,6 +19,7 @@ limitations under the License.
 #include <functional>
 #include "oneflow/core/vm/stream.msg.h"
 #include "oneflow/core/vm/stream_runtime_desc.msg.h"
+#include "oneflow/core/vm/scheduler_notifier.h"
 
 namespace oneflow {
 namespace vm {
@@ -32,6 +33,7 @@ OBJECT_MSG_BEGIN(ThreadCtx);
   OF_PUBLIC void LoopRun(const std::function<void(ThreadCtx*)>& Initializer);
   // fields
   OBJECT_MSG_DEFINE_PTR(const StreamRtDesc, stream_rt_desc); 
+  OBJECT_MSG_DEFINE_PTR(SchedulerNotifier, scheduler_notifier);
 
   // links
   OBJECT_MSG_DEFINE_LIST_LINK(thread_ctx_link);
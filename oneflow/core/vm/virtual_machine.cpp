@@ -562,6 +562,7 @@ void VirtualMachine::__Init__(const VmDesc& vm_desc, ObjectMsgAllocator* allocat
     BalancedSplitter bs(stream_desc->parallel_num(), stream_desc->num_threads());
     for (int64_t i = 0, rel_global_device_id = 0; i < stream_desc->num_threads(); ++i) {
       auto thread_ctx = ObjectMsgPtr<ThreadCtx>::NewFrom(allocator, stream_rt_desc.Get());
+      thread_ctx->set_scheduler_notifier(mut_scheduler_notifier());
       mut_thread_ctx_list()->PushBack(thread_ctx.Mutable());
       for (int j = bs.At(i).begin(); j < bs.At(i).end(); ++j, ++rel_global_device_id) {
         StreamId stream_id;
@@ -608,6 +609,7 @@ Maybe<void> VirtualMachine::Receive(InstructionMsgList* compute_instr_msg_list)
     }));
   }
   mut_pending_msg_list()->MoveFrom(&new_instr_msg_list);
+  mut_scheduler_notifier()->Notify();
   return Maybe<void>::Ok();
 }
 
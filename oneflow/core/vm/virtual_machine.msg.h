@@ -19,6 +19,7 @@ limitations under the License.
 #include <mutex>
 #include "oneflow/core/common/maybe.h"
 #include "oneflow/core/vm/interpret_type.h"
+#include "oneflow/core/vm/scheduler_notifier.h"
 #include "oneflow/core/vm/instruction.msg.h"
 #include "oneflow/core/vm/stream.msg.h"
 #include "oneflow/core/vm/stream_runtime_desc.msg.h"
@@ -57,6 +58,8 @@ OBJECT_MSG_BEGIN(VirtualMachine);
   OBJECT_MSG_DEFINE_STRUCT(Range, machine_id_range);
   OBJECT_MSG_DEFINE_STRUCT(std::atomic<int64_t>, flying_instruction_cnt);
   OBJECT_MSG_DEFINE_PTR(ObjectMsgAllocator, vm_thread_only_allocator);
+  // notified on new instructions and on instructions run by worker threads
+  OBJECT_MSG_DEFINE_STRUCT(SchedulerNotifier, scheduler_notifier);
 
   // heads
   OBJECT_MSG_DEFINE_LIST_HEAD(Stream, active_stream_link, active_stream_list);
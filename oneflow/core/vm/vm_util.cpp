@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/common/protobuf.h"
 #include "oneflow/core/job/cluster_instruction.h"
 #include "oneflow/core/vm/vm_util.h"
+#include "oneflow/core/vm/deferred_instruction_list.h"
 #include "oneflow/core/vm/oneflow_vm.h"
 #include "oneflow/core/vm/instruction.pb.h"
 #include "oneflow/core/vm/stream_type.h"
@@ -34,13 +35,44 @@ ObjectMsgPtr<InstructionMsg> NewInstruction(const std::string& instr_type_name)
   return ObjectMsgPtr<InstructionMsg>::New(instr_type_name);
 }
 
-Maybe<void> Run(vm::InstructionMsgList* instr_msg_list) {
+namespace {
+
+Maybe<void> Receive(vm::InstructionMsgList* instr_msg_list) {
   auto* oneflow_vm = JUST(GlobalMaybe<OneflowVM>());
   auto* vm = oneflow_vm->mut_vm();
   JUST(vm->Receive(instr_msg_list));
   return Maybe<void>::Ok();
 }
 
+DeferredInstructionList* GlobalDeferredInstructionList() {
+  static DeferredInstructionList deferred_list(
+      ParseIntegerFromEnv("ONEFLOW_VM_DEFERRED_SUBMIT_MAX_BATCH", 64), &Receive);
+  return &deferred_list;
+}
+
+// Flushes the instructions an exiting thread deferred
+struct DeferredInstructionFlusherAtThreadExit final {
+  ~DeferredInstructionFlusherAtThreadExit() {
+    const auto& ret = TRY(GlobalDeferredInstructionList()->FlushIfOwnedByThisThread());
+    if (!ret.IsOk()) { LOG(WARNING) << "failed to flush deferred instructions at thread exit"; }
+  }
+};
+
+}  // namespace
+
+Maybe<void> Run(vm::InstructionMsgList* instr_msg_list) {
+  // Every submission to the vm goes through here, so deferred instructions can never be
+  // overtaken by later ones from any thread, e.g. a sync barrier.
+  return GlobalDeferredInstructionList()->Submit(instr_msg_list);
+}
+
+Maybe<void> DeferredRun(vm::InstructionMsgList* instr_msg_list) {
+  static thread_local DeferredInstructionFlusherAtThreadExit flusher_at_thread_exit;
+  return GlobalDeferredInstructionList()->Defer(instr_msg_list);
+}
+
+Maybe<void> FlushDeferredInstructions() { return GlobalDeferredInstructionList()->Flush(); }
+
 Maybe<void> SingleClientSync() {
   BlockingCounter bc(1);
   JUST(LogicalRun([&bc](InstructionsBuilder* builder) -> Maybe<void> {
@@ -27,7 +27,13 @@ struct InstructionMsg;
 
 ObjectMsgPtr<InstructionMsg> NewInstruction(const std::string& instr_type_name);
 
+// Submits the deferred instructions followed by instr_msg_list
 Maybe<void> Run(vm::InstructionMsgList* instr_msg_list);
+// Keeps the instructions until the next Run or FlushDeferredInstructions on any thread, until
+// ONEFLOW_VM_DEFERRED_SUBMIT_MAX_BATCH (default 64) of them are pending, until another thread
+// defers, or until the issuing thread exits
+Maybe<void> DeferredRun(vm::InstructionMsgList* instr_msg_list);
+Maybe<void> FlushDeferredInstructions();
 Maybe<void> SingleClientSync();
 Maybe<void> MultiClientSync();
 
@@ -26,13 +26,19 @@ namespace data {
 
 static const int32_t kDataReaderBatchBufferSize = 4;
 
+// batches prefetched by the load thread, can be set by ONEFLOW_DATA_READER_BATCH_BUFFER_SIZE
+inline size_t DataReaderBatchBufferSize() {
+  return std::max<int64_t>(
+      ParseIntegerFromEnv("ONEFLOW_DATA_READER_BATCH_BUFFER_SIZE", kDataReaderBatchBufferSize), 1);
+}
+
 template<typename LoadTarget>
 class DataReader {
  public:
   using LoadTargetPtr = std::shared_ptr<LoadTarget>;
   using LoadTargetPtrList = std::vector<LoadTargetPtr>;
   DataReader(user_op::KernelInitContext* ctx)
-      : is_closed_(false), batch_buffer_(kDataReaderBatchBufferSize) {}
+      : is_closed_(false), batch_buffer_(DataReaderBatchBufferSize()) {}
   virtual ~DataReader() {
     Close();
     if (load_thrd_.joinable()) { load_thrd_.join(); }
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/user/data/dataset.h"
 #include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/common/buffer.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/framework/op_kernel.h"
 #include "oneflow/core/persistence/persistent_in_stream.h"
@@ -27,13 +28,32 @@ limitations under the License.
 namespace oneflow {
 namespace data {
 
+// OFRecordDataset reads the local part files with reader_num threads. Reader i reads the files
+// i, i + reader_num, ... of every epoch into its own readahead buffer, and Next() takes one record
+// from each reader in turn, so the record order only depends on reader_num. A reader that has
+// finished its files of the epoch is skipped until all the readers have.
+//
+// Options are read from the environment, unless the reader num and depth are given:
+//   ONEFLOW_OFRECORD_READER_NUM: reader threads, at most the local part file num, default 1
+//   ONEFLOW_OFRECORD_READER_READAHEAD_DEPTH: records buffered per reader, default 64
+//   ONEFLOW_OFRECORD_READER_STAT_LOG_INTERVAL: seconds between logs of the bytes/s and records/s
+//     of each reader, 0 to disable, default 0
 class OFRecordDataset final : public Dataset<TensorBuffer> {
  public:
   using LoadTargetPtr = std::shared_ptr<TensorBuffer>;
   using LoadTargetPtrList = std::vector<LoadTargetPtr>;
+
+  struct ReaderStat {
+    int64_t bytes;
+    int64_t records;
+    double seconds;
+  };
+
   OF_DISALLOW_COPY_AND_MOVE(OFRecordDataset);
-  OFRecordDataset(user_op::KernelInitContext* ctx) {
-    current_epoch_ = 0;
+  OFRecordDataset(user_op::KernelInitContext* ctx)
+      : OFRecordDataset(ctx, ParseIntegerFromEnv("ONEFLOW_OFRECORD_READER_NUM", 1),
+                        ParseIntegerFromEnv("ONEFLOW_OFRECORD_READER_READAHEAD_DEPTH", 64)) {}
+  OFRecordDataset(user_op::KernelInitContext* ctx, int64_t reader_num, int64_t readahead_depth) {
     shuffle_after_epoch_ = ctx->Attr<bool>("shuffle_after_epoch");
 
     // in stream
@@ -66,49 +86,131 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
     CHECK_LE(parallel_num_, data_part_num_);
     BalancedSplitter bs(data_part_num_, parallel_num_);
     range_ = bs.At(parallel_id_);
-    std::vector<std::string> local_file_paths = GetLocalFilePaths();
-    in_stream_.reset(
-        new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_, false));
+
+    reader_num = std::min<int64_t>(std::max<int64_t>(reader_num, 1), range_.size());
+    readahead_depth = std::max<int64_t>(readahead_depth, 1);
+    stat_log_interval_ = ParseIntegerFromEnv("ONEFLOW_OFRECORD_READER_STAT_LOG_INTERVAL", 0);
+    start_time_ = std::chrono::steady_clock::now();
+    last_stat_log_time_ = start_time_;
+    cur_reader_idx_ = 0;
+    epoch_done_readers_.assign(reader_num, false);
+    epoch_done_reader_cnt_ = 0;
+    epoch_sample_cnt_ = 0;
+    FOR_RANGE(int64_t, i, 0, reader_num) { readers_.emplace_back(new Reader(readahead_depth)); }
+    FOR_RANGE(int64_t, i, 0, reader_num) {
+      readers_.at(i)->thread = std::thread(&OFRecordDataset::ReaderLoop, this, i, reader_num);
+    }
+  }
+  ~OFRecordDataset() {
+    for (auto& reader : readers_) { reader->buffer.Close(); }
+    for (auto& reader : readers_) { reader->thread.join(); }
   }
-  ~OFRecordDataset() = default;
 
   LoadTargetPtrList Next() override {
     LoadTargetPtrList ret;
-    LoadTargetPtr sample_ptr(new TensorBuffer());
-    ReadSample(*sample_ptr);
-    ret.push_back(std::move(sample_ptr));
+    ret.push_back(NextSample());
+    if (stat_log_interval_ > 0) { TryLogStat(); }
     return ret;
   }
 
+  std::vector<ReaderStat> GetReaderStats() const {
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+    std::vector<ReaderStat> stats;
+    for (const auto& reader : readers_) {
+      stats.push_back(ReaderStat{reader->bytes.load(), reader->records.load(), seconds});
+    }
+    return stats;
+  }
+
  private:
-  void ReadSample(TensorBuffer& tensor) {
-    int64_t OFRecord_size = -1;
-    char* size_ptr = reinterpret_cast<char*>(&OFRecord_size);
-    if (in_stream_->ReadFully(size_ptr, sizeof(int64_t)) != 0) {
-      ShuffleAfterEpoch();
-      CHECK_EQ(in_stream_->ReadFully(size_ptr, sizeof(int64_t)), 0);
+  struct Reader {
+    explicit Reader(int64_t readahead_depth) : buffer(readahead_depth), bytes(0), records(0) {}
+    // a nullptr marks the end of an epoch
+    Buffer<LoadTargetPtr> buffer;
+    std::atomic<int64_t> bytes;
+    std::atomic<int64_t> records;
+    std::thread thread;
+  };
+
+  LoadTargetPtr NextSample() {
+    while (true) {
+      if (epoch_done_reader_cnt_ == static_cast<int64_t>(readers_.size())) {
+        // the readers would start over forever
+        CHECK_GT(epoch_sample_cnt_, 0) << "no record in the data part files " << range_.begin()
+                                       << " to " << range_.end() - 1 << ", e.g. "
+                                       << data_file_paths_.at(range_.begin());
+        epoch_sample_cnt_ = 0;
+        epoch_done_readers_.assign(readers_.size(), false);
+        epoch_done_reader_cnt_ = 0;
+        cur_reader_idx_ = 0;
+      }
+      const int64_t reader_idx = cur_reader_idx_;
+      cur_reader_idx_ = (cur_reader_idx_ + 1) % readers_.size();
+      if (epoch_done_readers_.at(reader_idx)) { continue; }
+      LoadTargetPtr sample;
+      CHECK_EQ(readers_.at(reader_idx)->buffer.Receive(&sample), kBufferStatusSuccess);
+      if (sample) {
+        epoch_sample_cnt_ += 1;
+        return sample;
+      }
+      epoch_done_readers_.at(reader_idx) = true;
+      epoch_done_reader_cnt_ += 1;
     }
-    CHECK_GT(OFRecord_size, 0);
-    tensor.Resize(Shape({OFRecord_size}), DataType::kChar);
-    CHECK_EQ(in_stream_->ReadFully(tensor.mut_data<char>(), OFRecord_size), 0);
   }
 
-  void ShuffleAfterEpoch() {
-    CHECK(shuffle_after_epoch_);
-    current_epoch_++;  // move to next epoch
-    std::mt19937 g(kOneflowDatasetSeed + current_epoch_);
-    std::shuffle(data_file_paths_.begin(), data_file_paths_.end(), g);
-    std::vector<std::string> local_file_paths = GetLocalFilePaths();
-    in_stream_.reset(new PersistentInStream(DataFS(), local_file_paths, false, false));
+  void ReaderLoop(int64_t reader_idx, int64_t reader_num) {
+    Reader* reader = readers_.at(reader_idx).get();
+    // every reader shuffles its own copy of the paths the same way
+    std::vector<std::string> data_file_paths = data_file_paths_;
+    for (int32_t epoch = 0;; ++epoch) {
+      if (epoch > 0 && shuffle_after_epoch_) {
+        std::mt19937 g(kOneflowDatasetSeed + epoch);
+        std::shuffle(data_file_paths.begin(), data_file_paths.end(), g);
+      }
+      std::vector<std::string> reader_file_paths;
+      for (int64_t i = range_.begin() + reader_idx; i < range_.end(); i += reader_num) {
+        reader_file_paths.push_back(data_file_paths.at(i));
+      }
+      PersistentInStream in_stream(DataFS(), reader_file_paths, false, false);
+      while (true) {
+        LoadTargetPtr sample = ReadSample(&in_stream);
+        if (sample) {
+          reader->bytes += sample->nbytes() + sizeof(int64_t);
+          reader->records += 1;
+        }
+        if (reader->buffer.Send(sample) != kBufferStatusSuccess) { return; }
+        if (!sample) { break; }
+      }
+    }
   }
 
-  std::vector<std::string> GetLocalFilePaths() {
-    std::vector<std::string> ret;
-    for (int i = range_.begin(); i < range_.end(); ++i) { ret.push_back(data_file_paths_.at(i)); }
-    return ret;
+  // returns nullptr at the end of the stream
+  static LoadTargetPtr ReadSample(PersistentInStream* in_stream) {
+    int64_t OFRecord_size = -1;
+    char* size_ptr = reinterpret_cast<char*>(&OFRecord_size);
+    if (in_stream->ReadFully(size_ptr, sizeof(int64_t)) != 0) { return nullptr; }
+    CHECK_GT(OFRecord_size, 0);
+    LoadTargetPtr tensor(new TensorBuffer());
+    tensor->Resize(Shape({OFRecord_size}), DataType::kChar);
+    CHECK_EQ(in_stream->ReadFully(tensor->mut_data<char>(), OFRecord_size), 0);
+    return tensor;
+  }
+
+  void TryLogStat() {
+    const auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - last_stat_log_time_).count() < stat_log_interval_) {
+      return;
+    }
+    last_stat_log_time_ = now;
+    const std::vector<ReaderStat> stats = GetReaderStats();
+    FOR_RANGE(int64_t, i, 0, stats.size()) {
+      LOG(INFO) << "OFRecordDataset " << parallel_id_ << " reader " << i << ": "
+                << stats.at(i).bytes / stats.at(i).seconds / (1024 * 1024) << " MiB/s, "
+                << stats.at(i).records / stats.at(i).seconds << " records/s";
+    }
   }
 
-  int32_t current_epoch_;
   bool shuffle_after_epoch_;
 
   int32_t data_part_num_;
@@ -116,7 +218,16 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
   int32_t parallel_num_;
   Range range_;
   std::vector<std::string> data_file_paths_;
-  std::unique_ptr<PersistentInStream> in_stream_;
+
+  std::vector<std::unique_ptr<Reader>> readers_;
+  int64_t cur_reader_idx_;
+  std::vector<bool> epoch_done_readers_;
+  int64_t epoch_done_reader_cnt_;
+  int64_t epoch_sample_cnt_;
+
+  int64_t stat_log_interval_;
+  std::chrono::steady_clock::time_point start_time_;
+  std::chrono::steady_clock::time_point last_stat_log_time_;
 };
 
 }  // namespace data
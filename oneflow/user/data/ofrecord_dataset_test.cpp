@@ -0,0 +1,185 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include "oneflow/user/data/ofrecord_dataset.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/job/global_for.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+class DatasetInitContext final : public user_op::KernelInitContext {
+ public:
+  explicit DatasetInitContext(const user_op::UserOpConfWrapper& user_op_conf)
+      : user_op_conf_(user_op_conf) {
+    parallel_ctx_.set_parallel_id(0);
+    parallel_ctx_.set_parallel_num(1);
+  }
+  ~DatasetInitContext() override = default;
+
+  DeviceCtx* device_ctx() override { return nullptr; }
+  DeviceType device_type() const override { return DeviceType::kCPU; }
+  const ParallelContext& parallel_ctx() const override { return parallel_ctx_; }
+  const user_op::TensorDesc* TensorDesc4ArgNameAndIndex(const std::string& arg_name,
+                                                        int32_t index) const override {
+    return nullptr;
+  }
+  const cfg::SbpParallel& SbpParallel4ArgNameAndIndex(const std::string& arg_name,
+                                                      int32_t index) const override {
+    UNIMPLEMENTED();
+    return *(const cfg::SbpParallel*)nullptr;
+  }
+  const user_op::TensorDesc* LogicalTensorDesc4ArgNameAndIndex(const std::string& arg_name,
+                                                               int32_t index) const override {
+    return nullptr;
+  }
+  const ParallelDesc& parallel_desc() const override {
+    UNIMPLEMENTED();
+    return *(const ParallelDesc*)nullptr;
+  }
+  const cfg::NdSbp& NdSbp4ArgNameAndIndex(const std::string& arg_name,
+                                          int32_t index) const override {
+    UNIMPLEMENTED();
+    return *(const cfg::NdSbp*)nullptr;
+  }
+  const std::vector<std::pair<std::string, int32_t>>& inputs() const override { return inputs_; }
+  const std::vector<std::pair<std::string, int32_t>>& outputs() const override {
+    return outputs_;
+  }
+
+ private:
+  const user_op::UserOpConfWrapper& user_op_conf() const override { return user_op_conf_; }
+  const std::shared_ptr<const user_op::AttrVal>& Attr4Name(
+      const std::string& attr_name) const override {
+    return user_op_conf_.Attr4Name(attr_name);
+  }
+
+  user_op::UserOpConfWrapper user_op_conf_;
+  ParallelContext parallel_ctx_;
+  std::vector<std::pair<std::string, int32_t>> inputs_;
+  std::vector<std::pair<std::string, int32_t>> outputs_;
+};
+
+// part files of uneven record nums, the empty one is skipped by its reader
+const std::vector<int64_t> kPartRecordNums{3, 0, 5, 1, 4, 2};
+
+int64_t RecordValue(int64_t part_id, int64_t i) { return part_id * 100 + i; }
+
+// records of a single int64, which is RecordValue of the part and the record
+void WritePartFiles(const std::string& data_dir) {
+  DataFS()->RecursivelyCreateDirIfNotExist(data_dir);
+  FOR_RANGE(int64_t, part_id, 0, kPartRecordNums.size()) {
+    std::ofstream out(JoinPath(data_dir, "part-" + std::to_string(part_id)), std::ios::binary);
+    FOR_RANGE(int64_t, i, 0, kPartRecordNums.at(part_id)) {
+      const int64_t size = sizeof(int64_t);
+      const int64_t value = RecordValue(part_id, i);
+      out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+      out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+  }
+}
+
+user_op::UserOpConfWrapper NewReaderConf(const std::string& data_dir, bool shuffle_after_epoch) {
+  return user_op::UserOpConfWrapperBuilder("ofrecord_reader")
+      .Op("OFRecordReader")
+      .Output("out")
+      .Attr<std::string>("data_dir", data_dir)
+      .Attr<int32_t>("data_part_num", static_cast<int32_t>(kPartRecordNums.size()))
+      .Attr<int32_t>("batch_size", 1)
+      .Attr<std::string>("part_name_prefix", "part-")
+      .Attr<int32_t>("part_name_suffix_length", -1)
+      .Attr<bool>("shuffle_after_epoch", shuffle_after_epoch)
+      .Build();
+}
+
+// Reader r reads the parts r, r + reader_num, ... of part_ids, the records are taken from the
+// readers in turn until all of them are done
+std::vector<int64_t> ExpectedEpoch(const std::vector<int64_t>& part_ids, int64_t reader_num) {
+  std::vector<std::vector<int64_t>> reader_records(reader_num);
+  FOR_RANGE(int64_t, j, 0, part_ids.size()) {
+    FOR_RANGE(int64_t, i, 0, kPartRecordNums.at(part_ids.at(j))) {
+      reader_records.at(j % reader_num).push_back(RecordValue(part_ids.at(j), i));
+    }
+  }
+  std::vector<int64_t> ret;
+  std::vector<size_t> reader_offsets(reader_num, 0);
+  bool has_record = true;
+  while (has_record) {
+    has_record = false;
+    FOR_RANGE(int64_t, r, 0, reader_num) {
+      if (reader_offsets.at(r) == reader_records.at(r).size()) { continue; }
+      ret.push_back(reader_records.at(r).at(reader_offsets.at(r)));
+      reader_offsets.at(r) += 1;
+      has_record = true;
+    }
+  }
+  return ret;
+}
+
+void TestEpochs(int64_t reader_num, bool shuffle_after_epoch) {
+  const std::string data_dir = JoinPath(GetCwd(), "tmp_test_ofrecord_dataset");
+  WritePartFiles(data_dir);
+  Maybe<bool> saved_is_multi_client = *Global<Maybe<bool>, MultiClient>::Get();
+  *Global<Maybe<bool>, MultiClient>::Get() = false;
+  {
+    DatasetInitContext ctx(NewReaderConf(data_dir, shuffle_after_epoch));
+    // depth 1 makes the readers block on each other
+    data::OFRecordDataset dataset(&ctx, reader_num, 1);
+    std::vector<int64_t> part_ids(kPartRecordNums.size());
+    std::iota(part_ids.begin(), part_ids.end(), 0);
+    FOR_RANGE(int32_t, epoch, 0, 4) {
+      if (epoch > 0 && shuffle_after_epoch) {
+        std::mt19937 g(data::kOneflowDatasetSeed + epoch);
+        std::shuffle(part_ids.begin(), part_ids.end(), g);
+      }
+      const std::vector<int64_t> expected =
+          ExpectedEpoch(part_ids, std::min<int64_t>(reader_num, part_ids.size()));
+      std::vector<int64_t> records;
+      for (size_t i = 0; i < expected.size(); ++i) {
+        auto samples = dataset.Next();
+        ASSERT_EQ(samples.size(), 1U);
+        ASSERT_EQ(samples.front()->elem_cnt(), static_cast<int64_t>(sizeof(int64_t)));
+        int64_t value = 0;
+        std::memcpy(&value, samples.front()->data<char>(), sizeof(int64_t));
+        records.push_back(value);
+      }
+      ASSERT_EQ(records, expected) << "reader_num " << reader_num << ", epoch " << epoch;
+    }
+  }
+  *Global<Maybe<bool>, MultiClient>::Get() = saved_is_multi_client;
+  DataFS()->RecursivelyDeleteDir(data_dir);
+}
+
+}  // namespace
+
+TEST(OFRecordDataset, order_across_reader_nums) {
+  for (int64_t reader_num : {1, 2, 3, 6, 8}) { TestEpochs(reader_num, false); }
+}
+
+TEST(OFRecordDataset, shuffle_after_epoch_across_reader_nums) {
+  for (int64_t reader_num : {1, 2, 4}) { TestEpochs(reader_num, true); }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -0,0 +1,103 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/common/cblas.h"
+
+namespace oneflow {
+
+template<typename T>
+using Im2ColFunc = void (*)(const T* in_dptr, const ShapeView& in_shape,
+                            const ShapeView& weight_shape, const ShapeView& out_shape,
+                            const int32_t* strides, const int32_t* dilation_rate,
+                            const int32_t* padding_before, T* col_buf);
+
+template<typename T>
+using Col2ImFunc = void (*)(const T* col_buf, const ShapeView& in_shape,
+                            const ShapeView& weight_shape, const ShapeView& out_shape,
+                            const int32_t* strides, const int32_t* dilation_rate,
+                            const int32_t* padding_before, T* in_diff_ptr);
+
+template<typename T>
+using GemmFunc = void (*)(enum CBLAS_TRANSPOSE trans_a, enum CBLAS_TRANSPOSE trans_b, const int m,
+                          const int n, const int k, const T alpha, const T* a, const T* b,
+                          const T beta, T* c);
+
+template<typename T>
+struct ConvOpKernelState final : public user_op::OpKernelState {
+  Im2ColFunc<T> im2col_func_;
+  Col2ImFunc<T> col2im_func_;
+  GemmFunc<T> forward_func_;
+
+  Shape in_5d_shape_;
+  Shape out_5d_shape_;
+  Shape weight_5d_shape_;
+
+  std::vector<int32_t> strides_3d_;
+  std::vector<int32_t> dilation_rate_3d_;
+  std::vector<int32_t> padding_before_3d_;
+
+  enum CBLAS_TRANSPOSE is_out_diff_need_trans_;
+  int32_t idx_offset_;
+
+  // Eager kernels keep their state across calls of different shapes, so Compute refreshes the
+  // shapes every time
+  void Update(const ShapeView& in_shape, const ShapeView& out_shape,
+              const ShapeView& weight_shape) {
+    auto Gen5DShape = [](const ShapeView& shape, int32_t idx_offset) -> Shape {
+      DimVector ret_vec;
+      shape.ToDimVector(&ret_vec);
+      int32_t ndims = ret_vec.size() - 2;
+      ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
+      return Shape(ret_vec);
+    };
+    in_5d_shape_ = Gen5DShape(in_shape, idx_offset_);
+    out_5d_shape_ = Gen5DShape(out_shape, idx_offset_);
+    weight_5d_shape_ = Gen5DShape(weight_shape, idx_offset_);
+  }
+};
+
+size_t CalcElemNumOfColBuf(const ShapeView& out_shape, const ShapeView& weight_shape,
+                           const int32_t idx_offset);
+// The samples of a batch are split into this number of tasks, each with its own col_buf
+int64_t ConvCpuTaskNum(int64_t sample_num);
+// Channels last 2d convolutions of 1x1 kernels, and of 3x3 kernels of enough input channels, run
+// without im2col
+bool IsDirectConv(const std::string& data_format, const ShapeView& weight_shape);
+
+// The convolutions of the CPU conv kernels. in, out and weight are x, y and the filter of the
+// forward, also for the grads. tmp_buf is the tmp_buffer of the kernels, of tmp_buf_size bytes,
+// the direct convolutions do not use it but the partial filter diffs of the filter grad.
+template<typename T>
+struct ConvCpuKernelUtil final {
+  static std::shared_ptr<ConvOpKernelState<T>> NewConvOpKernelState(
+      const std::string& data_format, const Shape& in_shape, const Shape& out_shape,
+      const Shape& weight_shape, const std::vector<int32_t>& strides,
+      const std::vector<int32_t>& dilation_rate, const std::vector<int32_t>& padding_before);
+  // bias may be nullptr
+  static void Forward(const ConvOpKernelState<T>& state, bool is_direct, const T* in,
+                      const T* weight, const T* bias, T* tmp_buf, size_t tmp_buf_size, T* out);
+  static void DataGrad(const ConvOpKernelState<T>& state, bool is_direct, const T* dy,
+                       const T* weight, T* tmp_buf, size_t tmp_buf_size, T* dx);
+  static void FilterGrad(const ConvOpKernelState<T>& state, bool is_direct, const T* dy,
+                         const T* x, T* tmp_buf, size_t tmp_buf_size, T* filter_diff);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
@@ -0,0 +1,120 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
+#include "oneflow/core/common/cpu_test_util.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+// A channels last 2d convolution of square kernels, strides, dilations and paddings
+struct ConvCase {
+  int64_t sample_num;
+  int64_t in_size;
+  int64_t in_channel;
+  int64_t filter_num;
+  int32_t kernel_size;
+  int32_t stride;
+  int32_t dilation;
+  int32_t padding;
+  int64_t out_size() const {
+    return (in_size + 2 * padding - dilation * (kernel_size - 1) - 1) / stride + 1;
+  }
+};
+
+void ExpectNear(const std::vector<double>& direct, const std::vector<double>& im2col,
+                const std::string& what) {
+  ASSERT_EQ(direct.size(), im2col.size());
+  FOR_RANGE(size_t, i, 0, direct.size()) {
+    ASSERT_NEAR(direct.at(i), im2col.at(i), 1e-9) << what << " at " << i;
+  }
+}
+
+// Runs the forward and the grads of the case on the direct and the im2col paths
+void TestDirectConv(const ConvCase& conv_case) {
+  const int64_t n = conv_case.sample_num;
+  const int64_t k = conv_case.kernel_size;
+  const int64_t out_size = conv_case.out_size();
+  const Shape in_shape({n, conv_case.in_size, conv_case.in_size, conv_case.in_channel});
+  const Shape out_shape({n, out_size, out_size, conv_case.filter_num});
+  const Shape weight_shape({conv_case.filter_num, k, k, conv_case.in_channel});
+  ASSERT_TRUE(IsDirectConv("channels_last", ShapeView(weight_shape)));
+  const std::shared_ptr<ConvOpKernelState<double>> state =
+      ConvCpuKernelUtil<double>::NewConvOpKernelState(
+          "channels_last", in_shape, out_shape, weight_shape,
+          {conv_case.stride, conv_case.stride}, {conv_case.dilation, conv_case.dilation},
+          {conv_case.padding, conv_case.padding});
+  const std::vector<double> x = RandomVector<double>(in_shape.elem_cnt(), 1, -1, 1);
+  const std::vector<double> weight = RandomVector<double>(weight_shape.elem_cnt(), 2, -1, 1);
+  const std::vector<double> bias = RandomVector<double>(conv_case.filter_num, 3, -1, 1);
+  const std::vector<double> dy = RandomVector<double>(out_shape.elem_cnt(), 4, -1, 1);
+  const int64_t task_num = ConvCpuTaskNum(n);
+  std::vector<double> tmp_buf(
+      task_num * CalcElemNumOfColBuf(ShapeView(out_shape), ShapeView(weight_shape), 1)
+      + out_size * out_size + (task_num - 1) * weight_shape.elem_cnt());
+  const size_t tmp_buf_size = tmp_buf.size() * sizeof(double);
+  // ys, dxs and filter diffs of the direct and the im2col paths
+  std::vector<std::vector<double>> y(2, std::vector<double>(out_shape.elem_cnt()));
+  std::vector<std::vector<double>> dx(2, std::vector<double>(in_shape.elem_cnt()));
+  std::vector<std::vector<double>> filter_diff(2, std::vector<double>(weight_shape.elem_cnt()));
+  FOR_RANGE(int32_t, i, 0, 2) {
+    const bool is_direct = (i == 0);
+    ConvCpuKernelUtil<double>::Forward(*state, is_direct, x.data(), weight.data(), bias.data(),
+                                       tmp_buf.data(), tmp_buf_size, y.at(i).data());
+    ConvCpuKernelUtil<double>::DataGrad(*state, is_direct, dy.data(), weight.data(),
+                                        tmp_buf.data(), tmp_buf_size, dx.at(i).data());
+    ConvCpuKernelUtil<double>::FilterGrad(*state, is_direct, dy.data(), x.data(), tmp_buf.data(),
+                                          tmp_buf_size, filter_diff.at(i).data());
+  }
+  ExpectNear(y.at(0), y.at(1), "y");
+  ExpectNear(dx.at(0), dx.at(1), "dx");
+  ExpectNear(filter_diff.at(0), filter_diff.at(1), "filter_diff");
+}
+
+std::vector<ConvCase> TestCases() {
+  std::vector<ConvCase> cases;
+  for (int32_t kernel_size : {1, 3}) {
+    for (int32_t stride : {1, 2}) {
+      for (int32_t dilation : {1, 2}) {
+        for (int32_t padding : {0, 1, 2}) {
+          // 1x1 kernels of any number of input channels, 3x3 ones of enough of them
+          const int64_t in_channel = kernel_size == 1 ? 5 : 16;
+          cases.push_back(ConvCase{3, 9, in_channel, 7, kernel_size, stride, dilation, padding});
+        }
+      }
+    }
+  }
+  return cases;
+}
+
+}  // namespace
+
+TEST(ConvCpuKernelUtil, direct_conv) {
+  for (const ConvCase& conv_case : TestCases()) { TestDirectConv(conv_case); }
+}
+
+TEST(ConvCpuKernelUtil, direct_conv_on_thread_pool) {
+  // the filter diffs of the samples of 3 tasks are summed up
+  ThreadPoolScope thread_pool_scope(3);
+  for (const ConvCase& conv_case : TestCases()) { TestDirectConv(conv_case); }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -13,32 +13,17 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
-#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
 #include "oneflow/user/ops/nn_util.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
 namespace {
 
-template<typename T>
-using Im2ColFunc = void (*)(const T* in_dptr, const ShapeView& in_shape,
-                            const ShapeView& weight_shape, const ShapeView& out_shape,
-                            const int32_t* strides, const int32_t* dilation_rate,
-                            const int32_t* padding_before, T* col_buf);
-
-template<typename T>
-using Col2ImFunc = void (*)(const T* col_buf, const ShapeView& in_shape,
-                            const ShapeView& weight_shape, const ShapeView& out_shape,
-                            const int32_t* strides, const int32_t* dilation_rate,
-                            const int32_t* padding_before, T* in_diff_ptr);
-
-template<typename T>
-using GemmFunc = void (*)(enum CBLAS_TRANSPOSE trans_a, enum CBLAS_TRANSPOSE trans_b, const int m,
-                          const int n, const int k, const T alpha, const T* a, const T* b,
-                          const T beta, T* c);
-
 template<typename T>
 void Gemm4ChannelFirst(enum CBLAS_TRANSPOSE trans_a, enum CBLAS_TRANSPOSE trans_b, const int m,
                        const int n, const int k, const T alpha, const T* a, const T* b,
@@ -55,26 +40,11 @@ void Gemm4ChannelLast(enum CBLAS_TRANSPOSE trans_a, enum CBLAS_TRANSPOSE trans_b
   NewKernelUtil<DeviceType::kCPU>::OFGemm(nullptr, trans_b, trans_a, n, m, k, alpha, b, a, beta, c);
 }
 
-template<typename T>
-T* GetImgMutDptr(user_op::Tensor* tensor, int64_t idx) {
-  return tensor->mut_dptr<T>() + tensor->shape().Count(1) * idx;
-}
-
 template<typename T>
 const T* GetImgDptr(const user_op::Tensor* tensor, int64_t idx) {
   return tensor->dptr<T>() + tensor->shape().Count(1) * idx;
 }
 
-size_t CalcElemNumOfColBuf(const ShapeView& out_shape, const ShapeView& weight_shape,
-                           const int32_t idx_offset) {
-  int64_t col_buf_elem_cnt = 1;
-  int64_t ndims = out_shape.NumAxes() - 2;
-
-  for (size_t i = 0; i != ndims + 1; ++i) { col_buf_elem_cnt *= weight_shape.At(i + 1); }
-  for (size_t i = 0; i != ndims; ++i) { col_buf_elem_cnt *= out_shape.At(idx_offset + i); }
-  return col_buf_elem_cnt;
-}
-
 template<typename T>
 class ColBufWriter {
  public:
@@ -293,46 +263,282 @@ struct ConvKernelUtil final {
 };
 
 template<typename T>
-struct ConvOpKernelState final : public user_op::OpKernelState {
-  Im2ColFunc<T> im2col_func_;
-  Col2ImFunc<T> col2im_func_;
-  GemmFunc<T> forward_func_;
-
-  Shape in_5d_shape_;
-  Shape out_5d_shape_;
-  Shape weight_5d_shape_;
-
-  std::vector<int32_t> strides_3d_;
-  std::vector<int32_t> dilation_rate_3d_;
-  std::vector<int32_t> padding_before_3d_;
-
-  enum CBLAS_TRANSPOSE is_out_diff_need_trans_;
-  int32_t idx_offset_;
-  bool is_dynamic_;
-
-  void Update(const ShapeView& x_shape, const ShapeView& out_shape) {
-    auto Gen5DShape = [](const ShapeView& shape, int32_t idx_offset) -> Shape {
-      DimVector ret_vec;
-      shape.ToDimVector(&ret_vec);
-      int32_t ndims = ret_vec.size() - 2;
-      ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
-      return Shape(ret_vec);
-    };
-    if (is_dynamic_) {
-      Shape in_shape;
-      in_5d_shape_ = Gen5DShape(x_shape, idx_offset_);
-      out_5d_shape_ = Gen5DShape(out_shape, idx_offset_);
+void InitBiasMulBuf(T* dptr, int64_t num) {
+  for (int64_t i = 0; i < num; ++i) { dptr[i] = 1; }
+}
+
+// 3x3 kernels of fewer input channels make the GEMMs of their taps too thin to beat im2col
+constexpr int64_t kDirectConvMinInChannelNum = 16;
+// Elements of the filter diff summed up by a task of the thread pool
+constexpr int64_t kFilterDiffSumGrainSize = 32 * 1024;
+
+int64_t ConvCpuThreadNum() {
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  return thread_pool == nullptr ? 1 : thread_pool->thread_num();
+}
+
+// Rows of the direct convolutions are heavy, they are split in about 4 ranges per thread
+void ConvParallelForRows(int64_t row_num,
+                         const std::function<void(int64_t begin, int64_t end)>& Handler) {
+  ParallelForTasks(row_num, std::max<int64_t>(row_num / (ConvCpuThreadNum() * 4), 1), Handler);
+}
+
+using SampleRangeHandler = std::function<void(int64_t task, int64_t begin, int64_t end)>;
+
+// Splits the samples into task_num ranges and handles them in parallel
+void ForEachSampleRange(int64_t sample_num, int64_t task_num, const SampleRangeHandler& Handler) {
+  BalancedSplitter splitter(sample_num, task_num);
+  ParallelForTasks(task_num, 1, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, task, begin, end) {
+      const Range range = splitter.At(task);
+      Handler(task, range.begin(), range.end());
     }
+  });
+}
+
+struct DirectConvGeometry final {
+  DirectConvGeometry(const Shape& in_5d_shape, const Shape& out_5d_shape,
+                     const Shape& weight_5d_shape, const std::vector<int32_t>& strides_3d,
+                     const std::vector<int32_t>& dilation_rate_3d,
+                     const std::vector<int32_t>& padding_before_3d)
+      : sample_num(in_5d_shape.At(0)),
+        ih_num(in_5d_shape.At(2)),
+        iw_num(in_5d_shape.At(3)),
+        ci_num(in_5d_shape.At(4)),
+        oh_num(out_5d_shape.At(2)),
+        ow_num(out_5d_shape.At(3)),
+        filter_num(out_5d_shape.At(4)),
+        kh_num(weight_5d_shape.At(2)),
+        kw_num(weight_5d_shape.At(3)),
+        stride_h(strides_3d.at(1)),
+        stride_w(strides_3d.at(2)),
+        dilation_h(dilation_rate_3d.at(1)),
+        dilation_w(dilation_rate_3d.at(2)),
+        padding_h(padding_before_3d.at(1)),
+        padding_w(padding_before_3d.at(2)) {}
+
+  // the input pixels are the rows of an (n * h * w, ci) matrix read as they are
+  bool IsPointwise() const {
+    return kh_num == 1 && kw_num == 1 && stride_h == 1 && stride_w == 1 && padding_h == 0
+           && padding_w == 0;
+  }
+  // input row of the output row oh and the tap kh, -1 if it is in the padding
+  int64_t InRow(int64_t oh, int64_t kh) const {
+    const int64_t ih = oh * stride_h + kh * dilation_h - padding_h;
+    return (ih < 0 || ih >= ih_num) ? -1 : ih;
   }
+  // output row of the input row ih and the tap kh, -1 if there is none
+  int64_t OutRow(int64_t ih, int64_t kh) const {
+    const int64_t offset = ih + padding_h - kh * dilation_h;
+    if (offset < 0 || offset % stride_h != 0 || offset / stride_h >= oh_num) { return -1; }
+    return offset / stride_h;
+  }
+  // input column of the output column ow and the tap kw, may be in the padding
+  int64_t InCol(int64_t ow, int64_t kw) const {
+    return ow * stride_w + kw * dilation_w - padding_w;
+  }
+  // [*begin, *end) of the output columns whose input column of the tap kw is not in the padding
+  void ValidOutCols(int64_t kw, int64_t* begin, int64_t* end) const {
+    const int64_t offset = kw * dilation_w - padding_w;
+    *begin = offset >= 0 ? 0 : (-offset + stride_w - 1) / stride_w;
+    *end = iw_num - offset <= 0 ? 0 : std::min((iw_num - offset - 1) / stride_w + 1, ow_num);
+  }
+  // weight of the tap (kh, kw) is a (filter, ci) matrix of this leading dimension
+  int64_t weight_ld() const { return kh_num * kw_num * ci_num; }
+  int64_t tap_offset(int64_t kh, int64_t kw) const { return (kh * kw_num + kw) * ci_num; }
+
+  int64_t sample_num;
+  int64_t ih_num;
+  int64_t iw_num;
+  int64_t ci_num;
+  int64_t oh_num;
+  int64_t ow_num;
+  int64_t filter_num;
+  int64_t kh_num;
+  int64_t kw_num;
+  int64_t stride_h;
+  int64_t stride_w;
+  int64_t dilation_h;
+  int64_t dilation_w;
+  int64_t padding_h;
+  int64_t padding_w;
 };
 
+// Channels last 2d convolutions of 1x1 or 3x3 kernels without im2col. A row of the output is the
+// sum of one GEMM per kernel tap, whose input pixels are read in place with a leading dimension of
+// stride_w * ci, and whose (filter, ci) weight is read in place from the weight. Pointwise ones are
+// a single GEMM of all the pixels.
 template<typename T>
-std::shared_ptr<ConvOpKernelState<T>> CreateConvOpKernelState(user_op::KernelComputeContext* ctx,
-                                                              const std::string& in_name,
-                                                              const std::string& out_name,
-                                                              const std::string& weight_name) {
-  const auto& data_format = ctx->Attr<std::string>("data_format");
+struct DirectConvUtil final {
+  static void Gemm(enum CBLAS_TRANSPOSE trans_a, enum CBLAS_TRANSPOSE trans_b, int64_t m,
+                   int64_t n, int64_t k, const T* a, int64_t lda, const T* b, int64_t ldb,
+                   T beta, T* c, int64_t ldc) {
+    KernelUtil<DeviceType::kCPU, T>::Gemm(nullptr, CblasRowMajor, trans_a, trans_b, m, n, k,
+                                          static_cast<T>(1), a, lda, b, ldb, beta, c, ldc);
+  }
+
+  static void Forward(const ConvOpKernelState<T>& state, const T* in, const T* weight,
+                      const T* bias, T* out) {
+    const DirectConvGeometry geo(state.in_5d_shape_, state.out_5d_shape_, state.weight_5d_shape_,
+                                 state.strides_3d_, state.dilation_rate_3d_,
+                                 state.padding_before_3d_);
+    const int64_t filter_num = geo.filter_num;
+    auto InitOutPixels = [&](T* out_pixels, int64_t pixel_num) {
+      if (bias == nullptr) {
+        std::fill(out_pixels, out_pixels + pixel_num * filter_num, static_cast<T>(0));
+      } else {
+        FOR_RANGE(int64_t, i, 0, pixel_num) {
+          std::copy(bias, bias + filter_num, out_pixels + i * filter_num);
+        }
+      }
+    };
+    if (geo.IsPointwise()) {
+      // out = in * weight(T)
+      ConvParallelForRows(geo.sample_num * geo.oh_num, [&](int64_t begin, int64_t end) {
+        const int64_t pixel_begin = begin * geo.ow_num;
+        const int64_t pixel_num = (end - begin) * geo.ow_num;
+        T* out_pixels = out + pixel_begin * filter_num;
+        InitOutPixels(out_pixels, pixel_num);
+        Gemm(CblasNoTrans, CblasTrans, pixel_num, filter_num, geo.ci_num,
+             in + pixel_begin * geo.ci_num, geo.ci_num, weight, geo.ci_num, static_cast<T>(1),
+             out_pixels, filter_num);
+      });
+      return;
+    }
+    // out[n, oh] = sum of in[n, ih(oh, kh), iw(:, kw)] * weight[:, kh, kw](T) over the taps
+    ConvParallelForRows(geo.sample_num * geo.oh_num, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, row, begin, end) {
+        const int64_t n = row / geo.oh_num;
+        T* out_row = out + row * geo.ow_num * filter_num;
+        InitOutPixels(out_row, geo.ow_num);
+        FOR_RANGE(int64_t, kh, 0, geo.kh_num) {
+          const int64_t ih = geo.InRow(row % geo.oh_num, kh);
+          if (ih == -1) { continue; }
+          const T* in_row = in + (n * geo.ih_num + ih) * geo.iw_num * geo.ci_num;
+          FOR_RANGE(int64_t, kw, 0, geo.kw_num) {
+            int64_t ow_begin = 0;
+            int64_t ow_end = 0;
+            geo.ValidOutCols(kw, &ow_begin, &ow_end);
+            if (ow_begin >= ow_end) { continue; }
+            Gemm(CblasNoTrans, CblasTrans, ow_end - ow_begin, filter_num, geo.ci_num,
+                 in_row + geo.InCol(ow_begin, kw) * geo.ci_num, geo.stride_w * geo.ci_num,
+                 weight + geo.tap_offset(kh, kw), geo.weight_ld(), static_cast<T>(1),
+                 out_row + ow_begin * filter_num, filter_num);
+          }
+        }
+      }
+    });
+  }
+
+  static void DataGrad(const ConvOpKernelState<T>& state, const T* dy, const T* weight, T* dx) {
+    const DirectConvGeometry geo(state.in_5d_shape_, state.out_5d_shape_, state.weight_5d_shape_,
+                                 state.strides_3d_, state.dilation_rate_3d_,
+                                 state.padding_before_3d_);
+    const int64_t filter_num = geo.filter_num;
+    if (geo.IsPointwise()) {
+      // dx = dy * weight
+      ConvParallelForRows(geo.sample_num * geo.ih_num, [&](int64_t begin, int64_t end) {
+        const int64_t pixel_begin = begin * geo.iw_num;
+        Gemm(CblasNoTrans, CblasNoTrans, (end - begin) * geo.iw_num, geo.ci_num, filter_num,
+             dy + pixel_begin * filter_num, filter_num, weight, geo.ci_num, static_cast<T>(0),
+             dx + pixel_begin * geo.ci_num, geo.ci_num);
+      });
+      return;
+    }
+    // Each row of dx gathers the rows of dy it contributed to, so that the tasks write disjoint
+    // rows: dx[n, ih, iw(:, kw)] += dy[n, oh(ih, kh)] * weight[:, kh, kw]
+    ConvParallelForRows(geo.sample_num * geo.ih_num, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, row, begin, end) {
+        const int64_t n = row / geo.ih_num;
+        T* dx_row = dx + row * geo.iw_num * geo.ci_num;
+        std::fill(dx_row, dx_row + geo.iw_num * geo.ci_num, static_cast<T>(0));
+        FOR_RANGE(int64_t, kh, 0, geo.kh_num) {
+          const int64_t oh = geo.OutRow(row % geo.ih_num, kh);
+          if (oh == -1) { continue; }
+          const T* dy_row = dy + (n * geo.oh_num + oh) * geo.ow_num * filter_num;
+          FOR_RANGE(int64_t, kw, 0, geo.kw_num) {
+            int64_t ow_begin = 0;
+            int64_t ow_end = 0;
+            geo.ValidOutCols(kw, &ow_begin, &ow_end);
+            if (ow_begin >= ow_end) { continue; }
+            Gemm(CblasNoTrans, CblasNoTrans, ow_end - ow_begin, geo.ci_num, filter_num,
+                 dy_row + ow_begin * filter_num, filter_num, weight + geo.tap_offset(kh, kw),
+                 geo.weight_ld(), static_cast<T>(1),
+                 dx_row + geo.InCol(ow_begin, kw) * geo.ci_num, geo.stride_w * geo.ci_num);
+          }
+        }
+      }
+    });
+  }
+
+  // filter_diff += the filter diff of the samples in [sample_begin, sample_end)
+  static void FilterGrad(const ConvOpKernelState<T>& state, const T* dy, const T* x,
+                         int64_t sample_begin, int64_t sample_end, T* filter_diff) {
+    const DirectConvGeometry geo(state.in_5d_shape_, state.out_5d_shape_, state.weight_5d_shape_,
+                                 state.strides_3d_, state.dilation_rate_3d_,
+                                 state.padding_before_3d_);
+    const int64_t filter_num = geo.filter_num;
+    if (geo.IsPointwise()) {
+      // filter_diff += dy(T) * x
+      const int64_t pixel_num = geo.ih_num * geo.iw_num;
+      Gemm(CblasTrans, CblasNoTrans, filter_num, geo.ci_num,
+           (sample_end - sample_begin) * pixel_num, dy + sample_begin * pixel_num * filter_num,
+           filter_num, x + sample_begin * pixel_num * geo.ci_num, geo.ci_num, static_cast<T>(1),
+           filter_diff, geo.ci_num);
+      return;
+    }
+    // filter_diff[:, kh, kw] += dy[n, oh](T) * x[n, ih(oh, kh), iw(:, kw)]
+    FOR_RANGE(int64_t, row, sample_begin * geo.oh_num, sample_end * geo.oh_num) {
+      const int64_t n = row / geo.oh_num;
+      const T* dy_row = dy + row * geo.ow_num * filter_num;
+      FOR_RANGE(int64_t, kh, 0, geo.kh_num) {
+        const int64_t ih = geo.InRow(row % geo.oh_num, kh);
+        if (ih == -1) { continue; }
+        const T* x_row = x + (n * geo.ih_num + ih) * geo.iw_num * geo.ci_num;
+        FOR_RANGE(int64_t, kw, 0, geo.kw_num) {
+          int64_t ow_begin = 0;
+          int64_t ow_end = 0;
+          geo.ValidOutCols(kw, &ow_begin, &ow_end);
+          if (ow_begin >= ow_end) { continue; }
+          Gemm(CblasTrans, CblasNoTrans, filter_num, geo.ci_num, ow_end - ow_begin,
+               dy_row + ow_begin * filter_num, filter_num,
+               x_row + geo.InCol(ow_begin, kw) * geo.ci_num, geo.stride_w * geo.ci_num,
+               static_cast<T>(1), filter_diff + geo.tap_offset(kh, kw), geo.weight_ld());
+        }
+      }
+    }
+  }
+};
+
+}  // namespace
+
+size_t CalcElemNumOfColBuf(const ShapeView& out_shape, const ShapeView& weight_shape,
+                           const int32_t idx_offset) {
+  int64_t col_buf_elem_cnt = 1;
+  int64_t ndims = out_shape.NumAxes() - 2;
+
+  for (size_t i = 0; i != ndims + 1; ++i) { col_buf_elem_cnt *= weight_shape.At(i + 1); }
+  for (size_t i = 0; i != ndims; ++i) { col_buf_elem_cnt *= out_shape.At(idx_offset + i); }
+  return col_buf_elem_cnt;
+}
+
+int64_t ConvCpuTaskNum(int64_t sample_num) {
+  return std::max<int64_t>(std::min<int64_t>(sample_num, ConvCpuThreadNum()), 1);
+}
 
+bool IsDirectConv(const std::string& data_format, const ShapeView& weight_shape) {
+  // weight of channels last 2d convolutions: (filter, kh, kw, ci)
+  if (data_format != "channels_last" || weight_shape.NumAxes() != 4) { return false; }
+  if (weight_shape.At(1) == 1 && weight_shape.At(2) == 1) { return true; }
+  return weight_shape.At(1) == 3 && weight_shape.At(2) == 3
+         && weight_shape.At(3) >= kDirectConvMinInChannelNum;
+}
+
+template<typename T>
+std::shared_ptr<ConvOpKernelState<T>> ConvCpuKernelUtil<T>::NewConvOpKernelState(
+    const std::string& data_format, const Shape& in_shape, const Shape& out_shape,
+    const Shape& weight_shape, const std::vector<int32_t>& strides,
+    const std::vector<int32_t>& dilation_rate, const std::vector<int32_t>& padding_before) {
   std::shared_ptr<ConvOpKernelState<T>> state(new ConvOpKernelState<T>());
   if (data_format == "channels_first") {
     state->im2col_func_ = ConvKernelUtil<T>::NCDHWIm2Col;
@@ -348,28 +554,15 @@ std::shared_ptr<ConvOpKernelState<T>> CreateConvOpKernelState(user_op::KernelCom
     state->idx_offset_ = 1;
   }
 
-  auto Gen5DShape = [](const Shape& shape, int32_t idx_offset) -> Shape {
-    DimVector ret_vec(shape.dim_vec());
-    int32_t ndims = ret_vec.size() - 2;
-    ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
-    return Shape(ret_vec);
-  };
-  state->in_5d_shape_ =
-      Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->shape(), state->idx_offset_);
-  state->out_5d_shape_ =
-      Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(out_name, 0)->shape(), state->idx_offset_);
-  state->weight_5d_shape_ =
-      Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape(), state->idx_offset_);
+  state->Update(in_shape, out_shape, weight_shape);
 
   auto Gen3DVec = [](const std::vector<int32_t>& origin_vec) -> std::vector<int32_t> {
     std::vector<int32_t> ret_vec = origin_vec;
     ret_vec.insert(ret_vec.begin(), 3 - ret_vec.size(), 1);
     return ret_vec;
   };
-  state->strides_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("strides"));
-  state->dilation_rate_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("dilation_rate"));
-  state->is_dynamic_ = ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->is_dynamic();
-  const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
+  state->strides_3d_ = Gen3DVec(strides);
+  state->dilation_rate_3d_ = Gen3DVec(dilation_rate);
   FOR_RANGE(uint8_t, dim, 0, 3) {
     int64_t index = static_cast<int64_t>(dim) - (3 - padding_before.size());
     if (index < 0) {
@@ -383,8 +576,165 @@ std::shared_ptr<ConvOpKernelState<T>> CreateConvOpKernelState(user_op::KernelCom
 }
 
 template<typename T>
-void InitBiasMulBuf(T* dptr, int64_t num) {
-  for (int64_t i = 0; i < num; ++i) { dptr[i] = 1; }
+void ConvCpuKernelUtil<T>::Forward(const ConvOpKernelState<T>& state, bool is_direct,
+                                   const T* in, const T* weight, const T* bias, T* tmp_buf,
+                                   size_t tmp_buf_size, T* out) {
+  if (is_direct) {
+    DirectConvUtil<T>::Forward(state, in, weight, bias, out);
+    return;
+  }
+  const int32_t idx_offset = state.idx_offset_;
+  const int64_t sample_num = state.in_5d_shape_.At(0);
+  const int64_t task_num = ConvCpuTaskNum(sample_num);
+  const int64_t num_of_col_buf =
+      CalcElemNumOfColBuf(ShapeView(state.out_5d_shape_), ShapeView(state.weight_5d_shape_),
+                          idx_offset);
+  const int64_t num_of_bias_mul =
+      bias == nullptr ? 0 : state.out_5d_shape_.Count(idx_offset, idx_offset + 3);
+  CHECK_LE((task_num * num_of_col_buf + num_of_bias_mul) * sizeof(T), tmp_buf_size);
+  T* bias_mul_dptr = tmp_buf + task_num * num_of_col_buf;
+  if (bias != nullptr) { InitBiasMulBuf(bias_mul_dptr, num_of_bias_mul); }
+
+  ForEachSampleRange(sample_num, task_num, [&](int64_t task, int64_t begin, int64_t end) {
+    T* col_buf_dptr = tmp_buf + task * num_of_col_buf;
+    FOR_RANGE(int64_t, i, begin, end) {
+      state.im2col_func_(in + i * state.in_5d_shape_.Count(1), ShapeView(state.in_5d_shape_),
+                         ShapeView(state.weight_5d_shape_), ShapeView(state.out_5d_shape_),
+                         state.strides_3d_.data(), state.dilation_rate_3d_.data(),
+                         state.padding_before_3d_.data(), col_buf_dptr);
+
+      // channels first: out = weight * col_buf
+      // channels last:  out = (weight * col_buf)(T)
+      state.forward_func_(CblasNoTrans, CblasNoTrans,
+                          state.weight_5d_shape_.At(0),                           // filter
+                          state.out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
+                          state.weight_5d_shape_.Count(1),  // ci * kd * kh * kw
+                          static_cast<T>(1), weight, col_buf_dptr, static_cast<T>(0),
+                          out + i * state.out_5d_shape_.Count(1));
+
+      if (bias != nullptr) {
+        // channels first:  out += bias * bias_mul
+        // channels last:   out += (bias * bias_mul)(T)
+        state.forward_func_(CblasNoTrans, CblasNoTrans,
+                            state.weight_5d_shape_.At(0),                           // filter
+                            state.out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
+                            1,                                                      // 1
+                            static_cast<T>(1), bias, bias_mul_dptr, static_cast<T>(1),
+                            out + i * state.out_5d_shape_.Count(1));
+      }
+    }
+  });
+}
+
+template<typename T>
+void ConvCpuKernelUtil<T>::DataGrad(const ConvOpKernelState<T>& state, bool is_direct,
+                                    const T* dy, const T* weight, T* tmp_buf,
+                                    size_t tmp_buf_size, T* dx) {
+  if (is_direct) {
+    DirectConvUtil<T>::DataGrad(state, dy, weight, dx);
+    return;
+  }
+  const int32_t idx_offset = state.idx_offset_;
+  const int64_t sample_num = state.out_5d_shape_.At(0);
+  const int64_t task_num = ConvCpuTaskNum(sample_num);
+  const int64_t num_of_col_buf =
+      CalcElemNumOfColBuf(ShapeView(state.out_5d_shape_), ShapeView(state.weight_5d_shape_),
+                          idx_offset);
+  CHECK_LE(task_num * num_of_col_buf * sizeof(T), tmp_buf_size);
+
+  ForEachSampleRange(sample_num, task_num, [&](int64_t task, int64_t begin, int64_t end) {
+    T* col_buf_dptr = tmp_buf + task * num_of_col_buf;
+    FOR_RANGE(int64_t, i, begin, end) {
+      // channels first:  col_buf' = weight(T) * out[i]'
+      // channels last :  col_buf' = weight(T) * out[i]'(T)
+      NewKernelUtil<DeviceType::kCPU>::OFGemm(
+          nullptr, CblasTrans, state.is_out_diff_need_trans_,
+          state.weight_5d_shape_.Count(1),                        //  ci * kd * kh * kw
+          state.out_5d_shape_.Count(idx_offset, idx_offset + 3),  //  od * oh * ow
+          state.weight_5d_shape_.At(0),                           //  filter
+          static_cast<T>(1), weight, dy + i * state.out_5d_shape_.Count(1), static_cast<T>(0),
+          col_buf_dptr);
+
+      // in' = col2im(col_buf')
+      T* dx_dptr = dx + i * state.in_5d_shape_.Count(1);
+      std::fill(dx_dptr, dx_dptr + state.in_5d_shape_.Count(1), static_cast<T>(0));
+      state.col2im_func_(col_buf_dptr, ShapeView(state.in_5d_shape_),
+                         ShapeView(state.weight_5d_shape_), ShapeView(state.out_5d_shape_),
+                         state.strides_3d_.data(), state.dilation_rate_3d_.data(),
+                         state.padding_before_3d_.data(), dx_dptr);
+    }
+  });
+}
+
+template<typename T>
+void ConvCpuKernelUtil<T>::FilterGrad(const ConvOpKernelState<T>& state, bool is_direct,
+                                      const T* dy, const T* x, T* tmp_buf, size_t tmp_buf_size,
+                                      T* filter_diff) {
+  const int32_t idx_offset = state.idx_offset_;
+  const int64_t sample_num = state.out_5d_shape_.At(0);
+  const int64_t task_num = ConvCpuTaskNum(sample_num);
+  const int64_t num_of_col_buf =
+      is_direct ? 0
+                : CalcElemNumOfColBuf(ShapeView(state.out_5d_shape_),
+                                      ShapeView(state.weight_5d_shape_), idx_offset);
+  const int64_t num_of_filter_diff = state.weight_5d_shape_.elem_cnt();
+  // the tasks but the first one accumulate into partial filter diffs of their own
+  CHECK_LE((task_num * num_of_col_buf + (task_num - 1) * num_of_filter_diff) * sizeof(T),
+           tmp_buf_size);
+  T* partial_filter_diff_dptr = tmp_buf + task_num * num_of_col_buf;
+
+  ForEachSampleRange(sample_num, task_num, [&](int64_t task, int64_t begin, int64_t end) {
+    T* filter_diff_dptr =
+        task == 0 ? filter_diff : partial_filter_diff_dptr + (task - 1) * num_of_filter_diff;
+    std::fill(filter_diff_dptr, filter_diff_dptr + num_of_filter_diff, static_cast<T>(0));
+    if (is_direct) {
+      DirectConvUtil<T>::FilterGrad(state, dy, x, begin, end, filter_diff_dptr);
+      return;
+    }
+    T* col_buf_dptr = tmp_buf + task * num_of_col_buf;
+    FOR_RANGE(int64_t, i, begin, end) {
+      state.im2col_func_(x + i * state.in_5d_shape_.Count(1), ShapeView(state.in_5d_shape_),
+                         ShapeView(state.weight_5d_shape_), ShapeView(state.out_5d_shape_),
+                         state.strides_3d_.data(), state.dilation_rate_3d_.data(),
+                         state.padding_before_3d_.data(), col_buf_dptr);
+
+      // channels first:  weight' += out[i]' * col_buf(T)
+      // channels last :  weight' += out[i]'(T) * col_buf(T)
+      NewKernelUtil<DeviceType::kCPU>::OFGemm(
+          nullptr, state.is_out_diff_need_trans_, CblasTrans,
+          state.weight_5d_shape_.At(0),                           //  filter
+          state.weight_5d_shape_.Count(1),                        //  ci * kd * kh * kw
+          state.out_5d_shape_.Count(idx_offset, idx_offset + 3),  //  od * oh * ow
+          static_cast<T>(1), dy + i * state.out_5d_shape_.Count(1), col_buf_dptr,
+          static_cast<T>(1), filter_diff_dptr);
+    }
+  });
+  if (task_num > 1) {
+    ParallelForTasks(num_of_filter_diff, kFilterDiffSumGrainSize, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, task, 1, task_num) {
+        const T* partial = partial_filter_diff_dptr + (task - 1) * num_of_filter_diff;
+        FOR_RANGE(int64_t, i, begin, end) { filter_diff[i] += partial[i]; }
+      }
+    });
+  }
+}
+
+template struct ConvCpuKernelUtil<float>;
+template struct ConvCpuKernelUtil<double>;
+
+namespace {
+
+template<typename T>
+std::shared_ptr<ConvOpKernelState<T>> CreateConvOpKernelState(user_op::KernelInitContext* ctx,
+                                                              const std::string& in_name,
+                                                              const std::string& out_name,
+                                                              const std::string& weight_name) {
+  return ConvCpuKernelUtil<T>::NewConvOpKernelState(
+      ctx->Attr<std::string>("data_format"), ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->shape(),
+      ctx->TensorDesc4ArgNameAndIndex(out_name, 0)->shape(),
+      ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape(),
+      ctx->Attr<std::vector<int32_t>>("strides"), ctx->Attr<std::vector<int32_t>>("dilation_rate"),
+      ctx->Attr<std::vector<int32_t>>("padding_before"));
 }
 
 template<typename T, size_t NDims>
@@ -395,84 +745,56 @@ class ConvCpuKernel final : public user_op::OpKernel {
 
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return CreateConvOpKernelState<T>(ctx, "in", "out", "weight");
+  }
+
  private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
-    const auto& conv_state = CreateConvOpKernelState<T>(ctx, "in", "out", "weight");
-    CHECK_NOTNULL(conv_state.get());
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    auto* conv_state = dynamic_cast<ConvOpKernelState<T>*>(state);
+    CHECK_NOTNULL(conv_state);
 
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
-    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
 
-    T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
-
-    bool is_bias_mul_inited = false;
-    for (int64_t i = 0; i < in->shape().At(0); ++i) {
-      conv_state->im2col_func_(GetImgDptr<T>(in, i), ShapeView(conv_state->in_5d_shape_),
-                               ShapeView(conv_state->weight_5d_shape_),
-                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
-                               conv_state->dilation_rate_3d_.data(),
-                               conv_state->padding_before_3d_.data(), col_buf_dptr);
-
-      // channels first: out = weight * col_buf
-      // channels last:  out = (weight * col_buf)(T)
-      int32_t idx_offset = conv_state->idx_offset_;
-      conv_state->forward_func_(
-          CblasNoTrans, CblasNoTrans,
-          conv_state->weight_5d_shape_.At(0),                           // filter
-          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-          conv_state->weight_5d_shape_.Count(1),                        // ci * kd * kh * kw
-          static_cast<T>(1), weight->dptr<T>(), col_buf_dptr, static_cast<T>(0),
-          GetImgMutDptr<T>(out, i));
-
-      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
-      if (bias != nullptr) {
-        int64_t num_of_col_buf = CalcElemNumOfColBuf(out->shape(), weight->shape(), idx_offset);
-        int64_t num_of_bias_mul =
-            (tmp_buffer->shape().elem_cnt() - num_of_col_buf * sizeof(T)) / sizeof(T);
-        CHECK_GT(num_of_bias_mul, 0);
-        T* bias_mul_dptr = col_buf_dptr + num_of_col_buf;
-        if (!is_bias_mul_inited) {
-          InitBiasMulBuf(bias_mul_dptr, num_of_bias_mul);
-          is_bias_mul_inited = true;
-        }
-
-        // channels first:  out += bias * bias_mul
-        // channels last:   out += (bias * bias_mul)(T)
-        conv_state->forward_func_(
-            CblasNoTrans, CblasNoTrans,
-            conv_state->weight_5d_shape_.At(0),                           // filter
-            conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-            1,                                                            // 1
-            static_cast<T>(1), bias->dptr<T>(), bias_mul_dptr, static_cast<T>(1),
-            GetImgMutDptr<T>(out, i));
-      }
-    }
+    conv_state->Update(in->shape(), out->shape(), weight->shape());
+    const bool is_direct = IsDirectConv(ctx->Attr<std::string>("data_format"), weight->shape());
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    ConvCpuKernelUtil<T>::Forward(*conv_state, is_direct, in->dptr<T>(), weight->dptr<T>(),
+                                  bias == nullptr ? nullptr : bias->dptr<T>(),
+                                  tmp_buffer->mut_dptr<T>(), tmp_buffer->shape().elem_cnt(),
+                                  out->mut_dptr<T>());
   }
 };
 
-#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                         \
-  REGISTER_USER_KERNEL(#op_name)                                                            \
-      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                           \
-      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                   \
-                       & (user_op::HobAttr<int32_t>("groups") == 1)                         \
-                       & (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))      \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                         \
-        size_t tmp_buffer_size = 0;                                                         \
-        const auto& out_shape = ctx->OutputTensorDesc("out", 0)->shape();                   \
-        const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();               \
-                                                                                            \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));              \
-        tmp_buffer_size +=                                                                  \
-            CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset) * sizeof(dtype);       \
-        bool has_bias = ctx->has_input("bias", 0);                                          \
-        if (has_bias) {                                                                     \
-          int64_t bias_mul_cnt = 1;                                                         \
-          for (int i = 0; i < ndims; ++i) { bias_mul_cnt *= out_shape.At(idx_offset + i); } \
-          tmp_buffer_size += bias_mul_cnt * sizeof(dtype);                                  \
-        }                                                                                   \
-        return tmp_buffer_size;                                                             \
+#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                              \
+  REGISTER_USER_KERNEL(#op_name)                                                                 \
+      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                                \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                        \
+                       & (user_op::HobAttr<int32_t>("groups") == 1)                              \
+                       & (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))           \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                              \
+        size_t tmp_buffer_size = 0;                                                              \
+        const auto& in_shape = ctx->InputTensorDesc("in", 0).shape();                            \
+        const auto& out_shape = ctx->OutputTensorDesc("out", 0)->shape();                        \
+        const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();                    \
+        const auto& data_format = ctx->Attr<std::string>("data_format");                         \
+        if (IsDirectConv(data_format, weight_shape)) { return 0; }                               \
+                                                                                                 \
+        int64_t idx_offset = IdxOffset(data_format);                                             \
+        const int64_t task_num = ConvCpuTaskNum(in_shape.At(0));                                 \
+        tmp_buffer_size +=                                                                       \
+            task_num * CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset) * sizeof(dtype); \
+        bool has_bias = ctx->has_input("bias", 0);                                               \
+        if (has_bias) {                                                                          \
+          int64_t bias_mul_cnt = 1;                                                              \
+          for (int i = 0; i < ndims; ++i) { bias_mul_cnt *= out_shape.At(idx_offset + i); }      \
+          tmp_buffer_size += bias_mul_cnt * sizeof(dtype);                                       \
+        }                                                                                        \
+        return tmp_buffer_size;                                                                  \
       })
 
 REGISTER_CONV_KERNEL(conv1d, float, 1);
@@ -491,38 +813,26 @@ class ConvDataGradCpuKernel final : public user_op::OpKernel {
 
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return CreateConvOpKernelState<T>(ctx, "dx", "dy", "filter");
+  }
+
  private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
-    const auto& conv_state = CreateConvOpKernelState<T>(ctx, "dx", "dy", "filter");
-    CHECK_NOTNULL(conv_state.get());
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    auto* conv_state = dynamic_cast<ConvOpKernelState<T>*>(state);
+    CHECK_NOTNULL(conv_state);
 
     const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
     const user_op::Tensor* filter = ctx->Tensor4ArgNameAndIndex("filter", 0);
     user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
-    user_op::Tensor* col_buf = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
 
-    Memset<DeviceType::kCPU>(ctx->device_ctx(), dx->mut_dptr<T>(), 0,
-                             dx->shape().elem_cnt() * sizeof(T));
-
-    int32_t idx_offset = conv_state->idx_offset_;
-    FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
-      // channels first:  col_buf' = weight(T) * out[i]'
-      // channels last :  col_buf' = weight(T) * out[i]'(T)
-      NewKernelUtil<DeviceType::kCPU>::OFGemm(
-          nullptr, CblasTrans, conv_state->is_out_diff_need_trans_,
-          conv_state->weight_5d_shape_.Count(1),                        //  ci * kd * kh * kw
-          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  //  od * oh * ow
-          conv_state->weight_5d_shape_.At(0),                           //  filter
-          static_cast<T>(1), filter->dptr<T>(), GetImgDptr<T>(dy, i), static_cast<T>(0),
-          col_buf->mut_dptr<T>());
-
-      // in' = col2im(col_buf')
-      conv_state->col2im_func_(col_buf->dptr<T>(), ShapeView(conv_state->in_5d_shape_),
-                               ShapeView(conv_state->weight_5d_shape_),
-                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
-                               conv_state->dilation_rate_3d_.data(),
-                               conv_state->padding_before_3d_.data(), GetImgMutDptr<T>(dx, i));
-    }
+    conv_state->Update(dx->shape(), dy->shape(), filter->shape());
+    const bool is_direct = IsDirectConv(ctx->Attr<std::string>("data_format"), filter->shape());
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    ConvCpuKernelUtil<T>::DataGrad(*conv_state, is_direct, dy->dptr<T>(), filter->dptr<T>(),
+                                   tmp_buffer->mut_dptr<T>(), tmp_buffer->shape().elem_cnt(),
+                                   dx->mut_dptr<T>());
     if (ctx->has_input("_add_to_output", 0)) {
       const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
       CHECK_EQ(add_to_output->data_type(), dx->data_type());
@@ -534,21 +844,24 @@ class ConvDataGradCpuKernel final : public user_op::OpKernel {
   }
 };
 
-#define REGISTER_CONV_DATA_GRAD_KERNEL(op_name, dtype)                                     \
-  REGISTER_USER_KERNEL(#op_name)                                                           \
-      .SetCreateFn<ConvDataGradCpuKernel<dtype>>()                                         \
-      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                  \
-                       & (user_op::HobAttr<int32_t>("groups") == 1)                        \
-                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))     \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                        \
-        size_t tmp_buffer_size = 0;                                                        \
-        const auto& out_diff_shape = ctx->InputTensorDesc("dy", 0).shape();                \
-        const auto& weight_shape = ctx->InputTensorDesc("filter", 0).shape();              \
-                                                                                           \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));             \
-        tmp_buffer_size +=                                                                 \
-            CalcElemNumOfColBuf(out_diff_shape, weight_shape, idx_offset) * sizeof(dtype); \
-        return tmp_buffer_size;                                                            \
+#define REGISTER_CONV_DATA_GRAD_KERNEL(op_name, dtype)                                      \
+  REGISTER_USER_KERNEL(#op_name)                                                            \
+      .SetCreateFn<ConvDataGradCpuKernel<dtype>>()                                          \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                   \
+                       & (user_op::HobAttr<int32_t>("groups") == 1)                         \
+                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))      \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                         \
+        size_t tmp_buffer_size = 0;                                                         \
+        const auto& out_diff_shape = ctx->InputTensorDesc("dy", 0).shape();                 \
+        const auto& weight_shape = ctx->InputTensorDesc("filter", 0).shape();               \
+        const auto& data_format = ctx->Attr<std::string>("data_format");                    \
+        if (IsDirectConv(data_format, weight_shape)) { return 0; }                          \
+                                                                                            \
+        int64_t idx_offset = IdxOffset(data_format);                                        \
+        const int64_t task_num = ConvCpuTaskNum(out_diff_shape.At(0));                      \
+        tmp_buffer_size += task_num * sizeof(dtype)                                         \
+                           * CalcElemNumOfColBuf(out_diff_shape, weight_shape, idx_offset); \
+        return tmp_buffer_size;                                                             \
       })
 
 REGISTER_CONV_DATA_GRAD_KERNEL(conv_data_grad, float);
@@ -563,54 +876,51 @@ class ConvFilterGradCpuKernel final : public user_op::OpKernel {
 
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    return CreateConvOpKernelState<T>(ctx, "x", "dy", "filter_diff");
+  }
+
  private:
-  void Compute(user_op::KernelComputeContext* ctx) const override {
-    const auto& conv_state = CreateConvOpKernelState<T>(ctx, "x", "dy", "filter_diff");
-    CHECK_NOTNULL(conv_state.get());
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state) const override {
+    auto* conv_state = dynamic_cast<ConvOpKernelState<T>*>(state);
+    CHECK_NOTNULL(conv_state);
 
     const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
     const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
     user_op::Tensor* filter_diff = ctx->Tensor4ArgNameAndIndex("filter_diff", 0);
-    user_op::Tensor* col_buf = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
-
-    Memset<DeviceType::kCPU>(ctx->device_ctx(), filter_diff->mut_dptr<T>(), 0,
-                             filter_diff->shape().elem_cnt() * sizeof(T));
-    int32_t idx_offset = conv_state->idx_offset_;
-    FOR_RANGE(int64_t, i, 0, dy->shape().At(0)) {
-      conv_state->im2col_func_(GetImgDptr<T>(x, i), ShapeView(conv_state->in_5d_shape_),
-                               ShapeView(conv_state->weight_5d_shape_),
-                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
-                               conv_state->dilation_rate_3d_.data(),
-                               conv_state->padding_before_3d_.data(), col_buf->mut_dptr<T>());
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
 
-      // channels first:  weight' += out[i]' * col_buf(T)
-      // channels last :  weight' += out[i]'(T) * col_buf(T)
-      NewKernelUtil<DeviceType::kCPU>::OFGemm(
-          nullptr, conv_state->is_out_diff_need_trans_, CblasTrans,
-          conv_state->weight_5d_shape_.At(0),                           //  filter
-          conv_state->weight_5d_shape_.Count(1),                        //  ci * kd * kh * kw
-          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  //  od * oh * ow
-          static_cast<T>(1), GetImgDptr<T>(dy, i), col_buf->dptr<T>(), static_cast<T>(1),
-          filter_diff->mut_dptr<T>());
-    }
+    conv_state->Update(x->shape(), dy->shape(), filter_diff->shape());
+    const bool is_direct =
+        IsDirectConv(ctx->Attr<std::string>("data_format"), filter_diff->shape());
+    ConvCpuKernelUtil<T>::FilterGrad(*conv_state, is_direct, dy->dptr<T>(), x->dptr<T>(),
+                                     tmp_buffer->mut_dptr<T>(), tmp_buffer->shape().elem_cnt(),
+                                     filter_diff->mut_dptr<T>());
   }
 };
 
-#define REGISTER_CONV_FILTER_GRAD_KERNEL(op_name, dtype)                                        \
-  REGISTER_USER_KERNEL(#op_name)                                                                \
-      .SetCreateFn<ConvFilterGradCpuKernel<dtype>>()                                            \
-      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                       \
-                       & (user_op::HobAttr<int32_t>("groups") == 1)                             \
-                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))          \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                             \
-        size_t tmp_buffer_size = 0;                                                             \
-        const auto& out_diff_shape = ctx->InputTensorDesc("dy", 0).shape();                     \
-        const auto& weight_diff_shape = ctx->OutputTensorDesc("filter_diff", 0)->shape();       \
-                                                                                                \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));                  \
-        tmp_buffer_size +=                                                                      \
-            CalcElemNumOfColBuf(out_diff_shape, weight_diff_shape, idx_offset) * sizeof(dtype); \
-        return tmp_buffer_size;                                                                 \
+#define REGISTER_CONV_FILTER_GRAD_KERNEL(op_name, dtype)                                  \
+  REGISTER_USER_KERNEL(#op_name)                                                          \
+      .SetCreateFn<ConvFilterGradCpuKernel<dtype>>()                                      \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                 \
+                       & (user_op::HobAttr<int32_t>("groups") == 1)                       \
+                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))    \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                       \
+        size_t tmp_buffer_size = 0;                                                       \
+        const auto& out_diff_shape = ctx->InputTensorDesc("dy", 0).shape();               \
+        const auto& weight_diff_shape = ctx->OutputTensorDesc("filter_diff", 0)->shape(); \
+        const auto& data_format = ctx->Attr<std::string>("data_format");                  \
+        const int64_t task_num = ConvCpuTaskNum(out_diff_shape.At(0));                    \
+                                                                                          \
+        int64_t idx_offset = IdxOffset(data_format);                                      \
+        if (!IsDirectConv(data_format, weight_diff_shape)) {                              \
+          tmp_buffer_size += task_num * sizeof(dtype)                                     \
+                             * CalcElemNumOfColBuf(out_diff_shape, weight_diff_shape,     \
+                                                   idx_offset);                           \
+        }                                                                                 \
+        tmp_buffer_size += (task_num - 1) * weight_diff_shape.elem_cnt() * sizeof(dtype); \
+        return tmp_buffer_size;                                                           \
       })
 
 REGISTER_CONV_FILTER_GRAD_KERNEL(conv_filter_grad, float);
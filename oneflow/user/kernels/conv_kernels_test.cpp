@@ -0,0 +1,310 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <cstring>
+#include <map>
+#include "oneflow/core/common/cpu_test_util.h"
+#include "oneflow/core/framework/op_kernel.h"
+#include "oneflow/core/framework/user_op_registry_manager.h"
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+class HostTensor final : public user_op::Tensor {
+ public:
+  HostTensor(const Shape& shape, DataType data_type, size_t byte_size)
+      : shape_(shape), shape_view_(shape_), data_type_(data_type), buf_(byte_size) {
+    mem_case_.mutable_host_mem();
+  }
+  ~HostTensor() = default;
+
+  const ShapeView& shape() const override { return shape_view_; }
+  MutShapeView* mut_shape() override {
+    UNIMPLEMENTED();
+    return nullptr;
+  }
+  DataType data_type() const override { return data_type_; }
+  const MemoryCase& mem_case() const override { return mem_case_; }
+  const void* raw_dptr() const override { return buf_.data(); }
+  void* mut_raw_dptr() override { return buf_.data(); }
+
+ private:
+  Shape shape_;
+  ShapeView shape_view_;
+  DataType data_type_;
+  MemoryCase mem_case_;
+  std::vector<char> buf_;
+};
+
+// Runs a CPU user kernel on host tensors. As in the eager interpreter, the kernel and its state
+// are created at the first Run and kept for the later ones, whatever the tensor shapes are.
+class KernelTestContext final : public user_op::KernelRegContext,
+                                public user_op::KernelInitContext,
+                                public user_op::KernelComputeContext {
+ public:
+  explicit KernelTestContext(const user_op::UserOpConfWrapper& user_op_conf)
+      : user_op_conf_(user_op_conf) {
+    for (const auto& pair : user_op_conf_.user_op_conf().input()) {
+      FOR_RANGE(int32_t, i, 0, pair.second.s_size()) { inputs_.emplace_back(pair.first, i); }
+    }
+    for (const auto& pair : user_op_conf_.user_op_conf().output()) {
+      FOR_RANGE(int32_t, i, 0, pair.second.s_size()) { outputs_.emplace_back(pair.first, i); }
+    }
+    parallel_ctx_.set_parallel_id(0);
+    parallel_ctx_.set_parallel_num(1);
+  }
+  ~KernelTestContext() override = default;
+
+  template<typename T>
+  void SetTensor(const std::string& arg_name, const Shape& shape, const std::vector<T>& data) {
+    CHECK_EQ(shape.elem_cnt(), static_cast<int64_t>(data.size()));
+    const auto key = std::make_pair(arg_name, 0);
+    tensors_[key].reset(new HostTensor(shape, GetDataType<T>::value, data.size() * sizeof(T)));
+    std::memcpy(tensors_.at(key)->mut_raw_dptr(), data.data(), data.size() * sizeof(T));
+    user_op::NaiveTensorDesc* desc = &tensor_descs_[key];
+    *desc->mut_shape() = shape;
+    *desc->mut_data_type() = GetDataType<T>::value;
+    desc->set_is_dynamic(false);
+  }
+  void SetTmpBuffer(size_t byte_size) {
+    tensors_[std::make_pair(std::string("tmp_buffer"), 0)].reset(
+        new HostTensor(Shape({static_cast<int64_t>(byte_size)}), DataType::kChar, byte_size));
+  }
+  template<typename T>
+  std::vector<T> GetTensor(const std::string& arg_name) const {
+    const HostTensor* tensor = tensors_.at(std::make_pair(arg_name, 0)).get();
+    const T* dptr = tensor->dptr<T>();
+    return std::vector<T>(dptr, dptr + tensor->shape().elem_cnt());
+  }
+
+  void Run() {
+    if (!kernel_) {
+      const user_op::OpKernelRegistryResult* result =
+          CHECK_JUST(user_op::UserOpRegistryMgr::Get().GetOpKernelRegistryResult(
+              user_op_conf_.op_type_name(), *this));
+      kernel_.reset(result->create_fn(nullptr));
+      state_ = kernel_->CreateOpKernelState(this);
+    }
+    kernel_->Compute(this, state_.get());
+  }
+
+  DeviceCtx* device_ctx() override { return nullptr; }
+  DeviceType device_type() const override { return DeviceType::kCPU; }
+  const std::string& device_tag() const override {
+    static const std::string device_tag = "cpu";
+    return device_tag;
+  }
+  const ParallelContext& parallel_ctx() const override { return parallel_ctx_; }
+  const JobDesc& job_desc() const override {
+    UNIMPLEMENTED();
+    return *(const JobDesc*)nullptr;
+  }
+  const ParallelDesc& parallel_desc() const override {
+    UNIMPLEMENTED();
+    return *(const ParallelDesc*)nullptr;
+  }
+  const cfg::SbpParallel& SbpParallel4ArgNameAndIndex(const std::string& arg_name,
+                                                      int32_t index) const override {
+    UNIMPLEMENTED();
+    return *(const cfg::SbpParallel*)nullptr;
+  }
+  const cfg::NdSbp& NdSbp4ArgNameAndIndex(const std::string& arg_name,
+                                          int32_t index) const override {
+    UNIMPLEMENTED();
+    return *(const cfg::NdSbp*)nullptr;
+  }
+  const user_op::TensorDesc* LogicalTensorDesc4ArgNameAndIndex(const std::string& arg_name,
+                                                               int32_t index) const override {
+    return TensorDesc4ArgNameAndIndex(arg_name, index);
+  }
+  const user_op::TensorDesc* TensorDesc4ArgNameAndIndex(const std::string& arg_name,
+                                                        int32_t index) const override {
+    const auto it = tensor_descs_.find(std::make_pair(arg_name, index));
+    return it == tensor_descs_.end() ? nullptr : &it->second;
+  }
+  user_op::Tensor* Tensor4ArgNameAndIndex(const std::string& arg_name, int32_t index) override {
+    const auto it = tensors_.find(std::make_pair(arg_name, index));
+    return it == tensors_.end() ? nullptr : it->second.get();
+  }
+  const std::vector<std::pair<std::string, int32_t>>& inputs() const override { return inputs_; }
+  const std::vector<std::pair<std::string, int32_t>>& outputs() const override {
+    return outputs_;
+  }
+  const user_op::UserOpConfWrapper& user_op_conf() const override { return user_op_conf_; }
+
+ private:
+  const std::shared_ptr<const user_op::AttrVal>& Attr4Name(
+      const std::string& attr_name) const override {
+    return user_op_conf_.Attr4Name(attr_name);
+  }
+
+  user_op::UserOpConfWrapper user_op_conf_;
+  std::vector<std::pair<std::string, int32_t>> inputs_;
+  std::vector<std::pair<std::string, int32_t>> outputs_;
+  ParallelContext parallel_ctx_;
+  std::map<std::pair<std::string, int32_t>, std::unique_ptr<HostTensor>> tensors_;
+  std::map<std::pair<std::string, int32_t>, user_op::NaiveTensorDesc> tensor_descs_;
+  std::unique_ptr<const user_op::OpKernel> kernel_;
+  std::shared_ptr<user_op::OpKernelState> state_;
+};
+
+// A channels first 2d convolution of square kernels, strides and paddings
+struct ConvShape {
+  int64_t sample_num;
+  int64_t in_channel;
+  int64_t in_height;
+  int64_t in_width;
+  int64_t filter_num;
+  int32_t kernel_size;
+  int32_t stride;
+  int32_t padding;
+  int64_t out_height() const { return (in_height + 2 * padding - kernel_size) / stride + 1; }
+  int64_t out_width() const { return (in_width + 2 * padding - kernel_size) / stride + 1; }
+  Shape x_shape() const { return Shape({sample_num, in_channel, in_height, in_width}); }
+  Shape y_shape() const { return Shape({sample_num, filter_num, out_height(), out_width()}); }
+  Shape w_shape() const { return Shape({filter_num, in_channel, kernel_size, kernel_size}); }
+};
+
+// Calls Handler(x_index, w_index, y_index) for every product term of the convolution
+template<typename HandlerT>
+void ForEachConvTerm(const ConvShape& s, const HandlerT& Handler) {
+  const int64_t k = s.kernel_size;
+  FOR_RANGE(int64_t, n, 0, s.sample_num) {
+    FOR_RANGE(int64_t, f, 0, s.filter_num) {
+      FOR_RANGE(int64_t, oh, 0, s.out_height()) {
+        FOR_RANGE(int64_t, ow, 0, s.out_width()) {
+          const int64_t y_index =
+              ((n * s.filter_num + f) * s.out_height() + oh) * s.out_width() + ow;
+          FOR_RANGE(int64_t, c, 0, s.in_channel) {
+            FOR_RANGE(int64_t, kh, 0, k) {
+              const int64_t ih = oh * s.stride - s.padding + kh;
+              if (ih < 0 || ih >= s.in_height) { continue; }
+              FOR_RANGE(int64_t, kw, 0, k) {
+                const int64_t iw = ow * s.stride - s.padding + kw;
+                if (iw < 0 || iw >= s.in_width) { continue; }
+                Handler(((n * s.in_channel + c) * s.in_height + ih) * s.in_width + iw,
+                        ((f * s.in_channel + c) * k + kh) * k + kw, y_index);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+void ExpectNear(const std::vector<double>& expected, const std::vector<double>& actual,
+                const std::string& what) {
+  ASSERT_EQ(expected.size(), actual.size()) << what;
+  FOR_RANGE(size_t, i, 0, expected.size()) {
+    ASSERT_NEAR(expected.at(i), actual.at(i), 1e-9) << what << " at " << i;
+  }
+}
+
+user_op::UserOpConfWrapper NewConvConf(const std::string& op_type_name, const ConvShape& s,
+                                       const std::vector<std::string>& input_arg_names,
+                                       const std::string& output_arg_name) {
+  user_op::UserOpConfWrapperBuilder builder(op_type_name);
+  builder.Op(op_type_name);
+  for (const std::string& arg_name : input_arg_names) { builder.Input(arg_name, "in/" + arg_name); }
+  builder.Output(output_arg_name)
+      .Attr<std::vector<int32_t>>("padding_before", {s.padding, s.padding})
+      .Attr<std::string>("data_format", "channels_first")
+      .Attr<std::vector<int32_t>>("kernel_size", {s.kernel_size, s.kernel_size})
+      .Attr<std::vector<int32_t>>("strides", {s.stride, s.stride})
+      .Attr<std::vector<int32_t>>("dilation_rate", {1, 1})
+      .Attr<int32_t>("groups", 1);
+  if (op_type_name == "conv2d") {
+    builder.Attr<int32_t>("filters", static_cast<int32_t>(s.filter_num));
+  } else {
+    builder.Attr<int32_t>("num_spatial_dims", 2);
+  }
+  return builder.Build();
+}
+
+size_t ColBufSize(const ConvShape& s) {
+  return ConvCpuTaskNum(s.sample_num) * sizeof(double)
+         * CalcElemNumOfColBuf(s.y_shape(), s.w_shape(), 2);
+}
+
+// The conv kernels of one op run on several shapes in turn, as the eager kernels do when the
+// batch or the spatial size changes between the calls
+void TestConvKernelsOnShapes(const std::vector<ConvShape>& conv_shapes) {
+  const ConvShape& first = conv_shapes.front();
+  KernelTestContext forward_ctx(NewConvConf("conv2d", first, {"in", "weight"}, "out"));
+  KernelTestContext data_grad_ctx(
+      NewConvConf("conv_data_grad", first, {"dy", "filter", "x_like"}, "dx"));
+  KernelTestContext filter_grad_ctx(NewConvConf("conv_filter_grad", first, {"dy", "x"},
+                                                "filter_diff"));
+  FOR_RANGE(size_t, i, 0, conv_shapes.size()) {
+    const ConvShape& s = conv_shapes.at(i);
+    const std::string what = "shape " + std::to_string(i) + " " + s.x_shape().ToString();
+    const std::vector<double> x = RandomVector<double>(s.x_shape().elem_cnt(), 3 * i + 1, -1, 1);
+    const std::vector<double> w = RandomVector<double>(s.w_shape().elem_cnt(), 3 * i + 2, -1, 1);
+    const std::vector<double> dy = RandomVector<double>(s.y_shape().elem_cnt(), 3 * i + 3, -1, 1);
+    std::vector<double> y(s.y_shape().elem_cnt(), 0);
+    std::vector<double> dx(s.x_shape().elem_cnt(), 0);
+    std::vector<double> dw(s.w_shape().elem_cnt(), 0);
+    ForEachConvTerm(s, [&](int64_t x_index, int64_t w_index, int64_t y_index) {
+      y.at(y_index) += x.at(x_index) * w.at(w_index);
+      dx.at(x_index) += dy.at(y_index) * w.at(w_index);
+      dw.at(w_index) += dy.at(y_index) * x.at(x_index);
+    });
+
+    forward_ctx.SetTensor("in", s.x_shape(), x);
+    forward_ctx.SetTensor("weight", s.w_shape(), w);
+    forward_ctx.SetTensor("out", s.y_shape(), std::vector<double>(y.size(), 0));
+    forward_ctx.SetTmpBuffer(ColBufSize(s));
+    forward_ctx.Run();
+    ExpectNear(y, forward_ctx.GetTensor<double>("out"), "forward of " + what);
+
+    data_grad_ctx.SetTensor("dy", s.y_shape(), dy);
+    data_grad_ctx.SetTensor("filter", s.w_shape(), w);
+    data_grad_ctx.SetTensor("x_like", s.x_shape(), x);
+    data_grad_ctx.SetTensor("dx", s.x_shape(), std::vector<double>(dx.size(), 0));
+    data_grad_ctx.SetTmpBuffer(ColBufSize(s));
+    data_grad_ctx.Run();
+    ExpectNear(dx, data_grad_ctx.GetTensor<double>("dx"), "data grad of " + what);
+
+    filter_grad_ctx.SetTensor("dy", s.y_shape(), dy);
+    filter_grad_ctx.SetTensor("x", s.x_shape(), x);
+    filter_grad_ctx.SetTensor("filter_diff", s.w_shape(), std::vector<double>(dw.size(), 0));
+    filter_grad_ctx.SetTmpBuffer(ColBufSize(s)
+                                 + (ConvCpuTaskNum(s.sample_num) - 1) * dw.size() * sizeof(double));
+    filter_grad_ctx.Run();
+    ExpectNear(dw, filter_grad_ctx.GetTensor<double>("filter_diff"), "filter grad of " + what);
+  }
+}
+
+}  // namespace
+
+TEST(ConvCpuKernel, batch_size_changes_between_calls) {
+  TestConvKernelsOnShapes({{2, 3, 8, 8, 4, 3, 1, 1}, {5, 3, 8, 8, 4, 3, 1, 1},
+                           {1, 3, 8, 8, 4, 3, 1, 1}});
+}
+
+TEST(ConvCpuKernel, spatial_size_changes_between_calls) {
+  TestConvKernelsOnShapes({{2, 3, 8, 8, 4, 3, 2, 1}, {2, 3, 13, 6, 4, 3, 2, 1},
+                           {2, 3, 5, 5, 4, 3, 2, 1}, {2, 3, 8, 8, 4, 3, 2, 1}});
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -18,8 +18,42 @@ limitations under the License.
 #include "oneflow/core/framework/framework.h"
 
 #include "oneflow/core/common/data_type.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
+
+// Below this elem_cnt the CPU launchers run serially on the calling thread
+constexpr int64_t kCpuElemwiseParallelThreshold = 32 * 1024;
+// Ranges handed to the thread pool are at least this many blocks
+constexpr int64_t kCpuElemwiseMinBlocksPerRange = 64;
+
+// One block is a 64-byte cache line of T, so the ranges of different threads never write to the
+// same cache line.
+template<typename T>
+constexpr int64_t CpuElemwiseBlockSize() { return sizeof(T) >= 64 ? 1 : 64 / sizeof(T); }
+
+// Calls Apply(i) for every i in [0, elem_cnt). Large elem_cnt are split into block-aligned ranges
+// over the thread pool.
+template<typename T, typename F>
+void CpuElemwiseForEach(int64_t elem_cnt, const F& Apply) {
+  constexpr int64_t kBlockSize = CpuElemwiseBlockSize<T>();
+  auto ApplyRange = [&Apply](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) { Apply(i); }
+  };
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (elem_cnt < kCpuElemwiseParallelThreshold || thread_pool == nullptr
+      || thread_pool->thread_num() <= 1) {
+    ApplyRange(0, elem_cnt);
+    return;
+  }
+  const int64_t block_num = (elem_cnt + kBlockSize - 1) / kBlockSize;
+  const int64_t grain_size =
+      std::max<int64_t>(block_num / (thread_pool->thread_num() * 4), kCpuElemwiseMinBlocksPerRange);
+  thread_pool->ParallelFor(block_num, grain_size, [&](size_t block_begin, size_t block_end) {
+    ApplyRange(block_begin * kBlockSize, std::min<int64_t>(block_end * kBlockSize, elem_cnt));
+  });
+}
+
 template<DeviceType device_type, typename FunctorT, typename OutputT, typename InputA>
 struct UnaryElemwiseXpuLauncher final {
   void operator()(DeviceCtx* ctx, int64_t elem_cnt, OutputT* out, const InputA* input_a,
@@ -30,7 +64,7 @@ template<typename FunctorT, typename OutputT, typename InputA>
 struct UnaryElemwiseXpuLauncher<DeviceType::kCPU, FunctorT, OutputT, InputA> final {
   void operator()(DeviceCtx* ctx, int64_t elem_cnt, OutputT* out, const InputA* input_a,
                   FunctorT functor) {
-    FOR_RANGE(int64_t, i, 0, elem_cnt) { out[i] = functor(input_a[i]); }
+    CpuElemwiseForEach<OutputT>(elem_cnt, [=](int64_t i) { out[i] = functor(input_a[i]); });
   }
 };
 
@@ -45,7 +79,8 @@ template<typename FunctorT, typename OutputT, typename InputA, typename InputB>
 struct BinaryElemwiseXpuLauncher<DeviceType::kCPU, FunctorT, OutputT, InputA, InputB> final {
   void operator()(DeviceCtx* ctx, int64_t elem_cnt, OutputT* out, const InputA* input_a,
                   const InputB* input_b, FunctorT functor) {
-    FOR_RANGE(int64_t, i, 0, elem_cnt) { out[i] = functor(input_a[i], input_b[i]); }
+    CpuElemwiseForEach<OutputT>(elem_cnt,
+                                [=](int64_t i) { out[i] = functor(input_a[i], input_b[i]); });
   }
 };
 
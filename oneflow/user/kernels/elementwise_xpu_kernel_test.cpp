@@ -0,0 +1,92 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/elementwise_xpu_kernel.h"
+#include "oneflow/core/common/cpu_test_util.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+struct AddFunctor {
+  float operator()(float a, float b) const { return a + b; }
+};
+
+std::vector<int64_t> TestElemCnts() {
+  return {0, 1, 17, kCpuElemwiseParallelThreshold - 1, kCpuElemwiseParallelThreshold + 3,
+          (1 << 20) + 5};
+}
+
+// every index is applied exactly once, whether the ranges run serially or over the thread pool
+void CheckEveryIndexOnce() {
+  for (int64_t elem_cnt : TestElemCnts()) {
+    std::vector<int32_t> apply_cnt(elem_cnt, 0);
+    int32_t* ptr = apply_cnt.data();
+    CpuElemwiseForEach<float>(elem_cnt, [=](int64_t i) { ptr[i] += 1; });
+    FOR_RANGE(int64_t, i, 0, elem_cnt) { ASSERT_EQ(apply_cnt.at(i), 1) << elem_cnt << " " << i; }
+  }
+}
+
+void CheckBinaryLauncher(int64_t elem_cnt) {
+  const std::vector<float> a = RandomVector<float>(elem_cnt, 1, -10, 10);
+  const std::vector<float> b = RandomVector<float>(elem_cnt, 2, -10, 10);
+  std::vector<float> out(elem_cnt);
+  BinaryElemwiseXpuLauncher<DeviceType::kCPU, AddFunctor, float, float, float>()(
+      nullptr, elem_cnt, out.data(), a.data(), b.data(), AddFunctor());
+  FOR_RANGE(int64_t, i, 0, elem_cnt) { ASSERT_EQ(out.at(i), a.at(i) + b.at(i)); }
+}
+
+}  // namespace
+
+class CpuElemwiseForEachTest : public ThreadPoolTest {};
+
+TEST(CpuElemwiseForEach, every_index_once_without_thread_pool) { CheckEveryIndexOnce(); }
+
+TEST_F(CpuElemwiseForEachTest, every_index_once) { CheckEveryIndexOnce(); }
+
+TEST_F(CpuElemwiseForEachTest, binary_launcher) {
+  for (int64_t elem_cnt : TestElemCnts()) { CheckBinaryLauncher(elem_cnt); }
+}
+
+TEST_F(CpuElemwiseForEachTest, DISABLED_benchmark_binary_launcher) {
+  const int64_t elem_cnt = 1 << 24;
+  const std::vector<float> a = RandomVector<float>(elem_cnt, 1, -10, 10);
+  const std::vector<float> b = RandomVector<float>(elem_cnt, 2, -10, 10);
+  std::vector<float> out(elem_cnt);
+  const float* a_ptr = a.data();
+  const float* b_ptr = b.data();
+  float* out_ptr = out.data();
+  AddFunctor functor;
+  auto Serial = [&]() {
+    FOR_RANGE(int64_t, i, 0, elem_cnt) { out_ptr[i] = functor(a_ptr[i], b_ptr[i]); }
+  };
+  auto Launcher = [&]() {
+    BinaryElemwiseXpuLauncher<DeviceType::kCPU, AddFunctor, float, float, float>()(
+        nullptr, elem_cnt, out_ptr, a_ptr, b_ptr, functor);
+  };
+  Serial();
+  Launcher();
+  const double serial_ms = MeasureMs(Serial);
+  const double launcher_ms = MeasureMs(Launcher);
+  LOG(INFO) << "add of " << elem_cnt << " floats, serial: " << serial_ms
+            << " ms, launcher: " << launcher_ms << " ms on "
+            << Global<ThreadPool>::Get()->thread_num() << " threads";
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -14,9 +14,148 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+#include "oneflow/user/kernels/welford_cpu_util.h"
 
 namespace oneflow {
 
+namespace {
+
+// Approximate number of elements of a task of ParamGrad
+constexpr int64_t kParamGradTaskElemNum = 32 * 1024;
+// Bounds the memory of the partial sums of ParamGrad
+constexpr int64_t kParamGradMaxPartNum = 256;
+
+}  // namespace
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::Forward(int64_t num_instances, int64_t norm_size,
+                                        int64_t instance_size, double epsilon, const T* x,
+                                        const T* gamma, const T* beta, T* normalized, T* y,
+                                        T* mean, T* inv_variance) {
+  const bool has_affine = gamma != nullptr || beta != nullptr;
+  // gamma and beta are applied in the same pass when they cover exactly one instance
+  const bool fuse_affine = has_affine && instance_size == norm_size;
+  MultiThreadLoop(num_instances, [&](size_t i) {
+    const T* row_x = x + i * norm_size;
+    T row_mean = 0;
+    T row_variance = 0;
+    WelfordMeanAndVariance<T>(row_x, norm_size, &row_mean, &row_variance);
+    const T row_inv_variance = static_cast<T>(1) / std::sqrt(row_variance + epsilon);
+    mean[i] = row_mean;
+    inv_variance[i] = row_inv_variance;
+    T* row_normalized = normalized + i * norm_size;
+    T* row_y = y + i * norm_size;
+    if (fuse_affine) {
+      for (int64_t j = 0; j < norm_size; ++j) {
+        const T normalized_val = (row_x[j] - row_mean) * row_inv_variance;
+        row_normalized[j] = normalized_val;
+        const T scaled = gamma ? normalized_val * gamma[j] : normalized_val;
+        row_y[j] = beta ? scaled + beta[j] : scaled;
+      }
+    } else {
+      for (int64_t j = 0; j < norm_size; ++j) {
+        row_normalized[j] = (row_x[j] - row_mean) * row_inv_variance;
+      }
+    }
+  });
+  if (has_affine && !fuse_affine) {
+    CHECK_EQ((num_instances * norm_size) % instance_size, 0);
+    MultiThreadLoop(num_instances * norm_size / instance_size, [&](size_t i) {
+      const T* row_normalized = normalized + i * instance_size;
+      T* row_y = y + i * instance_size;
+      for (int64_t j = 0; j < instance_size; ++j) {
+        const T scaled = gamma ? row_normalized[j] * gamma[j] : row_normalized[j];
+        row_y[j] = beta ? scaled + beta[j] : scaled;
+      }
+    });
+  }
+}
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::Backward(int64_t num_instances, int64_t norm_size, const T* dy,
+                                         const T* x, const T* mean, const T* inv_variance,
+                                         const T* add_to_output, T* dx) {
+  MultiThreadLoop(num_instances, [&](size_t i) {
+    const T* row_dy = dy + i * norm_size;
+    const T* row_x = x + i * norm_size;
+    const T row_mean = mean[i];
+    const T row_inv_variance = inv_variance[i];
+    T sum_dy = 0;
+    T sum_dy_normalized = 0;
+    for (int64_t j = 0; j < norm_size; ++j) {
+      sum_dy += row_dy[j];
+      sum_dy_normalized += row_dy[j] * (row_x[j] - row_mean) * row_inv_variance;
+    }
+    const T mean_dy = sum_dy / static_cast<T>(norm_size);
+    const T mean_dy_normalized = sum_dy_normalized / static_cast<T>(norm_size);
+    T* row_dx = dx + i * norm_size;
+    const T* row_add_to_output = add_to_output ? add_to_output + i * norm_size : nullptr;
+    for (int64_t j = 0; j < norm_size; ++j) {
+      const T normalized_val = (row_x[j] - row_mean) * row_inv_variance;
+      const T dx_val =
+          (row_dy[j] - mean_dy - normalized_val * mean_dy_normalized) * row_inv_variance;
+      row_dx[j] = row_add_to_output ? row_add_to_output[j] + dx_val : dx_val;
+    }
+  });
+}
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::ParamGrad(int64_t n, int64_t m, const T* dy, const T* normalized,
+                                          const T* gamma, T* gamma_diff, T* beta_diff,
+                                          T* normalized_diff) {
+  // Every part reduces a range of rows into its own partial sums, which are then added up in the
+  // order of the parts. The parts depend on the shape only, so do the results.
+  const int64_t part_size = std::max<int64_t>(
+      std::max<int64_t>(kParamGradTaskElemNum / std::max<int64_t>(m, 1), 1),
+      (n + kParamGradMaxPartNum - 1) / kParamGradMaxPartNum);
+  const int64_t part_num = (n + part_size - 1) / part_size;
+  std::vector<T> gamma_diff_parts(gamma_diff ? part_num * m : 0, 0);
+  std::vector<T> beta_diff_parts(beta_diff ? part_num * m : 0, 0);
+  ParallelForTasks(part_num, 1, [&](int64_t part_begin, int64_t part_end) {
+    FOR_RANGE(int64_t, part_id, part_begin, part_end) {
+      T* gamma_diff_part = gamma_diff ? gamma_diff_parts.data() + part_id * m : nullptr;
+      T* beta_diff_part = beta_diff ? beta_diff_parts.data() + part_id * m : nullptr;
+      FOR_RANGE(int64_t, i, part_id * part_size, std::min(n, (part_id + 1) * part_size)) {
+        const T* row_dy = dy + i * m;
+        if (gamma_diff_part) {
+          const T* row_normalized = normalized + i * m;
+          for (int64_t j = 0; j < m; ++j) { gamma_diff_part[j] += row_dy[j] * row_normalized[j]; }
+        }
+        if (beta_diff_part) {
+          for (int64_t j = 0; j < m; ++j) { beta_diff_part[j] += row_dy[j]; }
+        }
+        if (normalized_diff) {
+          T* row_normalized_diff = normalized_diff + i * m;
+          if (gamma) {
+            for (int64_t j = 0; j < m; ++j) { row_normalized_diff[j] = row_dy[j] * gamma[j]; }
+          } else {
+            for (int64_t j = 0; j < m; ++j) { row_normalized_diff[j] = row_dy[j]; }
+          }
+        }
+      }
+    }
+  });
+  const int64_t sum_grain_size =
+      std::max<int64_t>(kParamGradTaskElemNum / std::max<int64_t>(part_num, 1), 1);
+  auto SumParts = [&](const std::vector<T>& parts, T* out) {
+    ParallelForTasks(m, sum_grain_size, [&](int64_t begin, int64_t end) {
+      std::fill(out + begin, out + end, static_cast<T>(0));
+      FOR_RANGE(int64_t, part_id, 0, part_num) {
+        const T* part = parts.data() + part_id * m;
+        for (int64_t j = begin; j < end; ++j) { out[j] += part[j]; }
+      }
+    });
+  };
+  if (gamma_diff) { SumParts(gamma_diff_parts, gamma_diff); }
+  if (beta_diff) { SumParts(beta_diff_parts, beta_diff); }
+}
+
+template struct LayerNormCpuKernelUtil<float>;
+template struct LayerNormCpuKernelUtil<double>;
+
 template<typename T>
 class LayerNormCpuKernel final : public user_op::OpKernel {
  public:
@@ -25,7 +164,40 @@ class LayerNormCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const bool scale = ctx->Attr<bool>("scale");
+    const bool center = ctx->Attr<bool>("center");
+    user_op::Tensor* normalized = scale ? ctx->Tensor4ArgNameAndIndex("normalized", 0) : y;
+    const double epsilon = ctx->Attr<double>("epsilon");
+    const int64_t num_instances = mean->shape().elem_cnt();
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    int64_t instance_size = 0;
+    const T* gamma_ptr = nullptr;
+    const T* beta_ptr = nullptr;
+    if (scale) {
+      const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+      instance_size = gamma->shape().elem_cnt();
+      gamma_ptr = gamma->dptr<T>();
+    }
+    if (center) {
+      const user_op::Tensor* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+      if (gamma_ptr) {
+        CHECK_EQ(beta->shape().elem_cnt(), instance_size);
+      } else {
+        instance_size = beta->shape().elem_cnt();
+      }
+      beta_ptr = beta->dptr<T>();
+    }
+    if (scale || center) { CHECK_EQ(y->shape().elem_cnt() % instance_size, 0); }
+    LayerNormCpuKernelUtil<T>::Forward(num_instances, norm_size, instance_size, epsilon,
+                                       x->dptr<T>(), gamma_ptr, beta_ptr,
+                                       normalized->mut_dptr<T>(), y->mut_dptr<T>(),
+                                       mean->mut_dptr<T>(), inv_variance->mut_dptr<T>());
+  };
 };
 
 #define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)             \
@@ -45,14 +217,39 @@ class LayerNormGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const T* add_to_output_ptr = nullptr;
+    if (ctx->has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), dx->data_type());
+      CHECK_EQ(add_to_output->shape(), dx->shape());
+      add_to_output_ptr = add_to_output->dptr<T>();
+    }
+    const int64_t num_instances = mean->shape().elem_cnt();
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    LayerNormCpuKernelUtil<T>::Backward(num_instances, norm_size, dy->dptr<T>(), x->dptr<T>(),
+                                        mean->dptr<T>(), inv_variance->dptr<T>(),
+                                        add_to_output_ptr, dx->mut_dptr<T>());
+  };
 };
 
-#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)        \
-  REGISTER_USER_KERNEL("layer_norm_grad")                 \
-      .SetCreateFn<LayerNormGradCpuKernel<dtype>>()       \
-      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu") \
-                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value));
+#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)                                              \
+  REGISTER_USER_KERNEL("layer_norm_grad")                                                       \
+      .SetCreateFn<LayerNormGradCpuKernel<dtype>>()                                             \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                       \
+                       & (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))          \
+      .SetInplaceProposalFn([](const user_op::InferContext& ctx,                                \
+                               user_op::AddInplaceArgPair AddInplaceArgPairFn) -> Maybe<void> { \
+        if (ctx.has_input("_add_to_output", 0)) {                                               \
+          OF_RETURN_IF_ERROR(AddInplaceArgPairFn("dx", 0, "_add_to_output", 0, true));          \
+        }                                                                                       \
+        return Maybe<void>::Ok();                                                               \
+      });
 
 REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(float)
 REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(double)
@@ -65,7 +262,29 @@ class LayerNormParamGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    user_op::Tensor* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    user_op::Tensor* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    user_op::Tensor* normalized_diff = ctx->Tensor4ArgNameAndIndex("normalized_diff", 0);
+    const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const int64_t begin_params_axis = ctx->Attr<int64_t>("begin_params_axis");
+    const int64_t m = dy->shape().Count(begin_params_axis);
+    CHECK_EQ(dy->shape().elem_cnt() % m, 0);
+    const int64_t n = dy->shape().elem_cnt() / m;
+    const T* normalized_ptr = nullptr;
+    if (gamma_diff) {
+      CHECK_EQ(m, gamma_diff->shape().elem_cnt());
+      normalized_ptr = ctx->Tensor4ArgNameAndIndex("normalized", 0)->dptr<T>();
+    }
+    if (beta_diff) { CHECK_EQ(m, beta_diff->shape().elem_cnt()); }
+    if (gamma) { CHECK_EQ(m, gamma->shape().elem_cnt()); }
+    LayerNormCpuKernelUtil<T>::ParamGrad(
+        n, m, dy->dptr<T>(), normalized_ptr, gamma ? gamma->dptr<T>() : nullptr,
+        gamma_diff ? gamma_diff->mut_dptr<T>() : nullptr,
+        beta_diff ? beta_diff->mut_dptr<T>() : nullptr,
+        normalized_diff ? normalized_diff->mut_dptr<T>() : nullptr);
+  };
 };
 
 #define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)  \
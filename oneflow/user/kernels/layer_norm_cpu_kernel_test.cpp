@@ -0,0 +1,165 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+#include "oneflow/core/ndarray/ndarray_util.h"
+#include "oneflow/core/common/cpu_test_util.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+// LayerNorm without affine composed of ndarray ops, as a reference and a baseline
+void CompositeLayerNorm(int64_t n, int64_t m, float epsilon, const float* x, float* y) {
+  using NdUtil = NdarrayUtil<DeviceType::kCPU, float>;
+  auto Val = NdUtil::GetValNdarrayBuilder();
+  auto Var = NdUtil::GetVarNdarrayBuilder();
+  std::vector<float> sum(n);
+  std::vector<float> mean(n);
+  std::vector<float> variance(n);
+  std::vector<float> inv_variance(n);
+  std::vector<float> centered(n * m);
+  std::vector<float> square(n * m);
+  std::vector<float> tmp(n * m);
+  const float norm_size = m;
+  const float neg_half = -0.5;
+  NdUtil::ReduceSum(nullptr, Var({n, 1}, sum.data()), Val({n, m}, x), Var({n, m}, tmp.data()));
+  NdUtil::BroadcastDiv(nullptr, Var({n, 1}, mean.data()), Val({n, 1}, sum.data()),
+                       Val({1, 1}, &norm_size));
+  NdUtil::BroadcastSub(nullptr, Var({n, m}, centered.data()), Val({n, m}, x),
+                       Val({n, 1}, mean.data()));
+  NdUtil::Mul(nullptr, Var({n, m}, square.data()), Val({n, m}, centered.data()),
+              Val({n, m}, centered.data()));
+  NdUtil::ReduceSum(nullptr, Var({n, 1}, sum.data()), Val({n, m}, square.data()),
+                    Var({n, m}, tmp.data()));
+  NdUtil::BroadcastDiv(nullptr, Var({n, 1}, variance.data()), Val({n, 1}, sum.data()),
+                       Val({1, 1}, &norm_size));
+  NdUtil::BroadcastAdd(nullptr, Var({n, 1}, sum.data()), Val({n, 1}, variance.data()),
+                       Val({1, 1}, &epsilon));
+  NdUtil::BroadcastPow(nullptr, Var({n, 1}, inv_variance.data()), Val({n, 1}, sum.data()),
+                       Val({1, 1}, &neg_half));
+  NdUtil::BroadcastMul(nullptr, Var({n, m}, y), Val({n, m}, centered.data()),
+                       Val({n, 1}, inv_variance.data()));
+}
+
+}  // namespace
+
+class LayerNormCpuKernelUtilTest : public ThreadPoolTest {};
+
+TEST_F(LayerNormCpuKernelUtilTest, forward_and_backward) {
+  const int64_t n = 37;
+  const int64_t m = 203;
+  const float epsilon = 1e-5;
+  const std::vector<float> x = RandomVector<float>(n * m, 1, -2, 3);
+  const std::vector<float> dy = RandomVector<float>(n * m, 2, -2, 3);
+  const std::vector<float> gamma = RandomVector<float>(m, 3, -2, 3);
+  const std::vector<float> beta = RandomVector<float>(m, 4, -2, 3);
+  std::vector<float> normalized(n * m);
+  std::vector<float> y(n * m);
+  std::vector<float> mean(n);
+  std::vector<float> inv_variance(n);
+  LayerNormCpuKernelUtil<float>::Forward(n, m, m, epsilon, x.data(), gamma.data(), beta.data(),
+                                         normalized.data(), y.data(), mean.data(),
+                                         inv_variance.data());
+  std::vector<float> expected_normalized(n * m);
+  CompositeLayerNorm(n, m, epsilon, x.data(), expected_normalized.data());
+  FOR_RANGE(int64_t, i, 0, n * m) {
+    ASSERT_NEAR(normalized.at(i), expected_normalized.at(i), 1e-4);
+    ASSERT_NEAR(y.at(i), expected_normalized.at(i) * gamma.at(i % m) + beta.at(i % m), 1e-4);
+  }
+
+  std::vector<float> dx(n * m);
+  LayerNormCpuKernelUtil<float>::Backward(n, m, dy.data(), x.data(), mean.data(),
+                                          inv_variance.data(), nullptr, dx.data());
+  FOR_RANGE(int64_t, i, 0, n) {
+    // dx = inv_variance * (dy - mean(dy) - normalized * mean(dy * normalized))
+    double mean_dy = 0;
+    double mean_dy_normalized = 0;
+    FOR_RANGE(int64_t, j, 0, m) {
+      mean_dy += dy.at(i * m + j) / m;
+      mean_dy_normalized += dy.at(i * m + j) * expected_normalized.at(i * m + j) / m;
+    }
+    FOR_RANGE(int64_t, j, 0, m) {
+      const double expected = inv_variance.at(i)
+                              * (dy.at(i * m + j) - mean_dy
+                                 - expected_normalized.at(i * m + j) * mean_dy_normalized);
+      ASSERT_NEAR(dx.at(i * m + j), expected, 1e-3);
+    }
+  }
+
+  std::vector<float> gamma_diff(m);
+  std::vector<float> beta_diff(m);
+  std::vector<float> normalized_diff(n * m);
+  LayerNormCpuKernelUtil<float>::ParamGrad(n, m, dy.data(), normalized.data(), gamma.data(),
+                                           gamma_diff.data(), beta_diff.data(),
+                                           normalized_diff.data());
+  FOR_RANGE(int64_t, j, 0, m) {
+    double expected_gamma_diff = 0;
+    double expected_beta_diff = 0;
+    FOR_RANGE(int64_t, i, 0, n) {
+      expected_gamma_diff += dy.at(i * m + j) * normalized.at(i * m + j);
+      expected_beta_diff += dy.at(i * m + j);
+      ASSERT_FLOAT_EQ(normalized_diff.at(i * m + j), dy.at(i * m + j) * gamma.at(j));
+    }
+    ASSERT_NEAR(gamma_diff.at(j), expected_gamma_diff, 1e-3);
+    ASSERT_NEAR(beta_diff.at(j), expected_beta_diff, 1e-3);
+  }
+}
+
+TEST(LayerNormCpuKernelUtil, same_param_grads_with_any_thread_num) {
+  // rows of many parts, so that the partial sums are added up in some order
+  const int64_t n = 3001;
+  const int64_t m = 67;
+  const std::vector<float> dy = RandomVector<float>(n * m, 6, -2, 3);
+  const std::vector<float> normalized = RandomVector<float>(n * m, 7, -2, 3);
+  const auto ParamGrads = [&]() {
+    std::vector<float> grads(2 * m);
+    LayerNormCpuKernelUtil<float>::ParamGrad(n, m, dy.data(), normalized.data(), nullptr,
+                                             grads.data(), grads.data() + m, nullptr);
+    return grads;
+  };
+  const std::vector<float> expected = ParamGrads();
+  for (int32_t thread_num : {1, 2, 3, 5}) {
+    ThreadPoolScope thread_pool_scope(thread_num);
+    ASSERT_EQ(ParamGrads(), expected) << "thread_num " << thread_num;
+  }
+}
+
+TEST_F(LayerNormCpuKernelUtilTest, DISABLED_benchmark_against_composite_ndarray) {
+  const int64_t n = 4096;
+  const int64_t m = 1024;
+  const float epsilon = 1e-5;
+  const std::vector<float> x = RandomVector<float>(n * m, 5, -2, 3);
+  std::vector<float> y(n * m);
+  std::vector<float> mean(n);
+  std::vector<float> inv_variance(n);
+  const double fused_ms = MeasureMs([&]() {
+    LayerNormCpuKernelUtil<float>::Forward(n, m, m, epsilon, x.data(), nullptr, nullptr,
+                                           y.data(), y.data(), mean.data(),
+                                           inv_variance.data());
+  });
+  std::vector<float> expected_y(n * m);
+  const double composite_ms =
+      MeasureMs([&]() { CompositeLayerNorm(n, m, epsilon, x.data(), expected_y.data()); });
+  FOR_RANGE(int64_t, i, 0, n * m) { ASSERT_NEAR(y.at(i), expected_y.at(i), 1e-3); }
+  LOG(INFO) << "layer norm of [" << n << ", " << m << "]: fused " << fused_ms
+            << " ms, composite ndarray " << composite_ms << " ms";
+}
+
+}  // namespace test
+
+}  // namespace oneflow
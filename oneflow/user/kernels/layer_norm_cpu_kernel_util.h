@@ -0,0 +1,41 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// x, y, normalized, dy and dx are [num_instances, norm_size], mean and inv_variance are
+// [num_instances]. gamma and beta have instance_size elements and are broadcast over y, either of
+// them may be nullptr. normalized may be y when there is no gamma.
+template<typename T>
+struct LayerNormCpuKernelUtil {
+  static void Forward(int64_t num_instances, int64_t norm_size, int64_t instance_size,
+                      double epsilon, const T* x, const T* gamma, const T* beta, T* normalized,
+                      T* y, T* mean, T* inv_variance);
+  // dx = add_to_output + d(normalized(x)) / dx * dy, add_to_output may be nullptr
+  static void Backward(int64_t num_instances, int64_t norm_size, const T* dy, const T* x,
+                       const T* mean, const T* inv_variance, const T* add_to_output, T* dx);
+  // dy and normalized are [n, m], any of the outputs may be nullptr
+  static void ParamGrad(int64_t n, int64_t m, const T* dy, const T* normalized, const T* gamma,
+                        T* gamma_diff, T* beta_diff, T* normalized_diff);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
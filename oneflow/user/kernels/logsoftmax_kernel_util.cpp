@@ -13,79 +13,49 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
-#include <cstdint>
-#include "oneflow/core/common/util.h"
-#include "oneflow/core/ndarray/ndarray_util.h"
 #include "oneflow/user/kernels/logsoftmax_kernel_util.h"
+#include "oneflow/user/kernels/softmax_cpu_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.cuh"
 
 namespace oneflow {
 
+// Like the softmax CPU kernels, the log softmax ones work row by row and need no temp storage
 template<typename T>
 struct LogSoftmaxKernelUtil<DeviceType::kCPU, T> {
-  static size_t GetComputeProbTempStorageSizeInBytes(int64_t n, int64_t w) {
-    return GetProbTmpSize<T>(n, w) + GetReduceTempStorageSize<T>(n, w);
-  }
+  static size_t GetComputeProbTempStorageSizeInBytes(int64_t n, int64_t w) { return 0; }
 
-  static size_t GetComputeDiffTempStorageSizeInBytes(int64_t n, int64_t w) {
-    return GetDiffTmpSize<T>(n, w) + GetReduceTempStorageSize<T>(n, w);
-  }
+  static size_t GetComputeDiffTempStorageSizeInBytes(int64_t n, int64_t w) { return 0; }
 
   static void ComputeOut(DeviceCtx* ctx, const int64_t n, const int64_t w, const T* in, T* prob,
                          T* out, void* temp_storage, const size_t temp_storage_bytes) {
-    auto Val = NdarrayUtil<DeviceType::kCPU, T>::GetValNdarrayBuilder();
-    auto Var = NdarrayUtil<DeviceType::kCPU, T>::GetVarNdarrayBuilder();
-    const size_t min_temp_storage_bytes =
-        LogSoftmaxKernelUtil<DeviceType::kCPU, T>::GetComputeProbTempStorageSizeInBytes(n, w);
-    CHECK_GE(temp_storage_bytes, min_temp_storage_bytes);
-    const size_t reduce_temp_storage_bytes = GetReduceTempStorageSize<T>(n, w);
-    T* reduce_storage = reinterpret_cast<T*>(temp_storage);
-    auto reduce_storage_var =
-        Var({static_cast<int64_t>(reduce_temp_storage_bytes / sizeof(T))}, reduce_storage);
-    T* tmp = reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(temp_storage)
-                                  + reduce_temp_storage_bytes);
-    // max | tmp[i] = Max_j(in[i][j])
-    NdarrayUtil<DeviceType::kCPU, T>::ReduceMax(ctx, Var({n, 1}, tmp), Val({n, w}, in),
-                                                reduce_storage_var);
-    // sub | out[i][j] = in[i][j] - tmp[i]
-    NdarrayUtil<DeviceType::kCPU, T>::BroadcastSub(ctx, Var({n, w}, out), Val({n, w}, in),
-                                                   Val({n, 1}, tmp));
-    // exp | prob[i][j] = exp(out[i][j])
-    NdarrayUtil<DeviceType::kCPU, T>::BroadcastExp(ctx, Var({n, w}, prob), Val({n, w}, out));
-    // sum | tmp[i] = Sum_j(prob[i][j])
-    NdarrayUtil<DeviceType::kCPU, T>::ReduceSum(ctx, Var({n, 1}, tmp), Val({n, w}, prob),
-                                                reduce_storage_var);
-    // div | prob[i][j] /= tmp[i]
-    NdarrayUtil<DeviceType::kCPU, T>::InplaceBroadcastDiv(ctx, Var({n, w}, prob), Val({n, 1}, tmp));
-    // tmp | tmp[i] = log(tmp[i])
-    FOR_RANGE(int64_t, i, 0, n) { tmp[i] = SafeLog(tmp[i]); }
-    // sub | out[i][j] -= tmp[i]
-    NdarrayUtil<DeviceType::kCPU, T>::InplaceBroadcastSub(ctx, Var({n, w}, out), Val({n, 1}, tmp));
+    SoftmaxCpuForEachRow(n, w, [&](int64_t row) {
+      const T* row_in = in + row * w;
+      T* row_prob = prob + row * w;
+      T* row_out = out + row * w;
+      T max = 0;
+      T sum = 0;
+      SoftmaxCpuRowMaxAndSum(row_in, w, &max, &sum);
+      // out[i][j] = in[i][j] - max[i] - log(sum[i]), prob[i][j] = exp(out[i][j])
+      const T shift = max + SafeLog(sum);
+      FOR_RANGE(int64_t, j, 0, w) {
+        const T val = row_in[j] - shift;
+        row_out[j] = val;
+        row_prob[j] = std::exp(val);
+      }
+    });
   }
 
   static void ComputeDiff(DeviceCtx* ctx, const int64_t n, const int64_t w, const T* dy,
                           const T* out, T* dx, void* temp_storage,
                           const size_t temp_storage_bytes) {
-    auto Val = NdarrayUtil<DeviceType::kCPU, T>::GetValNdarrayBuilder();
-    auto Var = NdarrayUtil<DeviceType::kCPU, T>::GetVarNdarrayBuilder();
-    const size_t min_temp_storage_bytes =
-        LogSoftmaxKernelUtil<DeviceType::kCPU, T>::GetComputeDiffTempStorageSizeInBytes(n, w);
-    CHECK_GE(temp_storage_bytes, min_temp_storage_bytes);
-    const size_t reduce_temp_storage_bytes = GetReduceTempStorageSize<T>(n, w);
-    T* reduce_storage = reinterpret_cast<T*>(temp_storage);
-    auto reduce_storage_var =
-        Var({static_cast<int64_t>(reduce_temp_storage_bytes / sizeof(T))}, reduce_storage);
-    T* tmp = reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(temp_storage)
-                                  + reduce_temp_storage_bytes);
-    // sum | dx[i] = Sum_j(dy[i][j])
-    NdarrayUtil<DeviceType::kCPU, T>::ReduceSum(ctx, Var({n, 1}, dx), Val({n, w}, dy),
-                                                reduce_storage_var);
-    // mul | tmp[i][j] = out[i][j]*dx[i]
-    NdarrayUtil<DeviceType::kCPU, T>::BroadcastMul(ctx, Var({n, w}, tmp), Val({n, w}, out),
-                                                   Val({n, 1}, dx));
-    // sum | dx[i][j] = dy[i][j]-tmp[i][j]
-    NdarrayUtil<DeviceType::kCPU, T>::BroadcastSub(ctx, Var({n, w}, dx), Val({n, w}, dy),
-                                                   Val({n, w}, tmp));
+    SoftmaxCpuForEachRow(n, w, [&](int64_t row) {
+      const T* row_dy = dy + row * w;
+      const T* row_out = out + row * w;
+      T* row_dx = dx + row * w;
+      // dx[i][j] = dy[i][j] - out[i][j] * Sum_k(dy[i][k])
+      const T sum = SoftmaxCpuRowSum(row_dy, w);
+      FOR_RANGE(int64_t, j, 0, w) { row_dx[j] = row_dy[j] - row_out[j] * sum; }
+    });
   }
 };
 
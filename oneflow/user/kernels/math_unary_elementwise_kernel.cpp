@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/elementwise_xpu_kernel.h"
 #include "oneflow/user/kernels/math_unary_elementwise_func.h"
 
 namespace oneflow {
@@ -32,7 +33,7 @@ class MathUnaryElementwiseCpuKernel final : public user_op::OpKernel {
     T* y = tensor_y->mut_dptr<T>();
     int64_t n = tensor_x->shape().elem_cnt();
     CHECK_LE(n, GetMaxVal<int32_t>() / 2);
-    for (int32_t i = 0; i < n; ++i) { y[i] = UnaryFunctor<T>::Forward(x[i]); }
+    CpuElemwiseForEach<T>(n, [=](int64_t i) { y[i] = UnaryFunctor<T>::Forward(x[i]); });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -54,7 +55,7 @@ class MathUnaryElementwiseGradCpuKernel final : public user_op::OpKernel {
     T* dx = tensor_dx->mut_dptr<T>();
     int64_t n = tensor_x->shape().elem_cnt();
     CHECK_LE(n, GetMaxVal<int32_t>() / 2);
-    for (int32_t i = 0; i < n; ++i) { dx[i] = UnaryFunctor<T>::Backward(x[i], dy[i]); }
+    CpuElemwiseForEach<T>(n, [=](int64_t i) { dx[i] = UnaryFunctor<T>::Backward(x[i], dy[i]); });
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
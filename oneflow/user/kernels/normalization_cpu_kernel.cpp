@@ -0,0 +1,535 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+#include "oneflow/user/kernels/welford_cpu_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// Channels of a task of the channels last reductions, whose partial results stay in registers
+constexpr int64_t kChannelBlockSize = 64;
+// Approximate number of elements of a task of ParallelForTasks
+constexpr int64_t kTaskElemNum = 32 * 1024;
+constexpr int64_t kMaskBitNum = 32;
+
+// The per channel reductions run in tasks of a block of channels and a part of the outer axis,
+// each of which writes the partial results of its part.
+class ChannelReducePlan final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ChannelReducePlan);
+  ChannelReducePlan(int64_t outer, int64_t channel, int64_t inner)
+      : outer_(outer),
+        channel_(channel),
+        inner_(inner),
+        channel_block_size_(inner == 1 ? kChannelBlockSize : 1),
+        channel_block_num_((channel + channel_block_size_ - 1) / channel_block_size_),
+        part_size_(std::max<int64_t>(
+            kTaskElemNum / (std::min(channel_block_size_, channel) * inner), 1)),
+        part_num_((outer + part_size_ - 1) / part_size_) {}
+  ~ChannelReducePlan() = default;
+
+  int64_t part_num() const { return part_num_; }
+  // number of elements of a channel in the part
+  int64_t part_elem_cnt(int64_t part) const {
+    return (std::min(outer_, (part + 1) * part_size_) - part * part_size_) * inner_;
+  }
+
+  void ParallelForEachTask(const std::function<void(int64_t part, int64_t outer_begin,
+                                                    int64_t outer_end, int64_t channel_begin,
+                                                    int64_t channel_end)>& Handler) const {
+    ParallelForTasks(part_num_ * channel_block_num_, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, task, begin, end) {
+        const int64_t part = task / channel_block_num_;
+        const int64_t channel_begin = task % channel_block_num_ * channel_block_size_;
+        Handler(part, part * part_size_, std::min(outer_, (part + 1) * part_size_),
+                channel_begin, std::min(channel_, channel_begin + channel_block_size_));
+      }
+    });
+  }
+
+  // Calls Handler(channel_begin, channel_end) in parallel to combine the partial results
+  void ParallelForChannels(const std::function<void(int64_t begin, int64_t end)>& Handler) const {
+    ParallelForTasks(channel_, std::max<int64_t>(kTaskElemNum / part_num_, 1), Handler);
+  }
+
+ private:
+  const int64_t outer_;
+  const int64_t channel_;
+  const int64_t inner_;
+  const int64_t channel_block_size_;
+  const int64_t channel_block_num_;
+  const int64_t part_size_;
+  const int64_t part_num_;
+};
+
+// Calls Handler(i, n, c) on the contiguous segments [i, i + n) of [begin, end). All elements of a
+// segment are of the channel c when inner > 1, otherwise the k-th one is of the channel c + k.
+template<typename HandlerType>
+void ForEachChannelSegment(int64_t begin, int64_t end, int64_t channel, int64_t inner,
+                           const HandlerType& Handler) {
+  const int64_t segment_size = inner == 1 ? channel : inner;
+  int64_t i = begin;
+  while (i < end) {
+    const int64_t segment = i / segment_size;
+    const int64_t segment_end = std::min(end, (segment + 1) * segment_size);
+    Handler(i, segment_end - i, inner == 1 ? i - segment * segment_size : segment % channel);
+    i = segment_end;
+  }
+}
+
+template<typename T>
+inline T MaskedDy(const T* dy, const int32_t* relu_mask, int64_t i) {
+  if (relu_mask == nullptr) { return dy[i]; }
+  return static_cast<T>((relu_mask[i / kMaskBitNum] >> (i % kMaskBitNum)) & 1) * dy[i];
+}
+
+// Adds the sums of dy and dy * (x - mean) over [begin, begin + n) to *sum_dy and *sum_dy_x
+template<typename T>
+void SumDyAndDyX(const T* x, const T* dy, const int32_t* relu_mask, int64_t begin, int64_t n,
+                 T mean, T* sum_dy, T* sum_dy_x) {
+  T lane_dy[kWelfordLaneNum] = {0};
+  T lane_dy_x[kWelfordLaneNum] = {0};
+  const int64_t end = begin + n;
+  int64_t i = begin;
+  for (; i + kWelfordLaneNum <= end; i += kWelfordLaneNum) {
+    for (int64_t lane = 0; lane < kWelfordLaneNum; ++lane) {
+      const T dy_val = MaskedDy(dy, relu_mask, i + lane);
+      lane_dy[lane] += dy_val;
+      lane_dy_x[lane] += dy_val * (x[i + lane] - mean);
+    }
+  }
+  for (; i < end; ++i) {
+    const T dy_val = MaskedDy(dy, relu_mask, i);
+    lane_dy[0] += dy_val;
+    lane_dy_x[0] += dy_val * (x[i] - mean);
+  }
+  for (int64_t lane = 0; lane < kWelfordLaneNum; ++lane) {
+    *sum_dy += lane_dy[lane];
+    *sum_dy_x += lane_dy_x[lane];
+  }
+}
+
+}  // namespace
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::ComputeStatistics(int64_t outer, int64_t channel,
+                                                      int64_t inner, double epsilon,
+                                                      double momentum, const T* x, T* mean,
+                                                      T* inv_variance, T* moving_mean,
+                                                      T* moving_variance) {
+  if (channel == 0) { return; }
+  if (outer * inner == 0) {
+    std::fill(mean, mean + channel, static_cast<T>(0));
+    std::fill(inv_variance, inv_variance + channel, static_cast<T>(1 / std::sqrt(epsilon)));
+    return;
+  }
+  const ChannelReducePlan plan(outer, channel, inner);
+  // single pass Welford of every part, (part, channel) matrices
+  std::vector<T> part_mean(plan.part_num() * channel);
+  std::vector<T> part_m2(plan.part_num() * channel);
+  plan.ParallelForEachTask([&](int64_t part, int64_t outer_begin, int64_t outer_end,
+                               int64_t channel_begin, int64_t channel_end) {
+    T* cur_mean = part_mean.data() + part * channel;
+    T* cur_m2 = part_m2.data() + part * channel;
+    if (inner == 1) {
+      // the channels of a row are the lanes, they have the same count
+      const int64_t width = channel_end - channel_begin;
+      T block_mean[kChannelBlockSize] = {0};
+      T block_m2[kChannelBlockSize] = {0};
+      FOR_RANGE(int64_t, i, outer_begin, outer_end) {
+        const T* row = x + i * channel + channel_begin;
+        const T inv_cnt = static_cast<T>(1) / static_cast<T>(i - outer_begin + 1);
+        for (int64_t j = 0; j < width; ++j) {
+          const T delta = row[j] - block_mean[j];
+          block_mean[j] += delta * inv_cnt;
+          block_m2[j] += delta * (row[j] - block_mean[j]);
+        }
+      }
+      std::copy(block_mean, block_mean + width, cur_mean + channel_begin);
+      std::copy(block_m2, block_m2 + width, cur_m2 + channel_begin);
+    } else {
+      FOR_RANGE(int64_t, c, channel_begin, channel_end) {
+        int64_t cnt = 0;
+        T channel_mean = 0;
+        T channel_m2 = 0;
+        FOR_RANGE(int64_t, i, outer_begin, outer_end) {
+          WelfordReduce<T>(x + (i * channel + c) * inner, inner, &cnt, &channel_mean,
+                           &channel_m2);
+        }
+        cur_mean[c] = channel_mean;
+        cur_m2[c] = channel_m2;
+      }
+    }
+  });
+  plan.ParallelForChannels([&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, c, begin, end) {
+      int64_t cnt = 0;
+      T channel_mean = 0;
+      T channel_m2 = 0;
+      FOR_RANGE(int64_t, part, 0, plan.part_num()) {
+        WelfordCombine<T>(plan.part_elem_cnt(part), part_mean.at(part * channel + c),
+                          part_m2.at(part * channel + c), &cnt, &channel_mean, &channel_m2);
+      }
+      mean[c] = channel_mean;
+      inv_variance[c] = static_cast<T>(1) / std::sqrt(channel_m2 / static_cast<T>(cnt) + epsilon);
+      if (moving_mean != nullptr) {
+        // cudnn updates the moving variance with the unbiased variance
+        const T unbiased_variance = channel_m2 / static_cast<T>(std::max<int64_t>(cnt - 1, 1));
+        moving_mean[c] = moving_mean[c] * momentum + channel_mean * (1 - momentum);
+        moving_variance[c] = moving_variance[c] * momentum + unbiased_variance * (1 - momentum);
+      }
+    }
+  });
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::Normalize(int64_t outer, int64_t channel, int64_t inner,
+                                              const T* x, const T* mean, const T* inv_variance,
+                                              const T* gamma, const T* beta,
+                                              const T* add_to_output, const T* addend, T* y,
+                                              int32_t* relu_mask) {
+  // y = (x - mean) * scale + beta, x * scale + shift would lose the precision when the mean is
+  // large relative to the standard deviation
+  std::vector<T> scale(channel);
+  FOR_RANGE(int64_t, c, 0, channel) { scale[c] = gamma[c] * inv_variance[c]; }
+  const int64_t elem_cnt = outer * channel * inner;
+  // tasks are aligned to the words of the relu mask
+  const int64_t word_num = RoundUp(elem_cnt, kMaskBitNum) / kMaskBitNum;
+  ParallelForTasks(word_num, kTaskElemNum / kMaskBitNum, [&](int64_t word_begin, int64_t word_end) {
+    const int64_t begin = word_begin * kMaskBitNum;
+    const int64_t end = std::min(word_end * kMaskBitNum, elem_cnt);
+    ForEachChannelSegment(begin, end, channel, inner, [&](int64_t i, int64_t n, int64_t c) {
+      if (inner == 1) {
+        const T* cur_mean = mean + c;
+        const T* cur_scale = scale.data() + c;
+        const T* cur_beta = beta + c;
+        for (int64_t k = 0; k < n; ++k) {
+          y[i + k] = (x[i + k] - cur_mean[k]) * cur_scale[k] + cur_beta[k];
+        }
+      } else {
+        const T cur_mean = mean[c];
+        const T cur_scale = scale[c];
+        const T cur_beta = beta[c];
+        for (int64_t k = 0; k < n; ++k) { y[i + k] = (x[i + k] - cur_mean) * cur_scale + cur_beta; }
+      }
+    });
+    if (add_to_output != nullptr) {
+      for (int64_t i = begin; i < end; ++i) { y[i] += add_to_output[i]; }
+    }
+    if (relu_mask == nullptr) { return; }
+    if (addend != nullptr) {
+      for (int64_t i = begin; i < end; ++i) { y[i] += addend[i]; }
+    }
+    FOR_RANGE(int64_t, word, word_begin, word_end) {
+      uint32_t bits = 0;
+      const int64_t word_elem_end = std::min((word + 1) * kMaskBitNum, end);
+      for (int64_t i = word * kMaskBitNum; i < word_elem_end; ++i) {
+        if (y[i] > 0) {
+          bits |= (1U << (i % kMaskBitNum));
+        } else {
+          y[i] = 0;
+        }
+      }
+      relu_mask[word] = static_cast<int32_t>(bits);
+    }
+  });
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::Backward(int64_t outer, int64_t channel, int64_t inner,
+                                             const T* x, const T* dy, const T* mean,
+                                             const T* inv_variance, const T* gamma,
+                                             const int32_t* relu_mask, T* dx, T* gamma_diff,
+                                             T* beta_diff, T* addend_diff) {
+  const int64_t elem_cnt = outer * channel * inner;
+  if (elem_cnt == 0) {
+    std::fill(gamma_diff, gamma_diff + channel, static_cast<T>(0));
+    std::fill(beta_diff, beta_diff + channel, static_cast<T>(0));
+    return;
+  }
+  const ChannelReducePlan plan(outer, channel, inner);
+  // sums of dy and dy * (x - mean) of every part, (part, channel) matrices
+  std::vector<T> part_sum_dy(plan.part_num() * channel);
+  std::vector<T> part_sum_dy_x(plan.part_num() * channel);
+  plan.ParallelForEachTask([&](int64_t part, int64_t outer_begin, int64_t outer_end,
+                               int64_t channel_begin, int64_t channel_end) {
+    T* cur_sum_dy = part_sum_dy.data() + part * channel;
+    T* cur_sum_dy_x = part_sum_dy_x.data() + part * channel;
+    if (inner == 1) {
+      const int64_t width = channel_end - channel_begin;
+      T block_sum_dy[kChannelBlockSize] = {0};
+      T block_sum_dy_x[kChannelBlockSize] = {0};
+      const T* block_mean = mean + channel_begin;
+      FOR_RANGE(int64_t, i, outer_begin, outer_end) {
+        const int64_t offset = i * channel + channel_begin;
+        for (int64_t j = 0; j < width; ++j) {
+          const T dy_val = MaskedDy(dy, relu_mask, offset + j);
+          block_sum_dy[j] += dy_val;
+          block_sum_dy_x[j] += dy_val * (x[offset + j] - block_mean[j]);
+        }
+      }
+      std::copy(block_sum_dy, block_sum_dy + width, cur_sum_dy + channel_begin);
+      std::copy(block_sum_dy_x, block_sum_dy_x + width, cur_sum_dy_x + channel_begin);
+    } else {
+      FOR_RANGE(int64_t, c, channel_begin, channel_end) {
+        T sum_dy = 0;
+        T sum_dy_x = 0;
+        FOR_RANGE(int64_t, i, outer_begin, outer_end) {
+          SumDyAndDyX<T>(x, dy, relu_mask, (i * channel + c) * inner, inner, mean[c], &sum_dy,
+                         &sum_dy_x);
+        }
+        cur_sum_dy[c] = sum_dy;
+        cur_sum_dy_x[c] = sum_dy_x;
+      }
+    }
+  });
+  // dx = gamma * inv_variance * (dy - mean(dy) - normalized * mean(dy * normalized))
+  //    = dy_scale * dy - x_scale * (x - mean) - shift
+  std::vector<T> dy_scale(channel);
+  std::vector<T> x_scale(channel);
+  std::vector<T> shift(channel);
+  const T inv_cnt = static_cast<T>(1) / static_cast<T>(outer * inner);
+  plan.ParallelForChannels([&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, c, begin, end) {
+      T sum_dy = 0;
+      T sum_dy_x = 0;
+      FOR_RANGE(int64_t, part, 0, plan.part_num()) {
+        sum_dy += part_sum_dy.at(part * channel + c);
+        sum_dy_x += part_sum_dy_x.at(part * channel + c);
+      }
+      beta_diff[c] = sum_dy;
+      gamma_diff[c] = sum_dy_x * inv_variance[c];
+      dy_scale[c] = gamma[c] * inv_variance[c];
+      x_scale[c] = dy_scale[c] * inv_variance[c] * gamma_diff[c] * inv_cnt;
+      shift[c] = dy_scale[c] * beta_diff[c] * inv_cnt;
+    }
+  });
+  ParallelForTasks(elem_cnt, kTaskElemNum, [&](int64_t begin, int64_t end) {
+    ForEachChannelSegment(begin, end, channel, inner, [&](int64_t i, int64_t n, int64_t c) {
+      for (int64_t k = 0; k < n; ++k) {
+        const int64_t cur_c = inner == 1 ? c + k : c;
+        const T dy_val = MaskedDy(dy, relu_mask, i + k);
+        if (addend_diff != nullptr) { addend_diff[i + k] = dy_val; }
+        dx[i + k] = dy_scale[cur_c] * dy_val - x_scale[cur_c] * (x[i + k] - mean[cur_c])
+                    - shift[cur_c];
+      }
+    });
+  });
+}
+
+template struct NormalizationCpuKernelUtil<float>;
+template struct NormalizationCpuKernelUtil<double>;
+
+namespace {
+
+void GetOuterChannelInner(const ShapeView& x_shape, int32_t axis, int64_t* outer,
+                          int64_t* channel, int64_t* inner) {
+  CHECK_GE(axis, 0);
+  CHECK_LT(axis, x_shape.NumAxes());
+  *outer = x_shape.Count(0, axis);
+  *channel = x_shape.At(axis);
+  *inner = x_shape.Count(axis + 1);
+}
+
+void CheckParamTensor(const user_op::Tensor* tensor, int64_t channel) {
+  CHECK_EQ(tensor->shape().NumAxes(), 1);
+  CHECK_EQ(tensor->shape().At(0), channel);
+}
+
+}  // namespace
+
+template<typename T>
+class NormalizationCpuKernel final : public user_op::OpKernel {
+ public:
+  NormalizationCpuKernel() = default;
+  ~NormalizationCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const bool is_add_relu = ctx->op_type_name() == "normalization_add_relu";
+    const bool training = is_add_relu || ctx->Attr<bool>("training");
+    const auto* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    auto* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    const auto* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const auto* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+    const auto axis = ctx->Attr<int32_t>("axis");
+    const auto epsilon = ctx->Attr<float>("epsilon");
+
+    CHECK_EQ(x->shape(), y->shape());
+    CHECK_EQ(y->data_type(), x->data_type());
+    int64_t outer = 0;
+    int64_t channel = 0;
+    int64_t inner = 0;
+    GetOuterChannelInner(x->shape(), axis, &outer, &channel, &inner);
+    CheckParamTensor(gamma, channel);
+    CheckParamTensor(beta, channel);
+
+    user_op::Tensor* moving_mean = nullptr;
+    user_op::Tensor* moving_variance = nullptr;
+    if (ctx->has_input("moving_mean", 0)) {
+      CHECK(ctx->has_input("moving_variance", 0));
+      moving_mean = ctx->Tensor4ArgNameAndIndex("moving_mean", 0);
+      moving_variance = ctx->Tensor4ArgNameAndIndex("moving_variance", 0);
+      CheckParamTensor(moving_mean, channel);
+      CheckParamTensor(moving_variance, channel);
+    }
+    const T* add_to_output_ptr = nullptr;
+    if (ctx->has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), y->data_type());
+      CHECK_EQ(add_to_output->shape(), y->shape());
+      add_to_output_ptr = add_to_output->dptr<T>();
+    }
+    const T* addend_ptr = nullptr;
+    int32_t* relu_mask_ptr = nullptr;
+    if (is_add_relu) {
+      CHECK(add_to_output_ptr == nullptr);
+      if (ctx->has_input("addend", 0)) {
+        addend_ptr = ctx->Tensor4ArgNameAndIndex("addend", 0)->dptr<T>();
+      }
+      auto* reserve_space = ctx->Tensor4ArgNameAndIndex("reserve_space", 0);
+      CHECK_GE(reserve_space->shape().elem_cnt() * kMaskBitNum, x->shape().elem_cnt());
+      relu_mask_ptr = reserve_space->mut_dptr<int32_t>();
+    }
+
+    if (training) {
+      std::vector<T> mean_buf;
+      std::vector<T> inv_variance_buf;
+      T* mean_ptr = nullptr;
+      T* inv_variance_ptr = nullptr;
+      if (ctx->has_output("mean", 0)) {
+        CHECK(ctx->has_output("inv_variance", 0));
+        auto* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+        auto* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+        CheckParamTensor(mean, channel);
+        CheckParamTensor(inv_variance, channel);
+        mean_ptr = mean->mut_dptr<T>();
+        inv_variance_ptr = inv_variance->mut_dptr<T>();
+      } else {
+        mean_buf.resize(channel);
+        inv_variance_buf.resize(channel);
+        mean_ptr = mean_buf.data();
+        inv_variance_ptr = inv_variance_buf.data();
+      }
+      NormalizationCpuKernelUtil<T>::ComputeStatistics(
+          outer, channel, inner, epsilon, ctx->Attr<float>("momentum"), x->dptr<T>(), mean_ptr,
+          inv_variance_ptr, moving_mean ? moving_mean->mut_dptr<T>() : nullptr,
+          moving_variance ? moving_variance->mut_dptr<T>() : nullptr);
+      NormalizationCpuKernelUtil<T>::Normalize(outer, channel, inner, x->dptr<T>(), mean_ptr,
+                                               inv_variance_ptr, gamma->dptr<T>(),
+                                               beta->dptr<T>(), add_to_output_ptr, addend_ptr,
+                                               y->mut_dptr<T>(), relu_mask_ptr);
+    } else {
+      CHECK(moving_mean != nullptr);
+      const T* moving_variance_ptr = moving_variance->dptr<T>();
+      std::vector<T> inv_variance(channel);
+      FOR_RANGE(int64_t, c, 0, channel) {
+        inv_variance[c] = static_cast<T>(1) / std::sqrt(moving_variance_ptr[c] + epsilon);
+      }
+      NormalizationCpuKernelUtil<T>::Normalize(
+          outer, channel, inner, x->dptr<T>(), moving_mean->dptr<T>(), inv_variance.data(),
+          gamma->dptr<T>(), beta->dptr<T>(), add_to_output_ptr, addend_ptr, y->mut_dptr<T>(),
+          relu_mask_ptr);
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_NORMALIZATION_CPU_KERNEL(op_type_name, dtype)                                  \
+  REGISTER_USER_KERNEL(op_type_name)                                                            \
+      .SetCreateFn<NormalizationCpuKernel<dtype>>()                                             \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                       \
+                       & (user_op::HobDataType("y", 0) == GetDataType<dtype>::value))           \
+      .SetInplaceProposalFn([](const user_op::InferContext& ctx,                                \
+                               user_op::AddInplaceArgPair AddInplaceArgPairFn) -> Maybe<void> { \
+        if (ctx.has_input("_add_to_output", 0)) {                                               \
+          OF_RETURN_IF_ERROR(AddInplaceArgPairFn("y", 0, "_add_to_output", 0, true));           \
+        }                                                                                       \
+        return Maybe<void>::Ok();                                                               \
+      });
+
+REGISTER_NORMALIZATION_CPU_KERNEL("normalization", float)
+REGISTER_NORMALIZATION_CPU_KERNEL("normalization", double)
+REGISTER_NORMALIZATION_CPU_KERNEL("normalization_add_relu", float)
+REGISTER_NORMALIZATION_CPU_KERNEL("normalization_add_relu", double)
+
+template<typename T>
+class NormalizationGradCpuKernel final : public user_op::OpKernel {
+ public:
+  NormalizationGradCpuKernel() = default;
+  ~NormalizationGradCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    auto* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const auto* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const auto* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    auto* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    auto* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    const auto* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const auto* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const auto axis = ctx->Attr<int32_t>("axis");
+
+    CHECK_EQ(dy->shape(), x->shape());
+    CHECK_EQ(dy->data_type(), x->data_type());
+    CHECK_EQ(dx->shape(), x->shape());
+    CHECK_EQ(dx->data_type(), x->data_type());
+    int64_t outer = 0;
+    int64_t channel = 0;
+    int64_t inner = 0;
+    GetOuterChannelInner(x->shape(), axis, &outer, &channel, &inner);
+    CheckParamTensor(gamma, channel);
+    CheckParamTensor(gamma_diff, channel);
+    CheckParamTensor(beta_diff, channel);
+    CheckParamTensor(mean, channel);
+    CheckParamTensor(inv_variance, channel);
+
+    const int32_t* relu_mask_ptr = nullptr;
+    T* addend_diff_ptr = nullptr;
+    if (ctx->op_type_name() == "normalization_add_relu_grad") {
+      relu_mask_ptr = ctx->Tensor4ArgNameAndIndex("reserve_space", 0)->dptr<int32_t>();
+      if (ctx->has_output("addend_diff", 0)) {
+        addend_diff_ptr = ctx->Tensor4ArgNameAndIndex("addend_diff", 0)->mut_dptr<T>();
+      }
+    }
+    NormalizationCpuKernelUtil<T>::Backward(
+        outer, channel, inner, x->dptr<T>(), dy->dptr<T>(), mean->dptr<T>(),
+        inv_variance->dptr<T>(), gamma->dptr<T>(), relu_mask_ptr, dx->mut_dptr<T>(),
+        gamma_diff->mut_dptr<T>(), beta_diff->mut_dptr<T>(), addend_diff_ptr);
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_NORMALIZATION_GRAD_CPU_KERNEL(op_type_name, dtype) \
+  REGISTER_USER_KERNEL(op_type_name)                                \
+      .SetCreateFn<NormalizationGradCpuKernel<dtype>>()             \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")           \
+                       & (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value));
+
+REGISTER_NORMALIZATION_GRAD_CPU_KERNEL("normalization_grad", float)
+REGISTER_NORMALIZATION_GRAD_CPU_KERNEL("normalization_grad", double)
+REGISTER_NORMALIZATION_GRAD_CPU_KERNEL("normalization_add_relu_grad", float)
+REGISTER_NORMALIZATION_GRAD_CPU_KERNEL("normalization_add_relu_grad", double)
+
+}  // namespace oneflow
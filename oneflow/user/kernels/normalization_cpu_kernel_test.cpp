@@ -0,0 +1,255 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+#include "oneflow/core/common/cpu_test_util.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+struct NormShape {
+  int64_t outer;
+  int64_t channel;
+  int64_t inner;
+  int64_t elem_cnt() const { return outer * channel * inner; }
+};
+
+// The batch normalization of a channel, with relu(y + addend) when with_relu, in double
+struct NaiveChannelNorm {
+  NaiveChannelNorm(const NormShape& shape, int64_t c, const std::vector<float>& x,
+                   const std::vector<float>& addend, double gamma, double beta, float epsilon,
+                   bool with_relu) {
+    FOR_RANGE(int64_t, o, 0, shape.outer) {
+      FOR_RANGE(int64_t, i, 0, shape.inner) {
+        index.push_back((o * shape.channel + c) * shape.inner + i);
+      }
+    }
+    const double cnt = index.size();
+    mean = 0;
+    for (int64_t i : index) { mean += x.at(i) / cnt; }
+    variance = 0;
+    for (int64_t i : index) { variance += (x.at(i) - mean) * (x.at(i) - mean) / cnt; }
+    inv_variance = 1 / std::sqrt(variance + epsilon);
+    for (int64_t i : index) {
+      double val = (x.at(i) - mean) * inv_variance * gamma + beta;
+      if (with_relu) { val = std::max(val + addend.at(i), 0.0); }
+      y.push_back(val);
+    }
+  }
+  std::vector<int64_t> index;
+  double mean;
+  double variance;
+  double inv_variance;
+  std::vector<double> y;
+};
+
+bool MaskBit(const std::vector<int32_t>& mask, int64_t i) {
+  return (mask.at(i / 32) >> (i % 32)) & 1;
+}
+
+void TestForwardAndBackward(const NormShape& shape, bool with_relu) {
+  const int64_t n = shape.elem_cnt();
+  const int64_t channel = shape.channel;
+  const float epsilon = 1e-5;
+  const float momentum = 0.9;
+  // an offset mean makes the one pass sum of squares lose the variance
+  const std::vector<float> x = RandomVector<float>(n, 1, 99, 101);
+  const std::vector<float> dy = RandomVector<float>(n, 2, -1, 1);
+  const std::vector<float> addend = RandomVector<float>(n, 3, -1, 1);
+  const std::vector<float> gamma = RandomVector<float>(channel, 4, 0.5, 2);
+  const std::vector<float> beta = RandomVector<float>(channel, 5, -1, 1);
+  std::vector<float> moving_mean = RandomVector<float>(channel, 6, -1, 1);
+  std::vector<float> moving_variance = RandomVector<float>(channel, 7, 0.5, 2);
+  const std::vector<float> old_moving_mean = moving_mean;
+  const std::vector<float> old_moving_variance = moving_variance;
+  std::vector<float> mean(channel);
+  std::vector<float> inv_variance(channel);
+  std::vector<float> y(n);
+  std::vector<int32_t> mask((n + 31) / 32);
+  NormalizationCpuKernelUtil<float>::ComputeStatistics(
+      shape.outer, channel, shape.inner, epsilon, momentum, x.data(), mean.data(),
+      inv_variance.data(), moving_mean.data(), moving_variance.data());
+  NormalizationCpuKernelUtil<float>::Normalize(
+      shape.outer, channel, shape.inner, x.data(), mean.data(), inv_variance.data(),
+      gamma.data(), beta.data(), nullptr, with_relu ? addend.data() : nullptr, y.data(),
+      with_relu ? mask.data() : nullptr);
+  std::vector<float> dx(n);
+  std::vector<float> addend_diff(n);
+  std::vector<float> gamma_diff(channel);
+  std::vector<float> beta_diff(channel);
+  NormalizationCpuKernelUtil<float>::Backward(
+      shape.outer, channel, shape.inner, x.data(), dy.data(), mean.data(), inv_variance.data(),
+      gamma.data(), with_relu ? mask.data() : nullptr, dx.data(), gamma_diff.data(),
+      beta_diff.data(), with_relu ? addend_diff.data() : nullptr);
+
+  FOR_RANGE(int64_t, c, 0, channel) {
+    const NaiveChannelNorm expected(shape, c, x, addend, gamma.at(c), beta.at(c), epsilon,
+                                    with_relu);
+    const double cnt = expected.index.size();
+    ASSERT_NEAR(mean.at(c), expected.mean, 1e-4);
+    ASSERT_NEAR(inv_variance.at(c), expected.inv_variance, 1e-3 * expected.inv_variance);
+    ASSERT_NEAR(moving_mean.at(c), old_moving_mean.at(c) * momentum + expected.mean * 0.1, 1e-4);
+    const double unbiased_variance = expected.variance * cnt / std::max(cnt - 1, 1.0);
+    ASSERT_NEAR(moving_variance.at(c),
+                old_moving_variance.at(c) * momentum + unbiased_variance * 0.1, 1e-3);
+    // the masked dy, sums of dy and dy * normalized
+    std::vector<double> masked_dy;
+    double sum_dy = 0;
+    double sum_dy_normalized = 0;
+    FOR_RANGE(size_t, k, 0, expected.index.size()) {
+      const int64_t i = expected.index.at(k);
+      ASSERT_NEAR(y.at(i), expected.y.at(k), 1e-3);
+      if (with_relu) { ASSERT_EQ(MaskBit(mask, i), y.at(i) > 0); }
+      masked_dy.push_back(with_relu && !MaskBit(mask, i) ? 0 : dy.at(i));
+      if (with_relu) { ASSERT_EQ(addend_diff.at(i), masked_dy.back()); }
+      sum_dy += masked_dy.back();
+      sum_dy_normalized += masked_dy.back() * (x.at(i) - expected.mean) * expected.inv_variance;
+    }
+    ASSERT_NEAR(beta_diff.at(c), sum_dy, 1e-5 * cnt);
+    ASSERT_NEAR(gamma_diff.at(c), sum_dy_normalized, 1e-5 * cnt);
+    FOR_RANGE(size_t, k, 0, expected.index.size()) {
+      const int64_t i = expected.index.at(k);
+      const double normalized = (x.at(i) - expected.mean) * expected.inv_variance;
+      const double expected_dx =
+          gamma.at(c) * expected.inv_variance
+          * (masked_dy.at(k) - sum_dy / cnt - normalized * sum_dy_normalized / cnt);
+      ASSERT_NEAR(dx.at(i), expected_dx, 1e-3);
+    }
+  }
+}
+
+// The statistics, y, mask, dx and parameter diffs of a normalization add relu, concatenated
+std::vector<float> ForwardAndBackwardOutputs(const NormShape& shape) {
+  const int64_t n = shape.elem_cnt();
+  const int64_t channel = shape.channel;
+  const std::vector<float> x = RandomVector<float>(n, 8, -1, 1);
+  const std::vector<float> dy = RandomVector<float>(n, 9, -1, 1);
+  const std::vector<float> addend = RandomVector<float>(n, 10, -1, 1);
+  const std::vector<float> gamma = RandomVector<float>(channel, 11, 0.5, 2);
+  const std::vector<float> beta = RandomVector<float>(channel, 12, -1, 1);
+  std::vector<float> mean(channel);
+  std::vector<float> inv_variance(channel);
+  std::vector<float> y(n);
+  std::vector<int32_t> mask((n + 31) / 32);
+  std::vector<float> dx(n);
+  std::vector<float> addend_diff(n);
+  std::vector<float> gamma_diff(channel);
+  std::vector<float> beta_diff(channel);
+  NormalizationCpuKernelUtil<float>::ComputeStatistics(shape.outer, channel, shape.inner, 1e-5,
+                                                       0.9, x.data(), mean.data(),
+                                                       inv_variance.data(), nullptr, nullptr);
+  NormalizationCpuKernelUtil<float>::Normalize(shape.outer, channel, shape.inner, x.data(),
+                                               mean.data(), inv_variance.data(), gamma.data(),
+                                               beta.data(), nullptr, addend.data(), y.data(),
+                                               mask.data());
+  NormalizationCpuKernelUtil<float>::Backward(
+      shape.outer, channel, shape.inner, x.data(), dy.data(), mean.data(), inv_variance.data(),
+      gamma.data(), mask.data(), dx.data(), gamma_diff.data(), beta_diff.data(),
+      addend_diff.data());
+  std::vector<float> outputs;
+  for (const std::vector<float>* vec :
+       {&mean, &inv_variance, &y, &dx, &addend_diff, &gamma_diff, &beta_diff}) {
+    outputs.insert(outputs.end(), vec->begin(), vec->end());
+  }
+  FOR_RANGE(int64_t, i, 0, n) { outputs.push_back(MaskBit(mask, i)); }
+  return outputs;
+}
+
+const std::vector<NormShape>& TestShapes() {
+  // NCHW as (n, c, h * w) and NHWC as (n * h * w, c, 1), with more channels than a block and
+  // more rows than a task
+  static const std::vector<NormShape> shapes{{1, 1, 1},   {2, 3, 1},     {4, 3, 49},
+                                             {8, 5, 200}, {3, 2, 20000}, {392, 3, 1},
+                                             {98, 130, 1}, {4000, 70, 1}, {2, 65, 33}};
+  return shapes;
+}
+
+}  // namespace
+
+class NormalizationCpuKernelUtilTest : public ThreadPoolTest {};
+
+TEST_F(NormalizationCpuKernelUtilTest, forward_and_backward) {
+  for (const NormShape& shape : TestShapes()) {
+    TestForwardAndBackward(shape, false);
+    TestForwardAndBackward(shape, true);
+  }
+}
+
+TEST(NormalizationCpuKernelUtil, same_results_with_any_thread_num) {
+  for (const NormShape& shape : TestShapes()) {
+    const std::vector<float> expected = ForwardAndBackwardOutputs(shape);
+    for (int32_t thread_num : {1, 2, 3, 5}) {
+      ThreadPoolScope thread_pool_scope(thread_num);
+      ASSERT_EQ(ForwardAndBackwardOutputs(shape), expected) << "thread_num " << thread_num;
+    }
+  }
+}
+
+TEST_F(NormalizationCpuKernelUtilTest, DISABLED_benchmark) {
+  // ResNet50 batch normalizations of a batch of 32
+  const std::vector<std::pair<int64_t, int64_t>> shape_hw_and_c{{56 * 56, 64}, {28 * 28, 512},
+                                                                {7 * 7, 2048}};
+  for (const auto& hw_and_c : shape_hw_and_c) {
+    const int64_t batch = 32;
+    const int64_t hw = hw_and_c.first;
+    const int64_t channel = hw_and_c.second;
+    const int64_t n = batch * hw * channel;
+    const std::vector<float> x = RandomVector<float>(n, 9, -1, 1);
+    const std::vector<float> gamma(channel, 1);
+    const std::vector<float> beta(channel, 0);
+    std::vector<float> y(n);
+    std::vector<float> dx(n);
+    std::vector<float> mean(channel);
+    std::vector<float> inv_variance(channel);
+    std::vector<float> gamma_diff(channel);
+    std::vector<float> beta_diff(channel);
+    std::vector<int32_t> mask((n + 31) / 32);
+    for (const NormShape& shape :
+         {NormShape{batch, channel, hw}, NormShape{batch * hw, channel, 1}}) {
+      const auto Forward = [&]() {
+        NormalizationCpuKernelUtil<float>::ComputeStatistics(
+            shape.outer, channel, shape.inner, 1e-5, 0.9, x.data(), mean.data(),
+            inv_variance.data(), nullptr, nullptr);
+        NormalizationCpuKernelUtil<float>::Normalize(
+            shape.outer, channel, shape.inner, x.data(), mean.data(), inv_variance.data(),
+            gamma.data(), beta.data(), nullptr, nullptr, y.data(), mask.data());
+      };
+      const auto Backward = [&]() {
+        NormalizationCpuKernelUtil<float>::Backward(
+            shape.outer, channel, shape.inner, x.data(), y.data(), mean.data(),
+            inv_variance.data(), gamma.data(), mask.data(), dx.data(), gamma_diff.data(),
+            beta_diff.data(), nullptr);
+      };
+      // the first runs touch the pages of the outputs
+      Forward();
+      Backward();
+      const double forward_ms = MeasureMs(Forward);
+      const double backward_ms = MeasureMs(Backward);
+      // forward reads x twice and writes y, backward reads x and dy twice and writes dx
+      const double gb = n * sizeof(float) / 1e9;
+      LOG(INFO) << "normalization add relu of " << (shape.inner == 1 ? "NHWC" : "NCHW") << " ["
+                << batch << ", " << channel << ", " << hw << "]: forward " << forward_ms
+                << " ms, " << 3 * gb / forward_ms * 1e3 << " GB/s, backward " << backward_ms
+                << " ms, " << 5 * gb / backward_ms * 1e3 << " GB/s";
+    }
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
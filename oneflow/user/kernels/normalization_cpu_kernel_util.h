@@ -0,0 +1,50 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// x, y, dy, dx, addend and their diffs are (outer, channel, inner) tensors normalized over the
+// outer and inner axes, e.g. (n, c, h * w) for NCHW and (n * h * w, c, 1) for NHWC. mean,
+// inv_variance, gamma, beta and the moving statistics have channel elements. The relu mask has a
+// bit per element of y, set if it is positive, packed into int32 words of 32 elements.
+template<typename T>
+struct NormalizationCpuKernelUtil {
+  // Computes the mean and the inverse standard deviation 1 / sqrt(variance + epsilon) of the
+  // batch, and updates the moving mean and the moving unbiased variance with momentum when they
+  // are not nullptr.
+  static void ComputeStatistics(int64_t outer, int64_t channel, int64_t inner, double epsilon,
+                                double momentum, const T* x, T* mean, T* inv_variance,
+                                T* moving_mean, T* moving_variance);
+  // y = (x - mean) * inv_variance * gamma + beta + add_to_output, with relu(y + addend) applied
+  // when relu_mask is not nullptr. add_to_output and addend may be nullptr.
+  static void Normalize(int64_t outer, int64_t channel, int64_t inner, const T* x, const T* mean,
+                        const T* inv_variance, const T* gamma, const T* beta,
+                        const T* add_to_output, const T* addend, T* y, int32_t* relu_mask);
+  // The backward of the training normalization. dy is masked by relu_mask first when it is not
+  // nullptr, and the masked dy is the addend_diff when that is not nullptr.
+  static void Backward(int64_t outer, int64_t channel, int64_t inner, const T* x, const T* dy,
+                       const T* mean, const T* inv_variance, const T* gamma,
+                       const int32_t* relu_mask, T* dx, T* gamma_diff, T* beta_diff,
+                       T* addend_diff);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
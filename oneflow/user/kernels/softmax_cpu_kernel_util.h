@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_SOFTMAX_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_SOFTMAX_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+// Rows handed to the thread pool cover at least this many elements
+constexpr int64_t kSoftmaxCpuMinElemsPerRange = 16 * 1024;
+// The online statistics rescale the running sum once per block of this many elements
+constexpr int64_t kSoftmaxCpuBlockSize = 16;
+
+// Calls Apply(row) for every row in [0, n) of a [n, w] matrix, over the thread pool when there is
+// enough work
+template<typename F>
+void SoftmaxCpuForEachRow(int64_t n, int64_t w, const F& Apply) {
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (n * w < kSoftmaxCpuMinElemsPerRange || n == 1 || thread_pool == nullptr
+      || thread_pool->thread_num() <= 1) {
+    FOR_RANGE(int64_t, row, 0, n) { Apply(row); }
+    return;
+  }
+  const int64_t grain_size =
+      std::max<int64_t>(kSoftmaxCpuMinElemsPerRange / std::max<int64_t>(w, 1), 1);
+  thread_pool->ParallelFor(n, grain_size, [&](size_t begin, size_t end) {
+    for (size_t row = begin; row < end; ++row) { Apply(row); }
+  });
+}
+
+// Computes max_j(x[j]) and sum_j(exp(x[j] - max)) of a row in one pass. Every block first finds
+// its own max, rescales the running sum if the max grows, then accumulates its exps, so the inner
+// loops have a fixed trip count the compiler can vectorize.
+template<typename T>
+void SoftmaxCpuRowMaxAndSum(const T* x, int64_t w, T* row_max, T* row_sum) {
+  T max = -std::numeric_limits<T>::infinity();
+  T sum = 0;
+  int64_t begin = 0;
+  for (; begin + kSoftmaxCpuBlockSize <= w; begin += kSoftmaxCpuBlockSize) {
+    const T* block = x + begin;
+    T block_max = block[0];
+    for (int64_t j = 1; j < kSoftmaxCpuBlockSize; ++j) {
+      block_max = std::max(block_max, block[j]);
+    }
+    if (block_max > max) {
+      sum *= std::exp(max - block_max);
+      max = block_max;
+    }
+    T block_sum = 0;
+    for (int64_t j = 0; j < kSoftmaxCpuBlockSize; ++j) { block_sum += std::exp(block[j] - max); }
+    sum += block_sum;
+  }
+  if (begin < w) {
+    T block_max = x[begin];
+    for (int64_t j = begin + 1; j < w; ++j) { block_max = std::max(block_max, x[j]); }
+    if (block_max > max) {
+      sum *= std::exp(max - block_max);
+      max = block_max;
+    }
+    for (int64_t j = begin; j < w; ++j) { sum += std::exp(x[j] - max); }
+  }
+  *row_max = max;
+  *row_sum = sum;
+}
+
+template<typename T>
+T SoftmaxCpuRowDot(const T* a, const T* b, int64_t w) {
+  T sum = 0;
+  FOR_RANGE(int64_t, j, 0, w) { sum += a[j] * b[j]; }
+  return sum;
+}
+
+template<typename T>
+T SoftmaxCpuRowSum(const T* a, int64_t w) {
+  T sum = 0;
+  FOR_RANGE(int64_t, j, 0, w) { sum += a[j]; }
+  return sum;
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_SOFTMAX_CPU_KERNEL_UTIL_H_
@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/softmax_kernel_util.h"
+#include "oneflow/user/kernels/logsoftmax_kernel_util.h"
+#include "oneflow/core/common/cpu_test_util.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+void CheckSoftmax(int64_t n, int64_t w) {
+  const std::vector<double> in = RandomVector<double>(n * w, 1, -20, 30);
+  const std::vector<double> dy = RandomVector<double>(n * w, 2, -20, 30);
+  std::vector<double> prob(n * w);
+  std::vector<double> log_prob(n * w);
+  std::vector<double> log_softmax_prob(n * w);
+  std::vector<double> dx(n * w);
+  std::vector<double> log_softmax_dx(n * w);
+  using Util = SoftmaxKernelUtil<DeviceType::kCPU, double>;
+  using LogUtil = LogSoftmaxKernelUtil<DeviceType::kCPU, double>;
+  ASSERT_EQ(Util::GetComputeProbTempStorageSizeInBytes(n, w), 0);
+  ASSERT_EQ(LogUtil::GetComputeProbTempStorageSizeInBytes(n, w), 0);
+  Util::ComputeProb(nullptr, n, w, in.data(), prob.data(), nullptr, 0);
+  Util::ComputeDiff(nullptr, n, w, dy.data(), prob.data(), dx.data(), nullptr, 0);
+  LogUtil::ComputeOut(nullptr, n, w, in.data(), log_softmax_prob.data(), log_prob.data(), nullptr,
+                      0);
+  LogUtil::ComputeDiff(nullptr, n, w, dy.data(), log_softmax_prob.data(), log_softmax_dx.data(),
+                       nullptr, 0);
+  FOR_RANGE(int64_t, i, 0, n) {
+    const double* row_in = in.data() + i * w;
+    const double* row_dy = dy.data() + i * w;
+    const double max = *std::max_element(row_in, row_in + w);
+    double sum = 0;
+    FOR_RANGE(int64_t, j, 0, w) { sum += std::exp(row_in[j] - max); }
+    std::vector<double> expected_prob(w);
+    double dot = 0;
+    double dy_sum = 0;
+    FOR_RANGE(int64_t, j, 0, w) {
+      expected_prob.at(j) = std::exp(row_in[j] - max) / sum;
+      dot += expected_prob.at(j) * row_dy[j];
+      dy_sum += row_dy[j];
+    }
+    FOR_RANGE(int64_t, j, 0, w) {
+      const int64_t idx = i * w + j;
+      ASSERT_NEAR(prob.at(idx), expected_prob.at(j), 1e-12);
+      ASSERT_NEAR(log_softmax_prob.at(idx), expected_prob.at(j), 1e-12);
+      ASSERT_NEAR(log_prob.at(idx), row_in[j] - max - std::log(sum), 1e-9);
+      ASSERT_NEAR(dx.at(idx), (row_dy[j] - dot) * expected_prob.at(j), 1e-9);
+      ASSERT_NEAR(log_softmax_dx.at(idx), row_dy[j] - expected_prob.at(j) * dy_sum, 1e-9);
+    }
+  }
+}
+
+}  // namespace
+
+class SoftmaxCpuKernelUtilTest : public ThreadPoolTest {};
+
+TEST_F(SoftmaxCpuKernelUtilTest, small_rows) { CheckSoftmax(7, 5); }
+
+TEST_F(SoftmaxCpuKernelUtilTest, blocks_and_tail) { CheckSoftmax(513, 1003); }
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -392,6 +392,7 @@ class StatefulLocalOpKernel final {
                                           const std::shared_ptr<const ArgTuple>& output_arg_tuple);
   ~StatefulLocalOpKernel();
   const Symbol<Device>& device() const { return device_; }
+  const std::string& op_type_name() const { return user_op_conf_->op_type_name(); }
   const std::shared_ptr<MemoryCase>& mem_case() const { return device_->mem_case(); }
   const std::vector<int64_t>& input_tuple_indexes4const_ibns() const {
     return input_tuple_indexes4const_ibns_;
@@ -0,0 +1,76 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_WELFORD_CPU_UTIL_H_
+#define ONEFLOW_USER_KERNELS_WELFORD_CPU_UTIL_H_
+
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+constexpr int64_t kWelfordLaneNum = 8;
+
+// Merges the (count, mean, m2) of another set of values into (*cnt, *mean, *m2), where m2 is the
+// sum of squared differences from the mean.
+template<typename T>
+void WelfordCombine(int64_t b_cnt, T b_mean, T b_m2, int64_t* cnt, T* mean, T* m2) {
+  if (b_cnt == 0) { return; }
+  const int64_t new_cnt = *cnt + b_cnt;
+  const T delta = b_mean - *mean;
+  const T b_ratio = static_cast<T>(b_cnt) / static_cast<T>(new_cnt);
+  *mean += delta * b_ratio;
+  *m2 += b_m2 + delta * delta * static_cast<T>(*cnt) * b_ratio;
+  *cnt = new_cnt;
+}
+
+// Merges the n contiguous values of x into (*cnt, *mean, *m2). Welford runs over
+// kWelfordLaneNum interleaved lanes so the inner loop vectorizes, the lanes are combined at the
+// end.
+template<typename T>
+void WelfordReduce(const T* x, int64_t n, int64_t* cnt, T* mean, T* m2) {
+  T lane_mean[kWelfordLaneNum] = {0};
+  T lane_m2[kWelfordLaneNum] = {0};
+  const int64_t lane_cnt = n / kWelfordLaneNum;
+  for (int64_t step = 0; step < lane_cnt; ++step) {
+    const T* cur_x = x + step * kWelfordLaneNum;
+    const T inv_cnt = static_cast<T>(1) / static_cast<T>(step + 1);
+    for (int64_t lane = 0; lane < kWelfordLaneNum; ++lane) {
+      const T delta = cur_x[lane] - lane_mean[lane];
+      lane_mean[lane] += delta * inv_cnt;
+      lane_m2[lane] += delta * (cur_x[lane] - lane_mean[lane]);
+    }
+  }
+  for (int64_t lane = 0; lane < kWelfordLaneNum; ++lane) {
+    WelfordCombine<T>(lane_cnt, lane_mean[lane], lane_m2[lane], cnt, mean, m2);
+  }
+  for (int64_t i = lane_cnt * kWelfordLaneNum; i < n; ++i) {
+    WelfordCombine<T>(1, x[i], 0, cnt, mean, m2);
+  }
+}
+
+// Returns the biased variance
+template<typename T>
+void WelfordMeanAndVariance(const T* x, int64_t n, T* mean, T* variance) {
+  int64_t cnt = 0;
+  T cur_mean = 0;
+  T cur_m2 = 0;
+  WelfordReduce<T>(x, n, &cnt, &cur_mean, &cur_m2);
+  *mean = cur_mean;
+  *variance = cur_m2 / static_cast<T>(n);
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_WELFORD_CPU_UTIL_H_
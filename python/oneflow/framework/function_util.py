@@ -369,6 +369,18 @@ def set_enable_fuse_cast_scale(func_desc, value=True):
     func_desc.job_config_proto.set_enable_fuse_cast_scale(value)
 
 
+@oneflow_function_config("enable_auto_parallel")
+def set_enable_auto_parallel(func_desc, value=True):
+    """Whether enable auto_parallel.
+            If enabled, search sbp signatures of the whole job with a cost model instead of picking them op by op.
+
+    Args:
+        func_desc ([type]): [description]
+        value ([type]): [description]
+    """
+    func_desc.job_config_proto.set_enable_auto_parallel(value)
+
+
 @oneflow_function_config("cudnn_conv_use_deterministic_algo_only")
 def set_cudnn_conv_use_deterministic_algo_only(func_desc, value):
     """Set value to cudnn conv_use_deterministic_only algorithm
@@ -30,3 +30,24 @@ def ProfilerStart():
 
 def ProfilerStop():
     oneflow._oneflow_internal.profiler.ProfilerStop()
+
+
+def TimelineStart():
+    oneflow._oneflow_internal.profiler.TimelineStart()
+
+
+def TimelineStop():
+    oneflow._oneflow_internal.profiler.TimelineStop()
+
+
+def TimelineClear():
+    oneflow._oneflow_internal.profiler.TimelineClear()
+
+
+def ExportChromeTrace(path):
+    with open(path, "w") as f:
+        f.write(oneflow._oneflow_internal.profiler.TimelineChromeTraceJson())
+
+
+def TimelineSummary():
+    return oneflow._oneflow_internal.profiler.TimelineSummaryTable()
@@ -75,6 +75,27 @@ class GraphConfig(object):
         """
         self.proto.set_enable_fuse_cast_scale(mode)
 
+    def enable_auto_parallel(
+        self,
+        mode: bool = True,
+        computation_cost_ratio: float = None,
+        memory_cost_ratio: float = None,
+    ):
+        """If true, search sbp signatures of the whole graph with a cost model of compute, memory and boxing bytes,
+        instead of picking them op by op.
+
+        Args:
+            mode (bool, optional): [description]. Default is True.
+            computation_cost_ratio (float, optional): weight of the bytes an op reads and writes per rank, relative to the bytes boxing moves per rank.
+            memory_cost_ratio (float, optional): weight of the output bytes an op keeps per rank, relative to the bytes boxing moves per rank.
+        """
+        assert type(mode) is bool
+        self.proto.set_enable_auto_parallel(mode)
+        if computation_cost_ratio is not None:
+            self.proto.set_auto_parallel_computation_cost_ratio(computation_cost_ratio)
+        if memory_cost_ratio is not None:
+            self.proto.set_auto_parallel_memory_cost_ratio(memory_cost_ratio)
+
     def set_gradient_accumulation_steps(self, value):
         """Set num of steps to accumulate gradient.
 
@@ -106,8 +106,8 @@ class _BatchNorm(_NormBase):
         # TODO(zwx): Use `tensor.device_type()` method to help checking if x is on cpu.
         # Using `if x.device == flow.device("cpu"):` will fail as consistent tensor has
         # no device, however using `x.is_cuda` is not a good choice.
-        # TODO: support cpu batch norm kernel
-        if not x.is_cuda:
+        # The normalization kernels need gamma and beta, compose the cpu one without affine
+        if not x.is_cuda and not self.affine:
             reduce_axis = []
             for dim in range(len(x.shape)):
                 if dim != 1:
@@ -13,37 +13,25 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
-from collections import OrderedDict
-
 import oneflow as flow
 from oneflow.ops.builtin_ops import BuiltinOp as builtin_op
 from oneflow.framework.tensor_tuple_util import convert_to_tensor_tuple
 
 
-def allreduce_fn(ddp_state_for_reversed_params, param):
-    def allreduce(grad):
-        ddp_state_for_reversed_params[param][0] = True
-        ret = None
-        for cur_param, (ready, deleted) in ddp_state_for_reversed_params.items():
-            if deleted:
-                continue
-            if ready:
-                ddp_state_for_reversed_params[cur_param][1] = True
-                if cur_param is param:
-                    ret = flow._C.local_all_reduce(grad)
-                else:
-                    cur_param.grad = flow._C.local_all_reduce(cur_param.grad)
-            else:
-                break
-        return ret
-
-    return allreduce
-
-
 def DistributedDataParallel(
-    module: "flow.nn.Module", *, broadcast_buffers: bool = True
+    module: "flow.nn.Module",
+    *,
+    broadcast_buffers: bool = True,
+    bucket_size_mb: float = 25.0,
 ):
-    world_size = flow.env.get_world_size()
+    """Averages the grads of `module`'s parameters over all ranks in backward.
+
+    The grads are packed into buckets of at most `bucket_size_mb` megabytes in the
+    reversed order of `module.parameters()`, and the allreduce of a bucket is launched
+    as soon as all its grads are ready, overlapping with the rest of the backward pass.
+    `module._ddp_reducer.bucket_stats()` gives the size of each bucket in the last
+    backward pass and how long it waited for its grads in microseconds.
+    """
     with flow.no_grad():
         for x in module.parameters():
             requires_grad = x.requires_grad
@@ -52,21 +40,14 @@ def DistributedDataParallel(
             # after flow._C.broadcast
             x.requires_grad_(requires_grad)
 
-    ddp_state_for_reversed_params = OrderedDict(
-        reversed([(x, [False, False]) for x in module.parameters()])
+    params = list(module.parameters())
+    module._ddp_reducer = flow._oneflow_internal.autograd.GradientBucketReducer(
+        convert_to_tensor_tuple(params), max(int(bucket_size_mb * 1024 * 1024), 1)
     )
-    module._ddp_state_for_reversed_params = ddp_state_for_reversed_params
-    for param in module.parameters():
-        param.register_hook(lambda grad: grad / world_size)
-        param.register_hook(allreduce_fn(ddp_state_for_reversed_params, param))
 
     def post_forward_hook(module, input, output):
-        ddp_state_for_reversed_params = module._ddp_state_for_reversed_params
-        for state in ddp_state_for_reversed_params.values():
-            state[0], state[1] = False, False
-        output = flow._C.select_first(
-            convert_to_tensor_tuple([output, *ddp_state_for_reversed_params.keys()])
-        )
+        # makes all parameters get grads and so all buckets get full
+        output = flow._C.select_first(convert_to_tensor_tuple([output, *params]))
         return output
 
     module.register_forward_hook(post_forward_hook)
@@ -13,7 +13,12 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
+from oneflow.framework.profiler import ExportChromeTrace as export_chrome_trace
 from oneflow.framework.profiler import ProfilerStart as profiler_start
 from oneflow.framework.profiler import ProfilerStop as profiler_stop
 from oneflow.framework.profiler import RangePop as range_pop
 from oneflow.framework.profiler import RangePush as range_push
+from oneflow.framework.profiler import TimelineClear as timeline_clear
+from oneflow.framework.profiler import TimelineStart as timeline_start
+from oneflow.framework.profiler import TimelineStop as timeline_stop
+from oneflow.framework.profiler import TimelineSummary as timeline_summary
@@ -0,0 +1,104 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import unittest
+
+import numpy as np
+
+# the actor threads read it once, when the session starts
+os.environ["ONEFLOW_ACTOR_ENABLE_LIGHT_ACTOR"] = "1"
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _np_linear_train(x, weight, bias, iter_num, lr):
+    # sum(x @ w.T + b), plain sgd
+    losses = []
+    for _ in range(iter_num):
+        losses.append(np.sum(x.dot(weight.T) + bias))
+        weight = weight - lr * np.tile(np.sum(x, axis=0), (weight.shape[0], 1))
+        bias = bias - lr * x.shape[0]
+    return losses, weight
+
+
+def _test_light_actor_train_graph(test_case, device):
+    # a train graph runs the tick, device tick and subset tick tasks of the optimizer on LightActor
+    iter_num = 5
+    lr = 0.01
+    np_x = np.random.randn(8, 3).astype(np.float32)
+    np_weight = np.random.randn(4, 3).astype(np.float32)
+    np_bias = np.random.randn(4).astype(np.float32)
+    linear = flow.nn.Linear(3, 4).to(device)
+    linear.weight.copy_(np_weight)
+    linear.bias.copy_(np_bias)
+    of_sgd = flow.optim.SGD(linear.parameters(), lr=lr)
+
+    class LinearTrainGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.linear = linear
+            self.add_optimizer(of_sgd)
+
+        def build(self, x):
+            out = self.linear(x).sum()
+            out.backward()
+            return out
+
+    graph = LinearTrainGraph()
+    x = flow.tensor(np_x, device=device)
+    losses = [graph(x).numpy() for _ in range(iter_num)]
+    np_losses, np_trained_weight = _np_linear_train(
+        np_x, np_weight, np_bias, iter_num, lr
+    )
+    test_case.assertTrue(np.allclose(losses, np_losses, 1e-4, 1e-4))
+    test_case.assertTrue(
+        np.allclose(linear.weight.numpy(), np_trained_weight, 1e-4, 1e-4)
+    )
+
+
+def _test_light_actor_copy_graph(test_case):
+    # copies between host and device run the copy hd tasks on LightActor
+    class CopyGraph(flow.nn.Graph):
+        def build(self, x):
+            y = x.to("cuda")
+            y = flow.relu(y)
+            return y.to("cpu")
+
+    graph = CopyGraph()
+    for shape in [(2, 3), (2, 3), (2, 3)]:
+        np_x = np.random.randn(*shape).astype(np.float32)
+        out = graph(flow.tensor(np_x))
+        test_case.assertEqual(out.device, flow.device("cpu"))
+        test_case.assertTrue(np.array_equal(out.numpy(), np.maximum(np_x, 0)))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphLightActor(oneflow.unittest.TestCase):
+    def test_light_actor_train_graph_cpu(test_case):
+        _test_light_actor_train_graph(test_case, flow.device("cpu"))
+
+    @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+    def test_light_actor_train_graph_gpu(test_case):
+        _test_light_actor_train_graph(test_case, flow.device("cuda"))
+
+    @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+    def test_light_actor_copy_graph(test_case):
+        _test_light_actor_copy_graph(test_case)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -129,6 +129,74 @@ class TestDDP(flow.unittest.TestCase):
         test_case.assertTrue(np_allclose_with_shape(m.w2.grad.numpy(), np.array([4.5])))
         test_case.assertTrue(np_allclose_with_shape(m.w3.grad.numpy(), np.array([3])))
 
+    def test_ddp_with_small_buckets(test_case):
+        class Model(flow.nn.Module):
+            def __init__(self):
+                super().__init__()
+                self.w1 = flow.nn.Parameter(flow.ones(256))
+                self.w2 = flow.nn.Parameter(flow.ones(256))
+                self.w3 = flow.nn.Parameter(flow.ones(512))
+
+            def forward(self, x):
+                x = x * self.w1 * self.w2
+                return x.sum() + self.w3.sum()
+
+        rank = flow.env.get_rank()
+        x = flow.ones(256).to("cuda") * (rank + 1)
+        m = Model().to("cuda")
+        # 2KB buckets: [w3], [w2, w1]
+        m = ddp(m, bucket_size_mb=2.0 / 1024)
+        test_case.assertEqual(m._ddp_reducer.bucket_num, 2)
+        test_case.assertEqual(m._ddp_reducer.param_indices(0), [2])
+        test_case.assertEqual(m._ddp_reducer.param_indices(1), [1, 0])
+        for _ in range(2):
+            for param in m.parameters():
+                param.grad = None
+            m(x).backward()
+            test_case.assertTrue(np.allclose(m.w1.grad.numpy(), np.full(256, 1.5)))
+            test_case.assertTrue(np.allclose(m.w2.grad.numpy(), np.full(256, 1.5)))
+            test_case.assertTrue(np.allclose(m.w3.grad.numpy(), np.ones(512)))
+            stats = m._ddp_reducer.bucket_stats()
+            test_case.assertEqual([s.param_num for s in stats], [1, 2])
+            test_case.assertEqual([s.byte_size for s in stats], [2048, 2048])
+
+    def test_ddp_after_failed_backward(test_case):
+        class Model(flow.nn.Module):
+            def __init__(self):
+                super().__init__()
+                self.w1 = flow.nn.Parameter(flow.ones(256))
+                self.w2 = flow.nn.Parameter(flow.ones(512))
+
+            def forward(self, x):
+                return (x * self.w1).sum() + self.w2.sum() * x[0]
+
+        rank = flow.env.get_rank()
+        x = flow.ones(256).to("cuda") * (rank + 1)
+        m = Model().to("cuda")
+        # 2KB buckets: [w2], [w1]
+        m = ddp(m, bucket_size_mb=2.0 / 1024)
+        hook_calls = []
+
+        def fail_second_grad(grad):
+            hook_calls.append(1)
+            if len(hook_calls) == 2:
+                raise RuntimeError("failed in backward")
+            return grad
+
+        # the reducer has taken the first grad when the backward pass fails
+        m.w1.register_hook(fail_second_grad)
+        m.w2.register_hook(fail_second_grad)
+        with test_case.assertRaises(Exception):
+            m(x).backward()
+        for _ in range(2):
+            for param in m.parameters():
+                param.grad = None
+            m(x).backward()
+            test_case.assertTrue(np.allclose(m.w1.grad.numpy(), np.full(256, 1.5)))
+            test_case.assertTrue(np.allclose(m.w2.grad.numpy(), np.full(512, 1.5)))
+            stats = m._ddp_reducer.bucket_stats()
+            test_case.assertEqual([s.param_num for s in stats], [1, 1])
+
     def test_broadcast_buffer(test_case):
         rank = flow.env.get_rank()
 
@@ -0,0 +1,129 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import os
+
+# read once by the first eager op, so it has to be set before importing oneflow
+os.environ["ONEFLOW_VM_DEFERRED_SUBMIT"] = "1"
+
+import threading
+import time
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _test_op_chain(test_case, device):
+    # more ops than ONEFLOW_VM_DEFERRED_SUBMIT_MAX_BATCH, read back only at the end
+    np_x = np.random.randn(3, 4).astype(np.float32)
+    x = flow.tensor(np_x, device=flow.device(device))
+    np_y = np_x
+    for i in range(200):
+        x = flow.add(x, float(i % 3))
+        np_y = np_y + float(i % 3)
+    test_case.assertTrue(np.allclose(x.numpy(), np_y, 1e-4, 1e-4))
+
+
+def _test_hand_over_to_another_thread(test_case, device):
+    # tensors written by deferred ops are read and released on other threads
+    results = []
+    errors = []
+
+    def consume(x, expected):
+        try:
+            y = flow.mul(x, 2.0)
+            results.append(np.allclose(y.numpy(), expected * 2, 1e-4, 1e-4))
+        except Exception as e:
+            errors.append(e)
+
+    for _ in range(20):
+        np_x = np.random.randn(16, 16).astype(np.float32)
+        x = flow.tensor(np_x, device=flow.device(device))
+        x = flow.add(x, 1.0)
+        thread = threading.Thread(target=consume, args=(x, np_x + 1))
+        del x
+        thread.start()
+        thread.join()
+    test_case.assertEqual(errors, [])
+    test_case.assertEqual(results, [True] * 20)
+
+
+def _test_threads_defer_concurrently(test_case, device):
+    # several issuing threads take the deferred instructions over from each other
+    errors = []
+
+    def run(thread_idx):
+        try:
+            np_x = np.full((8, 8), thread_idx, dtype=np.float32)
+            x = flow.tensor(np_x, device=flow.device(device))
+            for _ in range(100):
+                x = flow.add(x, 1.0)
+            if not np.allclose(x.numpy(), np_x + 100, 1e-4, 1e-4):
+                errors.append(thread_idx)
+        except Exception as e:
+            errors.append(e)
+
+    threads = [threading.Thread(target=run, args=(i,)) for i in range(4)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    test_case.assertEqual(errors, [])
+
+
+def _test_dispatch_overhead(test_case, device):
+    # the same op as test_eager_op_dispatch measures with immediate submission
+    x = flow.tensor(np.ones((2, 2)), dtype=flow.float32, device=flow.device(device))
+    y = flow.tensor(np.ones((2, 2)), dtype=flow.float32, device=flow.device(device))
+    for _ in range(100):
+        out = flow.add(x, y)
+    out.numpy()
+    num_ops = 10000
+    start_t = time.time()
+    for _ in range(num_ops):
+        out = flow.add(x, y)
+    out.numpy()
+    end_t = time.time()
+    print(
+        "{} deferred eager op dispatch: {:.2f} us/op".format(
+            device, (end_t - start_t) * 1e6 / num_ops
+        )
+    )
+    test_case.assertTrue(np.array_equal(out.numpy(), np.full((2, 2), 2.0)))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestEagerDeferredSubmit(flow.unittest.TestCase):
+    def test_eager_deferred_submit(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_fun"] = [
+            _test_op_chain,
+            _test_hand_over_to_another_thread,
+            _test_threads_defer_concurrently,
+            _test_dispatch_overhead,
+        ]
+        arg_dict["device"] = ["cpu", "cuda"]
+        for arg in GenArgList(arg_dict):
+            arg[0](test_case, *arg[1:])
+
+
+if __name__ == "__main__":
+    unittest.main()
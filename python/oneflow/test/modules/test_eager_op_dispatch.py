@@ -0,0 +1,154 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import os
+import threading
+import time
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _test_infer_cache_hit_and_miss(test_case, device):
+    # the same op alternates between hits and misses on shape, dtype and attrs
+    for _ in range(3):
+        for shape in [(2, 3), (4, 5), (2, 3, 4), (2, 3)]:
+            for dtype in [flow.float32, flow.float64]:
+                np_x = np.random.randn(*shape)
+                x = flow.tensor(np_x, dtype=dtype, device=flow.device(device))
+                for dim in range(len(shape)):
+                    of_out = flow.sum(x, dim=dim)
+                    test_case.assertEqual(of_out.dtype, dtype)
+                    test_case.assertEqual(of_out.device, x.device)
+                    test_case.assertTrue(
+                        np.allclose(of_out.numpy(), np.sum(np_x, axis=dim), 1e-4, 1e-4)
+                    )
+
+
+def _test_infer_cache_overflow(test_case, device):
+    # more shapes than ONEFLOW_EAGER_MIRRORED_INFER_CACHE_SIZE evict the oldest entries
+    y = flow.tensor(np.ones((1, 1)), dtype=flow.float32, device=flow.device(device))
+    for n in list(range(1, 1100)) + [1, 7]:
+        np_x = np.random.randn(1, n).astype(np.float32)
+        x = flow.tensor(np_x, device=flow.device(device))
+        of_out = flow.add(x, y)
+        test_case.assertEqual(of_out.shape, flow.Size([1, n]))
+        if n % 100 == 1 or n == 7:
+            test_case.assertTrue(np.allclose(of_out.numpy(), np_x + 1, 1e-4, 1e-4))
+
+
+def _test_infer_cache_threads(test_case, device):
+    # threads share the cache of the op expr, with hits, misses and evictions
+    errors = []
+
+    def run(thread_idx):
+        try:
+            for i in range(200):
+                n = (thread_idx * 200 + i) % 1500 + 1
+                np_x = np.random.randn(2, n).astype(np.float32)
+                x = flow.tensor(np_x, device=flow.device(device))
+                of_out = flow.sum(x, dim=1)
+                if not np.allclose(of_out.numpy(), np.sum(np_x, axis=1), 1e-4, 1e-4):
+                    errors.append((thread_idx, n))
+        except Exception as e:
+            errors.append(e)
+
+    threads = [threading.Thread(target=run, args=(i,)) for i in range(4)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    test_case.assertEqual(errors, [])
+
+
+def _test_inplace_outputs(test_case, device):
+    # inplace outputs keep their tensor on hits and on misses
+    for shape in [(2, 3), (2, 3), (3, 4, 5), (2, 3)]:
+        np_x = np.random.randn(*shape).astype(np.float32)
+        np_y = np.random.randn(*shape).astype(np.float32)
+        x = flow.tensor(np_x, device=flow.device(device))
+        y = flow.tensor(np_y, device=flow.device(device))
+        id_old = id(x)
+        x.add_(y)
+        test_case.assertEqual(id_old, id(x))
+        test_case.assertTrue(np.allclose(x.numpy(), np_x + np_y, 1e-4, 1e-4))
+        of_out = flow.relu(x, inplace=True)
+        test_case.assertEqual(id(of_out), id(x))
+        test_case.assertTrue(
+            np.allclose(x.numpy(), np.maximum(np_x + np_y, 0), 1e-4, 1e-4)
+        )
+
+
+def _test_device_infer_op(test_case, device):
+    # copy infers the output device from its attrs instead of from its inputs
+    dst_devices = ["cpu"]
+    if not os.getenv("ONEFLOW_TEST_CPU_ONLY"):
+        dst_devices.append("cuda")
+    for _ in range(2):
+        for dst_device in dst_devices:
+            for shape in [(2, 3), (4,)]:
+                np_x = np.random.randn(*shape).astype(np.float32)
+                x = flow.tensor(np_x, device=flow.device(device))
+                of_out = flow._C.copy(x, device_type=dst_device, device_id=0)
+                test_case.assertEqual(of_out.device, flow.device(dst_device))
+                test_case.assertTrue(np.array_equal(of_out.numpy(), np_x))
+
+
+def _test_dispatch_overhead(test_case, device):
+    # tiny ops measure the per-op cost of the interpreter rather than of the kernels
+    x = flow.tensor(np.ones((2, 2)), dtype=flow.float32, device=flow.device(device))
+    y = flow.tensor(np.ones((2, 2)), dtype=flow.float32, device=flow.device(device))
+    for _ in range(100):
+        out = flow.add(x, y)
+    out.numpy()
+    num_ops = 10000
+    start_t = time.time()
+    for _ in range(num_ops):
+        out = flow.add(x, y)
+    out.numpy()
+    end_t = time.time()
+    print(
+        "{} eager op dispatch: {:.2f} us/op".format(
+            device, (end_t - start_t) * 1e6 / num_ops
+        )
+    )
+    test_case.assertTrue(np.array_equal(out.numpy(), np.full((2, 2), 2.0)))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestEagerOpDispatch(flow.unittest.TestCase):
+    def test_eager_op_dispatch(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_fun"] = [
+            _test_infer_cache_hit_and_miss,
+            _test_infer_cache_overflow,
+            _test_infer_cache_threads,
+            _test_inplace_outputs,
+            _test_device_infer_op,
+            _test_dispatch_overhead,
+        ]
+        arg_dict["device"] = ["cpu", "cuda"]
+        for arg in GenArgList(arg_dict):
+            arg[0](test_case, *arg[1:])
+
+
+if __name__ == "__main__":
+    unittest.main()
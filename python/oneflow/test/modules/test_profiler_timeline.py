@@ -0,0 +1,79 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import json
+import os
+import tempfile
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _run_relu(num):
+    x = flow.tensor(np.random.randn(4, 5).astype(np.float32))
+    for _ in range(num):
+        y = flow.relu(x)
+    return y.numpy()
+
+
+def _export_trace_events():
+    with tempfile.TemporaryDirectory() as trace_dir:
+        trace_path = os.path.join(trace_dir, "timeline.json")
+        flow.profiler.export_chrome_trace(trace_path)
+        with open(trace_path) as f:
+            return json.load(f)["traceEvents"]
+
+
+def _relu_kernel_events(events):
+    return [e for e in events if e["cat"] == "kernel" and e["name"] == "relu"]
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestProfilerTimeline(flow.unittest.TestCase):
+    def test_eager_kernels_by_op_type(test_case):
+        flow.profiler.timeline_clear()
+        flow.profiler.timeline_start()
+        _run_relu(10)
+        flow.profiler.timeline_stop()
+        events = _export_trace_events()
+        relu_events = _relu_kernel_events(events)
+        test_case.assertEqual(len(relu_events), 10)
+        for e in relu_events:
+            test_case.assertEqual(e["ph"], "X")
+            test_case.assertGreaterEqual(e["dur"], 0)
+        test_case.assertTrue(any(e["cat"] == "instruction" for e in events))
+        summary = flow.profiler.timeline_summary()
+        test_case.assertIn("relu", summary)
+        test_case.assertIn("count", summary.splitlines()[0])
+
+    def test_stop_and_clear(test_case):
+        flow.profiler.timeline_clear()
+        flow.profiler.timeline_start()
+        _run_relu(3)
+        flow.profiler.timeline_stop()
+        # nothing is recorded once the timeline is stopped
+        _run_relu(5)
+        relu_events = _relu_kernel_events(_export_trace_events())
+        test_case.assertEqual(len(relu_events), 3)
+        flow.profiler.timeline_clear()
+        test_case.assertEqual(_export_trace_events(), [])
+
+
+if __name__ == "__main__":
+    unittest.main()